@@ -269,6 +269,57 @@ int mpr_dev_start_polling(mpr_dev device, int block_ms);
  *  \return             Zero if successful, less than zero otherwise. */
 int mpr_dev_stop_polling(mpr_dev device);
 
+/*! Evaluate the expressions of updated outgoing maps in parallel using a pool of worker threads.
+ *  The thread calling `mpr_dev_poll()` or `mpr_dev_update_maps()` also takes part, and the
+ *  resulting messages are bundled on that thread once all maps have been evaluated. This is only
+ *  worthwhile for devices with many maps or computationally expensive expressions.
+ *  \param device       The device to configure.
+ *  \param num_workers  The number of additional threads to use, or `0` to evaluate all maps on
+ *                      the calling thread (the default).
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_dev_set_num_map_workers(mpr_dev device, int num_workers);
+
+/*! Pass map updates to and from devices running in other processes on the same host through
+ *  shared memory instead of the network. This is enabled by default where supported; updates are
+ *  sent over the network if the remote device does not use shared memory.
+ *  \param device       The device to configure.
+ *  \param use          Non-zero to use shared memory, zero to always use the network.
+ *  \return             Zero if successful, less than zero if shared memory is not supported. */
+int mpr_dev_set_use_shm(mpr_dev device, int use);
+
+/*! Set the policy used to send map updates from a device to remote devices. By default updates
+ *  are sent as soon as the device's maps are processed. With a policy in place, the updates queued
+ *  for each linked device are held until they can be sent in a single bundle; while held, a newer
+ *  value for the same signal instance replaces the queued one. Updates between local devices are
+ *  not affected.
+ *  \param device       The device to configure.
+ *  \param max_rate     The maximum number of bundles per second sent to each linked device, or
+ *                      `0` for no limit.
+ *  \param max_latency  The maximum time in seconds that updates may be held in order to coalesce
+ *                      them, or `0` to send them as soon as the rate limit allows.
+ *  \param min_fill     The number of queued updates at which a bundle is sent without waiting
+ *                      for `max_latency` to elapse.
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_dev_set_send_policy(mpr_dev device, float max_rate, float max_latency, int min_fill);
+
+/*! Retrieve counters of the map updates a device has sent to other devices.
+ *  \param device       The device to query.
+ *  \param bundles      Location for the number of bundles sent, or `NULL`.
+ *  \param msgs         Location for the number of messages sent, or `NULL`.
+ *  \param coalesced    Location for the number of updates that were replaced by a newer value
+ *                      before being sent, or `NULL`.
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_dev_get_send_stats(mpr_dev device, uint64_t *bundles, uint64_t *msgs,
+                           uint64_t *coalesced);
+
+/*! Limit the bandwidth used to send signal metadata to new subscribers of a device. A subscriber
+ *  that has already recorded a version of the device is only sent the signals that have changed
+ *  since, and the remaining signals are sent in the background while the device is polled.
+ *  \param device       The device to configure.
+ *  \param bytes_per_sec    The maximum number of bytes per second, or `0` for no limit.
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_dev_set_meta_budget(mpr_dev device, int bytes_per_sec);
+
 /*! Detect whether a device is completely initialized.
  *  \param device       The device to query.
  *  \return             Non-zero if device is completely initialized, i.e., has an allocated
@@ -386,6 +437,16 @@ mpr_dev mpr_sig_get_dev(mpr_sig signal);
  *                      in the enum `mpr_sig_evt` found in `mapper_constants.h` */
 void mpr_sig_set_cb(mpr_sig signal, mpr_sig_handler *handler, int events);
 
+/*! Send the updates of a local signal to remote destinations through a multicast group instead of
+ *  sending a copy through each link. This is useful for signals mapped to many devices, such as a
+ *  shared clock. It applies to maps processed at their destination that use UDP, once the
+ *  destination has joined the group, which happens when maps are established.
+ *  \param signal       The local signal to operate on.
+ *  \param group        The multicast group address, or `NULL` to send updates through each link.
+ *  \param port         The port of the multicast group.
+ *  \return             Zero if successful, non-zero otherwise. */
+int mpr_sig_set_multicast(mpr_sig signal, const char *group, int port);
+
 /**** Signal Instances ****/
 
 /*! @defgroup instances Instances
@@ -686,6 +747,25 @@ int mpr_graph_set_address(mpr_graph graph, const char *group, int port);
  *                      distributed graph. */
 const char *mpr_graph_get_address(mpr_graph graph);
 
+/*! Send and receive signal updates for this graph's devices in batches, reducing the number of
+ *  system calls needed when many links are active. Disabled by default.
+ *  \param graph        The graph to configure.
+ *  \param use          Non-zero to use batched I/O, zero to send and receive one datagram at a time.
+ *  \return             Zero if successful, less than zero if batched I/O is not supported or the
+ *                      graph is currently being polled. */
+int mpr_graph_set_use_batch_io(mpr_graph graph, int use);
+
+/*! Use an event-driven engine for polling this graph. Sockets are watched for readiness and
+ *  housekeeping is scheduled on timers, so that polling sleeps until a message arrives, an update
+ *  is queued, or housekeeping is due, rather than waking at a fixed interval. A polling thread
+ *  started with `mpr_graph_start_polling()` then ignores its `block_ms` argument. Disabled by
+ *  default.
+ *  \param graph        The graph to configure.
+ *  \param use          Non-zero to use event-driven polling.
+ *  \return             Zero if successful, less than zero if event-driven polling is not
+ *                      supported or the graph is currently being polled. */
+int mpr_graph_set_use_epoll(mpr_graph graph, int use);
+
 /*! Synchronize a local graph copy with the distributed graph.
  *  \param graph        The graph to update.
  *  \param block_ms     Number of milliseconds to block waiting for messages, or `0` for
@@ -706,6 +786,32 @@ int mpr_graph_start_polling(mpr_graph graph, int block_ms);
  *  \return             Zero if successful, less than zero otherwise. */
 int mpr_graph_stop_polling(mpr_graph graph);
 
+/*! Retrieve the file descriptors used by a graph, so that it can be driven from an external event
+ *  loop instead of `mpr_graph_poll()`. When any of them is readable, or the timeout returned by
+ *  `mpr_graph_get_timeout()` has elapsed, `mpr_graph_process_fds()` should be called. The set of
+ *  descriptors changes when local devices are added or removed, so it should be retrieved again
+ *  after each call to `mpr_graph_process_fds()`.
+ *  \param graph        The graph to query.
+ *  \param fds          An array to fill with file descriptors.
+ *  \param size         The number of elements in the array.
+ *  \return             The number of file descriptors, which may be larger than `size`. */
+int mpr_graph_get_fds(mpr_graph graph, int *fds, int size);
+
+/*! Retrieve the time until a graph next needs processing by `mpr_graph_process_fds()` if none of
+ *  its file descriptors become readable. The timeout depends on housekeeping deadlines if
+ *  event-driven polling has been enabled using `mpr_graph_set_use_epoll()`, and is otherwise
+ *  fixed at 100 milliseconds.
+ *  \param graph        The graph to query.
+ *  \return             The timeout in milliseconds, or `-1` if there is no deadline. */
+int mpr_graph_get_timeout(mpr_graph graph);
+
+/*! Handle all messages waiting on a graph's file descriptors and run any housekeeping that is due,
+ *  without blocking. This should not be called while a polling thread started with
+ *  `mpr_graph_start_polling()` is running.
+ *  \param graph        The graph to update.
+ *  \return             The number of handled messages. */
+int mpr_graph_process_fds(mpr_graph graph);
+
 /*! Free a graph.
  *  \param graph        The graph to free. */
 void mpr_graph_free(mpr_graph graph);
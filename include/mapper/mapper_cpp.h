@@ -1279,6 +1279,14 @@ namespace mapper {
             RETURN_SELF
         }
 
+        /*! Send updates to remote destinations through a multicast group instead of through
+         *  each link.
+         *  \param group    The multicast group address, or `NULL` to stop using multicast.
+         *  \param port     The port of the multicast group.
+         *  \return         Self. */
+        Signal& set_multicast(const char *group, int port = 0)
+            { mpr_sig_set_multicast(_obj, group, port); RETURN_SELF }
+
         /*! Activate and return a new Instance with an automatically-generated id.
          *  \return         The new Instance. */
         Instance instance()
@@ -1712,6 +1720,33 @@ namespace mapper {
         Device& stop()
             { mpr_dev_stop_polling(_obj); RETURN_SELF }
 
+        /*! Evaluate updated outgoing maps in parallel using a pool of worker threads.
+         *  \param num_workers The number of additional threads to use, or 0 to disable.
+         *  \return            Self. */
+        Device& set_num_map_workers(int num_workers)
+            { mpr_dev_set_num_map_workers(_obj, num_workers); RETURN_SELF }
+
+        /*! Pass map updates to and from devices on the same host through shared memory.
+         *  \param use         True to use shared memory, false to always use the network.
+         *  \return            Self. */
+        Device& set_use_shm(bool use)
+            { mpr_dev_set_use_shm(_obj, use); RETURN_SELF }
+
+        /*! Limit the rate at which map updates are sent to remote devices, coalescing updates
+         *  for the same signal instance while they are held.
+         *  \param max_rate    The maximum number of bundles per second, or 0 for no limit.
+         *  \param max_latency The maximum time in seconds that updates may be held.
+         *  \param min_fill    The number of updates at which a bundle is sent early.
+         *  \return            Self. */
+        Device& set_send_policy(float max_rate, float max_latency = 0, int min_fill = 0)
+            { mpr_dev_set_send_policy(_obj, max_rate, max_latency, min_fill); RETURN_SELF }
+
+        /*! Limit the bandwidth used to send signal metadata to new subscribers.
+         *  \param bytes_per_sec  The maximum number of bytes per second, or 0 for no limit.
+         *  \return            Self. */
+        Device& set_meta_budget(int bytes_per_sec)
+            { mpr_dev_set_meta_budget(_obj, bytes_per_sec); RETURN_SELF }
+
         /*! Detect whether a device is completely initialized.
          *  \return         Non-zero if device is completely initialized, i.e., has an allocated
          *                  receiving port and unique identifier. Zero otherwise. */
@@ -1917,6 +1952,18 @@ namespace mapper {
         std::string address() const
             { return std::string(mpr_graph_get_address(_obj)); }
 
+        /*! Send and receive signal updates in batches to reduce the number of system calls.
+         *  \param use      True to use batched I/O.
+         *  \return         Self. */
+        Graph& set_use_batch_io(bool use)
+            { mpr_graph_set_use_batch_io(_obj, use); RETURN_SELF }
+
+        /*! Poll using an event-driven engine that sleeps until there is work to do.
+         *  \param use      True to use event-driven polling.
+         *  \return         Self. */
+        Graph& set_use_epoll(bool use)
+            { mpr_graph_set_use_epoll(_obj, use); RETURN_SELF }
+
         /*! Synchronize a Graph object with the distributed graph.
          *  \param block_ms The number of milliseconds to block, or 0 for non-blocking behavior.
          *  \return         The number of handled messages. */
@@ -1935,6 +1982,24 @@ namespace mapper {
         Graph& stop()
             { mpr_graph_stop_polling(_obj); RETURN_SELF }
 
+        /*! Retrieve the file descriptors to watch when driving this Graph from an external event
+         *  loop.
+         *  \param fds      An array to fill with file descriptors.
+         *  \param size     The number of elements in the array.
+         *  \return         The number of file descriptors, which may be larger than size. */
+        int fds(int *fds, int size) const
+            { return mpr_graph_get_fds(_obj, fds, size); }
+
+        /*! Retrieve the time until this Graph next needs processing.
+         *  \return         The timeout in milliseconds, or -1 if there is no deadline. */
+        int timeout() const
+            { return mpr_graph_get_timeout(_obj); }
+
+        /*! Handle messages waiting on this Graph's file descriptors without blocking.
+         *  \return         The number of handled messages. */
+        int process_fds()
+            { return mpr_graph_process_fds(_obj); }
+
         // subscriptions
         /*! Subscribe to information about a specific Device.
          *  \param dev      The Device of interest.
@@ -0,0 +1,131 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "util/mpr_debug.h"
+
+#define CLASS_ALIGN     16          /* must be a power of two */
+#define NUM_CLASSES     256         /* allocations up to 4kB are served from blocks */
+#define MAX_CLASS_SIZE  (CLASS_ALIGN * NUM_CLASSES)
+#define MIN_BLOCK_SIZE  16384
+#define MAX_BLOCK_SIZE  1048576
+
+/* The size class of an allocation, and the number of bytes reserved for each member of a class. */
+#define SIZE_CLASS(S) (((S) - 1) / CLASS_ALIGN)
+#define CLASS_SIZE(C) (((C) + 1) * CLASS_ALIGN)
+
+/* A freed allocation stores a pointer to the next member of its freelist. */
+typedef struct _mpr_arena_item {
+    struct _mpr_arena_item *next;
+} *mpr_arena_item;
+
+typedef struct _mpr_arena_block {
+    struct _mpr_arena_block *next;
+    size_t size;
+    size_t used;
+} *mpr_arena_block;
+
+/* Pad the block header so that allocations keep the alignment of the block itself. */
+#define BLOCK_HEADER_SIZE \
+    ((sizeof(struct _mpr_arena_block) + CLASS_ALIGN - 1) & ~(size_t)(CLASS_ALIGN - 1))
+
+typedef struct _mpr_arena {
+    mpr_arena_block blocks;         /*!< Blocks in use, the most recent first. */
+    mpr_arena_item free[NUM_CLASSES];
+    size_t block_size;              /*!< The size of the next block, doubling up to a limit. */
+} mpr_arena_t;
+
+mpr_arena mpr_arena_new(void)
+{
+    mpr_arena arena = (mpr_arena)calloc(1, sizeof(mpr_arena_t));
+    RETURN_ARG_UNLESS(arena, 0);
+    arena->block_size = MIN_BLOCK_SIZE;
+    return arena;
+}
+
+void mpr_arena_free(mpr_arena arena)
+{
+    RETURN_UNLESS(arena);
+    while (arena->blocks) {
+        mpr_arena_block block = arena->blocks;
+        arena->blocks = block->next;
+        free(block);
+    }
+    free(arena);
+}
+
+/* Carve new memory for a size class out of the most recent block, adding a block if needed. */
+static void *carve(mpr_arena arena, size_t size)
+{
+    mpr_arena_block block = arena->blocks;
+    void *mem;
+    if (!block || block->used + size > block->size) {
+        block = (mpr_arena_block)malloc(BLOCK_HEADER_SIZE + arena->block_size);
+        RETURN_ARG_UNLESS(block, 0);
+        block->size = arena->block_size;
+        block->used = 0;
+        block->next = arena->blocks;
+        arena->blocks = block;
+        if (arena->block_size < MAX_BLOCK_SIZE)
+            arena->block_size *= 2;
+    }
+    mem = (char*)block + BLOCK_HEADER_SIZE + block->used;
+    block->used += size;
+    return mem;
+}
+
+void *mpr_arena_alloc(mpr_arena arena, size_t size)
+{
+    int cls;
+    void *mem;
+    RETURN_ARG_UNLESS(size, 0);
+    if (!arena || size > MAX_CLASS_SIZE)
+        return calloc(1, size);
+
+    cls = SIZE_CLASS(size);
+    if (arena->free[cls]) {
+        mem = arena->free[cls];
+        arena->free[cls] = arena->free[cls]->next;
+    }
+    else if (!(mem = carve(arena, CLASS_SIZE(cls))))
+        return 0;
+    memset(mem, 0, size);
+    return mem;
+}
+
+void *mpr_arena_realloc(mpr_arena arena, void *mem, size_t old_size, size_t new_size)
+{
+    void *new_mem;
+    if (!mem)
+        return mpr_arena_alloc(arena, new_size);
+    if (!arena || (old_size > MAX_CLASS_SIZE && new_size > MAX_CLASS_SIZE)) {
+        new_mem = realloc(mem, new_size);
+        if (new_mem && new_size > old_size)
+            memset((char*)new_mem + old_size, 0, new_size - old_size);
+        return new_mem;
+    }
+    if (   old_size <= MAX_CLASS_SIZE && new_size <= MAX_CLASS_SIZE
+        && SIZE_CLASS(old_size) == SIZE_CLASS(new_size)) {
+        /* the existing memory already has room */
+        if (new_size > old_size)
+            memset((char*)mem + old_size, 0, new_size - old_size);
+        return mem;
+    }
+    RETURN_ARG_UNLESS(new_mem = mpr_arena_alloc(arena, new_size), 0);
+    memcpy(new_mem, mem, old_size < new_size ? old_size : new_size);
+    mpr_arena_release(arena, mem, old_size);
+    return new_mem;
+}
+
+void mpr_arena_release(mpr_arena arena, void *mem, size_t size)
+{
+    mpr_arena_item item;
+    RETURN_UNLESS(mem);
+    if (!arena || size > MAX_CLASS_SIZE) {
+        free(mem);
+        return;
+    }
+    item = (mpr_arena_item)mem;
+    item->next = arena->free[SIZE_CLASS(size)];
+    arena->free[SIZE_CLASS(size)] = item;
+}
@@ -0,0 +1,43 @@
+
+#ifndef __MPR_ARENA_H__
+#define __MPR_ARENA_H__
+
+#include <stddef.h>
+
+/*! A graph-scoped memory arena. Small allocations are carved out of large blocks and sorted into
+ *  size classes; released memory is kept on a freelist for its class and reused by the next
+ *  allocation of a similar size. All of the blocks are returned to the system at once when the
+ *  arena is freed, so tearing down a large graph does not need to visit each allocation.
+ *  Allocations larger than the biggest size class, and all allocations made with a null arena,
+ *  are passed through to the system allocator. The caller must supply the size of an allocation
+ *  when releasing it. */
+typedef struct _mpr_arena *mpr_arena;
+
+/*! Create a new memory arena.
+ *  \return             The new arena. */
+mpr_arena mpr_arena_new(void);
+
+/*! Free a memory arena and all of the memory allocated from it. */
+void mpr_arena_free(mpr_arena arena);
+
+/*! Allocate zeroed memory from an arena.
+ *  \param arena        The arena to allocate from, or zero to use the system allocator.
+ *  \param size         The number of bytes to allocate.
+ *  \return             The allocated memory, or zero on failure. */
+void *mpr_arena_alloc(mpr_arena arena, size_t size);
+
+/*! Change the size of memory allocated from an arena. Any additional memory is zeroed.
+ *  \param arena        The arena that the memory was allocated from.
+ *  \param mem          The memory to resize, or zero to allocate new memory.
+ *  \param old_size     The size that the memory was allocated with.
+ *  \param new_size     The new size of the memory.
+ *  \return             The resized memory, or zero on failure. */
+void *mpr_arena_realloc(mpr_arena arena, void *mem, size_t old_size, size_t new_size);
+
+/*! Return memory to an arena for reuse.
+ *  \param arena        The arena that the memory was allocated from.
+ *  \param mem          The memory to release.
+ *  \param size         The size that the memory was allocated with. */
+void mpr_arena_release(mpr_arena arena, void *mem, size_t size);
+
+#endif /* __MPR_ARENA_H__ */
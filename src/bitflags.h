@@ -1,35 +1,70 @@
-
 #ifndef __MPR_BITFLAGS_H__
 #define __MPR_BITFLAGS_H__
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include "util/mpr_inline.h"
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 typedef char *mpr_bitflags;
 
-/* A mpr_bitflags object consists of a char array with at least num_flags bits.
- * The bit 0 is used to indicate whether all bits are set.
- * Bits 1–7 are used to store the length of the bitflag array.
+/* A mpr_bitflags object consists of a 32-bit header followed by a char array with at least
+ * num_flags bits. Bit 0 of the header is used to indicate whether all bits are set and the
+ * remaining bits store the length of the bitflag array. The header is accessed with memcpy()
+ * since bitflags may be embedded at any offset in a buffer of queued updates.
  * On allocation any extra bits are set to 1 for efficient comparison. */
 
+#define MPR_BITFLAGS_HEADER_SIZE 4
+
+/* The number of bytes needed to store a given number of bitflags. */
+#define MPR_BITFLAGS_SIZE(num_flags) (((num_flags) - 1) / 8 + 1 + MPR_BITFLAGS_HEADER_SIZE)
+
+#define BITFLAGS_DATA(B) ((unsigned char*)(B) + MPR_BITFLAGS_HEADER_SIZE)
+
+MPR_INLINE static uint32_t _get_header(mpr_bitflags bitflags)
+{
+    uint32_t header;
+    memcpy(&header, bitflags, sizeof(uint32_t));
+    return header;
+}
+
+MPR_INLINE static void _set_header(mpr_bitflags bitflags, uint32_t header)
+{
+    memcpy(bitflags, &header, sizeof(uint32_t));
+}
+
+MPR_INLINE static unsigned int mpr_bitflags_get_num(mpr_bitflags bitflags)
+{
+    return _get_header(bitflags) >> 1;
+}
+
+/* Initialise bitflags in memory provided by the caller, which must be at least
+ * MPR_BITFLAGS_SIZE(num_flags) bytes long. */
+MPR_INLINE static void mpr_bitflags_init(mpr_bitflags bitflags, unsigned int num_flags)
+{
+    memset(BITFLAGS_DATA(bitflags), 0, (num_flags - 1) / 8 + 1);
+    if (num_flags % 8) {
+        /* set extraneous bits to one */
+        BITFLAGS_DATA(bitflags)[(num_flags - 1) / 8] |= 255 << (num_flags % 8);
+    }
+    _set_header(bitflags, num_flags << 1);
+}
+
 MPR_INLINE static mpr_bitflags mpr_bitflags_new(unsigned int num_flags)
 {
     mpr_bitflags bitflags;
     if (!num_flags)
         return 0;
-    /* allocate an extra byte for length prefix */
-    unsigned int num_bytes = (num_flags - 1) / 8 + 2;
-    assert(num_flags < 128);
-    bitflags = calloc(1, num_bytes);
-    if (num_flags % 8) {
-        /* set extraneous bits to one */
-        bitflags[num_bytes - 1] |= 255 << (num_flags % 8);
-    }
-    bitflags[0] = num_flags << 1;
+    assert(num_flags < (1u << 31));
+    bitflags = malloc(MPR_BITFLAGS_SIZE(num_flags));
+    mpr_bitflags_init(bitflags, num_flags);
     return bitflags;
 }
 
@@ -42,22 +77,23 @@ MPR_INLINE static void mpr_bitflags_free(mpr_bitflags bitflags)
 MPR_INLINE static mpr_bitflags mpr_bitflags_realloc(mpr_bitflags bitflags,
                                                     unsigned int new_num_flags)
 {
-    unsigned int old_num_flags = bitflags[0] >> 1;
-    unsigned int old_num_bytes = (old_num_flags - 1) / 8 + 2;
+    uint32_t header = _get_header(bitflags);
+    unsigned int old_num_flags = header >> 1;
 
     if (new_num_flags < old_num_flags) {
-        char all_set = bitflags[0] & 0x01;
-        unsigned int new_num_bytes = (new_num_flags - 1) / 8 + 2;
-        if (new_num_bytes < old_num_bytes)
-            bitflags = realloc(bitflags, new_num_bytes);
-        bitflags[0] = (new_num_flags << 1) | all_set;
+        bitflags = realloc(bitflags, MPR_BITFLAGS_SIZE(new_num_flags));
+        _set_header(bitflags, (new_num_flags << 1) | (header & 0x01));
     }
-    else if (new_num_flags > (bitflags[0] >> 1)) {
+    else if (new_num_flags > old_num_flags) {
         mpr_bitflags new_bitflags = mpr_bitflags_new(new_num_flags);
-        int i = old_num_bytes - 1;
-        new_bitflags[i] |= (bitflags[i] & (255 >> (8 - (old_num_flags % 8))));
-        while (--i)
-            new_bitflags[i] = bitflags[i];
+        unsigned int last = (old_num_flags - 1) / 8;
+        unsigned char *dst = BITFLAGS_DATA(new_bitflags), *src = BITFLAGS_DATA(bitflags);
+        memcpy(dst, src, last);
+        /* copy only the bits in use from the last byte */
+        if (old_num_flags % 8)
+            dst[last] |= src[last] & (255 >> (8 - old_num_flags % 8));
+        else
+            dst[last] = src[last];
         /* leave all_set flag at zero since new flags have not been set */
         free(bitflags);
         bitflags = new_bitflags;
@@ -67,67 +103,114 @@ MPR_INLINE static mpr_bitflags mpr_bitflags_realloc(mpr_bitflags bitflags,
 
 MPR_INLINE static void mpr_bitflags_set(mpr_bitflags bitflags, unsigned int idx)
 {
-    bitflags[idx / 8 + 1] |= (1 << (idx % 8));
+    BITFLAGS_DATA(bitflags)[idx / 8] |= (1 << (idx % 8));
 }
 
 MPR_INLINE static void mpr_bitflags_set_all(mpr_bitflags bitflags)
 {
-    memset(bitflags + 1, 255, ((bitflags[0] >> 1) - 1) / 8 + 1);
-    bitflags[0] |= 0x01;
+    uint32_t header = _get_header(bitflags);
+    memset(BITFLAGS_DATA(bitflags), 255, ((header >> 1) - 1) / 8 + 1);
+    _set_header(bitflags, header | 0x01);
 }
 
 MPR_INLINE static int mpr_bitflags_get_all(mpr_bitflags bitflags)
 {
-    if (bitflags[0] & 0x01)
+    uint32_t header = _get_header(bitflags);
+    if (header & 0x01)
         return 1;
     else {
-        unsigned int i, num_bytes = ((bitflags[0] >> 1) - 1) / 8 + 2;
-        for (i = 1; i < num_bytes; i++) {
-            if (bitflags[i] != (char)0xFF)
+        unsigned int i, num_bytes = ((header >> 1) - 1) / 8 + 1;
+        for (i = 0; i < num_bytes; i++) {
+            if (BITFLAGS_DATA(bitflags)[i] != 0xFF)
                 return 0;
         }
-        bitflags[0] |= 0x01;
+        _set_header(bitflags, header | 0x01);
         return 1;
     }
 }
 
 MPR_INLINE static void mpr_bitflags_unset(mpr_bitflags bitflags, unsigned int idx)
 {
-    bitflags[idx / 8 + 1] &= (0xFF ^ (1 << (idx % 8)));
-    bitflags[0] &= ~0x01;
+    BITFLAGS_DATA(bitflags)[idx / 8] &= (0xFF ^ (1 << (idx % 8)));
+    _set_header(bitflags, _get_header(bitflags) & ~0x01);
 }
 
 MPR_INLINE static int mpr_bitflags_get(mpr_bitflags bitflags, unsigned int idx)
 {
-    return bitflags[idx / 8 + 1] & (1 << (idx % 8));
+    return BITFLAGS_DATA(bitflags)[idx / 8] & (1 << (idx % 8));
+}
+
+/* Return the index of the lowest set flag at or above idx, or -1 if there is none. The flags are
+ * scanned a 64-bit word at a time so that sparse updates of many instances can be found quickly. */
+MPR_INLINE static int mpr_bitflags_get_next(mpr_bitflags bitflags, unsigned int idx)
+{
+    unsigned int num_flags = mpr_bitflags_get_num(bitflags);
+    unsigned int num_bytes = (num_flags - 1) / 8 + 1, pos = idx / 8 & ~7u;
+    const unsigned char *flags = BITFLAGS_DATA(bitflags);
+    uint64_t word;
+    if (idx >= num_flags)
+        return -1;
+
+    while (pos < num_bytes) {
+        if (num_bytes - pos >= 8) {
+            memcpy(&word, flags + pos, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            word = __builtin_bswap64(word);
+#endif
+        }
+        else {
+            unsigned int i;
+            word = 0;
+            for (i = 0; i < num_bytes - pos; i++)
+                word |= (uint64_t)flags[pos + i] << (i * 8);
+        }
+        if (pos * 8 < idx)
+            word &= ~(uint64_t)0 << (idx - pos * 8);
+        if (word) {
+#ifdef _MSC_VER
+            unsigned long bit;
+            _BitScanForward64(&bit, word);
+#else
+            unsigned int bit = __builtin_ctzll(word);
+#endif
+            idx = pos * 8 + bit;
+            return idx < num_flags ? (int)idx : -1;
+        }
+        pos += 8;
+    }
+    return -1;
 }
 
 MPR_INLINE static int mpr_bitflags_compare(mpr_bitflags l, mpr_bitflags r)
 {
-    return (l[0] != r[0]) || memcmp(l, r, ((l[0] >> 1) - 1) / 8 + 2);
+    uint32_t header = _get_header(l);
+    return (header != _get_header(r)) || memcmp(l, r, MPR_BITFLAGS_SIZE(header >> 1));
 }
 
 MPR_INLINE static void mpr_bitflags_clear(mpr_bitflags bitflags)
 {
-    unsigned int num_flags = bitflags[0] >> 1;
-    unsigned int num_bytes = (num_flags - 1) / 8 + 1;
-    memset(bitflags + 1, 0, num_bytes);
-    if (num_flags % 8) {
-        /* set extraneous bits to one */
-        bitflags[num_bytes] |= 255 << (num_flags % 8);
-    }
-    bitflags[0] &= ~0x01;
+    mpr_bitflags_init(bitflags, mpr_bitflags_get_num(bitflags));
+}
+
+/* Set all the flags in dst that are set in src. Both must have the same number of flags. */
+MPR_INLINE static void mpr_bitflags_or(mpr_bitflags dst, mpr_bitflags src)
+{
+    uint32_t header = _get_header(dst);
+    unsigned int i, num_bytes = ((header >> 1) - 1) / 8 + 1;
+    for (i = 0; i < num_bytes; i++)
+        BITFLAGS_DATA(dst)[i] |= BITFLAGS_DATA(src)[i];
+    _set_header(dst, header | (_get_header(src) & 0x01));
 }
 
 MPR_INLINE static void mpr_bitflags_cpy(mpr_bitflags dst, mpr_bitflags src)
 {
     /* TODO: check whether sizes match? */
-    memcpy(dst, src, ((src[0] >> 1) - 1) / 8 + 2);
+    memcpy(dst, src, MPR_BITFLAGS_SIZE(mpr_bitflags_get_num(src)));
 }
 
 MPR_INLINE static void mpr_bitflags_print(mpr_bitflags bitflags)
 {
-    unsigned int i, num_flags = bitflags[0] >> 1;
+    unsigned int i, num_flags = mpr_bitflags_get_num(bitflags);
     printf("%d:[", num_flags);
     for (i = 0; i < num_flags; i++)
         printf("%d", mpr_bitflags_get(bitflags, i) ? 1 : 0);
@@ -136,8 +219,10 @@ MPR_INLINE static void mpr_bitflags_print(mpr_bitflags bitflags)
     for (; i < num_flags; i++)
         printf("%d", mpr_bitflags_get(bitflags, i) ? 1 : 0);
     printf("]");
-    if (bitflags[0] & 0x01)
+    if (_get_header(bitflags) & 0x01)
         printf("*");
 }
 
+#undef BITFLAGS_DATA
+
 #endif /* __MPR_BITFLAGS_H__ */
@@ -15,6 +15,7 @@
 #include "graph.h"
 #include "map.h"
 #include "path.h"
+#include "shm_ring.h"
 #include "table.h"
 
 #include "util/mpr_debug.h"
@@ -22,11 +23,50 @@
 #include "config.h"
 #include <mapper/mapper.h>
 
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+
 extern const char* net_msg_strings[NUM_MSG_STRINGS];
 
+/*! An open-addressed hash table of signals keyed by name, using linear probing. */
+typedef struct _mpr_sig_idx {
+    mpr_sig *sigs;      /*!< Buckets, or zero for empty buckets. */
+    int num;            /*!< Number of indexed signals. */
+    int size;           /*!< Number of buckets, always zero or a power of two. */
+} mpr_sig_idx_t, *mpr_sig_idx;
+
+/*! An open-addressed hash table of active instance id maps keyed by either LID or GID. Each
+ *  bucket holds the most recently added id map for its key, which is chained to older id maps
+ *  sharing the same key. */
+typedef struct _mpr_id_map_idx {
+    mpr_id_map *heads;  /*!< Buckets, or zero for empty buckets. */
+    int num;            /*!< Number of distinct keys. */
+    int size;           /*!< Number of buckets, always zero or a power of two. */
+} mpr_id_map_idx_t, *mpr_id_map_idx;
+
+/*! The active instance id maps for one signal group. */
+typedef struct _mpr_id_map_group {
+    mpr_id_map list;            /*!< Active id maps, most recently added first. */
+    mpr_id_map_idx_t by_LID;    /*!< Active id maps indexed by LID. */
+    mpr_id_map_idx_t by_GID;    /*!< Active id maps indexed by GID. */
+} mpr_id_map_group_t, *mpr_id_map_group;
+
+/*! A block of instance id maps allocated together. */
+typedef struct _mpr_id_map_block {
+    struct _mpr_id_map_block *next;
+    int size;
+    int used;
+    mpr_id_map_t id_maps[];
+} mpr_id_map_block_t, *mpr_id_map_block;
+
+#define ID_MAP_BLOCK_MIN_SIZE 8
+#define ID_MAP_BLOCK_MAX_SIZE 256
+
 #define MPR_DEV_STRUCT_ITEMS                                            \
     mpr_obj_t obj;      /* always first for type punning */             \
     mpr_dev *linked;                                                    \
+    mpr_sig_idx_t sig_idx;  /*!< Signals indexed by name. */            \
     char *name;         /*!< The full name for this device, or zero. */ \
     mpr_time synced;    /*!< Timestamp of last sync. */                 \
     double clk_offset;  /*!< Clock offset in seconds */                 \
@@ -47,10 +87,27 @@ struct _mpr_dev {
 typedef struct _mpr_subscriber {
     struct _mpr_subscriber *next;
     lo_address addr;
+    mpr_udp_dest dest;          /*!< Resolved address for sending serialised bundles. */
+    struct {
+        mpr_sig *sigs;          /*!< Entries are zeroed if a signal is removed. */
+        int num;
+        int size;
+        int idx;                /*!< Index of the next signal to send. */
+    } pending;                  /*!< Signals waiting to be sent within the metadata budget. */
     uint32_t lease_exp;
     int flags;
 } mpr_subscriber_t, *mpr_subscriber;
 
+#define SUBSCRIBER_FANOUT_SIZE 32   /* Subscribers sent to with each batch of datagrams. */
+#define META_BUDGET_MAX_BURST 0.5   /* Seconds of the metadata budget that may be sent at once. */
+
+/*! A list of maps waiting to be processed by a local device. */
+typedef struct _mpr_map_queue {
+    mpr_local_map *maps;        /*!< Queued maps; entries are zeroed if a map is freed. */
+    int num;
+    int size;
+} mpr_map_queue_t, *mpr_map_queue;
+
 /*! Allocated resources */
 typedef struct _mpr_allocated_t {
     double count_time;          /*!< The last time collision count was updated. */
@@ -71,10 +128,15 @@ struct _mpr_local_dev {
     mpr_subscriber subscribers;         /*!< Linked-list of subscribed peers. */
 
     struct {
-        struct _mpr_id_map **active;    /*!< The list of active instance id maps. */
+        mpr_id_map_group active;        /*!< Active instance id maps per signal group. */
         struct _mpr_id_map *reserve;    /*!< The list of reserve instance id maps. */
+        mpr_id_map_block blocks;        /*!< Storage for all instance id maps. */
     } id_maps;
 
+    mpr_map_queue_t maps_in;            /*!< Maps with pending incoming updates. */
+    mpr_map_queue_t maps_out;           /*!< Maps with pending outgoing updates or messages. */
+    struct _mpr_map_workers *map_workers;   /*!< Optional threads for evaluating maps. */
+
     mpr_time time;
     int num_sig_groups;
     uint8_t time_is_stale;
@@ -82,11 +144,27 @@ struct _mpr_local_dev {
     uint8_t sending;
     uint8_t receiving;
     uint8_t own_graph;
+    uint8_t use_shm;                    /*!< Use shared memory for devices on the same host. */
+
+    mpr_send_policy_t send_policy;      /*!< Policy for sending updates to remote devices. */
+    struct {
+        uint64_t bundles;
+        uint64_t msgs;
+        uint64_t coalesced;
+    } send_stats;
+
+    struct {
+        double rate;                    /*!< Bytes per second, or zero for no limit. */
+        double credit;                  /*!< Bytes that may be sent before waiting. */
+        double time;                    /*!< Time at which the credit was last updated. */
+    } meta_budget;                      /*!< Budget for bringing subscribers up to date. */
 } mpr_local_dev_t;
 
 /* prototypes */
 static int process_outgoing_maps(mpr_local_dev dev);
+static void free_subscriber(mpr_subscriber sub);
 static int check_registration(mpr_local_dev dev);
+static void free_map_workers(struct _mpr_map_workers *workers);
 
 mpr_time ts = {0,1};
 
@@ -118,6 +196,7 @@ static int cmp_qry_sigs(const void *context_data, mpr_sig sig)
 
 void mpr_dev_init(mpr_dev dev, int is_local, const char *name, mpr_id id)
 {
+    mpr_graph g = dev->obj.graph;
     mpr_tbl tbl;
     mpr_list qry;
 
@@ -125,16 +204,16 @@ void mpr_dev_init(mpr_dev dev, int is_local, const char *name, mpr_id id)
     dev->obj.status = 0;
     if (name) {
         assert(!dev->name);
-        dev->name = strdup(name);
+        dev->name = (char*)mpr_strtab_add(mpr_graph_get_strtab(g), name);
     }
     if (id) {
         assert(!dev->obj.id);
         dev->obj.id = id;
     }
 
-    dev->obj.props.synced = mpr_tbl_new();
+    dev->obj.props.synced = mpr_tbl_new(mpr_graph_get_arena(g), mpr_graph_get_strtab(g));
     if (!is_local)
-        dev->obj.props.staged = mpr_tbl_new();
+        dev->obj.props.staged = mpr_tbl_new(mpr_graph_get_arena(g), mpr_graph_get_strtab(g));
     tbl = dev->obj.props.synced;
 
     /* these properties need to be added in alphabetical order */
@@ -144,7 +223,7 @@ void mpr_dev_init(mpr_dev dev, int is_local, const char *name, mpr_id id)
     link(ID,           MPR_INT64, &dev->obj.id,       MOD_NONE);
     qry = mpr_graph_new_query(dev->obj.graph, 0, MPR_DEV, (void*)cmp_qry_linked, "v", &dev);
     link(LINKED,       MPR_LIST,  qry,                MOD_NONE | PROP_OWNED);
-    link(NAME,         MPR_STR,   &dev->name,         MOD_NONE | INDIRECT | LOCAL_ACCESS);
+    link(NAME,         MPR_STR,   &dev->name,         MOD_NONE | INDIRECT | LOCAL_ACCESS | INTERNED);
     link(NUM_MAPS_IN,  MPR_INT32, &dev->num_maps_in,  MOD_NONE);
     link(NUM_MAPS_OUT, MPR_INT32, &dev->num_maps_out, MOD_NONE);
     link(NUM_SIGS_IN,  MPR_INT32, &dev->num_inputs,   MOD_NONE);
@@ -194,10 +273,12 @@ mpr_dev mpr_dev_new(const char *name_prefix, mpr_graph graph)
 
     dev->ordinal_allocator.val = 1;
     dev->ordinal_allocator.count_time = mpr_get_current_time();
-    dev->id_maps.active = (mpr_id_map*) malloc(sizeof(mpr_id_map));
-    dev->id_maps.active[0] = 0;
+    dev->id_maps.active = (mpr_id_map_group) calloc(1, sizeof(mpr_id_map_group_t));
     dev->num_sig_groups = 1;
+    dev->use_shm = mpr_shm_ring_get_is_supported();
 
+    /* the device is added to the network by graph housekeeping */
+    mpr_net_wake(mpr_graph_get_net(g), 1);
     return (mpr_dev)dev;
 }
 
@@ -220,6 +301,11 @@ void mpr_dev_free(mpr_dev dev)
 
     mpr_net_stop_polling(net);
 
+    if (ldev->map_workers) {
+        free_map_workers(ldev->map_workers);
+        ldev->map_workers = 0;
+    }
+
     /* remove local graph handlers here so they are not called when child objects are freed */
     /* CHANGE: if graph is not owned then its callbacks _should_ be called when device is removed. */
     if (own_graph) {
@@ -235,11 +321,13 @@ void mpr_dev_free(mpr_dev dev)
     /* remove subscribers */
     while (ldev->subscribers) {
         mpr_subscriber sub = ldev->subscribers;
-        FUNC_IF(lo_address_free, sub->addr);
         ldev->subscribers = sub->next;
-        free(sub);
+        free_subscriber(sub);
     }
 
+    /* send any updates held back by the send policy */
+    memset(&ldev->send_policy, 0, sizeof(mpr_send_policy_t));
+    ldev->sending = 1;
     process_outgoing_maps(ldev);
 
     /* free signals owned by this device */
@@ -269,21 +357,32 @@ void mpr_dev_free(mpr_dev dev)
         mpr_graph_remove_link(graph, link, MPR_STATUS_REMOVED);
     }
 
+    /* Release any maps that are still queued */
+    for (i = 0; i < ldev->maps_out.num; i++) {
+        if (ldev->maps_out.maps[i])
+            mpr_local_map_dequeue(ldev->maps_out.maps[i], MPR_DIR_OUT);
+    }
+    for (i = 0; i < ldev->maps_in.num; i++) {
+        if (ldev->maps_in.maps[i])
+            mpr_local_map_dequeue(ldev->maps_in.maps[i], MPR_DIR_IN);
+    }
+    FUNC_IF(free, ldev->maps_out.maps);
+    FUNC_IF(free, ldev->maps_in.maps);
+    memset(&ldev->maps_out, 0, sizeof(mpr_map_queue_t));
+    memset(&ldev->maps_in, 0, sizeof(mpr_map_queue_t));
+
     /* Release device id maps */
     for (i = 0; i < ldev->num_sig_groups; i++) {
-        while (ldev->id_maps.active[i]) {
-            mpr_id_map id_map = ldev->id_maps.active[i];
-            ldev->id_maps.active[i] = id_map->next;
-            free(id_map);
-        }
+        FUNC_IF(free, ldev->id_maps.active[i].by_LID.heads);
+        FUNC_IF(free, ldev->id_maps.active[i].by_GID.heads);
     }
     free(ldev->id_maps.active);
-
-    while (ldev->id_maps.reserve) {
-        mpr_id_map id_map = ldev->id_maps.reserve;
-        ldev->id_maps.reserve = id_map->next;
-        free(id_map);
+    while (ldev->id_maps.blocks) {
+        mpr_id_map_block block = ldev->id_maps.blocks;
+        ldev->id_maps.blocks = block->next;
+        free(block);
     }
+    ldev->id_maps.reserve = 0;
 
     dev->obj.status |= MPR_STATUS_REMOVED;
     if (own_graph)
@@ -293,12 +392,22 @@ void mpr_dev_free(mpr_dev dev)
 void mpr_dev_free_mem(mpr_dev dev)
 {
     FUNC_IF(free, dev->linked);
-    FUNC_IF(free, dev->name);
+    if (dev->obj.is_local && !((mpr_local_dev)dev)->registered) {
+        /* the name is only interned once the ordinal has been settled */
+        FUNC_IF(free, dev->name);
+    }
+    else
+        mpr_strtab_remove(mpr_graph_get_strtab(dev->obj.graph), dev->name);
+    FUNC_IF(free, dev->sig_idx.sigs);
+    if (dev->obj.is_local) {
+        FUNC_IF(free, ((mpr_local_dev)dev)->maps_in.maps);
+        FUNC_IF(free, ((mpr_local_dev)dev)->maps_out.maps);
+    }
 }
 
 static void on_registered(mpr_local_dev dev)
 {
-    char *name;
+    const char *name;
     mpr_net net = mpr_graph_get_net(dev->obj.graph);
     mpr_list qry;
 
@@ -318,9 +427,9 @@ static void on_registered(mpr_local_dev dev)
     dev->ordinal = dev->ordinal_allocator.val;
 
     snprintf(dev->name + dev->prefix_len + 1, dev->prefix_len + 6, "%d", dev->ordinal);
-    name = strdup(dev->name);
+    name = mpr_strtab_add(mpr_graph_get_strtab(dev->obj.graph), dev->name);
     free(dev->name);
-    dev->name = name;
+    dev->name = (char*)name;
 
     dev->obj.status &= ~MPR_STATUS_STAGED;
     dev->obj.status |= MPR_STATUS_ACTIVE;
@@ -344,26 +453,53 @@ void mpr_local_dev_add_sig(mpr_local_dev dev, mpr_local_sig sig, mpr_dir dir)
     else
         ++dev->num_outputs;
 
+    mpr_dev_index_sig((mpr_dev)dev, (mpr_sig)sig);
+
     if (dev->registered)
         mpr_local_sig_add_to_net(sig, mpr_graph_get_net(dev->obj.graph));
 
     mpr_obj_incr_version((mpr_obj)dev);
-    dev->obj.status |= MPR_DEV_SIG_CHANGED;
+    mpr_local_dev_set_sig_changed(dev, sig);
 }
 
 void mpr_dev_remove_sig(mpr_dev dev, mpr_sig sig)
 {
     mpr_dir dir = mpr_sig_get_dir(sig);
+    mpr_dev_unindex_sig(dev, sig);
+    if (dev->obj.is_local) {
+        /* drop any references to this signal held by pending in-process messages */
+        mpr_list links = mpr_graph_get_list(dev->obj.graph, MPR_LINK);
+        while (links) {
+            mpr_link_forget_sig((mpr_link)*links, sig);
+            links = mpr_list_get_next(links);
+        }
+    }
     if (dir & MPR_DIR_IN)
         --dev->num_inputs;
     if (dir & MPR_DIR_OUT)
         --dev->num_outputs;
     if (dev->obj.is_local) {
+        mpr_subscriber sub = ((mpr_local_dev)dev)->subscribers;
+        int i;
+        /* forget the signal if it is waiting to be sent to subscribers */
+        for (; sub; sub = sub->next) {
+            for (i = sub->pending.idx; i < sub->pending.num; i++) {
+                if (sub->pending.sigs[i] == sig)
+                    sub->pending.sigs[i] = 0;
+            }
+        }
         mpr_obj_incr_version((mpr_obj)dev);
         dev->obj.status |= MPR_DEV_SIG_CHANGED;
     }
 }
 
+void mpr_local_dev_set_sig_changed(mpr_local_dev dev, mpr_local_sig sig)
+{
+    /* subscribers who have seen this version of the device may have missed the change */
+    mpr_local_sig_set_meta_version(sig, dev->obj.version);
+    dev->obj.status |= MPR_DEV_SIG_CHANGED;
+}
+
 mpr_list mpr_dev_get_sigs(mpr_dev dev, mpr_dir dir)
 {
     RETURN_ARG_UNLESS(dev, 0);
@@ -371,17 +507,79 @@ mpr_list mpr_dev_get_sigs(mpr_dev dev, mpr_dir dir)
                                "hi", dev->obj.id, dir);
 }
 
+/* FNV-1a hash of a signal name */
+static unsigned int hash_sig_name(const char *name)
+{
+    unsigned int hash = 2166136261u;
+    while (*name)
+        hash = (hash ^ (unsigned char)*name++) * 16777619u;
+    return hash;
+}
+
+static void insert_sig(mpr_sig_idx idx, mpr_sig sig)
+{
+    unsigned int mask = idx->size - 1, i = hash_sig_name(mpr_sig_get_name(sig)) & mask;
+    while (idx->sigs[i])
+        i = (i + 1) & mask;
+    idx->sigs[i] = sig;
+    ++idx->num;
+}
+
+void mpr_dev_index_sig(mpr_dev dev, mpr_sig sig)
+{
+    mpr_sig_idx idx = &dev->sig_idx;
+    if ((idx->num + 1) * 2 > idx->size) {
+        /* grow to keep the table at most half full */
+        mpr_sig *sigs = idx->sigs;
+        int i, size = idx->size;
+        idx->size = size ? size * 2 : 16;
+        idx->sigs = (mpr_sig*)calloc(1, idx->size * sizeof(mpr_sig));
+        idx->num = 0;
+        for (i = 0; i < size; i++) {
+            if (sigs[i])
+                insert_sig(idx, sigs[i]);
+        }
+        FUNC_IF(free, sigs);
+    }
+    insert_sig(idx, sig);
+}
+
+void mpr_dev_unindex_sig(mpr_dev dev, mpr_sig sig)
+{
+    mpr_sig_idx idx = &dev->sig_idx;
+    unsigned int i, j, mask;
+    RETURN_UNLESS(idx->num);
+    mask = idx->size - 1;
+    i = hash_sig_name(mpr_sig_get_name(sig)) & mask;
+    while (idx->sigs[i] != sig) {
+        RETURN_UNLESS(idx->sigs[i]);
+        i = (i + 1) & mask;
+    }
+    idx->sigs[i] = 0;
+    --idx->num;
+
+    /* shift later entries of the probe sequence back so that lookups do not stop early */
+    for (j = (i + 1) & mask; idx->sigs[j]; j = (j + 1) & mask) {
+        unsigned int k = hash_sig_name(mpr_sig_get_name(idx->sigs[j])) & mask;
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        idx->sigs[i] = idx->sigs[j];
+        idx->sigs[j] = 0;
+        i = j;
+    }
+}
+
 mpr_sig mpr_dev_get_sig_by_name(mpr_dev dev, const char *sig_name)
 {
-    mpr_list sigs;
-    RETURN_ARG_UNLESS(dev && sig_name, 0);
-    sigs = mpr_graph_get_list(dev->obj.graph, MPR_SIG);
-    while (sigs) {
-        mpr_sig sig = (mpr_sig)*sigs;
-        if (   mpr_sig_get_dev(sig) == dev
-            && strcmp(mpr_sig_get_name(sig), mpr_path_skip_slash(sig_name))==0)
-            return sig;
-        sigs = mpr_list_get_next(sigs);
+    mpr_sig_idx idx;
+    unsigned int i, mask;
+    RETURN_ARG_UNLESS(dev && sig_name && dev->sig_idx.num, 0);
+    idx = &dev->sig_idx;
+    sig_name = mpr_path_skip_slash(sig_name);
+    mask = idx->size - 1;
+    for (i = hash_sig_name(sig_name) & mask; idx->sigs[i]; i = (i + 1) & mask) {
+        if (strcmp(mpr_sig_get_name(idx->sigs[i]), sig_name) == 0)
+            return idx->sigs[i];
     }
     return 0;
 }
@@ -444,55 +642,300 @@ mpr_link mpr_dev_get_link_by_remote(mpr_dev dev, mpr_dev remote)
     return 0;
 }
 
+void mpr_local_dev_queue_map(mpr_local_dev dev, mpr_local_map map, mpr_dir dir)
+{
+    mpr_map_queue q = MPR_DIR_IN == dir ? &dev->maps_in : &dev->maps_out;
+    if (q->num >= q->size) {
+        q->size = q->size ? q->size * 2 : 8;
+        q->maps = realloc(q->maps, q->size * sizeof(mpr_local_map));
+    }
+    q->maps[q->num++] = map;
+    if (MPR_DIR_IN == dir)
+        dev->receiving = 1;
+    else
+        mpr_local_dev_set_sending(dev);
+}
+
+void mpr_local_dev_remove_queued_map(mpr_local_dev dev, mpr_local_map map)
+{
+    int i;
+    /* zero the entries rather than removing them since the queue may be being processed */
+    for (i = 0; i < dev->maps_in.num; i++) {
+        if (dev->maps_in.maps[i] == map)
+            dev->maps_in.maps[i] = 0;
+    }
+    for (i = 0; i < dev->maps_out.num; i++) {
+        if (dev->maps_out.maps[i] == map)
+            dev->maps_out.maps[i] = 0;
+    }
+}
+
+/* Remove maps that have been processed from the front of a queue. Maps queued during processing
+ * are kept for the next pass. */
+static void trim_map_queue(mpr_map_queue q, int num)
+{
+    q->num -= num;
+    if (q->num > 0)
+        memmove(q->maps, q->maps + num, q->num * sizeof(mpr_local_map));
+}
+
 /* TODO: handle interrupt-driven updates that omit call to this function */
 void mpr_dev_process_incoming_maps(mpr_local_dev dev)
 {
-    mpr_graph graph;
-    mpr_list maps;
+    mpr_map_queue q = &dev->maps_in;
+    int i, num;
     RETURN_UNLESS(dev->receiving);
-    graph = dev->obj.graph;
-    /* process and send updated maps */
-    /* TODO: speed this up! */
+    /* only process the maps that have been updated */
     dev->receiving = 0;
-    maps = mpr_graph_get_list(graph, MPR_MAP);
-    while (maps) {
-        mpr_map map = (mpr_map)*maps;
-        maps = mpr_list_get_next(maps);
-        if (mpr_obj_get_is_local((mpr_obj)map)) {
-            mpr_map_receive((mpr_local_map)map, dev->time);
-            mpr_map_clear_slot_msgs((mpr_local_map)map);
+    num = q->num;
+    for (i = 0; i < num; i++) {
+        mpr_local_map map = q->maps[i];
+        if (!map)
+            continue;
+        mpr_local_map_dequeue(map, MPR_DIR_IN);
+        mpr_map_receive(map, dev->time);
+        mpr_map_clear_slot_msgs(map);
+    }
+    trim_map_queue(q, num);
+}
+
+#ifdef HAVE_LIBPTHREAD
+/* Number of maps claimed at once by each thread during a parallel pass. */
+#define MAP_WORKER_CHUNK 8
+
+/*! A pool of threads for evaluating the expressions of outgoing maps in parallel. */
+typedef struct _mpr_map_workers {
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;       /*!< Signalled when a new pass is ready. */
+    pthread_cond_t done;        /*!< Signalled when the last worker has finished a pass. */
+    mpr_local_map *maps;        /*!< The maps to be evaluated during the current pass. */
+    mpr_time time;
+    int num_maps;
+    volatile int next;          /*!< Index of the next unclaimed map, updated atomically. */
+    int num_threads;
+    int num_busy;               /*!< Number of workers still busy with the current pass. */
+    unsigned int pass;
+    uint8_t quit;
+} mpr_map_workers_t, *mpr_map_workers;
+
+/* Evaluate maps in chunks until none are left unclaimed. This is called by the workers and by
+ * the thread processing the device; since each map is claimed exactly once no locking is needed. */
+static void eval_map_chunks(mpr_map_workers w)
+{
+    int i, end;
+    while ((i = __sync_fetch_and_add(&w->next, MAP_WORKER_CHUNK)) < w->num_maps) {
+        end = i + MAP_WORKER_CHUNK < w->num_maps ? i + MAP_WORKER_CHUNK : w->num_maps;
+        for (; i < end; i++) {
+            if (w->maps[i])
+                mpr_map_eval_send(w->maps[i], w->time);
         }
-        else {
-            /* local maps are always located at the start of the list */
+    }
+}
+
+static void *map_worker_func(void *data)
+{
+    mpr_map_workers w = (mpr_map_workers)data;
+    unsigned int pass = 0;
+    pthread_mutex_lock(&w->lock);
+    while (1) {
+        while (pass == w->pass && !w->quit)
+            pthread_cond_wait(&w->start, &w->lock);
+        if (w->quit)
             break;
+        pass = w->pass;
+        pthread_mutex_unlock(&w->lock);
+
+        eval_map_chunks(w);
+
+        pthread_mutex_lock(&w->lock);
+        if (!--w->num_busy)
+            pthread_cond_signal(&w->done);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return 0;
+}
+
+/* Evaluate the first `num` queued outgoing maps using the worker pool. Messages are built and
+ * bundled later by `mpr_map_send()` on the calling thread, which reuses the stored results. */
+static void eval_maps_parallel(mpr_local_dev dev, int num)
+{
+    mpr_map_workers w = dev->map_workers;
+    w->maps = dev->maps_out.maps;
+    w->num_maps = num;
+
+    pthread_mutex_lock(&w->lock);
+    w->time = dev->time;
+    w->next = 0;
+    w->num_busy = w->num_threads;
+    ++w->pass;
+    pthread_cond_broadcast(&w->start);
+    pthread_mutex_unlock(&w->lock);
+
+    eval_map_chunks(w);
+
+    pthread_mutex_lock(&w->lock);
+    while (w->num_busy)
+        pthread_cond_wait(&w->done, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+}
+
+static void free_map_workers(mpr_map_workers w)
+{
+    int i;
+    pthread_mutex_lock(&w->lock);
+    w->quit = 1;
+    pthread_cond_broadcast(&w->start);
+    pthread_mutex_unlock(&w->lock);
+    for (i = 0; i < w->num_threads; i++)
+        pthread_join(w->threads[i], NULL);
+    pthread_cond_destroy(&w->start);
+    pthread_cond_destroy(&w->done);
+    pthread_mutex_destroy(&w->lock);
+    free(w->threads);
+    free(w);
+}
+#else
+static void free_map_workers(struct _mpr_map_workers *workers) {}
+#endif /* HAVE_LIBPTHREAD */
+
+int mpr_dev_set_num_map_workers(mpr_dev dev, int num_workers)
+{
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    RETURN_ARG_UNLESS(dev && dev->obj.is_local && num_workers >= 0, -1);
+    /* the pool cannot be changed while it is in use */
+    RETURN_ARG_UNLESS(!ldev->polling, -1);
+
+    if (ldev->map_workers) {
+        free_map_workers(ldev->map_workers);
+        ldev->map_workers = 0;
+    }
+    RETURN_ARG_UNLESS(num_workers, 0);
+
+#ifdef HAVE_LIBPTHREAD
+    {
+        int i;
+        mpr_map_workers w = (mpr_map_workers)calloc(1, sizeof(mpr_map_workers_t));
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->start, NULL);
+        pthread_cond_init(&w->done, NULL);
+        w->threads = (pthread_t*)malloc(num_workers * sizeof(pthread_t));
+        for (i = 0; i < num_workers; i++) {
+            if (pthread_create(&w->threads[i], 0, map_worker_func, w))
+                break;
+        }
+        w->num_threads = i;
+        if (i < num_workers) {
+            printf("Device error: couldn't create map worker thread.\n");
+            free_map_workers(w);
+            return -1;
         }
+        ldev->map_workers = w;
+        return 0;
     }
+#else
+    printf("error: threading is not available.\n");
+    return -1;
+#endif /* HAVE_LIBPTHREAD */
+}
+
+int mpr_dev_set_use_shm(mpr_dev dev, int use)
+{
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    mpr_list links;
+    RETURN_ARG_UNLESS(dev && dev->obj.is_local, -1);
+    RETURN_ARG_UNLESS(!use || mpr_shm_ring_get_is_supported(), -1);
+    RETURN_ARG_UNLESS(!ldev->polling, -1);
+
+    ldev->use_shm = use ? 1 : 0;
+    links = mpr_graph_get_list(dev->obj.graph, MPR_LINK);
+    while (links) {
+        mpr_link link = (mpr_link)*links;
+        if (mpr_link_get_dev(link, LINK_LOCAL_DEV) == dev)
+            mpr_link_set_use_shm(link, ldev->use_shm);
+        links = mpr_list_get_next(links);
+    }
+    return 0;
+}
+
+int mpr_local_dev_get_use_shm(mpr_local_dev dev)
+{
+    return dev->use_shm;
+}
+
+int mpr_dev_set_send_policy(mpr_dev dev, float max_rate, float max_latency, int min_fill)
+{
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    RETURN_ARG_UNLESS(dev && dev->obj.is_local, -1);
+    RETURN_ARG_UNLESS(max_rate >= 0 && max_latency >= 0 && min_fill >= 0, -1);
+    ldev->send_policy.max_rate = max_rate;
+    ldev->send_policy.max_latency = max_latency;
+    ldev->send_policy.min_fill = min_fill;
+    /* send any held updates according to the new policy */
+    mpr_local_dev_set_sending(ldev);
+    return 0;
+}
+
+mpr_send_policy mpr_local_dev_get_send_policy(mpr_local_dev dev)
+{
+    mpr_send_policy p = &dev->send_policy;
+    return (p->max_rate > 0 || p->max_latency > 0) ? p : 0;
+}
+
+int mpr_dev_get_send_stats(mpr_dev dev, uint64_t *bundles, uint64_t *msgs, uint64_t *coalesced)
+{
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    RETURN_ARG_UNLESS(dev && dev->obj.is_local, -1);
+    if (bundles)
+        *bundles = ldev->send_stats.bundles;
+    if (msgs)
+        *msgs = ldev->send_stats.msgs;
+    if (coalesced)
+        *coalesced = ldev->send_stats.coalesced;
+    return 0;
+}
+
+int mpr_dev_set_meta_budget(mpr_dev dev, int bytes_per_sec)
+{
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    RETURN_ARG_UNLESS(dev && dev->obj.is_local && bytes_per_sec >= 0, -1);
+    ldev->meta_budget.rate = bytes_per_sec;
+    ldev->meta_budget.credit = 0;
+    ldev->meta_budget.time = mpr_get_current_time();
+    return 0;
+}
+
+void mpr_local_dev_add_send_stats(mpr_local_dev dev, int bundles, int msgs, int coalesced)
+{
+    dev->send_stats.bundles += bundles;
+    dev->send_stats.msgs += msgs;
+    dev->send_stats.coalesced += coalesced;
 }
 
 /* TODO: handle interrupt-driven updates that omit call to this function */
 static int process_outgoing_maps(mpr_local_dev dev)
 {
-    int msgs = 0;
+    int i, num, msgs = 0, held = 0;
     mpr_list list;
-    mpr_graph graph;
+    mpr_map_queue q = &dev->maps_out;
     RETURN_ARG_UNLESS(dev->sending && !dev->polling, 0);
 
     dev->polling = 1;
-    graph = dev->obj.graph;
-    /* process and send updated maps */
-    /* TODO: speed this up! */
-    list = mpr_graph_get_list(graph, MPR_MAP);
-    while (list) {
-        mpr_map map = (mpr_map)*list;
-        if (!mpr_obj_get_is_local((mpr_obj)map)) {
-            /* local maps are always located at the start of the list */
-            break;
-        }
-        mpr_map_send((mpr_local_map)map, dev->time);
-        list = mpr_list_get_next(list);
+    /* only process the maps that have been updated or have messages waiting */
+    num = q->num;
+#ifdef HAVE_LIBPTHREAD
+    if (dev->map_workers && num > MAP_WORKER_CHUNK)
+        eval_maps_parallel(dev, num);
+#endif
+    for (i = 0; i < num; i++) {
+        mpr_local_map map = q->maps[i];
+        if (!map)
+            continue;
+        mpr_local_map_dequeue(map, MPR_DIR_OUT);
+        mpr_map_send(map, dev->time);
     }
     dev->sending = 0;
-    list = mpr_graph_get_list(graph, MPR_LINK);
+    list = mpr_graph_get_list(dev->obj.graph, MPR_LINK);
     while (list) {
         mpr_link link = (mpr_link)*list;
         if (!mpr_obj_get_is_local((mpr_obj)link)) {
@@ -500,18 +943,16 @@ static int process_outgoing_maps(mpr_local_dev dev)
             break;
         }
         msgs += mpr_link_process_bundles(link, dev->time);
+        held |= mpr_link_get_is_holding(link);
         list = mpr_list_get_next(list);
     }
-    list = mpr_graph_get_list(graph, MPR_MAP);
-    while (list) {
-        mpr_map map = (mpr_map)*list;
-        if (!mpr_obj_get_is_local((mpr_obj)map)) {
-            /* local maps are always located at the start of the list */
-            break;
-        }
-        mpr_map_clear_slot_msgs((mpr_local_map)map);
-        list = mpr_list_get_next(list);
-    }
+    mpr_net_flush_udp_batch(mpr_graph_get_net(dev->obj.graph));
+    for (i = 0; i < num; i++)
+        FUNC_IF(mpr_map_clear_slot_msgs, q->maps[i]);
+    trim_map_queue(q, num);
+    /* links holding updates have scheduled the network to poll again when they are due */
+    if (q->num || held)
+        dev->sending = 1;
     dev->polling = 0;
     return msgs != 0;
 }
@@ -598,9 +1039,22 @@ void mpr_dev_set_time(mpr_dev dev, mpr_time time)
     }
 }
 
-void mpr_dev_reserve_id_map(mpr_local_dev dev)
+/*! Move an id map to the reserve list. Id maps are carved from blocks that grow in size as more
+ *  are needed, and are only freed along with the device. */
+static void reserve_id_map(mpr_local_dev dev)
 {
-    mpr_id_map id_map = (mpr_id_map)calloc(1, sizeof(mpr_id_map_t));
+    mpr_id_map id_map;
+    mpr_id_map_block block = dev->id_maps.blocks;
+    if (!block || block->used >= block->size) {
+        int size = block ? block->size * 2 : ID_MAP_BLOCK_MIN_SIZE;
+        if (size > ID_MAP_BLOCK_MAX_SIZE)
+            size = ID_MAP_BLOCK_MAX_SIZE;
+        block = (mpr_id_map_block)calloc(1, sizeof(mpr_id_map_block_t) + size * sizeof(mpr_id_map_t));
+        block->size = size;
+        block->next = dev->id_maps.blocks;
+        dev->id_maps.blocks = block;
+    }
+    id_map = &block->id_maps[block->used++];
     id_map->next = dev->id_maps.reserve;
     dev->id_maps.reserve = id_map;
 }
@@ -608,7 +1062,7 @@ void mpr_dev_reserve_id_map(mpr_local_dev dev)
 int mpr_local_dev_get_num_id_maps(mpr_local_dev dev, int active)
 {
     int count = 0;
-    mpr_id_map *id_map = active ? &(dev)->id_maps.active[0] : &(dev)->id_maps.reserve;
+    mpr_id_map *id_map = active ? &(dev)->id_maps.active[0].list : &(dev)->id_maps.reserve;
     while (*id_map) {
         ++count;
         id_map = &(*id_map)->next;
@@ -620,7 +1074,7 @@ int mpr_local_dev_get_num_id_maps(mpr_local_dev dev, int active)
 void mpr_local_dev_print_id_maps(mpr_local_dev dev)
 {
     printf("ID MAPS for %s:\n", dev->name);
-    mpr_id_map *id_maps = &dev->id_maps.active[0];
+    mpr_id_map *id_maps = &dev->id_maps.active[0].list;
     while (*id_maps) {
         mpr_id_map_print(*id_maps);
         id_maps = &(*id_maps)->next;
@@ -628,11 +1082,87 @@ void mpr_local_dev_print_id_maps(mpr_local_dev dev)
 }
 #endif
 
+/* Fibonacci hash of an instance id */
+MPR_INLINE static unsigned int hash_id(mpr_id id)
+{
+    return (unsigned int)((id * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+MPR_INLINE static mpr_id get_id_map_key(mpr_id_map id_map, int by_GID)
+{
+    return by_GID ? id_map->GID : id_map->LID;
+}
+
+MPR_INLINE static mpr_id_map *get_id_map_chain(mpr_id_map id_map, int by_GID)
+{
+    return by_GID ? &id_map->next_GID : &id_map->next_LID;
+}
+
+/* Return the bucket holding the given key, or the empty bucket where it would be inserted. */
+static unsigned int find_id_map_bucket(mpr_id_map_idx idx, mpr_id key, int by_GID)
+{
+    unsigned int mask = idx->size - 1, i = hash_id(key) & mask;
+    while (idx->heads[i] && get_id_map_key(idx->heads[i], by_GID) != key)
+        i = (i + 1) & mask;
+    return i;
+}
+
+static void index_id_map(mpr_id_map_idx idx, mpr_id_map id_map, int by_GID)
+{
+    unsigned int i;
+    if ((idx->num + 1) * 2 > idx->size) {
+        /* grow to keep the table at most half full; chains move along with their heads */
+        mpr_id_map *heads = idx->heads;
+        int j, size = idx->size;
+        idx->size = size ? size * 2 : 16;
+        idx->heads = (mpr_id_map*)calloc(1, idx->size * sizeof(mpr_id_map));
+        for (j = 0; j < size; j++) {
+            if (heads[j])
+                idx->heads[find_id_map_bucket(idx, get_id_map_key(heads[j], by_GID), by_GID)] = heads[j];
+        }
+        FUNC_IF(free, heads);
+    }
+    i = find_id_map_bucket(idx, get_id_map_key(id_map, by_GID), by_GID);
+    *get_id_map_chain(id_map, by_GID) = idx->heads[i];
+    if (!idx->heads[i])
+        ++idx->num;
+    idx->heads[i] = id_map;
+}
+
+static void unindex_id_map(mpr_id_map_idx idx, mpr_id_map id_map, int by_GID)
+{
+    mpr_id_map *link;
+    unsigned int i, j, mask;
+    RETURN_UNLESS(idx->num);
+    i = find_id_map_bucket(idx, get_id_map_key(id_map, by_GID), by_GID);
+    link = &idx->heads[i];
+    while (*link != id_map) {
+        RETURN_UNLESS(*link);
+        link = get_id_map_chain(*link, by_GID);
+    }
+    *link = *get_id_map_chain(id_map, by_GID);
+    *get_id_map_chain(id_map, by_GID) = 0;
+    RETURN_UNLESS(!idx->heads[i]);
+    --idx->num;
+
+    /* shift later entries of the probe sequence back so that lookups do not stop early */
+    mask = idx->size - 1;
+    for (j = (i + 1) & mask; idx->heads[j]; j = (j + 1) & mask) {
+        unsigned int k = hash_id(get_id_map_key(idx->heads[j], by_GID)) & mask;
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        idx->heads[i] = idx->heads[j];
+        idx->heads[j] = 0;
+        i = j;
+    }
+}
+
 mpr_id_map mpr_dev_add_id_map(mpr_local_dev dev, int group, mpr_id LID, mpr_id GID, int indirect)
 {
     mpr_id_map id_map;
+    mpr_id_map_group g = &dev->id_maps.active[group];
     if (!dev->id_maps.reserve)
-        mpr_dev_reserve_id_map(dev);
+        reserve_id_map(dev);
     id_map = dev->id_maps.reserve;
     id_map->LID = LID;
     id_map->GID = GID ? GID : mpr_dev_generate_unique_id((mpr_dev)dev);
@@ -642,8 +1172,13 @@ mpr_id_map mpr_dev_add_id_map(mpr_local_dev dev, int group, mpr_id LID, mpr_id G
     id_map->GID_refcount = 0;
     id_map->indirect = indirect;
     dev->id_maps.reserve = id_map->next;
-    id_map->next = dev->id_maps.active[group];
-    dev->id_maps.active[group] = id_map;
+    id_map->next = g->list;
+    if (g->list)
+        g->list->prev = &id_map->next;
+    id_map->prev = &g->list;
+    g->list = id_map;
+    index_id_map(&g->by_LID, id_map, 0);
+    index_id_map(&g->by_GID, id_map, 1);
 #ifdef DEBUG
     mpr_local_dev_print_id_maps(dev);
 #endif
@@ -652,23 +1187,35 @@ mpr_id_map mpr_dev_add_id_map(mpr_local_dev dev, int group, mpr_id LID, mpr_id G
 
 void mpr_dev_remove_id_map(mpr_local_dev dev, int group, mpr_id_map rem)
 {
-    mpr_id_map *map = &dev->id_maps.active[group];
+    mpr_id_map_group g = &dev->id_maps.active[group];
+    RETURN_UNLESS(rem && rem->prev);
     trace_dev(dev, "mpr_dev_remove_id_map(%s) %"PR_MPR_ID" -> %"PR_MPR_ID"\n",
               dev->name, rem->LID, rem->GID);
-    while (*map) {
-        if ((*map) == rem) {
-            *map = (*map)->next;
-            rem->next = dev->id_maps.reserve;
-            dev->id_maps.reserve = rem;
-            break;
-        }
-        map = &(*map)->next;
-    }
+    unindex_id_map(&g->by_LID, rem, 0);
+    unindex_id_map(&g->by_GID, rem, 1);
+    *rem->prev = rem->next;
+    if (rem->next)
+        rem->next->prev = rem->prev;
+    rem->prev = 0;
+    rem->next = dev->id_maps.reserve;
+    dev->id_maps.reserve = rem;
 #ifdef DEBUG
     mpr_local_dev_print_id_maps(dev);
 #endif
 }
 
+void mpr_dev_set_id_map_GID(mpr_local_dev dev, int group, mpr_id_map id_map, mpr_id GID)
+{
+    mpr_id_map_group g = &dev->id_maps.active[group];
+    if (!id_map->prev) {
+        id_map->GID = GID;
+        return;
+    }
+    unindex_id_map(&g->by_GID, id_map, 1);
+    id_map->GID = GID;
+    index_id_map(&g->by_GID, id_map, 1);
+}
+
 int mpr_dev_LID_decref(mpr_local_dev dev, int group, mpr_id_map id_map)
 {
     trace_dev(dev, "mpr_dev_LID_decref(%s) %"PR_MPR_ID" -> %"PR_MPR_ID"\n",
@@ -710,35 +1257,33 @@ int mpr_dev_GID_decref(mpr_local_dev dev, int group, mpr_id_map id_map)
 
 mpr_id_map mpr_dev_get_id_map_by_LID(mpr_local_dev dev, int group, mpr_id LID)
 {
-    mpr_id_map id_map = dev->id_maps.active[group];
+    mpr_id_map id_map;
+    mpr_id_map_idx idx = &dev->id_maps.active[group].by_LID;
+    RETURN_ARG_UNLESS(idx->num, 0);
+    id_map = idx->heads[find_id_map_bucket(idx, LID, 0)];
     while (id_map) {
-        if (id_map->LID == LID && id_map->LID_refcount > 0) {
+        if (id_map->LID_refcount > 0)
             return id_map;
-        }
-        id_map = id_map->next;
+        id_map = id_map->next_LID;
     }
     return 0;
 }
 
 mpr_id_map mpr_dev_get_id_map_by_GID(mpr_local_dev dev, int group, mpr_id GID)
 {
-    mpr_id_map id_map = dev->id_maps.active[group];
-    while (id_map) {
-        if (id_map->GID == GID)
-            return id_map;
-        id_map = id_map->next;
-    }
-    return 0;
+    mpr_id_map_idx idx = &dev->id_maps.active[group].by_GID;
+    RETURN_ARG_UNLESS(idx->num, 0);
+    return idx->heads[find_id_map_bucket(idx, GID, 1)];
 }
 
 /* TODO: rename this function */
 mpr_id_map mpr_dev_get_id_map_GID_free(mpr_local_dev dev, int group, mpr_id last_GID)
 {
-    int searching = last_GID != 0;
-    mpr_id_map id_map = dev->id_maps.active[group];
-    while (id_map && searching) {
-        if (id_map->GID == last_GID)
-            searching = 0;
+    mpr_id_map id_map = dev->id_maps.active[group].list;
+    if (last_GID) {
+        /* resume the search after the most recently added id map with this GID */
+        id_map = mpr_dev_get_id_map_by_GID(dev, group, last_GID);
+        RETURN_ARG_UNLESS(id_map, 0);
         id_map = id_map->next;
     }
     while (id_map) {
@@ -1051,13 +1596,70 @@ void mpr_dev_set_is_subscribed(mpr_dev dev, int subscribed)
     dev->subscribed = (subscribed != 0);
 }
 
+static void free_subscriber(mpr_subscriber sub)
+{
+    FUNC_IF(lo_address_free, sub->addr);
+    mpr_udp_dest_free(sub->dest);
+    FUNC_IF(free, sub->pending.sigs);
+    free(sub);
+}
+
+/* Queue the signals changed since a version of the device to be sent to a subscriber, or all of
+ * them if the version is negative. */
+static void queue_sigs(mpr_local_dev dev, mpr_subscriber sub, mpr_dir dir, int version)
+{
+    mpr_list list = mpr_dev_get_sigs((mpr_dev)dev, dir);
+    while (list) {
+        mpr_local_sig sig = (mpr_local_sig)*list;
+        list = mpr_list_get_next(list);
+        if (version >= 0 && mpr_local_sig_get_meta_version(sig) < version)
+            continue;
+        if (sub->pending.num >= sub->pending.size) {
+            sub->pending.size = sub->pending.size ? sub->pending.size * 2 : 16;
+            sub->pending.sigs = realloc(sub->pending.sigs, sub->pending.size * sizeof(mpr_sig));
+        }
+        sub->pending.sigs[sub->pending.num++] = (mpr_sig)sig;
+    }
+}
+
+/* Add the time elapsed since the last update to the device's metadata budget. */
+static void update_meta_budget(mpr_local_dev dev)
+{
+    double now, max = dev->meta_budget.rate * META_BUDGET_MAX_BURST;
+    RETURN_UNLESS(dev->meta_budget.rate > 0);
+    now = mpr_get_current_time();
+    dev->meta_budget.credit += (now - dev->meta_budget.time) * dev->meta_budget.rate;
+    if (dev->meta_budget.credit > max)
+        dev->meta_budget.credit = max;
+    dev->meta_budget.time = now;
+}
+
+/* Send the signals queued for a subscriber while the metadata budget allows. */
+static void send_pending_sigs(mpr_local_dev dev, mpr_subscriber sub, mpr_net net)
+{
+    int limited = dev->meta_budget.rate > 0;
+    RETURN_UNLESS(sub->pending.idx < sub->pending.num);
+    RETURN_UNLESS(!limited || dev->meta_budget.credit > 0);
+    mpr_net_use_mesh(net, sub->addr, NULL);
+    while (sub->pending.idx < sub->pending.num) {
+        mpr_sig sig = sub->pending.sigs[sub->pending.idx++];
+        if (sig)
+            dev->meta_budget.credit -= mpr_sig_send_state(sig, MSG_SIG);
+        if (limited && dev->meta_budget.credit <= 0)
+            break;
+    }
+    mpr_net_send(net);
+    if (sub->pending.idx >= sub->pending.num)
+        sub->pending.idx = sub->pending.num = 0;
+}
+
 /* Add/renew/remove a subscription. */
 void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
-                               int timeout_sec, int revision)
+                               int timeout_sec, int since)
 {
     mpr_time t;
     mpr_net net;
-    mpr_subscriber *s = &dev->subscribers;
+    mpr_subscriber *s = &dev->subscribers, sub = 0;
     const char *ip = lo_address_get_hostname(addr);
     const char *port = lo_address_get_port(addr);
     RETURN_UNLESS(ip && port);
@@ -1076,8 +1678,7 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
                     int prev_flags = temp->flags;
                     trace_dev(dev, "removing subscription from %s:%s\n", s_ip, s_port);
                     *s = temp->next;
-                    FUNC_IF(lo_address_free, temp->addr);
-                    free(temp);
+                    free_subscriber(temp);
                     RETURN_UNLESS(flags && (flags &= ~prev_flags));
                 }
                 else {
@@ -1091,6 +1692,9 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
                     (*s)->lease_exp = t.sec + timeout_sec;
                     flags &= ~(*s)->flags;
                     (*s)->flags = temp;
+                    /* the subscriber has not received anything for the added flags */
+                    sub = *s;
+                    since = -1;
                 }
                 break;
             }
@@ -1106,8 +1710,9 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
         trace_dev(dev, "adding new subscription from %s:%s with flags ", ip, port);
         print_subscription_flags(flags);
 #endif
-        mpr_subscriber sub = malloc(sizeof(mpr_subscriber_t));
+        sub = calloc(1, sizeof(mpr_subscriber_t));
         sub->addr = lo_address_new(ip, port);
+        sub->dest = mpr_udp_dest_new(ip, atoi(port));
         sub->lease_exp = t.sec + timeout_sec;
         sub->flags = flags;
         sub->next = dev->subscribers;
@@ -1126,9 +1731,18 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
             dir |= MPR_DIR_IN;
         if (flags & MPR_SIG_OUT)
             dir |= MPR_DIR_OUT;
-        mpr_net_use_mesh(net, addr, NULL);
-        mpr_dev_send_sigs(dev, dir, 1);
-        mpr_net_send(net);
+        if (sub) {
+            /* only send the signals that have changed since the version already seen */
+            trace_dev(dev, "queueing signals changed since version %d\n", since);
+            queue_sigs(dev, sub, dir, since);
+            update_meta_budget(dev);
+            send_pending_sigs(dev, sub, net);
+        }
+        else {
+            mpr_net_use_mesh(net, addr, NULL);
+            mpr_dev_send_sigs(dev, dir, 1);
+            mpr_net_send(net);
+        }
     }
     if (flags & MPR_MAP) {
         mpr_dir dir = 0;
@@ -1145,6 +1759,7 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
 void mpr_dev_update_subscribers(mpr_local_dev ldev)
 {
     mpr_net net = mpr_graph_get_net(ldev->obj.graph);
+    mpr_subscriber sub;
     if (ldev->subscribers) {
         if (mpr_tbl_get_is_dirty(ldev->obj.props.synced)) {
             /* inform device subscribers of changed properties */
@@ -1156,6 +1771,10 @@ void mpr_dev_update_subscribers(mpr_local_dev ldev)
             mpr_dev_send_sigs(ldev, MPR_DIR_ANY, 0);
             ldev->obj.status &= ~MPR_DEV_SIG_CHANGED;
         }
+        /* continue bringing new subscribers up to date */
+        update_meta_budget(ldev);
+        for (sub = ldev->subscribers; sub; sub = sub->next)
+            send_pending_sigs(ldev, sub, net);
         ldev->time_is_stale = 1;
     }
 }
@@ -1182,7 +1801,10 @@ int mpr_dev_has_local_link(mpr_dev dev)
 
 void mpr_local_dev_set_sending(mpr_local_dev dev)
 {
+    RETURN_UNLESS(!dev->sending);
     dev->sending = 1;
+    /* updates may be queued from outside a polling thread */
+    mpr_net_wake(mpr_graph_get_net(dev->obj.graph), 0);
 }
 
 void mpr_local_dev_set_receiving(mpr_local_dev dev)
@@ -1195,40 +1817,89 @@ int mpr_local_dev_has_subscribers(mpr_local_dev dev)
     return dev->subscribers != 0;
 }
 
-void mpr_local_dev_send_to_subscribers(mpr_local_dev dev, lo_bundle bundle,
-                                       int msg_type, lo_server from)
+void mpr_local_dev_remove_expired_subscribers(mpr_local_dev dev)
 {
     mpr_subscriber *sub = &dev->subscribers;
     mpr_time t;
-    if (*sub) {
-        mpr_time_set(&t, MPR_NOW);
-        mpr_time_add_dbl(&t, dev->clk_offset);
-        while (*sub) {
-            if ((*sub)->lease_exp < t.sec || !(*sub)->flags) {
-                /* subscription expired, remove from subscriber list */
+    RETURN_UNLESS(*sub);
+    mpr_time_set(&t, MPR_NOW);
+    mpr_time_add_dbl(&t, dev->clk_offset);
+    while (*sub) {
+        if ((*sub)->lease_exp < t.sec || !(*sub)->flags) {
+            /* subscription expired, remove from subscriber list */
 #ifdef DEBUG
-                char *addr = lo_address_get_url((*sub)->addr);
-                trace_dev(dev, "removing expired subscription from %s\n", addr);
+            char *addr = lo_address_get_url((*sub)->addr);
+            trace_dev(dev, "removing expired subscription from %s\n", addr);
 #ifndef WIN32
-                /* For some reason Windows thinks return of lo_address_get_url() should not be freed */
-                free(addr);
+            /* For some reason Windows thinks return of lo_address_get_url() should not be freed */
+            free(addr);
 #endif /* WIN32 */
 #endif /* DEBUG */
-                mpr_subscriber temp = *sub;
-                *sub = temp->next;
-                FUNC_IF(lo_address_free, temp->addr);
-                free(temp);
-                continue;
-            }
-            if ((*sub)->flags & msg_type)
-                lo_send_bundle_from((*sub)->addr, from, bundle);
-            sub = &(*sub)->next;
+            mpr_subscriber temp = *sub;
+            *sub = temp->next;
+            free_subscriber(temp);
+            continue;
         }
+        sub = &(*sub)->next;
     }
 }
 
+static void send_fanout(mpr_udp_batch batch, lo_server from, mpr_udp_dest *dests, int num,
+                        const void *data, size_t len)
+{
+    int i;
+    if (batch && !mpr_udp_batch_add_fanout(batch, from, dests, num, data, len))
+        return;
+    for (i = 0; i < num; i++)
+        mpr_udp_send(from, dests[i], data, len);
+}
+
+void mpr_local_dev_send_to_subscribers(mpr_local_dev dev, lo_bundle bundle,
+                                       int msg_type, lo_server from)
+{
+    mpr_subscriber sub = dev->subscribers;
+    mpr_udp_dest dests[SUBSCRIBER_FANOUT_SIZE];
+    mpr_udp_batch batch;
+    size_t len;
+    void *data;
+    int num = 0;
+    RETURN_UNLESS(sub);
+
+    /* serialise the bundle once for all subscribers */
+    data = lo_bundle_serialise(bundle, NULL, &len);
+    RETURN_UNLESS(data);
+    batch = mpr_net_get_udp_batch(mpr_graph_get_net(dev->obj.graph));
+    for (; sub; sub = sub->next) {
+        if (!(sub->flags & msg_type))
+            continue;
+        if (!sub->dest) {
+            /* the address could not be resolved for sending directly */
+            lo_send_bundle_from(sub->addr, from, bundle);
+            continue;
+        }
+        dests[num++] = sub->dest;
+        if (SUBSCRIBER_FANOUT_SIZE == num) {
+            send_fanout(batch, from, dests, num, data, len);
+            num = 0;
+        }
+    }
+    if (num)
+        send_fanout(batch, from, dests, num, data, len);
+    /* metadata is not held back with signal updates */
+    if (batch)
+        mpr_udp_batch_flush(batch);
+    free(data);
+}
+
 void mpr_local_dev_restart_registration(mpr_local_dev dev, int start_ordinal)
 {
+    if (dev->registered) {
+        /* the interned name is shared, so probe for a new ordinal using a private copy */
+        char *name = (char*)malloc(dev->prefix_len + 6);
+        snprintf(name, dev->prefix_len + 6, "%s", dev->name);
+        mpr_strtab_remove(mpr_graph_get_strtab(dev->obj.graph), dev->name);
+        dev->name = name;
+    }
     dev->registered = 0;
     dev->ordinal_allocator.val = start_ordinal;
 }
@@ -20,6 +20,14 @@ typedef struct _mpr_local_dev *mpr_local_dev;
 
 #define MPR_DEV_SIG_CHANGED 0x2000
 
+/*! The policy used by a local device to send slot updates to remote devices, see
+ *  mpr_dev_set_send_policy(). */
+typedef struct _mpr_send_policy {
+    float max_rate;         /*!< Maximum bundles per second per link, or zero for no limit. */
+    float max_latency;      /*!< Maximum time in seconds that updates may be held. */
+    int min_fill;           /*!< Number of held updates at which a bundle is sent early. */
+} mpr_send_policy_t, *mpr_send_policy;
+
 /**** Debug macros ****/
 
 /*! Debug tracer */
@@ -50,8 +58,15 @@ int mpr_dev_set_from_msg(mpr_dev dev, mpr_msg msg);
 int mpr_dev_get_is_subscribed(mpr_dev dev);
 void mpr_dev_set_is_subscribed(mpr_dev dev, int subscribed);
 
+/*! Add, renew, or remove a subscription and bring the subscriber up to date.
+ *  \param dev          The local device.
+ *  \param address      The address of the subscriber.
+ *  \param flags        The types of objects subscribed to.
+ *  \param timeout_seconds  The lease of the subscription, or -1 to only request the current state.
+ *  \param since        The version of the device since which the subscriber only needs changed
+ *                      signals, or -1 to send every signal. */
 void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address address, int flags,
-                               int timeout_seconds, int revision);
+                               int timeout_seconds, int since);
 
 /*! Return the list of inter-device links associated with a given device.
  *  \param dev          Device record query.
@@ -67,6 +82,16 @@ mpr_list mpr_dev_get_maps(mpr_dev dev, mpr_dir dir);
  *  \return             Information about the signal, or zero if not found. */
 mpr_sig mpr_dev_get_sig_by_name(mpr_dev dev, const char *sig_name);
 
+/*! Add a signal to the device's name index used by `mpr_dev_get_sig_by_name()`.
+ *  \param dev          The device owning the signal.
+ *  \param sig          The signal to add. */
+void mpr_dev_index_sig(mpr_dev dev, mpr_sig sig);
+
+/*! Remove a signal from the device's name index. Does nothing if the signal is not indexed.
+ *  \param dev          The device owning the signal.
+ *  \param sig          The signal to remove. */
+void mpr_dev_unindex_sig(mpr_dev dev, mpr_sig sig);
+
 int mpr_dev_add_link(mpr_dev dev1, mpr_dev dev2);
 
 void mpr_dev_remove_link(mpr_dev dev1, mpr_dev dev2);
@@ -105,13 +130,40 @@ int mpr_dev_get_is_registered(mpr_dev dev);
 
 void mpr_local_dev_set_sending(mpr_local_dev dev);
 
+/*! Check whether a device may exchange updates with devices in other processes on the same host
+ *  through shared memory. */
+int mpr_local_dev_get_use_shm(mpr_local_dev dev);
+
+/*! Retrieve the send policy of a local device.
+ *  \return             The policy, or zero if updates should be sent without being held. */
+mpr_send_policy mpr_local_dev_get_send_policy(mpr_local_dev dev);
+
+/*! Add to the counters of updates sent by a local device, see mpr_dev_get_send_stats(). */
+void mpr_local_dev_add_send_stats(mpr_local_dev dev, int bundles, int msgs, int coalesced);
+
 void mpr_local_dev_set_receiving(mpr_local_dev dev);
 
+/*! Add a map to the incoming or outgoing processing queue of a local device. Only queued maps
+ *  are processed when the device is polled or its maps are updated. */
+void mpr_local_dev_queue_map(mpr_local_dev dev, mpr_local_map map, mpr_dir dir);
+
+/*! Remove all queue entries for a map that is about to be freed. */
+void mpr_local_dev_remove_queued_map(mpr_local_dev dev, mpr_local_map map);
+
 int mpr_local_dev_has_subscribers(mpr_local_dev dev);
 
+/*! Record that the metadata of a local signal has changed so that it will be sent to
+ *  subscribers. */
+void mpr_local_dev_set_sig_changed(mpr_local_dev dev, mpr_local_sig sig);
+
+/*! Send a bundle to the subscribers of a device that are subscribed to a given message type.
+ *  The bundle is serialised once and the same datagram is sent to each subscriber. */
 void mpr_local_dev_send_to_subscribers(mpr_local_dev dev, lo_bundle bundle, int msg_type,
                                        lo_server from);
 
+/*! Remove the subscriptions to a device whose leases have expired. */
+void mpr_local_dev_remove_expired_subscribers(mpr_local_dev dev);
+
 void mpr_local_dev_handler_name(mpr_local_dev dev, const char *name,
                                 int temp_id, int random_id, int hint);
 
@@ -139,6 +191,9 @@ int mpr_local_dev_get_num_id_maps(mpr_local_dev dev, int active);
 
 void mpr_dev_remove_id_map(mpr_local_dev dev, int group, mpr_id_map rem);
 
+/*! Change the GID of an id map, keeping the device's index of active id maps up to date. */
+void mpr_dev_set_id_map_GID(mpr_local_dev dev, int group, mpr_id_map id_map, mpr_id GID);
+
 #ifdef DEBUG
 void mpr_local_dev_print_id_maps(mpr_local_dev dev);
 #endif
@@ -5,9 +5,11 @@
 #include "map.h"
 #include "expression.h"
 #include "expression/expr_buffer.h"
+#include "expression/expr_compiler.h"
 #include "expression/expr_evaluator.h"
 #include "expression/expr_function.h"
 #include "expression/expr_operator.h"
+#include "expression/expr_optimizer.h"
 #include "expression/expr_parser.h"
 #include "expression/expr_stack.h"
 #include "expression/expr_struct.h"
@@ -26,16 +28,22 @@
 #define REDUCES_INST 0x04
 
 /* Reallocate evaluation stack if necessary. */
-void mpr_expr_realloc_eval_buffer(mpr_expr expr, mpr_expr_eval_buffer buff)
+void mpr_expr_realloc_eval_buffer(mpr_expr expr, mpr_expr_eval_buffer buff, unsigned int num_inst)
 {
-    ebuffer_realloc(buff, estack_get_eval_buffer_size(expr->stack), expr->stack->vec_len);
+    int num_slots = estack_get_eval_buffer_size(expr->stack);
+    if (num_slots < 0)
+        num_slots = 255;
+    ebuffer_realloc(buff, num_slots, expr->stack->vec_len);
+    /* Per-instance stacks for batched evaluation. Vector functions may also write a second result
+     * above the top of the stack. */
+    ebuffer_realloc_inst(buff, num_inst, num_slots + 1, expr->stack->vec_len, sizeof(ectx_t));
 }
 
 mpr_expr_eval_buffer mpr_expr_new_eval_buffer(mpr_expr expr)
 {
     mpr_expr_eval_buffer buff = ebuffer_new();
     if (expr)
-        ebuffer_realloc(buff, estack_get_eval_buffer_size(expr->stack), expr->stack->vec_len);
+        mpr_expr_realloc_eval_buffer(expr, buff, 0);
     return buff;
 }
 
@@ -121,6 +129,8 @@ mpr_expr mpr_expr_new_from_str(const char *str, unsigned int num_src, const mpr_
         return NULL;
     }
 
+    expr_optimize(expr);
+
     /* Check for maximum vector length used in stack */
     for (i = 0; i < expr->stack->num_tokens; i++) {
         estack_update_vec_len(expr->stack, expr->stack->tokens[i].gen.vec_len);
@@ -142,6 +152,7 @@ void mpr_expr_free(mpr_expr expr)
 {
     int i;
     FUNC_IF(free, expr->src_mlen);
+    eprog_free_all(expr);
     if (expr->flags & OWN_STACK)
         estack_free(expr->stack, 1);
     if (expr->num_vars && expr->vars) {
@@ -62,10 +62,36 @@ void mpr_expr_set_var_updated(mpr_expr expr, int var_idx);
 int mpr_expr_eval(mpr_expr expr, mpr_expr_eval_buffer buff, mpr_value *srcs, mpr_value *expr_vars,
                   mpr_value result, mpr_time *time, int inst_idx);
 
+/*! Evaluate the expression for all updated instances in a single pass over the compiled program.
+ *  Each instruction is applied to every instance before moving on to the next one. Results are
+ *  identical to calling `mpr_expr_eval()` for each updated instance in ascending order, which
+ *  callers should fall back to if this function returns 0.
+ *  \param buff         A preallocated expression evaluation buffer.
+ *  \param expr         The expression to use.
+ *  \param srcs         An array of `mpr_value` structures for sources.
+ *  \param expr_vars    An array of `mpr_value` structures for user variables.
+ *  \param result       A `mpr_value` structure for receiving the evaluation result.
+ *  \param time         The timestamp to associate with this evaluation.
+ *  \param inst_flags   Bitflags indicating which instances have been updated.
+ *  \param num_inst     Number of instances represented by `inst_flags`.
+ *  \param inst_status  Array of length `num_inst` for receiving the status of each updated
+ *                      instance, as returned by `mpr_expr_eval()`.
+ *  \result             The number of instances evaluated, or 0 if the instances could not be
+ *                      evaluated together. */
+int mpr_expr_eval_batch(mpr_expr expr, mpr_expr_eval_buffer buff, mpr_value *srcs,
+                        mpr_value *expr_vars, mpr_value result, mpr_time *time,
+                        mpr_bitflags inst_flags, unsigned int num_inst, uint8_t *inst_status);
+
 int mpr_expr_get_num_src(mpr_expr expr);
 
 mpr_expr_eval_buffer mpr_expr_new_eval_buffer(mpr_expr expr);
-void mpr_expr_realloc_eval_buffer(mpr_expr expr, mpr_expr_eval_buffer buff);
+/*! Size an evaluation buffer for the given expression. Evaluation never reallocates the buffer,
+ *  so this must be called whenever the expression or the number of instances changes.
+ *  \param expr         The expression to be evaluated using the buffer.
+ *  \param buff         The evaluation buffer.
+ *  \param num_inst     Number of instances that may be evaluated together by
+ *                      `mpr_expr_eval_batch()`. */
+void mpr_expr_realloc_eval_buffer(mpr_expr expr, mpr_expr_eval_buffer buff, unsigned int num_inst);
 void mpr_expr_free_eval_buffer(mpr_expr_eval_buffer eval_buff);
 
 void mpr_expr_update_mlen(mpr_expr expr, int idx, unsigned int mlen);
@@ -3,6 +3,8 @@
 
 #include "expr_value.h"
 
+struct _ectx;
+
 /* could we use mpr_value here instead, with stack idx instead of history idx?
  * pro: vectors, commonality with I/O
  * con: timetags wasted
@@ -14,6 +16,14 @@ typedef struct _ebuffer
     uint8_t *lens;
     unsigned int size;
     unsigned int len;
+
+    /* per-instance stacks and contexts for instance-batched evaluation */
+    evalue inst_vals;
+    uint8_t *inst_lens;
+    struct _ectx *inst_ctxs;
+    unsigned int inst_size;
+    unsigned int inst_len;
+    unsigned int num_inst;
 } *ebuffer;
 
 ebuffer ebuffer_new(void)
@@ -49,11 +59,34 @@ void ebuffer_realloc(ebuffer buff, uint8_t num_slots, uint8_t vec_len)
     }
 }
 
+/* Reallocate the per-instance evaluation stacks if necessary. */
+void ebuffer_realloc_inst(ebuffer buff, unsigned int num_inst, unsigned int num_slots,
+                          unsigned int vec_len, size_t ctx_size)
+{
+    if (!vec_len)
+        vec_len = 1;
+    if (buff->num_inst < num_inst) {
+        buff->num_inst = num_inst;
+        buff->inst_ctxs = realloc(buff->inst_ctxs, num_inst * ctx_size);
+    }
+    if (buff->inst_len < num_inst * num_slots) {
+        buff->inst_len = num_inst * num_slots;
+        buff->inst_lens = realloc(buff->inst_lens, buff->inst_len * sizeof(uint8_t));
+    }
+    if (buff->inst_size < num_inst * num_slots * vec_len) {
+        buff->inst_size = num_inst * num_slots * vec_len;
+        buff->inst_vals = realloc(buff->inst_vals, buff->inst_size * sizeof(evalue_t));
+    }
+}
+
 void ebuffer_free(ebuffer buff)
 {
     FUNC_IF(free, buff->vals);
     FUNC_IF(free, buff->types);
     FUNC_IF(free, buff->lens);
+    FUNC_IF(free, buff->inst_vals);
+    FUNC_IF(free, buff->inst_lens);
+    FUNC_IF(free, buff->inst_ctxs);
     free(buff);
 }
 
@@ -0,0 +1,898 @@
+#ifndef __MPR_EXPR_COMPILER_H__
+#define __MPR_EXPR_COMPILER_H__
+
+#include <fenv.h>
+#include <math.h>
+#include <errno.h>
+#include "expr_buffer.h"
+#include "expr_kernel.h"
+#include "expr_struct.h"
+#include "expr_token.h"
+
+/* The expression compiler translates a parsed token stack into a flat array of instructions, each
+ * holding a pointer to a handler that has been specialised for the operation and data types of
+ * its token. Stack positions and operand types are resolved once at compile time so that the
+ * handlers do not need to switch on token type, data type or stack pointer arithmetic at runtime.
+ *
+ * Only straight-line expressions are compiled: tokens that implement loops (reductions over
+ * history, instances, signals or vectors), timetag access, computed indices or instance management
+ * are left to the interpreter in `mpr_expr_eval()`, which remains the fallback for any expression
+ * or expression section that cannot be compiled. */
+
+#define EXEC_OK     0
+#define EXEC_SKIP   1   /* numeric error: skip to after the next assignment */
+#define EXEC_ABORT  2   /* missing input value: abandon evaluation */
+
+#define EPROG_UNCOMPILED    0
+#define EPROG_COMPILED      1
+#define EPROG_FAILED        2
+
+#define EPROG_USES_SRC      0x01
+#define EPROG_USES_VARS     0x02
+#define EPROG_SRC_FIRST     0x04    /* a source is read before any instruction that can fail */
+#define EPROG_ORDERED       0x08    /* instances must be evaluated in turn, e.g. for random() */
+
+typedef struct _ectx
+{
+    evalue vals;
+    uint8_t *lens;
+    mpr_value *v_in;
+    mpr_value *v_vars;
+    mpr_value v_out;
+    mpr_time *time;
+    expr_var_t *vars;
+    int inst_idx;
+    int status;
+    int vlen;
+    int next;               /* next instruction to execute in batched evaluation */
+} ectx_t, *ectx;
+
+struct _einstr;
+typedef int einstr_fn(struct _einstr *in, ectx ctx);
+
+typedef struct _einstr
+{
+    einstr_fn *fn;          /* handler specialised for this token and data type */
+    einstr_fn *cast;        /* optional type conversion applied to the result */
+    etoken tok;
+    void *aux;              /* resolved function pointer for TOK_FN and TOK_VFN */
+    int16_t sp;             /* stack offset of the instruction's first operand/result */
+    int16_t dp;             /* stack index of the instruction's first operand/result */
+    int16_t dp_from;        /* source stack index for TOK_COPY_FROM and TOK_MOVE */
+    uint8_t skip;           /* instruction index at which to resume after a numeric error */
+} einstr_t, *einstr;
+
+typedef struct _eprog
+{
+    einstr_t *instrs;
+    uint8_t num_instrs;
+    uint8_t start;          /* token offset at which this program starts */
+    uint8_t state;
+    uint8_t flags;
+    int16_t max_dp;         /* deepest stack slot used, checked against the eval buffer */
+} eprog_t, *eprog;
+
+MPR_INLINE static int _eprog_max(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+/* Replicates the operand length alignment performed by the interpreter for TOK_OP and TOK_FN;
+ * returns the length of the last operand. */
+MPR_INLINE static uint8_t _einstr_align(evalue vals, uint8_t *lens, int arity)
+{
+    int i, diff;
+    uint8_t max_len = lens[0];
+    for (i = 1; i < arity; i++)
+        max_len = _eprog_max(max_len, lens[i]);
+    diff = max_len - lens[0];
+    while (diff > 0) {
+        int min_diff = lens[0] > diff ? diff : lens[0];
+        evalue_cpy(&vals[lens[0]], vals, min_diff);
+        lens[0] += min_diff;
+        diff -= min_diff;
+    }
+    return arity ? lens[arity - 1] : 0;
+}
+
+#define CLEAR_FP_ERRORS()       \
+    feclearexcept(FE_ALL_EXCEPT);\
+    errno = 0;
+
+#define CHECK_FP_ERRORS()                                   \
+    return (errno || fetestexcept(FE_DIVBYZERO | FE_INVALID)) ? EXEC_SKIP : EXEC_OK;
+
+/* Literals */
+
+#define LITERAL_INSTR(T)                                                \
+static int einstr_lit_##T(einstr in, ectx ctx)                          \
+{                                                                       \
+    int i, len = in->tok->gen.vec_len;                                  \
+    evalue vals = ctx->vals + in->sp;                                   \
+    for (i = 0; i < len; i++)                                           \
+        vals[i].T = in->tok->lit.val.T;                                 \
+    ctx->lens[in->dp] = len;                                            \
+    return EXEC_OK;                                                     \
+}                                                                       \
+static int einstr_vlit_##T(einstr in, ectx ctx)                         \
+{                                                                       \
+    int i, len = in->tok->gen.vec_len;                                  \
+    evalue vals = ctx->vals + in->sp;                                   \
+    for (i = 0; i < len; i++)                                           \
+        vals[i].T = in->tok->lit.val.T##p[i];                           \
+    ctx->lens[in->dp] = len;                                            \
+    return EXEC_OK;                                                     \
+}
+LITERAL_INSTR(i)
+LITERAL_INSTR(f)
+LITERAL_INSTR(d)
+#undef LITERAL_INSTR
+
+/* Variable access (current sample only, static vector index) */
+
+MPR_INLINE static mpr_value _einstr_get_var(einstr in, ectx ctx)
+{
+    int idx = in->tok->var.idx;
+    if (VAR_Y == idx)
+        return ctx->v_out;
+    if (idx >= VAR_X) {
+        /* this expression references a source directly */
+        ctx->status &= ~EXPR_EVAL_DONE;
+        return ctx->v_in[idx - VAR_X];
+    }
+    return ctx->v_vars[idx];
+}
+
+#define VAR_INSTR(TYPE, T)                                              \
+static int einstr_var_##T(einstr in, ectx ctx)                          \
+{                                                                       \
+    int i, vec_idx, len, vlen;                                          \
+    evalue vals = ctx->vals + in->sp;                                   \
+    mpr_value v = _einstr_get_var(in, ctx);                             \
+    TYPE *a;                                                            \
+    if (mpr_value_get_num_samps(v, ctx->inst_idx) <= 0)                 \
+        return EXEC_ABORT;                                              \
+    vlen = mpr_value_get_vlen(v);                                       \
+    len = in->tok->gen.vec_len ? in->tok->gen.vec_len : vlen;           \
+    ctx->lens[in->dp] = len;                                            \
+    a = (TYPE*)mpr_value_get_value(v, ctx->inst_idx, 0);                \
+    vec_idx = in->tok->var.vec_idx % vlen;                              \
+    for (i = 0; i < len; i++) {                                         \
+        vals[i].T = a[vec_idx];                                         \
+        if (++vec_idx >= vlen)                                          \
+            vec_idx = 0;                                                \
+    }                                                                   \
+    return EXEC_OK;                                                     \
+}
+VAR_INSTR(int, i)
+VAR_INSTR(float, f)
+VAR_INSTR(double, d)
+#undef VAR_INSTR
+
+static int einstr_inst_idx(einstr in, ectx ctx)
+{
+    int i, len = in->tok->gen.vec_len;
+    evalue vals = ctx->vals + in->sp;
+    for (i = 0; i < len; i++)
+        vals[i].i = ctx->inst_idx;
+    ctx->lens[in->dp] = len;
+    return EXEC_OK;
+}
+
+/* Operators */
+
+#define BINARY_OP_INSTR(NAME, T, CHECK)                                 \
+static int einstr_##NAME##_##T(einstr in, ectx ctx)                     \
+{                                                                       \
+    evalue vals = ctx->vals + in->sp;                                   \
+    uint8_t *lens = ctx->lens + in->dp, rlen;                           \
+    CHECK(CLEAR_FP_ERRORS())                                            \
+    rlen = _einstr_align(vals, lens, 2);                                \
+    ekernel_##NAME##_##T(vals, vals + ctx->vlen, lens[0], rlen);        \
+    CHECK(CHECK_FP_ERRORS())                                            \
+    return EXEC_OK;                                                     \
+}
+
+#define FP_CHECKED(X) X
+#define FP_UNCHECKED(X)
+
+#define OP_INSTRS(T, CHECK)                                             \
+    BINARY_OP_INSTR(add, T, CHECK)                                      \
+    BINARY_OP_INSTR(sub, T, CHECK)                                      \
+    BINARY_OP_INSTR(mul, T, CHECK)                                      \
+    BINARY_OP_INSTR(eq, T, CHECK)                                       \
+    BINARY_OP_INSTR(neq, T, CHECK)                                      \
+    BINARY_OP_INSTR(lt, T, CHECK)                                       \
+    BINARY_OP_INSTR(lte, T, CHECK)                                      \
+    BINARY_OP_INSTR(gt, T, CHECK)                                       \
+    BINARY_OP_INSTR(gte, T, CHECK)                                      \
+    BINARY_OP_INSTR(and, T, CHECK)                                      \
+    BINARY_OP_INSTR(or, T, CHECK)                                       \
+static int einstr_not_##T(einstr in, ectx ctx)                          \
+{                                                                       \
+    int i;                                                              \
+    evalue vals = ctx->vals + in->sp;                                   \
+    for (i = 0; i < ctx->lens[in->dp]; i++)                             \
+        vals[i].T = !vals[i].T;                                         \
+    return EXEC_OK;                                                     \
+}                                                                       \
+static int einstr_if_else_##T(einstr in, ectx ctx)                      \
+{                                                                       \
+    int i, vlen = ctx->vlen;                                            \
+    evalue vals = ctx->vals + in->sp;                                   \
+    uint8_t *lens = ctx->lens + in->dp, rlen;                           \
+    rlen = _einstr_align(vals, lens, 2);                                \
+    for (i = 0; i < lens[0]; i++) {                                     \
+        if (!vals[i].T)                                                 \
+            vals[i].T = vals[vlen + i % rlen].T;                        \
+    }                                                                   \
+    return EXEC_OK;                                                     \
+}                                                                       \
+static int einstr_if_then_else_##T(einstr in, ectx ctx)                 \
+{                                                                       \
+    int i, vlen = ctx->vlen;                                            \
+    evalue vals = ctx->vals + in->sp;                                   \
+    uint8_t *lens = ctx->lens + in->dp, rlen;                           \
+    rlen = _einstr_align(vals, lens, 3);                                \
+    for (i = 0; i < lens[0]; i++) {                                     \
+        if (vals[i].T)                                                  \
+            vals[i].T = vals[vlen + i % rlen].T;                        \
+        else                                                            \
+            vals[i].T = vals[2 * vlen + i % lens[2]].T;                 \
+    }                                                                   \
+    return EXEC_OK;                                                     \
+}
+OP_INSTRS(i, FP_UNCHECKED)
+OP_INSTRS(f, FP_CHECKED)
+OP_INSTRS(d, FP_CHECKED)
+#undef OP_INSTRS
+
+BINARY_OP_INSTR(div, f, FP_CHECKED)
+BINARY_OP_INSTR(div, d, FP_CHECKED)
+BINARY_OP_INSTR(mod, i, FP_UNCHECKED)
+BINARY_OP_INSTR(lshift, i, FP_UNCHECKED)
+BINARY_OP_INSTR(rshift, i, FP_UNCHECKED)
+BINARY_OP_INSTR(bitand, i, FP_UNCHECKED)
+BINARY_OP_INSTR(bitor, i, FP_UNCHECKED)
+BINARY_OP_INSTR(bitxor, i, FP_UNCHECKED)
+#undef BINARY_OP_INSTR
+#undef FP_CHECKED
+#undef FP_UNCHECKED
+
+static int einstr_div_i(einstr in, ectx ctx)
+{
+    int i, j, vlen = ctx->vlen;
+    evalue vals = ctx->vals + in->sp;
+    uint8_t *lens = ctx->lens + in->dp, rlen = _einstr_align(vals, lens, 2);
+    for (i = 0, j = 0; i < lens[0]; i++, j = (j + 1) % rlen) {
+        /* Check for divide-by-zero */
+        if (!vals[vlen + j].i)
+            return EXEC_SKIP;
+        vals[i].i /= vals[vlen + j].i;
+    }
+    return EXEC_OK;
+}
+
+#define MOD_INSTR(FN, T)                                                \
+static int einstr_mod_##T(einstr in, ectx ctx)                          \
+{                                                                       \
+    int i, vlen = ctx->vlen;                                            \
+    evalue vals = ctx->vals + in->sp;                                   \
+    uint8_t *lens = ctx->lens + in->dp, rlen;                           \
+    CLEAR_FP_ERRORS();                                                  \
+    rlen = _einstr_align(vals, lens, 2);                                \
+    for (i = 0; i < lens[0]; i++)                                       \
+        vals[i].T = FN(vals[i].T, vals[vlen + i % rlen].T);             \
+    CHECK_FP_ERRORS();                                                  \
+}
+MOD_INSTR(fmodf, f)
+MOD_INSTR(fmod, d)
+#undef MOD_INSTR
+
+static einstr_fn *eop_lookup(expr_op_t op, mpr_type type)
+{
+    switch (type) {
+#define TYPED_CASE(MTYPE, T)                                            \
+        case MTYPE:                                                     \
+            switch (op) {                                               \
+                case OP_ADD:                        return einstr_add_##T;  \
+                case OP_SUBTRACT:                   return einstr_sub_##T;  \
+                case OP_MULTIPLY:                   return einstr_mul_##T;  \
+                case OP_DIVIDE:                     return einstr_div_##T;  \
+                case OP_MODULO:                     return einstr_mod_##T;  \
+                case OP_IS_EQUAL:                   return einstr_eq_##T;   \
+                case OP_IS_NOT_EQUAL:               return einstr_neq_##T;  \
+                case OP_IS_LESS_THAN:               return einstr_lt_##T;   \
+                case OP_IS_LESS_THAN_OR_EQUAL:      return einstr_lte_##T;  \
+                case OP_IS_GREATER_THAN:            return einstr_gt_##T;   \
+                case OP_IS_GREATER_THAN_OR_EQUAL:   return einstr_gte_##T;  \
+                case OP_LOGICAL_AND:                return einstr_and_##T;  \
+                case OP_LOGICAL_OR:                 return einstr_or_##T;   \
+                case OP_LOGICAL_NOT:                return einstr_not_##T;  \
+                case OP_IF_ELSE:                    return einstr_if_else_##T;      \
+                case OP_IF_THEN_ELSE:               return einstr_if_then_else_##T; \
+                default:                            break;                  \
+            }                                                           \
+            break;
+        TYPED_CASE(MPR_INT32, i)
+        TYPED_CASE(MPR_FLT, f)
+        TYPED_CASE(MPR_DBL, d)
+#undef TYPED_CASE
+        default:
+            return NULL;
+    }
+    if (MPR_INT32 != type)
+        return NULL;
+    switch (op) {
+        case OP_LEFT_BIT_SHIFT:     return einstr_lshift_i;
+        case OP_RIGHT_BIT_SHIFT:    return einstr_rshift_i;
+        case OP_BITWISE_AND:        return einstr_bitand_i;
+        case OP_BITWISE_OR:         return einstr_bitor_i;
+        case OP_BITWISE_XOR:        return einstr_bitxor_i;
+        default:                    return NULL;
+    }
+}
+
+/* Functions */
+
+#define FN_INSTRS(FN, T)                                                \
+static int einstr_fn0_##T(einstr in, ectx ctx)                          \
+{                                                                       \
+    int i;                                                              \
+    evalue vals = ctx->vals + in->sp;                                   \
+    CLEAR_FP_ERRORS();                                                  \
+    for (i = 0; i < ctx->lens[in->dp]; i++)                             \
+        vals[i].T = ((FN##_arity0*)in->aux)();                          \
+    CHECK_FP_ERRORS();                                                  \
+}                                                                       \
+static int einstr_fn1_##T(einstr in, ectx ctx)                          \
+{                                                                       \
+    int i;                                                              \
+    evalue vals = ctx->vals + in->sp;                                   \
+    CLEAR_FP_ERRORS();                                                  \
+    for (i = 0; i < ctx->lens[in->dp]; i++)                             \
+        vals[i].T = ((FN##_arity1*)in->aux)(vals[i].T);                 \
+    CHECK_FP_ERRORS();                                                  \
+}                                                                       \
+static int einstr_fn2_##T(einstr in, ectx ctx)                          \
+{                                                                       \
+    int i, j, vlen = ctx->vlen;                                         \
+    evalue vals = ctx->vals + in->sp;                                   \
+    uint8_t *lens = ctx->lens + in->dp, rlen;                           \
+    CLEAR_FP_ERRORS();                                                  \
+    rlen = _einstr_align(vals, lens, 2);                                \
+    for (i = 0, j = 0; i < lens[0]; i++, j = j + 1 < rlen ? j + 1 : 0)  \
+        vals[i].T = ((FN##_arity2*)in->aux)(vals[i].T, vals[vlen + j].T);\
+    CHECK_FP_ERRORS();                                                  \
+}                                                                       \
+static int einstr_fn3_##T(einstr in, ectx ctx)                          \
+{                                                                       \
+    int i, vlen = ctx->vlen;                                            \
+    evalue vals = ctx->vals + in->sp;                                   \
+    uint8_t *lens = ctx->lens + in->dp, rlen;                           \
+    CLEAR_FP_ERRORS();                                                  \
+    _einstr_align(vals, lens, 3);                                       \
+    rlen = lens[1];                                                     \
+    for (i = 0; i < lens[0]; i++)                                       \
+        vals[i].T = ((FN##_arity3*)in->aux)(vals[i].T, vals[vlen + i % rlen].T,    \
+                                            vals[2 * vlen + i % lens[2]].T);       \
+    CHECK_FP_ERRORS();                                                  \
+}                                                                       \
+static int einstr_fn4_##T(einstr in, ectx ctx)                          \
+{                                                                       \
+    int i, vlen = ctx->vlen;                                            \
+    evalue vals = ctx->vals + in->sp;                                   \
+    uint8_t *lens = ctx->lens + in->dp, rlen;                           \
+    CLEAR_FP_ERRORS();                                                  \
+    _einstr_align(vals, lens, 4);                                       \
+    rlen = lens[1];                                                     \
+    for (i = 0; i < lens[0]; i++)                                       \
+        vals[i].T = ((FN##_arity4*)in->aux)(vals[i].T, vals[vlen + i % rlen].T,    \
+                                            vals[2 * vlen + i % lens[2]].T,        \
+                                            vals[3 * vlen + i % lens[3]].T);       \
+    CHECK_FP_ERRORS();                                                  \
+}
+FN_INSTRS(fn_int, i)
+FN_INSTRS(fn_flt, f)
+FN_INSTRS(fn_dbl, d)
+#undef FN_INSTRS
+
+static einstr_fn *efn_lookup(int arity, mpr_type type)
+{
+    switch (type) {
+#define TYPED_CASE(MTYPE, T)                                            \
+        case MTYPE:                                                     \
+            switch (arity) {                                            \
+                case 0: return einstr_fn0_##T;                          \
+                case 1: return einstr_fn1_##T;                          \
+                case 2: return einstr_fn2_##T;                          \
+                case 3: return einstr_fn3_##T;                          \
+                case 4: return einstr_fn4_##T;                          \
+                default: return NULL;                                   \
+            }
+        TYPED_CASE(MPR_INT32, i)
+        TYPED_CASE(MPR_FLT, f)
+        TYPED_CASE(MPR_DBL, d)
+#undef TYPED_CASE
+        default:
+            return NULL;
+    }
+}
+
+static int einstr_vfn(einstr in, ectx ctx)
+{
+    int i, vlen = ctx->vlen, idx = in->tok->fn.idx, arity = vfn_tbl[idx].arity;
+    evalue vals = ctx->vals + in->sp;
+    uint8_t *lens = ctx->lens + in->dp;
+    CLEAR_FP_ERRORS();
+    if (VFN_CONCAT != idx && (arity > 1 || VFN_DOT == idx)) {
+        int max_len = in->tok->gen.vec_len;
+        for (i = 0; i < arity; i++)
+            max_len = max_len > lens[i] ? max_len : lens[i];
+        for (i = 0; i < arity; i++) {
+            /* we need to ensure the vector lengths are equal */
+            while (lens[i] < max_len) {
+                int diff = max_len - lens[i];
+                diff = diff < lens[i] ? diff : lens[i];
+                evalue_cpy(&vals[i * vlen + lens[i]], &vals[i * vlen], diff);
+                lens[i] += diff;
+            }
+        }
+    }
+    ((vfn_template*)in->aux)(vals, lens, vlen);
+    if (vfn_tbl[idx].reduce) {
+        for (i = 1; i < in->tok->gen.vec_len; i++)
+            vals[i].d = vals[0].d;
+        lens[0] = in->tok->gen.vec_len;
+    }
+    return (errno == EDOM || fetestexcept(FE_DIVBYZERO | FE_INVALID)) ? EXEC_SKIP : EXEC_OK;
+}
+
+/* Stack manipulation */
+
+static int einstr_sp_add(einstr in, ectx ctx)
+{
+    return EXEC_OK;
+}
+
+static int einstr_copy_from(einstr in, ectx ctx)
+{
+    ctx->lens[in->dp] = in->tok->gen.vec_len;
+    evalue_cpy(ctx->vals + in->sp, ctx->vals + in->dp_from * ctx->vlen, in->tok->gen.vec_len);
+    return EXEC_OK;
+}
+
+static int einstr_move(einstr in, ectx ctx)
+{
+    evalue_cpy(ctx->vals + in->sp, ctx->vals + in->dp_from * ctx->vlen, ctx->vlen);
+    ctx->lens[in->dp] = ctx->lens[in->dp_from];
+    return EXEC_OK;
+}
+
+static int einstr_vectorize(einstr in, ectx ctx)
+{
+    int i, j, vlen = ctx->vlen;
+    evalue vals = ctx->vals + in->sp;
+    uint8_t *lens = ctx->lens + in->dp;
+    /* don't need to copy vector elements from first token */
+    for (i = 1, j = lens[0]; i < in->tok->fn.arity; i++) {
+        evalue_cpy(&vals[j], &vals[i * vlen], lens[i]);
+        j += lens[i];
+    }
+    lens[0] = j;
+    return EXEC_OK;
+}
+
+/* Assignment (current sample only, static vector index) */
+
+#define ASSIGN_INSTR(TYPE, T)                                           \
+static int einstr_assign_##T(einstr in, ectx ctx)                       \
+{                                                                       \
+    mpr_value v;                                                        \
+    int i, j, vidx, idx = in->tok->var.idx, len = ctx->lens[in->dp];    \
+    evalue vals = ctx->vals + in->sp;                                   \
+    TYPE *a;                                                            \
+    if (VAR_Y == idx) {                                                 \
+        ctx->status |= EXPR_UPDATE;                                     \
+        v = ctx->v_out;                                                 \
+    }                                                                   \
+    else if (ctx->vars[idx].flags & VAR_SET_EXTERN)                     \
+        return EXEC_OK;                                                 \
+    else                                                                \
+        v = ctx->v_vars[idx];                                           \
+    vidx = in->tok->var.vec_idx % (int)mpr_value_get_vlen(v);           \
+    mpr_value_set_time(v, *ctx->time, ctx->inst_idx, 0);                \
+    a = (TYPE*)mpr_value_get_value(v, ctx->inst_idx, 0);                \
+    for (i = vidx, j = in->tok->var.offset; i < in->tok->gen.vec_len + vidx; i++, j++) {   \
+        if (j >= len) j = 0;                                            \
+        a[i] = vals[j].T;                                               \
+    }                                                                   \
+    mpr_value_set_elements_known(v, ctx->inst_idx, vidx, in->tok->gen.vec_len);    \
+    return EXEC_OK;                                                     \
+}
+ASSIGN_INSTR(int, i)
+ASSIGN_INSTR(float, f)
+ASSIGN_INSTR(double, d)
+#undef ASSIGN_INSTR
+
+/* Type conversion */
+
+#define CAST_INSTR(T0, TYPE1, T1)                                       \
+static int einstr_cast_##T0##T1(einstr in, ectx ctx)                    \
+{                                                                       \
+    int i;                                                              \
+    evalue vals = ctx->vals + in->sp;                                   \
+    for (i = 0; i < ctx->lens[in->dp]; i++)                             \
+        vals[i].T1 = (TYPE1)vals[i].T0;                                 \
+    return EXEC_OK;                                                     \
+}
+CAST_INSTR(i, float, f)
+CAST_INSTR(i, double, d)
+CAST_INSTR(f, int, i)
+CAST_INSTR(f, double, d)
+CAST_INSTR(d, int, i)
+CAST_INSTR(d, float, f)
+#undef CAST_INSTR
+
+static einstr_fn *ecast_lookup(mpr_type from, mpr_type to)
+{
+    switch (from) {
+#define TYPED_CASE(MTYPE0, T0, MTYPE1, T1, MTYPE2, T2)  \
+        case MTYPE0:                                    \
+            switch (to) {                               \
+                case MTYPE1: return einstr_cast_##T0##T1;   \
+                case MTYPE2: return einstr_cast_##T0##T2;   \
+                default:     return NULL;               \
+            }
+        TYPED_CASE(MPR_INT32, i, MPR_FLT, f, MPR_DBL, d)
+        TYPED_CASE(MPR_FLT, f, MPR_INT32, i, MPR_DBL, d)
+        TYPED_CASE(MPR_DBL, d, MPR_INT32, i, MPR_FLT, f)
+#undef TYPED_CASE
+        default:
+            return NULL;
+    }
+}
+
+#define TYPED_LOOKUP(NAME, TYPE)                                        \
+    (MPR_INT32 == TYPE ? NAME##_i : MPR_FLT == TYPE ? NAME##_f : MPR_DBL == TYPE ? NAME##_d : NULL)
+
+static void eprog_free(eprog prog)
+{
+    FUNC_IF(free, prog->instrs);
+    prog->instrs = NULL;
+    prog->num_instrs = 0;
+    prog->state = EPROG_UNCOMPILED;
+}
+
+/* Compile the token stack starting at token `start`. Returns 0 on success or -1 if the stack
+ * contains tokens that must be handled by the interpreter. */
+static int eprog_compile(eprog prog, mpr_expr expr, int start, mpr_value *v_in,
+                         mpr_value *v_vars, mpr_value v_out)
+{
+    estack stk = expr->stack;
+    etoken_t *tokens = stk->tokens;
+    int i, j, dp = -1, can_advance = 1, can_fail = 0, num = stk->num_tokens - start;
+    int vlen = stk->vec_len;
+    mpr_type types[256], type;
+    einstr in;
+
+    eprog_free(prog);
+    prog->start = start;
+    prog->state = EPROG_FAILED;
+    prog->flags = 0;
+    prog->max_dp = 0;
+    RETURN_ARG_UNLESS(num > 0 && expr->inst_ctl < 0 && expr->mute_ctl < 0, -1);
+
+    prog->instrs = calloc(1, sizeof(einstr_t) * num);
+    prog->num_instrs = num;
+
+    for (i = 0; i < num; i++) {
+        etoken tok = &tokens[start + i];
+        in = &prog->instrs[i];
+        in->tok = tok;
+
+        switch (tok->toktype) {
+            case TOK_LITERAL:
+            case TOK_VLITERAL:
+                ++dp;
+                types[dp] = tok->gen.datatype;
+                if (TOK_LITERAL == tok->toktype)
+                    in->fn = TYPED_LOOKUP(einstr_lit, types[dp]);
+                else
+                    in->fn = TYPED_LOOKUP(einstr_vlit, types[dp]);
+                break;
+            case TOK_VAR: {
+                mpr_value v;
+                int idx = tok->var.idx;
+                if (tok->gen.flags & VAR_IDXS)
+                    goto fail;
+                if (VAR_Y == idx)
+                    v = v_out;
+                else if (idx >= VAR_X && idx - VAR_X < expr->num_src && v_in) {
+                    v = v_in[idx - VAR_X];
+                    prog->flags |= EPROG_USES_SRC;
+                    if (!can_fail)
+                        prog->flags |= EPROG_SRC_FIRST;
+                }
+                else if (idx >= 0 && idx < expr->num_vars && v_vars) {
+                    v = v_vars[idx];
+                    prog->flags |= EPROG_USES_VARS;
+                }
+                else
+                    goto fail;
+                if (!v)
+                    goto fail;
+                ++dp;
+                types[dp] = mpr_value_get_type(v);
+                in->fn = TYPED_LOOKUP(einstr_var, types[dp]);
+                can_advance = 0;
+                break;
+            }
+            case TOK_VAR_INST_IDX:
+                ++dp;
+                types[dp] = MPR_INT32;
+                in->fn = einstr_inst_idx;
+                break;
+            case TOK_OP:
+                dp += 1 - op_tbl[tok->op.idx].arity;
+                if (dp < 0)
+                    goto fail;
+                in->fn = eop_lookup(tok->op.idx, types[dp]);
+                types[dp] = tok->gen.datatype;
+                can_fail = 1;
+                break;
+            case TOK_FN:
+                dp += 1 - fn_tbl[tok->fn.idx].arity;
+                if (dp < 0)
+                    goto fail;
+                types[dp] = tok->gen.datatype;
+                in->fn = efn_lookup(fn_tbl[tok->fn.idx].arity, types[dp]);
+                switch (types[dp]) {
+                    case MPR_INT32: in->aux = fn_tbl[tok->fn.idx].fn_int;   break;
+                    case MPR_FLT:   in->aux = fn_tbl[tok->fn.idx].fn_flt;   break;
+                    case MPR_DBL:   in->aux = fn_tbl[tok->fn.idx].fn_dbl;   break;
+                    default:                                                break;
+                }
+                if (!in->aux)
+                    goto fail;
+                if (tok->fn.idx > FN_DEL_IDX) {
+                    can_advance = 0;
+                    prog->flags |= EPROG_ORDERED;
+                }
+                can_fail = 1;
+                break;
+            case TOK_VFN:
+                dp += 1 - vfn_tbl[tok->fn.idx].arity;
+                if (dp < 0)
+                    goto fail;
+                types[dp] = tok->gen.datatype;
+                in->fn = einstr_vfn;
+                switch (types[dp]) {
+                    case MPR_INT32: in->aux = vfn_tbl[tok->fn.idx].fn_int;  break;
+                    case MPR_FLT:   in->aux = vfn_tbl[tok->fn.idx].fn_flt;  break;
+                    case MPR_DBL:   in->aux = vfn_tbl[tok->fn.idx].fn_dbl;  break;
+                    default:                                                break;
+                }
+                if (!in->aux)
+                    goto fail;
+                /* some vector functions also write a second result to the next stack slot */
+                prog->max_dp = _eprog_max(prog->max_dp, dp + 1);
+                can_fail = 1;
+                break;
+            case TOK_VECTORIZE:
+                dp += 1 - tok->fn.arity;
+                if (dp < 0)
+                    goto fail;
+                types[dp] = tok->gen.datatype;
+                in->fn = einstr_vectorize;
+                break;
+            case TOK_SP_ADD:
+                dp += tok->lit.val.i;
+                in->fn = einstr_sp_add;
+                break;
+            case TOK_COPY_FROM:
+                in->dp_from = dp - tok->con.cache_offset;
+                if (in->dp_from < 0)
+                    goto fail;
+                ++dp;
+                types[dp] = tok->gen.datatype;
+                in->fn = einstr_copy_from;
+                break;
+            case TOK_MOVE:
+                in->dp_from = dp;
+                dp -= tok->con.cache_offset;
+                if (dp < 0 || in->dp_from < 0)
+                    goto fail;
+                types[dp] = types[in->dp_from];
+                in->fn = einstr_move;
+                break;
+            case TOK_ASSIGN:
+            case TOK_ASSIGN_USE:
+            case TOK_ASSIGN_CONST: {
+                mpr_value v;
+                int idx = tok->var.idx;
+                if (tok->gen.flags & VAR_IDXS || tok->gen.casttype || dp < 0)
+                    goto fail;
+                if (VAR_Y == idx) {
+                    v = v_out;
+                    can_advance = 0;
+                }
+                else if (idx >= 0 && idx < expr->num_vars && v_vars) {
+                    v = v_vars[idx];
+                    prog->flags |= EPROG_USES_VARS;
+                }
+                else
+                    goto fail;
+                /* Constant assignments move the expression start offset; leave this to the
+                 * interpreter and compile the remaining section on a later evaluation. */
+                if (can_advance || start + i < stk->const_len || !v)
+                    goto fail;
+                in->fn = TYPED_LOOKUP(einstr_assign, mpr_value_get_type(v));
+                break;
+            }
+            default:
+                goto fail;
+        }
+        if (!in->fn || dp >= 255)
+            goto fail;
+
+        in->dp = dp;
+        in->sp = dp * vlen;
+        if (dp > prog->max_dp)
+            prog->max_dp = dp;
+
+        if (tok->toktype & TOK_ASSIGN) {
+            if (tok->gen.flags & CLEAR_STACK)
+                dp = -1;
+            else if (dp && TOK_ASSIGN_USE != tok->toktype)
+                --dp;
+        }
+        else if (tok->gen.casttype) {
+            if (dp < 0)
+                goto fail;
+            type = tok->gen.casttype;
+            if (type != types[dp]) {
+                in->cast = ecast_lookup(types[dp], type);
+                if (!in->cast)
+                    goto fail;
+                types[dp] = type;
+            }
+        }
+    }
+
+    /* Resolve the resume point following a numeric error, which is the instruction after the
+     * next group of assignment tokens. We require the stack to be cleared at this point so that
+     * stack positions remain static. */
+    for (i = 0; i < num; i++) {
+        for (j = i + 1; j < num && !(tokens[start + j].toktype & TOK_ASSIGN); j++) {}
+        if (j < num) {
+            while (j < num && tokens[start + j].toktype & TOK_ASSIGN)
+                ++j;
+            if (!(tokens[start + j - 1].gen.flags & CLEAR_STACK))
+                goto fail;
+        }
+        prog->instrs[i].skip = j;
+    }
+
+    prog->state = EPROG_COMPILED;
+    return 0;
+
+  fail:
+    free(prog->instrs);
+    prog->instrs = NULL;
+    prog->num_instrs = 0;
+    return -1;
+}
+
+/* Retrieve the compiled program for the expression section starting at token `start`, compiling
+ * it if necessary. Returns NULL if the section must be evaluated by the interpreter. */
+static eprog eprog_get(mpr_expr expr, ebuffer buff, int start, mpr_value *v_in,
+                       mpr_value *v_vars, mpr_value v_out)
+{
+    eprog prog;
+    if (!expr->progs)
+        expr->progs = calloc(1, sizeof(eprog_t) * 2);
+    /* keep separate programs for the full expression and for the section following any constant
+     * assignments, since the first evaluation of each instance always starts at token 0 */
+    prog = &expr->progs[start ? 1 : 0];
+    if (EPROG_UNCOMPILED == prog->state || prog->start != start)
+        eprog_compile(prog, expr, start, v_in, v_vars, v_out);
+    RETURN_ARG_UNLESS(EPROG_COMPILED == prog->state, NULL);
+    RETURN_ARG_UNLESS(!(prog->flags & EPROG_USES_SRC) || v_in, NULL);
+    RETURN_ARG_UNLESS(!(prog->flags & EPROG_USES_VARS) || v_vars, NULL);
+    RETURN_ARG_UNLESS(prog->max_dp < buff->len
+                      && (prog->max_dp + 1) * expr->stack->vec_len <= buff->size, NULL);
+    return prog;
+}
+
+static void eprog_free_all(mpr_expr expr)
+{
+    RETURN_UNLESS(expr->progs);
+    eprog_free(&expr->progs[0]);
+    eprog_free(&expr->progs[1]);
+    free(expr->progs);
+    expr->progs = NULL;
+}
+
+static int eprog_run(eprog prog, ectx ctx)
+{
+    einstr in = prog->instrs, end = in + prog->num_instrs;
+    while (in < end) {
+        switch (in->fn(in, ctx)) {
+            case EXEC_OK:
+                if (in->cast)
+                    in->cast(in, ctx);
+                ++in;
+                break;
+            case EXEC_SKIP:
+                if (in->skip >= prog->num_instrs)
+                    return 0;
+                in = prog->instrs + in->skip;
+                break;
+            default:
+                return 0;
+        }
+    }
+
+    /* Undo position increment if nothing was updated. */
+    if (!(ctx->status & EXPR_UPDATE))
+        mpr_value_decr_idx(ctx->v_out, ctx->inst_idx);
+    return ctx->status;
+}
+
+/* Check whether a set of instances can be evaluated together by `eprog_run_batch()`, producing
+ * the same results as evaluating each instance in turn. This requires that instances do not share
+ * any buffers written by the program, that random numbers are not drawn, and that every instance
+ * which completes evaluation has read a source, since otherwise the caller would stop after the
+ * first instance (`EXPR_EVAL_DONE`). */
+static int eprog_get_can_batch(eprog prog, mpr_value *v_vars, mpr_value v_out, int num_inst)
+{
+    int i;
+    RETURN_ARG_UNLESS(prog->flags & EPROG_SRC_FIRST && !(prog->flags & EPROG_ORDERED), 0);
+    RETURN_ARG_UNLESS(mpr_value_get_num_inst(v_out) >= num_inst, 0);
+    for (i = 0; i < prog->num_instrs; i++) {
+        etoken tok = prog->instrs[i].tok;
+        if (   tok->toktype & TOK_ASSIGN && VAR_Y != tok->var.idx
+            && mpr_value_get_num_inst(v_vars[tok->var.idx]) < num_inst)
+            return 0;
+    }
+    return 1;
+}
+
+/* Run the program once for a set of instances, applying each instruction to every instance
+ * before moving on to the next. Each context holds its own stack and resume point; instances
+ * that hit a numeric error skip ahead and rejoin at a later instruction. The final status of each
+ * instance is left in `ctx->status`. */
+static void eprog_run_batch(eprog prog, ectx ctxs, int num_ctxs)
+{
+    int i, j, num_instrs = prog->num_instrs;
+    for (i = 0; i < num_instrs; i++) {
+        einstr in = prog->instrs + i;
+        for (j = 0; j < num_ctxs; j++) {
+            ectx ctx = ctxs + j;
+            if (ctx->next != i)
+                continue;
+            switch (in->fn(in, ctx)) {
+                case EXEC_OK:
+                    if (in->cast)
+                        in->cast(in, ctx);
+                    ++ctx->next;
+                    break;
+                case EXEC_SKIP:
+                    ctx->next = in->skip < num_instrs ? in->skip : -1;
+                    break;
+                default:
+                    ctx->next = -1;
+            }
+        }
+    }
+    for (j = 0; j < num_ctxs; j++) {
+        ectx ctx = ctxs + j;
+        if (ctx->next < 0)
+            ctx->status = 0;
+        else if (!(ctx->status & EXPR_UPDATE))
+            mpr_value_decr_idx(ctx->v_out, ctx->inst_idx);
+    }
+}
+
+#endif /* __MPR_EXPR_COMPILER_H__ */
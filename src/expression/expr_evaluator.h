@@ -5,6 +5,8 @@
 #include <math.h>
 #include <errno.h>
 #include "expr_buffer.h"
+#include "expr_compiler.h"
+#include "expr_kernel.h"
 #include "expr_struct.h"
 #include "expr_token.h"
 #include <mapper/mapper.h>
@@ -17,13 +19,10 @@
         break;                                  \
     }
 
-#define BINARY_OP_CASE(OP, SYM, T)                                  \
-    case OP: {                                                      \
-        int i, j;                                                   \
-        for (i = 0, j = sp; i < lens[dp]; i++, j++)                 \
-            vals[j].T = vals[j].T SYM vals[sp + vlen + i % rlen].T; \
-        break;                                                      \
-    }
+#define BINARY_OP_CASE(OP, NAME, T)                                         \
+    case OP:                                                                \
+        ekernel_##NAME##_##T(vals + sp, vals + sp + vlen, lens[dp], rlen);  \
+        break;
 
 #define CONDITIONAL_CASES(T)                                        \
     case OP_IF_ELSE: {                                              \
@@ -46,17 +45,17 @@
     }
 
 #define OP_CASES_META(EL)                                   \
-    BINARY_OP_CASE(OP_ADD, +, EL);                          \
-    BINARY_OP_CASE(OP_SUBTRACT, -, EL);                     \
-    BINARY_OP_CASE(OP_MULTIPLY, *, EL);                     \
-    BINARY_OP_CASE(OP_IS_EQUAL, ==, EL);                    \
-    BINARY_OP_CASE(OP_IS_NOT_EQUAL, !=, EL);                \
-    BINARY_OP_CASE(OP_IS_LESS_THAN, <, EL);                 \
-    BINARY_OP_CASE(OP_IS_LESS_THAN_OR_EQUAL, <=, EL);       \
-    BINARY_OP_CASE(OP_IS_GREATER_THAN, >, EL);              \
-    BINARY_OP_CASE(OP_IS_GREATER_THAN_OR_EQUAL, >=, EL);    \
-    BINARY_OP_CASE(OP_LOGICAL_AND, &&, EL);                 \
-    BINARY_OP_CASE(OP_LOGICAL_OR, ||, EL);                  \
+    BINARY_OP_CASE(OP_ADD, add, EL);                        \
+    BINARY_OP_CASE(OP_SUBTRACT, sub, EL);                   \
+    BINARY_OP_CASE(OP_MULTIPLY, mul, EL);                   \
+    BINARY_OP_CASE(OP_IS_EQUAL, eq, EL);                    \
+    BINARY_OP_CASE(OP_IS_NOT_EQUAL, neq, EL);               \
+    BINARY_OP_CASE(OP_IS_LESS_THAN, lt, EL);                \
+    BINARY_OP_CASE(OP_IS_LESS_THAN_OR_EQUAL, lte, EL);      \
+    BINARY_OP_CASE(OP_IS_GREATER_THAN, gt, EL);             \
+    BINARY_OP_CASE(OP_IS_GREATER_THAN_OR_EQUAL, gte, EL);   \
+    BINARY_OP_CASE(OP_LOGICAL_AND, and, EL);                \
+    BINARY_OP_CASE(OP_LOGICAL_OR, or, EL);                  \
     UNARY_OP_CASE(OP_LOGICAL_NOT, =!, EL);                  \
     CONDITIONAL_CASES(EL);
 
@@ -109,7 +108,7 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
     etoken_t *tok = stk->tokens, *end = tok + stk->num_tokens;
     int dp = -1, sp = -stk->vec_len, status = 1 | EXPR_EVAL_DONE;
     /* Note: signal, history, and vector reduce are currently limited to 255 items here */
-    uint8_t alive = 1, muted = 0, can_advance = 1, cache = 0, vlen = stk->vec_len;
+    uint8_t alive = 1, muted = 0, can_advance = 1, const_ok = 1, cache = 0, vlen = stk->vec_len;
     uint8_t hist_offset = 0, sig_offset = 0, vec_offset = 0;
     mpr_value x = NULL;
 
@@ -154,6 +153,27 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
         }
     }
 
+#if !TRACE_EVAL
+    if (v_in && v_out && time) {
+        /* use the compiled program for this section of the expression if available */
+        eprog prog = eprog_get(expr, buff, tok - stk->tokens, v_in, v_vars, v_out);
+        if (prog) {
+            ectx_t ctx;
+            ctx.vals = vals;
+            ctx.lens = lens;
+            ctx.v_in = v_in;
+            ctx.v_vars = v_vars;
+            ctx.v_out = v_out;
+            ctx.time = time;
+            ctx.vars = expr->vars;
+            ctx.inst_idx = inst_idx;
+            ctx.status = status;
+            ctx.vlen = vlen;
+            return eprog_run(prog, &ctx);
+        }
+    }
+#endif
+
 #if TRACE_EVAL
     printf("instruction\targuments\t\tresult\n");
 
@@ -540,12 +560,12 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
                             }
                             break;
                         }
-                        BINARY_OP_CASE(OP_MODULO, %, i);
-                        BINARY_OP_CASE(OP_LEFT_BIT_SHIFT, <<, i);
-                        BINARY_OP_CASE(OP_RIGHT_BIT_SHIFT, >>, i);
-                        BINARY_OP_CASE(OP_BITWISE_AND, &, i);
-                        BINARY_OP_CASE(OP_BITWISE_OR, |, i);
-                        BINARY_OP_CASE(OP_BITWISE_XOR, ^, i);
+                        BINARY_OP_CASE(OP_MODULO, mod, i);
+                        BINARY_OP_CASE(OP_LEFT_BIT_SHIFT, lshift, i);
+                        BINARY_OP_CASE(OP_RIGHT_BIT_SHIFT, rshift, i);
+                        BINARY_OP_CASE(OP_BITWISE_AND, bitand, i);
+                        BINARY_OP_CASE(OP_BITWISE_OR, bitor, i);
+                        BINARY_OP_CASE(OP_BITWISE_XOR, bitxor, i);
                         default: goto error;
                     }
                     break;
@@ -553,7 +573,7 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
                 case MPR_FLT: {
                     switch (tok->op.idx) {
                         OP_CASES_META(f);
-                        BINARY_OP_CASE(OP_DIVIDE, /, f);
+                        BINARY_OP_CASE(OP_DIVIDE, div, f);
                         case OP_MODULO: {
                             int i;
                             for (i = 0; i < max_len; i++)
@@ -567,7 +587,7 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
                 case MPR_DBL: {
                     switch (tok->op.idx) {
                         OP_CASES_META(d);
-                        BINARY_OP_CASE(OP_DIVIDE, /, d);
+                        BINARY_OP_CASE(OP_DIVIDE, div, d);
                         case OP_MODULO: {
                             int i;
                             for (i = 0; i < max_len; i++)
@@ -590,7 +610,7 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
             break;
         }
         case TOK_FN: {
-            int i, diff;
+            int i, j, diff;
             uint8_t max_len, llen, rlen = 0, arity = fn_tbl[tok->fn.idx].arity;
             INCR_STACK_PTR(1 - arity);
             /* TODO: use preprocessor macro or inline func here */
@@ -623,9 +643,9 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
                                           (vals[sp + i].T));                            \
                     break;                                                              \
                 case 2:                                                                 \
-                    for (i = 0; i < llen; i++)                                          \
+                    for (i = 0, j = 0; i < llen; i++, j = j + 1 < rlen ? j + 1 : 0)     \
                         vals[sp + i].T = (((FN##_arity2*)fn_tbl[tok->fn.idx].FN)        \
-                                          (vals[sp + i].T, vals[sp + vlen + i % rlen].T));\
+                                          (vals[sp + i].T, vals[sp + vlen + j].T));     \
                     break;                                                              \
                 case 3:                                                                 \
                     for (i = 0; i < llen; i++)                                          \
@@ -1065,7 +1085,8 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
             /* If assignment was constant or history initialization, move expr
              * start token pointer so we don't evaluate this section again. */
 
-            if (can_advance || tok->gen.flags & VAR_HIST_IDX) {
+            if (can_advance || tok->gen.flags & VAR_HIST_IDX
+                || (const_ok && tok - stk->tokens < stk->const_len)) {
 #if TRACE_EVAL
                 printf("\n     move start\t%ld\n", tok - stk->tokens + 1);
 #endif
@@ -1190,6 +1211,8 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
 #if TRACE_EVAL
             printf("     error detected, skipping assignment\n");
 #endif
+    /* the failed assignment will need to be evaluated again */
+    const_ok = 0;
     while (tok < end && !((++tok)->toktype & TOK_ASSIGN)) {}
     while (tok < end && (tok)->toktype & TOK_ASSIGN) {
         if (tok->gen.flags & CLEAR_STACK) {
@@ -1210,4 +1233,73 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
     return 0;
 }
 
+int mpr_expr_eval_batch(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_vars,
+                        mpr_value v_out, mpr_time *time, mpr_bitflags inst_flags,
+                        unsigned int num_inst, uint8_t *inst_status)
+{
+#if TRACE_EVAL
+    return 0;
+#else
+    estack stk = expr->stack;
+    eprog progs[2] = {NULL, NULL};
+    int i, j, k, num = 0, num_first = 0, num_slots = 0, stride;
+
+    RETURN_ARG_UNLESS(v_in && v_out && time && inst_flags, 0);
+
+    /* All updated instances must be handled by compiled programs. The first evaluation of an
+     * instance starts at token 0, later evaluations after any constant assignments. */
+    for (i = mpr_bitflags_get_next(inst_flags, 0); i >= 0 && i < num_inst;
+         i = mpr_bitflags_get_next(inst_flags, i + 1)) {
+        int start;
+        start = mpr_value_get_num_samps(v_out, i) > 0 ? stk->offset : 0;
+        j = start ? 1 : 0;
+        if (!progs[j]) {
+            progs[j] = eprog_get(expr, buff, start, v_in, v_vars, v_out);
+            RETURN_ARG_UNLESS(progs[j] && eprog_get_can_batch(progs[j], v_vars, v_out, num_inst), 0);
+            num_slots = _eprog_max(num_slots, progs[j]->max_dp + 1);
+        }
+        if (!j)
+            ++num_first;
+        ++num;
+    }
+    RETURN_ARG_UNLESS(num > 1, 0);
+
+    /* the buffer is sized in advance by mpr_expr_realloc_eval_buffer() */
+    stride = stk->vec_len ? stk->vec_len : 1;
+    RETURN_ARG_UNLESS(   num <= buff->num_inst && num * num_slots <= buff->inst_len
+                      && num * num_slots * stride <= buff->inst_size, 0);
+
+    /* instances starting at token 0 are placed first, the remainder after them */
+    for (i = mpr_bitflags_get_next(inst_flags, 0), j = 0, k = num_first; i >= 0 && i < num_inst;
+         i = mpr_bitflags_get_next(inst_flags, i + 1)) {
+        ectx ctx;
+        if (mpr_value_get_num_samps(v_out, i) > 0 && stk->offset)
+            ctx = buff->inst_ctxs + k++;
+        else
+            ctx = buff->inst_ctxs + j++;
+        ctx->vals = buff->inst_vals + (ctx - buff->inst_ctxs) * num_slots * stride;
+        ctx->lens = buff->inst_lens + (ctx - buff->inst_ctxs) * num_slots;
+        ctx->v_in = v_in;
+        ctx->v_vars = v_vars;
+        ctx->v_out = v_out;
+        ctx->time = time;
+        ctx->vars = expr->vars;
+        ctx->inst_idx = i;
+        ctx->status = 1 | EXPR_EVAL_DONE;
+        ctx->vlen = stk->vec_len;
+        ctx->next = 0;
+        mpr_value_cpy_next(v_out, i, *time);
+    }
+
+    if (num_first)
+        eprog_run_batch(progs[0], buff->inst_ctxs, num_first);
+    if (num > num_first)
+        eprog_run_batch(progs[1], buff->inst_ctxs + num_first, num - num_first);
+
+    for (i = 0; i < num; i++)
+        inst_status[buff->inst_ctxs[i].inst_idx] = buff->inst_ctxs[i].status;
+    return num;
+#endif
+}
+
 #endif /* __MPR_EXPR_EVALUATOR_H__ */
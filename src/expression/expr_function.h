@@ -3,6 +3,7 @@
 
 #include <ctype.h>
 #include <math.h>
+#include "expr_kernel.h"
 #include "expr_operator.h"
 #include "expr_value.h"
 
@@ -89,11 +90,7 @@ LEN_VFUNC(vlend, double, d)
 #define SUM_VFUNC(NAME, TYPE, T)                    \
 static void NAME(evalue val, uint8_t *dim, int inc) \
 {                                                   \
-    register TYPE aggregate = 0;                    \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++)                       \
-        aggregate += val[i].T;                      \
-    val[0].T = aggregate;                           \
+    val[0].T = ekernel_sum_##T(val, dim[0]);        \
 }
 SUM_VFUNC(vsumi, int, i)
 SUM_VFUNC(vsumf, float, f)
@@ -204,11 +201,8 @@ MEDIAN_VFUNC(vmediand, double, d)
 #define NORM_VFUNC(NAME, TYPE, T)                   \
 static void NAME(evalue val, uint8_t *dim, int inc) \
 {                                                   \
-    register TYPE tmp = 0;                          \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++)                       \
-        tmp += pow##T(val[i].T, 2);                 \
-    val[0].T = sqrt##T(tmp);                        \
+    TYPE sumsq = ekernel_dot_##T(val, val, dim[0]); \
+    val[0].T = sqrt##T(sumsq);                      \
 }
 NORM_VFUNC(vnormf, float, f)
 NORM_VFUNC(vnormd, double, d)
@@ -216,12 +210,7 @@ NORM_VFUNC(vnormd, double, d)
 #define DOT_VFUNC(NAME, TYPE, T)                    \
 static void NAME(evalue a, uint8_t *dim, int inc)   \
 {                                                   \
-    register TYPE dot = 0;                          \
-    evalue b = a + inc;                             \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++)                       \
-        dot += a[i].T * b[i].T;                     \
-    a[0].T = dot;                                   \
+    a[0].T = ekernel_dot_##T(a, a + inc, dim[0]);   \
 }
 DOT_VFUNC(vdoti, int, i)
 DOT_VFUNC(vdotf, float, f)
@@ -0,0 +1,329 @@
+#ifndef __MPR_EXPR_KERNEL_H__
+#define __MPR_EXPR_KERNEL_H__
+
+#include "expr_value.h"
+
+/* Elementwise and reduction kernels for vector operands on the evaluation stack. Binary kernels
+ * compute a[i] = a[i] OP b[i % blen] for i < len, but handle the common cases of equal lengths and
+ * scalar broadcast with separate loops so that no modulo is computed per element. Floating-point
+ * arithmetic and the sum, dot product and sum of squares reductions additionally use SSE2 on x86
+ * or NEON on AArch64 when available, with the scalar loops as fallback.
+ *
+ * Stack values are stored as evalue unions, so consecutive floats are 8 bytes apart; the float
+ * kernels pack four of these into one vector register and unpack the results again. */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define EKERNEL_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define EKERNEL_NEON 1
+#endif
+
+/* Vectorised loops return the number of elements processed; the caller completes the rest. */
+
+#if EKERNEL_SSE2
+
+#define _EKERNEL_LOAD_F(P)                                                      \
+    _mm_shuffle_ps(_mm_loadu_ps(&(P)[0].f), _mm_loadu_ps(&(P)[2].f), _MM_SHUFFLE(2, 0, 2, 0))
+#define _EKERNEL_STORE_F(P, V)                                                  \
+    _mm_storeu_ps(&(P)[0].f, _mm_unpacklo_ps(V, V));                            \
+    _mm_storeu_ps(&(P)[2].f, _mm_unpackhi_ps(V, V));
+
+#define EKERNEL_SIMD_F(NAME, VOP)                                               \
+MPR_INLINE static int _ekernel_v##NAME##_f(evalue a, evalue b, int len)         \
+{                                                                               \
+    int i;                                                                      \
+    for (i = 0; i + 4 <= len; i += 4) {                                         \
+        __m128 r = VOP(_EKERNEL_LOAD_F(a + i), _EKERNEL_LOAD_F(b + i));         \
+        _EKERNEL_STORE_F(a + i, r);                                             \
+    }                                                                           \
+    return i;                                                                   \
+}                                                                               \
+MPR_INLINE static int _ekernel_s##NAME##_f(evalue a, float b, int len)          \
+{                                                                               \
+    int i;                                                                      \
+    __m128 vb = _mm_set1_ps(b);                                                 \
+    for (i = 0; i + 4 <= len; i += 4) {                                         \
+        __m128 r = VOP(_EKERNEL_LOAD_F(a + i), vb);                             \
+        _EKERNEL_STORE_F(a + i, r);                                             \
+    }                                                                           \
+    return i;                                                                   \
+}
+
+#define EKERNEL_SIMD_D(NAME, VOP)                                               \
+MPR_INLINE static int _ekernel_v##NAME##_d(evalue a, evalue b, int len)         \
+{                                                                               \
+    int i;                                                                      \
+    for (i = 0; i + 2 <= len; i += 2)                                           \
+        _mm_storeu_pd(&a[i].d, VOP(_mm_loadu_pd(&a[i].d), _mm_loadu_pd(&b[i].d)));\
+    return i;                                                                   \
+}                                                                               \
+MPR_INLINE static int _ekernel_s##NAME##_d(evalue a, double b, int len)         \
+{                                                                               \
+    int i;                                                                      \
+    __m128d vb = _mm_set1_pd(b);                                                \
+    for (i = 0; i + 2 <= len; i += 2)                                           \
+        _mm_storeu_pd(&a[i].d, VOP(_mm_loadu_pd(&a[i].d), vb));                 \
+    return i;                                                                   \
+}
+
+EKERNEL_SIMD_F(add, _mm_add_ps)
+EKERNEL_SIMD_F(sub, _mm_sub_ps)
+EKERNEL_SIMD_F(mul, _mm_mul_ps)
+EKERNEL_SIMD_F(div, _mm_div_ps)
+EKERNEL_SIMD_D(add, _mm_add_pd)
+EKERNEL_SIMD_D(sub, _mm_sub_pd)
+EKERNEL_SIMD_D(mul, _mm_mul_pd)
+EKERNEL_SIMD_D(div, _mm_div_pd)
+
+MPR_INLINE static int _ekernel_vdot_f(evalue a, evalue b, int len, float *ret)
+{
+    int i;
+    float tmp[4];
+    __m128 acc = _mm_setzero_ps();
+    for (i = 0; i + 4 <= len; i += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_EKERNEL_LOAD_F(a + i), _EKERNEL_LOAD_F(b + i)));
+    _mm_storeu_ps(tmp, acc);
+    *ret = (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+    return i;
+}
+
+MPR_INLINE static int _ekernel_vsum_f(evalue a, int len, float *ret)
+{
+    int i;
+    float tmp[4];
+    __m128 acc = _mm_setzero_ps();
+    for (i = 0; i + 4 <= len; i += 4)
+        acc = _mm_add_ps(acc, _EKERNEL_LOAD_F(a + i));
+    _mm_storeu_ps(tmp, acc);
+    *ret = (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+    return i;
+}
+
+MPR_INLINE static int _ekernel_vdot_d(evalue a, evalue b, int len, double *ret)
+{
+    int i;
+    double tmp[2];
+    __m128d acc = _mm_setzero_pd();
+    for (i = 0; i + 2 <= len; i += 2)
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(&a[i].d), _mm_loadu_pd(&b[i].d)));
+    _mm_storeu_pd(tmp, acc);
+    *ret = tmp[0] + tmp[1];
+    return i;
+}
+
+MPR_INLINE static int _ekernel_vsum_d(evalue a, int len, double *ret)
+{
+    int i;
+    double tmp[2];
+    __m128d acc = _mm_setzero_pd();
+    for (i = 0; i + 2 <= len; i += 2)
+        acc = _mm_add_pd(acc, _mm_loadu_pd(&a[i].d));
+    _mm_storeu_pd(tmp, acc);
+    *ret = tmp[0] + tmp[1];
+    return i;
+}
+
+#elif EKERNEL_NEON
+
+/* vld2q/vst2q de-interleave the float and padding words of four evalues */
+#define EKERNEL_SIMD_F(NAME, VOP)                                               \
+MPR_INLINE static int _ekernel_v##NAME##_f(evalue a, evalue b, int len)         \
+{                                                                               \
+    int i;                                                                      \
+    for (i = 0; i + 4 <= len; i += 4) {                                         \
+        float32x4x2_t va = vld2q_f32(&a[i].f), vb = vld2q_f32(&b[i].f);         \
+        va.val[0] = VOP(va.val[0], vb.val[0]);                                  \
+        vst2q_f32(&a[i].f, va);                                                 \
+    }                                                                           \
+    return i;                                                                   \
+}                                                                               \
+MPR_INLINE static int _ekernel_s##NAME##_f(evalue a, float b, int len)          \
+{                                                                               \
+    int i;                                                                      \
+    float32x4_t vb = vdupq_n_f32(b);                                            \
+    for (i = 0; i + 4 <= len; i += 4) {                                         \
+        float32x4x2_t va = vld2q_f32(&a[i].f);                                  \
+        va.val[0] = VOP(va.val[0], vb);                                         \
+        vst2q_f32(&a[i].f, va);                                                 \
+    }                                                                           \
+    return i;                                                                   \
+}
+
+#define EKERNEL_SIMD_D(NAME, VOP)                                               \
+MPR_INLINE static int _ekernel_v##NAME##_d(evalue a, evalue b, int len)         \
+{                                                                               \
+    int i;                                                                      \
+    for (i = 0; i + 2 <= len; i += 2)                                           \
+        vst1q_f64(&a[i].d, VOP(vld1q_f64(&a[i].d), vld1q_f64(&b[i].d)));        \
+    return i;                                                                   \
+}                                                                               \
+MPR_INLINE static int _ekernel_s##NAME##_d(evalue a, double b, int len)         \
+{                                                                               \
+    int i;                                                                      \
+    float64x2_t vb = vdupq_n_f64(b);                                            \
+    for (i = 0; i + 2 <= len; i += 2)                                           \
+        vst1q_f64(&a[i].d, VOP(vld1q_f64(&a[i].d), vb));                        \
+    return i;                                                                   \
+}
+
+EKERNEL_SIMD_F(add, vaddq_f32)
+EKERNEL_SIMD_F(sub, vsubq_f32)
+EKERNEL_SIMD_F(mul, vmulq_f32)
+EKERNEL_SIMD_F(div, vdivq_f32)
+EKERNEL_SIMD_D(add, vaddq_f64)
+EKERNEL_SIMD_D(sub, vsubq_f64)
+EKERNEL_SIMD_D(mul, vmulq_f64)
+EKERNEL_SIMD_D(div, vdivq_f64)
+
+MPR_INLINE static int _ekernel_vdot_f(evalue a, evalue b, int len, float *ret)
+{
+    int i;
+    float32x4_t acc = vdupq_n_f32(0.f);
+    for (i = 0; i + 4 <= len; i += 4)
+        acc = vmlaq_f32(acc, vld2q_f32(&a[i].f).val[0], vld2q_f32(&b[i].f).val[0]);
+    *ret = vaddvq_f32(acc);
+    return i;
+}
+
+MPR_INLINE static int _ekernel_vsum_f(evalue a, int len, float *ret)
+{
+    int i;
+    float32x4_t acc = vdupq_n_f32(0.f);
+    for (i = 0; i + 4 <= len; i += 4)
+        acc = vaddq_f32(acc, vld2q_f32(&a[i].f).val[0]);
+    *ret = vaddvq_f32(acc);
+    return i;
+}
+
+MPR_INLINE static int _ekernel_vdot_d(evalue a, evalue b, int len, double *ret)
+{
+    int i;
+    float64x2_t acc = vdupq_n_f64(0.);
+    for (i = 0; i + 2 <= len; i += 2)
+        acc = vmlaq_f64(acc, vld1q_f64(&a[i].d), vld1q_f64(&b[i].d));
+    *ret = vaddvq_f64(acc);
+    return i;
+}
+
+MPR_INLINE static int _ekernel_vsum_d(evalue a, int len, double *ret)
+{
+    int i;
+    float64x2_t acc = vdupq_n_f64(0.);
+    for (i = 0; i + 2 <= len; i += 2)
+        acc = vaddq_f64(acc, vld1q_f64(&a[i].d));
+    *ret = vaddvq_f64(acc);
+    return i;
+}
+
+#else /* scalar fallback */
+
+#define EKERNEL_SIMD_F(NAME, VOP)                                               \
+MPR_INLINE static int _ekernel_v##NAME##_f(evalue a, evalue b, int len) { return 0; } \
+MPR_INLINE static int _ekernel_s##NAME##_f(evalue a, float b, int len) { return 0; }
+#define EKERNEL_SIMD_D(NAME, VOP)                                               \
+MPR_INLINE static int _ekernel_v##NAME##_d(evalue a, evalue b, int len) { return 0; } \
+MPR_INLINE static int _ekernel_s##NAME##_d(evalue a, double b, int len) { return 0; }
+
+EKERNEL_SIMD_F(add, 0)
+EKERNEL_SIMD_F(sub, 0)
+EKERNEL_SIMD_F(mul, 0)
+EKERNEL_SIMD_F(div, 0)
+EKERNEL_SIMD_D(add, 0)
+EKERNEL_SIMD_D(sub, 0)
+EKERNEL_SIMD_D(mul, 0)
+EKERNEL_SIMD_D(div, 0)
+
+#define _ekernel_vdot_f(A, B, LEN, RET) 0
+#define _ekernel_vsum_f(A, LEN, RET)    0
+#define _ekernel_vdot_d(A, B, LEN, RET) 0
+#define _ekernel_vsum_d(A, LEN, RET)    0
+
+#endif
+
+#undef EKERNEL_SIMD_F
+#undef EKERNEL_SIMD_D
+
+/* Operations without a vectorised implementation */
+#define _ekernel_vnone(A, B, LEN) 0
+#define _ekernel_snone(A, B, LEN) 0
+
+#define EKERNEL_BINARY(NAME, SYM, TYPE, T, SIMD)                                \
+static void ekernel_##NAME##_##T(evalue a, evalue b, int len, int blen)         \
+{                                                                               \
+    int i, j;                                                                   \
+    if (1 == blen) {                                                            \
+        register TYPE b0 = b[0].T;                                              \
+        for (i = _ekernel_s##SIMD(a, b0, len); i < len; i++)                    \
+            a[i].T = a[i].T SYM b0;                                             \
+    }                                                                           \
+    else if (blen >= len) {                                                     \
+        for (i = _ekernel_v##SIMD(a, b, len); i < len; i++)                     \
+            a[i].T = a[i].T SYM b[i].T;                                         \
+    }                                                                           \
+    else {                                                                      \
+        for (i = 0; i < len; i += blen) {                                       \
+            int n = len - i < blen ? len - i : blen;                            \
+            evalue ai = a + i;                                                  \
+            for (j = 0; j < n; j++)                                             \
+                ai[j].T = ai[j].T SYM b[j].T;                                   \
+        }                                                                       \
+    }                                                                           \
+}
+
+#define EKERNEL_BINARY_TYPES(NAME, SYM, SIMD_F, SIMD_D) \
+    EKERNEL_BINARY(NAME, SYM, int, i, none)             \
+    EKERNEL_BINARY(NAME, SYM, float, f, SIMD_F)         \
+    EKERNEL_BINARY(NAME, SYM, double, d, SIMD_D)
+
+EKERNEL_BINARY_TYPES(add, +, add_f, add_d)
+EKERNEL_BINARY_TYPES(sub, -, sub_f, sub_d)
+EKERNEL_BINARY_TYPES(mul, *, mul_f, mul_d)
+EKERNEL_BINARY_TYPES(eq, ==, none, none)
+EKERNEL_BINARY_TYPES(neq, !=, none, none)
+EKERNEL_BINARY_TYPES(lt, <, none, none)
+EKERNEL_BINARY_TYPES(lte, <=, none, none)
+EKERNEL_BINARY_TYPES(gt, >, none, none)
+EKERNEL_BINARY_TYPES(gte, >=, none, none)
+EKERNEL_BINARY_TYPES(and, &&, none, none)
+EKERNEL_BINARY_TYPES(or, ||, none, none)
+EKERNEL_BINARY(div, /, float, f, div_f)
+EKERNEL_BINARY(div, /, double, d, div_d)
+EKERNEL_BINARY(mod, %, int, i, none)
+EKERNEL_BINARY(lshift, <<, int, i, none)
+EKERNEL_BINARY(rshift, >>, int, i, none)
+EKERNEL_BINARY(bitand, &, int, i, none)
+EKERNEL_BINARY(bitor, |, int, i, none)
+EKERNEL_BINARY(bitxor, ^, int, i, none)
+#undef EKERNEL_BINARY_TYPES
+#undef EKERNEL_BINARY
+
+/* Reductions */
+
+#define EKERNEL_REDUCE(TYPE, T, VSUM, VDOT)                                     \
+MPR_INLINE static TYPE ekernel_sum_##T(evalue a, int len)                       \
+{                                                                               \
+    TYPE ret = 0;                                                               \
+    int i = VSUM(a, len, &ret);                                                 \
+    for (; i < len; i++)                                                        \
+        ret += a[i].T;                                                          \
+    return ret;                                                                 \
+}                                                                               \
+MPR_INLINE static TYPE ekernel_dot_##T(evalue a, evalue b, int len)             \
+{                                                                               \
+    TYPE ret = 0;                                                               \
+    int i = VDOT(a, b, len, &ret);                                              \
+    for (; i < len; i++)                                                        \
+        ret += a[i].T * b[i].T;                                                 \
+    return ret;                                                                 \
+}
+
+#define _ekernel_vsum_i(A, LEN, RET)    0
+#define _ekernel_vdot_i(A, B, LEN, RET) 0
+EKERNEL_REDUCE(int, i, _ekernel_vsum_i, _ekernel_vdot_i)
+EKERNEL_REDUCE(float, f, _ekernel_vsum_f, _ekernel_vdot_f)
+EKERNEL_REDUCE(double, d, _ekernel_vsum_d, _ekernel_vdot_d)
+#undef EKERNEL_REDUCE
+
+#endif /* __MPR_EXPR_KERNEL_H__ */
@@ -0,0 +1,392 @@
+#ifndef __MPR_EXPR_OPTIMIZER_H__
+#define __MPR_EXPR_OPTIMIZER_H__
+
+#include "expr_stack.h"
+#include "expr_struct.h"
+#include "expr_token.h"
+
+/* Optimisation passes run once over the token stack after parsing. Subtrees consisting only of
+ * literals have already been folded by `precompute()` during parsing; the passes here handle the
+ * remaining cases that can only be recognised once the whole stack has been built:
+ *
+ *   - conditionals with a constant condition are replaced by the branch that would be taken
+ *   - chains of integer additions, subtractions or multiplications by literals are combined
+ *   - repeated reads of the same variable within a statement are replaced by a copy of the
+ *     value already on the stack
+ *   - the leading run of statements that do not depend on the sources or on any later assignment
+ *     is marked as constant so that it is skipped after the first evaluation
+ *
+ * Stacks containing loops or explicit stack manipulation are left untouched by the first three
+ * passes since token positions and stack depths would need to be rewritten. */
+
+static int etoken_get_type(etoken tok)
+{
+    return tok->gen.casttype ? tok->gen.casttype : tok->gen.datatype;
+}
+
+static void estack_remove_tokens(estack stk, int idx, int num)
+{
+    int i;
+    for (i = idx; i < idx + num; i++)
+        etoken_free(&stk->tokens[i]);
+    memmove(&stk->tokens[idx], &stk->tokens[idx + num],
+            sizeof(etoken_t) * (stk->num_tokens - idx - num));
+    stk->num_tokens -= num;
+}
+
+static int estack_get_can_optimize(estack stk)
+{
+    int i;
+    for (i = 0; i < stk->num_tokens; i++) {
+        switch (stk->tokens[i].toktype) {
+            case TOK_LOOP_START:
+            case TOK_LOOP_END:
+            case TOK_COPY_FROM:
+            case TOK_MOVE:
+            case TOK_SP_ADD:
+            case TOK_REDUCING:
+                return 0;
+            default:
+                break;
+        }
+    }
+    return 1;
+}
+
+/* Count references to the input signals in the token range [start, end). */
+static int estack_count_src_refs(estack stk, int start, int end)
+{
+    int i, count = 0;
+    for (i = start; i < end; i++) {
+        etoken tok = &stk->tokens[i];
+        if (TOK_VAR == tok->toktype && tok->var.idx >= VAR_X_NEWEST)
+            ++count;
+    }
+    return count;
+}
+
+/* Replace the tokens in the range [start, end] with the substack of length `len` at `keep`, which
+ * must lie inside the range. */
+static void estack_replace_range(estack stk, int start, int end, int keep, int len)
+{
+    int i;
+    for (i = start; i <= end; i++) {
+        if (i < keep || i >= keep + len)
+            etoken_free(&stk->tokens[i]);
+    }
+    memmove(&stk->tokens[start], &stk->tokens[keep], sizeof(etoken_t) * len);
+    memmove(&stk->tokens[start + len], &stk->tokens[end + 1],
+            sizeof(etoken_t) * (stk->num_tokens - end - 1));
+    stk->num_tokens -= end - start + 1 - len;
+}
+
+/* Replace conditional operators with a literal condition by the branch that would be selected.
+ * Branches that refer to the input signals are kept. */
+static int estack_fold_branches(estack stk)
+{
+    int i, num_removed = 0;
+    etoken_t *tokens = stk->tokens;
+
+    for (i = 0; i < stk->num_tokens; i++) {
+        int j, idx, arity, keep, start[3], len[3];
+        etoken op = &tokens[i], top;
+        if (TOK_OP != op->toktype)
+            continue;
+        if (OP_IF_THEN_ELSE == op->op.idx)
+            arity = 3;
+        else if (OP_IF_ELSE == op->op.idx)
+            arity = 2;
+        else
+            continue;
+
+        /* locate the operand substacks */
+        for (j = arity - 1, idx = i - 1; j >= 0; j--) {
+            len[j] = estack_get_substack_len(stk, idx);
+            start[j] = idx - len[j] + 1;
+            idx -= len[j];
+        }
+        if (len[0] != 1 || TOK_LITERAL != tokens[start[0]].toktype || tokens[start[0]].gen.casttype)
+            continue;
+        if (etoken_get_is_0(&tokens[start[0]]))
+            keep = arity - 1;
+        else
+            keep = 3 == arity ? 1 : 0;
+
+        /* all operands must already have the type and length of the result */
+        for (j = 0; j < arity; j++) {
+            etoken t = &tokens[start[j] + len[j] - 1];
+            if (etoken_get_type(t) != op->gen.datatype)
+                break;
+            if (j && t->gen.vec_len != op->gen.vec_len)
+                break;
+        }
+        if (j < arity)
+            continue;
+        top = &tokens[start[keep] + len[keep] - 1];
+        if (top->gen.vec_len != op->gen.vec_len || (op->gen.casttype && top->gen.casttype))
+            continue;
+        /* references to the sources determine instance handling and muting and must be kept */
+        if (estack_count_src_refs(stk, start[0], i)
+            != estack_count_src_refs(stk, start[keep], start[keep] + len[keep]))
+            continue;
+
+#if TRACE_PARSE
+        printf("optimizer: replacing conditional at token %d with operand %d\n", i, keep);
+#endif
+        if (op->gen.casttype)
+            top->gen.casttype = op->gen.casttype;
+        top->gen.flags |= (op->gen.flags & CLEAR_STACK);
+        estack_replace_range(stk, start[0], i, start[keep], len[keep]);
+        num_removed += i - start[0] + 1 - len[keep];
+        i = start[0] + len[keep] - 1;
+    }
+    return num_removed;
+}
+
+/* Combine sequences of the form (a + c1) + c2 into a + (c1 + c2). This is only done for integer
+ * operands, for which the result is exact. */
+static int estack_fold_int_literals(estack stk)
+{
+    int i, num_removed = 0;
+    etoken_t *tokens = stk->tokens;
+
+    for (i = 0; i + 3 < stk->num_tokens; i++) {
+        etoken c1 = &tokens[i], op1 = &tokens[i + 1], c2 = &tokens[i + 2], op2 = &tokens[i + 3];
+        int sign = 1;
+        if (TOK_LITERAL != c1->toktype || TOK_OP != op1->toktype
+            || TOK_LITERAL != c2->toktype || TOK_OP != op2->toktype)
+            continue;
+        if (c1->gen.flags & CLEAR_STACK || op1->gen.flags & CLEAR_STACK || c2->gen.flags & CLEAR_STACK)
+            continue;
+        if (MPR_INT32 != etoken_get_type(c1) || MPR_INT32 != etoken_get_type(c2)
+            || MPR_INT32 != op1->gen.datatype || MPR_INT32 != op2->gen.datatype
+            || c1->gen.casttype || c2->gen.casttype || op1->gen.casttype)
+            continue;
+        if (c1->gen.vec_len != op1->gen.vec_len || c2->gen.vec_len != op2->gen.vec_len
+            || op1->gen.vec_len != op2->gen.vec_len)
+            continue;
+
+        switch (op1->op.idx) {
+            case OP_ADD:
+            case OP_SUBTRACT:
+                if (OP_SUBTRACT == op2->op.idx)
+                    sign = -1;
+                else if (OP_ADD != op2->op.idx)
+                    continue;
+                /* a - c1 + c2 == a - (c1 - c2) */
+                if (OP_SUBTRACT == op1->op.idx)
+                    sign *= -1;
+                c1->lit.val.i += sign * c2->lit.val.i;
+                break;
+            case OP_MULTIPLY:
+                if (OP_MULTIPLY != op2->op.idx)
+                    continue;
+                c1->lit.val.i *= c2->lit.val.i;
+                break;
+            default:
+                continue;
+        }
+
+#if TRACE_PARSE
+        printf("optimizer: combining integer literals at token %d\n", i);
+#endif
+        op1->gen.casttype = op2->gen.casttype;
+        op1->gen.flags |= (op2->gen.flags & CLEAR_STACK);
+        estack_remove_tokens(stk, i + 2, 2);
+        num_removed += 2;
+        /* step back in case this completes another chain */
+        i = i > 2 ? i - 3 : -1;
+    }
+    return num_removed;
+}
+
+/* Replace repeated reads of a variable with a copy of the value already on the stack. Candidate
+ * reads are tracked on a simulated stack and invalidated by any assignment. */
+static int estack_reuse_reads(estack stk, expr_var_t *vars, int num_vars)
+{
+    int i, dp = -1, num_reused = 0;
+    int16_t *src;
+    etoken_t *tokens = stk->tokens;
+
+    RETURN_ARG_UNLESS(stk->num_tokens, 0);
+    /* for each stack position, the index of the token whose read result it holds, or -1 */
+    src = malloc(sizeof(int16_t) * stk->num_tokens);
+
+    for (i = 0; i < stk->num_tokens; i++) {
+        etoken tok = &tokens[i];
+        switch (tok->toktype) {
+            case TOK_VAR: {
+                int j, eligible = !(tok->gen.flags & VAR_IDXS) && tok->gen.vec_len
+                                  && VAR_X_NEWEST != tok->var.idx;
+                if (eligible && tok->var.idx < N_USER_VARS)
+                    eligible = tok->var.idx < num_vars && vars[tok->var.idx].datatype == tok->gen.datatype;
+                dp -= NUM_VAR_IDXS(tok->gen.flags);
+                ++dp;
+                src[dp] = -1;
+                if (!eligible)
+                    break;
+                for (j = 0; j < dp; j++) {
+                    etoken prev;
+                    if (src[j] < 0)
+                        continue;
+                    prev = &tokens[src[j]];
+                    if (prev->var.idx != tok->var.idx || prev->var.vec_idx != tok->var.vec_idx
+                        || prev->gen.vec_len != tok->gen.vec_len || prev->gen.flags != tok->gen.flags
+                        || prev->gen.datatype != tok->gen.datatype
+                        || etoken_get_type(prev) != etoken_get_type(tok))
+                        continue;
+#if TRACE_PARSE
+                    printf("optimizer: replacing read at token %d with copy of token %d\n",
+                           i, src[j]);
+#endif
+                    tok->toktype = TOK_COPY_FROM;
+                    tok->gen.datatype = etoken_get_type(prev);
+                    tok->gen.casttype = 0;
+                    tok->con.cache_offset = dp - 1 - j;
+                    ++num_reused;
+                    break;
+                }
+                if (TOK_VAR == tok->toktype)
+                    src[dp] = i;
+                break;
+            }
+            case TOK_LITERAL:
+            case TOK_VLITERAL:
+            case TOK_VAR_NUM_INST:
+            case TOK_VAR_INST_IDX:
+                ++dp;
+                src[dp] = -1;
+                break;
+            case TOK_TT:
+                dp += 1 - NUM_VAR_IDXS(tok->gen.flags);
+                src[dp] = -1;
+                break;
+            case TOK_OP:
+                dp += 1 - op_tbl[tok->op.idx].arity;
+                src[dp] = -1;
+                break;
+            case TOK_FN:
+                dp += 1 - fn_tbl[tok->fn.idx].arity;
+                src[dp] = -1;
+                break;
+            case TOK_VFN:
+                dp += 1 - vfn_tbl[tok->fn.idx].arity;
+                src[dp] = -1;
+                break;
+            case TOK_VECTORIZE:
+                dp += 1 - tok->fn.arity;
+                src[dp] = -1;
+                break;
+            case TOK_ASSIGN:
+            case TOK_ASSIGN_USE:
+            case TOK_ASSIGN_CONST:
+            case TOK_ASSIGN_TT: {
+                int j;
+                dp -= NUM_VAR_IDXS(tok->gen.flags);
+                if (tok->gen.flags & CLEAR_STACK)
+                    dp = -1;
+                else if (dp >= 0 && TOK_ASSIGN_USE != tok->toktype)
+                    --dp;
+                /* the assigned variable may have been read earlier */
+                for (j = 0; j <= dp; j++)
+                    src[j] = -1;
+                break;
+            }
+            default:
+                /* unexpected token: abandon the pass without making further changes */
+                free(src);
+                return num_reused;
+        }
+        if (dp < -1 || dp >= stk->num_tokens)
+            break;
+    }
+    free(src);
+    return num_reused;
+}
+
+/* Find the leading run of statements whose results cannot change between evaluations: assignments
+ * to user variables computed only from literals and from variables assigned earlier in the run,
+ * none of which are assigned again later in the expression. The evaluator skips these statements
+ * once they have been evaluated. */
+static int estack_get_const_len(estack stk, int inst_ctl, int mute_ctl)
+{
+    int i, j, start, const_len, assigned, limit = stk->num_tokens;
+    etoken_t *tokens = stk->tokens;
+
+    while (1) {
+        const_len = start = assigned = 0;
+        for (i = 0; i < limit; i++) {
+            etoken tok = &tokens[i];
+            if (!(TOK_ASSIGN & tok->toktype) || !(tok->gen.flags & CLEAR_STACK))
+                continue;
+            /* statement spans tokens [start, i] */
+            if ((TOK_ASSIGN != tok->toktype && TOK_ASSIGN_CONST != tok->toktype)
+                || tok->gen.flags & VAR_IDXS || tok->var.idx < 0 || tok->var.idx >= N_USER_VARS
+                || tok->var.idx == inst_ctl || tok->var.idx == mute_ctl)
+                break;
+            for (j = start; j < i; j++) {
+                etoken t = &tokens[j];
+                if (TOK_LITERAL == t->toktype || TOK_VLITERAL == t->toktype || TOK_OP == t->toktype
+                    || TOK_VECTORIZE == t->toktype || TOK_COPY_FROM == t->toktype)
+                    continue;
+                if (TOK_FN == t->toktype && t->fn.idx < FN_DEL_IDX)
+                    continue;
+                if (TOK_VFN == t->toktype && !vfn_tbl[t->fn.idx].memory)
+                    continue;
+                if (TOK_VAR == t->toktype && !(t->gen.flags & VAR_IDXS) && t->var.idx >= 0
+                    && t->var.idx < N_USER_VARS && assigned & (1 << t->var.idx))
+                    continue;
+                break;
+            }
+            if (j < i)
+                break;
+            assigned |= 1 << tok->var.idx;
+            start = const_len = i + 1;
+        }
+        RETURN_ARG_UNLESS(const_len, 0);
+
+        /* variables assigned in the run must not be assigned again afterwards */
+        for (i = const_len; i < stk->num_tokens; i++) {
+            etoken tok = &tokens[i];
+            if (TOK_ASSIGN & tok->toktype && tok->var.idx >= 0 && tok->var.idx < N_USER_VARS
+                && assigned & (1 << tok->var.idx))
+                break;
+        }
+        if (i >= stk->num_tokens)
+            return const_len;
+
+        /* shorten the run to end before the first statement assigning this variable */
+        j = tokens[i].var.idx;
+        for (i = 0; i < const_len; i++) {
+            if (TOK_ASSIGN & tokens[i].toktype && tokens[i].var.idx == j)
+                break;
+        }
+        while (i > 0 && !(TOK_ASSIGN & tokens[i - 1].toktype && tokens[i - 1].gen.flags & CLEAR_STACK))
+            --i;
+        limit = i;
+    }
+    return 0;
+}
+
+static void expr_optimize(mpr_expr expr)
+{
+    estack stk = expr->stack;
+    int num_tokens = stk->num_tokens;
+
+    if (estack_get_can_optimize(stk)) {
+        estack_fold_branches(stk);
+        estack_fold_int_literals(stk);
+        estack_reuse_reads(stk, expr->vars, expr->num_vars);
+    }
+    stk->const_len = estack_get_const_len(stk, expr->inst_ctl, expr->mute_ctl);
+
+#if TRACE_PARSE
+    printf("optimizer: removed %d tokens, %d constant\n", num_tokens - stk->num_tokens,
+           stk->const_len);
+    estack_print("optimized stack", stk, expr->vars, 0);
+#else
+    (void)num_tokens;
+#endif
+}
+
+#endif /* __MPR_EXPR_OPTIMIZER_H__ */
@@ -12,6 +12,7 @@ typedef struct _estack
     uint8_t offset;
     uint8_t num_tokens;
     uint8_t vec_len;
+    uint8_t const_len;      /* number of leading tokens that only need to be evaluated once */
 } estack_t, *estack;
 
 #if TRACE_PARSE
@@ -31,6 +32,7 @@ void estack_cpy(estack to, estack from)
     to->num_tokens = from->num_tokens;
     to->vec_len = from->vec_len;
     to->offset = from->offset;
+    to->const_len = from->const_len;
     to->tokens = malloc(sizeof(etoken_t) * (size_t)from->num_tokens);
     memcpy(to->tokens, from->tokens, sizeof(etoken_t) * (size_t)from->num_tokens);
 
@@ -254,7 +256,12 @@ static int precompute(estack stk, uint8_t num_tokens_to_compute)
 
     /* temporarily set the stk 'offset' variable */
     stk->offset = stk->num_tokens - num_tokens_to_compute;
+    /* the evaluation stack stride must fit the longest vector being computed */
     stk->vec_len = vec_len;
+    for (i = stk->offset; i < stk->num_tokens; i++) {
+        if (stk->tokens[i].gen.vec_len > stk->vec_len)
+            stk->vec_len = stk->tokens[i].gen.vec_len;
+    }
     expr = mpr_expr_new(0, 0, stk);
     buff = mpr_expr_new_eval_buffer(expr);
     val = mpr_value_new(vec_len, type, 1, 1);
@@ -795,7 +802,10 @@ static int estack_get_eval_buffer_size(estack stk)
     while (i < stk->num_tokens && tok->toktype != TOK_END) {
         switch (tok->toktype) {
             case TOK_LITERAL:
+            case TOK_VLITERAL:
             case TOK_VAR:
+            case TOK_VAR_NUM_INST:
+            case TOK_VAR_INST_IDX:
             case TOK_TT:
             case TOK_COPY_FROM:
             case TOK_OP:
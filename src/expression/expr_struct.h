@@ -4,6 +4,8 @@
 #include "expr_stack.h"
 #include "expr_variable.h"
 
+struct _eprog;
+
 struct _mpr_expr
 {
     estack stack;
@@ -16,6 +18,7 @@ struct _mpr_expr
     int8_t mute_ctl;
     int8_t num_src;
     int8_t flags;
+    struct _eprog *progs;   /* compiled sections of the token stack, see expr_compiler.h */
 };
 
 #endif /* __MPR_EXPR_STRUCT_H__ */
@@ -8,6 +8,7 @@
 
 #endif
 
+#include "arena.h"
 #include "graph.h"
 #include "link.h"
 #include "mpr_time.h"
@@ -62,13 +63,13 @@ typedef struct _mpr_graph {
     mpr_list sigs;                  /*!< List of signals. */
     mpr_list maps;                  /*!< List of maps. */
     mpr_list links;                 /*!< List of links. */
+    mpr_arena arena;                /*!< Memory for objects, slots and property tables. */
+    mpr_strtab strings;             /*!< Interned names, units, keys and string properties. */
     fptr_list callbacks;            /*!< List of object record callbacks. */
 
     /*! Linked-list of autorenewing device subscriptions. */
     mpr_subscription subscriptions;
 
-    mpr_expr_eval_buffer expr_eval_buff;
-
     /*! Flags indicating whether information on signals and mappings should
      *  be automatically subscribed to when a new device is seen.*/
     int autosub;
@@ -79,6 +80,23 @@ typedef struct _mpr_graph {
     uint32_t resource_counter;
 } mpr_graph_t;
 
+static size_t get_obj_size(int obj_type, int is_local)
+{
+    switch (obj_type) {
+        case MPR_DEV:  return mpr_dev_get_struct_size(is_local);
+        case MPR_LINK: return mpr_link_get_struct_size();
+        case MPR_MAP:  return mpr_map_get_struct_size(is_local);
+        case MPR_SIG:  return mpr_sig_get_struct_size(is_local);
+        default:       return 0;
+    }
+}
+
+/* Release the memory of an object that has been removed from its list. */
+static void free_obj_mem(mpr_graph g, mpr_obj o)
+{
+    mpr_list_free_item(o, get_obj_size(o->type, o->is_local), g->arena);
+}
+
 static mpr_list *get_list_internal(mpr_graph g, int obj_type)
 {
     switch (obj_type) {
@@ -136,6 +154,7 @@ static void set_net_dst(mpr_graph g, mpr_dev d)
 static void send_subscribe_msg(mpr_graph g, mpr_dev d, int flags, int timeout)
 {
     char cmd[1024];
+    mpr_subscription s = g->subscriptions;
     NEW_LO_MSG(msg, return);
     snprintf(cmd, 1024, "/%s/subscribe", mpr_dev_get_name(d)); /* MSG_SUBSCRIBE */
 
@@ -168,6 +187,15 @@ static void send_subscribe_msg(mpr_graph g, mpr_dev d, int flags, int timeout)
     lo_message_add_string(msg, "@version");
     lo_message_add_int32(msg, mpr_obj_get_version((mpr_obj)d));
 
+    /* Only ask for the changes since the recorded version of the device if we already hold its
+     * records for every type of object subscribed to. */
+    while (s && s->dev != d)
+        s = s->next;
+    if (s && !(flags & ~s->flags)) {
+        lo_message_add_string(msg, "@since");
+        lo_message_add_int32(msg, mpr_obj_get_version((mpr_obj)d));
+    }
+
     mpr_net_add_msg(g->net, cmd, 0, msg);
     mpr_net_send(g->net);
 }
@@ -265,6 +293,8 @@ mpr_graph mpr_graph_new(int subscribe_flags)
     RETURN_ARG_UNLESS(subscribe_flags <= MPR_OBJ, NULL);
     g = (mpr_graph) calloc(1, sizeof(mpr_graph_t));
     RETURN_ARG_UNLESS(g, NULL);
+    g->arena = mpr_arena_new();
+    g->strings = mpr_strtab_new(g->arena);
 
     mpr_obj_init((mpr_obj)g, g, MPR_GRAPH);
     g->obj.id = 0;
@@ -274,14 +304,12 @@ mpr_graph mpr_graph_new(int subscribe_flags)
         autosubscribe(g, subscribe_flags);
 
     /* TODO: consider whether graph objects should sync properties over the network. */
-    tbl = g->obj.props.synced = mpr_tbl_new();
+    tbl = g->obj.props.synced = mpr_tbl_new(g->arena, g->strings);
     mpr_tbl_link_value(tbl, MPR_PROP_DATA, 1, MPR_PTR, &g->obj.data,
                        MOD_LOCAL | INDIRECT | LOCAL_ACCESS | PROP_SET);
     mpr_tbl_add_record(tbl, MPR_PROP_LIBVER, NULL, 1, MPR_STR, PACKAGE_VERSION, MOD_NONE);
     /* TODO: add object queries as properties. */
 
-    g->expr_eval_buff = mpr_expr_new_eval_buffer(NULL);
-
     return g;
 }
 
@@ -343,9 +371,12 @@ void mpr_graph_free(mpr_graph g)
         mpr_graph_remove_dev(g, (mpr_dev)dev, MPR_STATUS_REMOVED);
     }
 
-    FUNC_IF(mpr_expr_free_eval_buffer, g->expr_eval_buff);
     mpr_net_free(g->net);
     mpr_obj_free(&g->obj);
+
+    /* any remaining object memory is released along with the arena */
+    mpr_strtab_free(g->strings);
+    mpr_arena_free(g->arena);
     free(g);
 }
 
@@ -506,7 +537,7 @@ mpr_dev mpr_graph_add_dev(mpr_graph g, const char *name, mpr_msg props, const ch
 
     if (!dev) {
         mpr_id id = mpr_id_from_str(no_slash);
-        dev = (mpr_dev)mpr_list_add_item((void**)&g->devs, mpr_dev_get_struct_size(0), 0);
+        dev = (mpr_dev)mpr_list_add_item((void**)&g->devs, mpr_dev_get_struct_size(0), 0, g->arena);
         mpr_obj_init((mpr_obj)dev, g, MPR_DEV);
         mpr_dev_init(dev, 0, no_slash, id);
 #ifdef DEBUG
@@ -580,7 +611,7 @@ void mpr_graph_remove_dev(mpr_graph g, mpr_dev d, mpr_graph_evt e)
 
     mpr_obj_free((mpr_obj)d);
     mpr_dev_free_mem(d);
-    mpr_list_free_item(d);
+    free_obj_mem(g, (mpr_obj)d);
 }
 
 mpr_dev mpr_graph_get_dev_by_name(mpr_graph g, const char *name)
@@ -615,9 +646,10 @@ mpr_sig mpr_graph_add_sig(mpr_graph g, const char *name, const char *dev_name, m
 
     if (!sig) {
         int num_inst = 1;
-        sig = (mpr_sig)mpr_list_add_item((void**)&g->sigs, mpr_sig_get_struct_size(0), 0);
+        sig = (mpr_sig)mpr_list_add_item((void**)&g->sigs, mpr_sig_get_struct_size(0), 0, g->arena);
         mpr_obj_init((mpr_obj)sig, g, MPR_SIG);
         mpr_sig_init(sig, dev, 0, MPR_DIR_UNDEFINED, name, 0, 0, 0, 0, 0, &num_inst);
+        mpr_dev_index_sig(dev, sig);
         rc = 1;
 #ifdef DEBUG
         trace_graph(g, "added signal ");
@@ -649,6 +681,10 @@ void mpr_graph_remove_sig(mpr_graph g, mpr_sig s, mpr_graph_evt e)
     /* remove any stored maps using this signal */
     remove_by_qry(g, mpr_sig_get_maps(s, MPR_DIR_ANY), e);
 
+    /* local signals marked as removed have already left the index and may outlive their device */
+    if (!(((mpr_obj)s)->status & MPR_STATUS_REMOVED))
+        mpr_dev_unindex_sig(mpr_sig_get_dev(s), s);
+
     mpr_list_remove_item((void**)&g->sigs, s);
     mpr_graph_call_cbs(g, (mpr_obj)s, MPR_SIG, e);
 
@@ -659,7 +695,7 @@ void mpr_graph_remove_sig(mpr_graph g, mpr_sig s, mpr_graph_evt e)
 #endif
 
     mpr_sig_free_internal(s);
-    mpr_list_free_item(s);
+    free_obj_mem(g, (mpr_obj)s);
 }
 
 /**** Link records ****/
@@ -672,7 +708,8 @@ mpr_link mpr_graph_add_link(mpr_graph g, mpr_dev dev1, mpr_dev dev2, int is_loca
     if (link)
         return link;
 
-    link = (mpr_link)mpr_list_add_item((void**)&g->links, mpr_link_get_struct_size(), is_local);
+    link = (mpr_link)mpr_list_add_item((void**)&g->links, mpr_link_get_struct_size(), is_local,
+                                       g->arena);
     mpr_obj_init((mpr_obj)link, g, MPR_LINK);
     if (mpr_obj_get_is_local((mpr_obj)dev2))
         mpr_link_init(link, g, dev2, dev1);
@@ -701,7 +738,7 @@ void mpr_graph_remove_link(mpr_graph g, mpr_link l, mpr_graph_evt e)
 #endif
 
     mpr_link_free(l);
-    mpr_list_free_item(l);
+    free_obj_mem(g, (mpr_obj)l);
 }
 
 /**** Map records ****/
@@ -766,7 +803,7 @@ mpr_map mpr_graph_add_map(mpr_graph g, mpr_id id, int num_src, const char **src_
         is_local += mpr_obj_get_is_local((mpr_obj)dst_sig);
 
         map = (mpr_map)mpr_list_add_item((void**)&g->maps, mpr_map_get_struct_size(is_local),
-                                         is_local);
+                                         is_local, g->arena);
         mpr_obj_init((mpr_obj)map, g, MPR_MAP);
         mpr_map_init(map, num_src, src_sigs, dst_sig, is_local);
         if (id && !mpr_obj_get_id((mpr_obj)map))
@@ -842,7 +879,7 @@ void mpr_graph_remove_map(mpr_graph g, mpr_map m, mpr_graph_evt e)
 #endif
 
     mpr_map_free(m);
-    mpr_list_free_item(m);
+    free_obj_mem(g, (mpr_obj)m);
 }
 
 void mpr_graph_print(mpr_graph g, int properties)
@@ -991,6 +1028,21 @@ int mpr_graph_stop_polling(mpr_graph g)
     return mpr_net_stop_polling(g->net);
 }
 
+int mpr_graph_get_fds(mpr_graph g, int *fds, int size)
+{
+    return mpr_net_get_fds(g->net, fds, size);
+}
+
+int mpr_graph_get_timeout(mpr_graph g)
+{
+    return mpr_net_get_timeout(g->net);
+}
+
+int mpr_graph_process_fds(mpr_graph g)
+{
+    return mpr_net_process_fds(g->net);
+}
+
 void mpr_graph_subscribe(mpr_graph g, mpr_dev d, int flags, int timeout)
 {
     RETURN_UNLESS(g && flags <= MPR_OBJ);
@@ -1108,6 +1160,16 @@ const char *mpr_graph_get_address(mpr_graph g)
     return mpr_net_get_address(g->net);
 }
 
+int mpr_graph_set_use_batch_io(mpr_graph g, int use)
+{
+    return mpr_net_set_use_batch_io(g->net, use);
+}
+
+int mpr_graph_set_use_epoll(mpr_graph g, int use)
+{
+    return mpr_net_set_use_epoll(g->net, use);
+}
+
 void mpr_graph_set_owned(mpr_graph g, int own)
 {
     g->own = own;
@@ -1118,6 +1180,16 @@ mpr_net mpr_graph_get_net(mpr_graph g)
     return g->net;
 }
 
+mpr_arena mpr_graph_get_arena(mpr_graph g)
+{
+    return g->arena;
+}
+
+mpr_strtab mpr_graph_get_strtab(mpr_graph g)
+{
+    return g->strings;
+}
+
 int mpr_graph_get_owned(mpr_graph g)
 {
     return g->own;
@@ -1127,17 +1199,11 @@ mpr_obj mpr_graph_add_obj(mpr_graph g, int obj_type, int is_local)
 {
     mpr_list *list = get_list_internal(g, obj_type);
     mpr_obj obj;
-    size_t size;
-    RETURN_ARG_UNLESS(list, 0);
+    RETURN_ARG_UNLESS(list && MPR_LINK != obj_type, 0);
 
-    switch (obj_type) {
-        case MPR_DEV:   size = mpr_dev_get_struct_size(is_local);   break;
-        case MPR_SIG:   size = mpr_sig_get_struct_size(is_local);   break;
-        case MPR_MAP:   size = mpr_map_get_struct_size(is_local);   break;
-        default:                                                    return 0;
-    }
-
-    obj = mpr_list_add_item((void**)list, size, is_local && (MPR_MAP == obj_type));
+    obj = mpr_list_add_item((void**)list, get_obj_size(obj_type, is_local),
+                            is_local && (MPR_MAP == obj_type), g->arena);
+    RETURN_ARG_UNLESS(obj, 0);
     mpr_obj_init(obj, g, obj_type);
 
     if (MPR_MAP == obj_type)
@@ -1184,11 +1250,6 @@ int mpr_graph_get_autosub(mpr_graph g)
     return g->autosub;
 }
 
-mpr_expr_eval_buffer mpr_graph_get_expr_eval_buffer(mpr_graph g)
-{
-    return g->expr_eval_buff;
-}
-
 void mpr_graph_reset_obj_statuses(mpr_graph g)
 {
     mpr_list list = mpr_list_from_data(g->devs);
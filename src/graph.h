@@ -91,6 +91,12 @@ void mpr_graph_set_owned(mpr_graph g, int own);
 
 mpr_net mpr_graph_get_net(mpr_graph g);
 
+/*! Get the memory arena used for objects, slots and property tables in this graph. */
+mpr_arena mpr_graph_get_arena(mpr_graph g);
+
+/*! Get the table of interned strings shared by objects in this graph. */
+mpr_strtab mpr_graph_get_strtab(mpr_graph g);
+
 int mpr_graph_get_owned(mpr_graph g);
 
 mpr_obj mpr_graph_add_obj(mpr_graph g, int obj_type, int is_local);
@@ -101,8 +107,6 @@ void mpr_graph_sync_dev(mpr_graph g, const char *name);
 
 int mpr_graph_get_autosub(mpr_graph g);
 
-mpr_expr_eval_buffer mpr_graph_get_expr_eval_buffer(mpr_graph g);
-
 void mpr_graph_reset_obj_statuses(mpr_graph g);
 
 #endif /* __MPR_GRAPH_H__ */
@@ -13,9 +13,13 @@
 #define RELEASED_REMOTELY 0x04
 
 /*! The instance ID map is a linked list of int32 instance ids for coordinating
- *  remote and local instances. */
+ *  remote and local instances. Active id maps are also chained by LID and GID so that the
+ *  device can index them by either id. */
 typedef struct _mpr_id_map {
     struct _mpr_id_map *next;       /*!< The next id map in the list. */
+    struct _mpr_id_map **prev;      /*!< The link pointing to this id map, or zero if inactive. */
+    struct _mpr_id_map *next_LID;   /*!< The next older active id map with the same LID. */
+    struct _mpr_id_map *next_GID;   /*!< The next older active id map with the same GID. */
 
     uint64_t GID;                   /*!< Hash for originating device. */
     uint64_t LID;                   /*!< Local instance id to map. */
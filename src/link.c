@@ -10,18 +10,56 @@
 #include "mpr_time.h"
 #include "network.h"
 #include "object.h"
+#include "osc_encoder.h"
+#include "shm_ring.h"
+#include "slot.h"
 #include "table.h"
+#include "udp_batch.h"
 #include "util/mpr_debug.h"
 
 #include <mapper/mapper.h>
 
 #define NUM_BUNDLES 2
 
+/*! An entry queued on a local-only link. Entries are delivered by calling the destination signal
+ *  directly instead of sending them over the network. */
+typedef struct _mpr_local_msg {
+    mpr_sig dst;                        /*!< Destination signal, or zero if it has been removed. */
+    lo_message msg;                     /*!< An OSC message, or zero if `slot` holds the updates.
+                                         *   Links that are not local-only only queue messages
+                                         *   for updates left behind by a freed slot. */
+    mpr_local_slot slot;                /*!< A slot holding unencoded updates. */
+} mpr_local_msg_t, *mpr_local_msg;
+
+/*! Entries queued on a local-only link in place of an OSC bundle, or on a link to a device on the
+ *  same host in order to be written to its shared memory ring. */
+typedef struct _mpr_local_bundle {
+    mpr_local_msg msgs;
+    mpr_time time;
+    int num;
+    int size;
+} mpr_local_bundle_t, *mpr_local_bundle;
+
 typedef struct _mpr_bundle {
     lo_bundle udp;
     lo_bundle tcp;
+    mpr_local_bundle_t local[2];        /*!< Used instead of `udp` and `tcp` by local-only links,
+                                         *   and for slot updates on links using shared memory. */
 } mpr_bundle_t, *mpr_bundle;
 
+/*! Header of a signal update passed through a shared memory ring. The header is followed by the
+ *  destination signal name, padded to 8 bytes, then the value vector and the bitflags indicating
+ *  which elements are known. */
+typedef struct _mpr_shm_update {
+    mpr_time time;
+    mpr_id GID;                         /*!< Instance id, or zero if not instanced. */
+    uint16_t name_len;                  /*!< Length of the padded signal name. */
+    uint16_t len;                       /*!< Vector length of the value. */
+    char type;
+} mpr_shm_update_t, *mpr_shm_update;
+
+#define SHM_CHECK_INTERVAL 0.1
+
 /*! Clock and timing information. */
 typedef struct _mpr_sync_time_t {
     mpr_time time;
@@ -48,8 +86,27 @@ typedef struct _mpr_link {
         lo_address admin;               /*!< Network address of remote endpoint */
         lo_address udp;                 /*!< Network address of remote endpoint */
         lo_address tcp;                 /*!< Network address of remote endpoint */
+        mpr_udp_dest dest;              /*!< Resolved UDP address for sending encoded bundles */
     } addr;
 
+    mpr_osc_encoder encoder;            /*!< Encoder for slot updates sent over UDP, or zero if
+                                         *   the UDP address could not be resolved. */
+
+    /* Rings for passing slot updates to and from a remote device running on the same host. */
+    struct {
+        mpr_shm_ring out;               /*!< Written by this process, or zero if not in use. */
+        mpr_shm_ring in;                /*!< Read by this process, or zero if not attached. */
+        double next_check;              /*!< Time of the next attempt to attach to `in`, or of the
+                                         *   next check that its writer still exists. */
+        uint8_t same_host;              /*!< Non-zero if the remote device is on this host. */
+    } shm;
+
+    /* Slot updates held back according to the send policy of the local device. */
+    struct {
+        double held_since;              /*!< Time updates started being held, or zero. */
+        double last;                    /*!< Time updates were last sent. */
+    } send;
+
     int is_local_only;
     uint8_t bundle_idx;
 
@@ -93,13 +150,14 @@ void mpr_link_init(mpr_link link, mpr_graph g, mpr_dev dev1, mpr_dev dev2)
     link->is_local_only = mpr_obj_get_is_local((mpr_obj)dev1) && mpr_obj_get_is_local((mpr_obj)dev2);
 
     if (!link->obj.props.synced) {
-        mpr_tbl t = link->obj.props.synced = mpr_tbl_new();
+        mpr_tbl t = mpr_tbl_new(mpr_graph_get_arena(g), mpr_graph_get_strtab(g));
+        link->obj.props.synced = t;
         mpr_tbl_add_record(t, MPR_PROP_DEV, NULL, 2, MPR_DEV, &link->devs, MOD_NONE | LOCAL_ACCESS);
         mpr_tbl_add_record(t, MPR_PROP_ID, NULL, 1, MPR_INT64, &link->obj.id, MOD_NONE);
         mpr_tbl_add_record(t, MPR_PROP_NUM_MAPS, NULL, 1, MPR_INT32, &link->num_maps, MOD_NONE | INDIRECT);
     }
     if (!link->obj.props.staged)
-        link->obj.props.staged = mpr_tbl_new();
+        link->obj.props.staged = mpr_tbl_new(mpr_graph_get_arena(g), mpr_graph_get_strtab(g));
 
     if (!link->obj.id && mpr_obj_get_is_local((mpr_obj)link->devs[LINK_LOCAL_DEV]))
         link->obj.id = mpr_dev_generate_unique_id(link->devs[LINK_LOCAL_DEV]);
@@ -144,10 +202,17 @@ void mpr_link_connect(mpr_link link, const char *host, int admin_port, int data_
         sprintf(str, "%d", data_port);
         link->addr.udp = lo_address_new(host, str);
         link->addr.tcp = lo_address_new_with_proto(LO_TCP, host, str);
+        link->addr.dest = mpr_udp_dest_new(host, data_port);
+        if (link->addr.dest && !link->encoder)
+            link->encoder = mpr_osc_encoder_new();
         sprintf(str, "%d", admin_port);
         link->addr.admin = lo_address_new(host, str);
         trace_dev(link->devs[LINK_LOCAL_DEV], "activated link to device '%s' at %s:%d\n",
                   mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]), host, data_port);
+
+        link->shm.same_host = mpr_net_get_is_local_host(mpr_graph_get_net(link->obj.graph), host);
+        if (mpr_local_dev_get_use_shm((mpr_local_dev)link->devs[LINK_LOCAL_DEV]))
+            mpr_link_set_use_shm(link, 1);
     }
     else {
         trace_dev(link->devs[LINK_LOCAL_DEV], "activating link to local device '%s'\n",
@@ -165,26 +230,142 @@ void mpr_link_connect(mpr_link link, const char *host, int admin_port, int data_
 
 void mpr_link_free(mpr_link link)
 {
-    int i;
+    int i, j, k;
     mpr_obj_free(&link->obj);
     FUNC_IF(lo_address_free, link->addr.admin);
     FUNC_IF(lo_address_free, link->addr.udp);
     FUNC_IF(lo_address_free, link->addr.tcp);
+    FUNC_IF(mpr_udp_dest_free, link->addr.dest);
+    FUNC_IF(mpr_osc_encoder_free, link->encoder);
     for (i = 0; i < NUM_BUNDLES; i++) {
         FUNC_IF(lo_bundle_free_recursive, link->bundles[i].udp);
         FUNC_IF(lo_bundle_free_recursive, link->bundles[i].tcp);
+        for (j = 0; j < 2; j++) {
+            mpr_local_bundle lb = &link->bundles[i].local[j];
+            for (k = 0; k < lb->num; k++) {
+                FUNC_IF(lo_message_free, lb->msgs[k].msg);
+                /* let the slot queue its updates again */
+                FUNC_IF(mpr_local_slot_clear_updates, lb->msgs[k].slot);
+            }
+            FUNC_IF(free, lb->msgs);
+        }
     }
+    FUNC_IF(mpr_shm_ring_free, link->shm.out);
+    FUNC_IF(mpr_shm_ring_free, link->shm.in);
     mpr_dev_remove_link(link->devs[LINK_LOCAL_DEV], link->devs[LINK_REMOTE_DEV]);
     FUNC_IF(free, link->maps);
 }
 
-/* note on memory handling of mpr_link_add_msg(): messages are owned by slot */
-void mpr_link_add_msg(mpr_link link, const char *path, lo_message msg, mpr_time t, mpr_proto proto)
+/* The ring name is derived from both device ids since names are limited to 31 characters on some
+ * platforms; the ids themselves are checked when attaching. */
+static void get_shm_ring_name(char *name, mpr_dev src, mpr_dev dst)
 {
-    lo_bundle *b;
-    uint8_t bundle_idx = link->bundle_idx;
-    RETURN_UNLESS(msg);
+    uint64_t hash = mpr_obj_get_id((mpr_obj)src) * 0x9E3779B97F4A7C15ULL;
+    hash ^= mpr_obj_get_id((mpr_obj)dst);
+    snprintf(name, 32, "/mpr.%"PR_MPR_ID, hash);
+}
+
+void mpr_link_set_use_shm(mpr_link link, int use)
+{
+    char name[32];
+    RETURN_UNLESS(!link->is_local_only && link->shm.same_host);
+    if (!use) {
+        /* the incoming ring is released by mpr_link_receive_shm() since this may be called from a
+         * signal handler while updates are being read */
+        FUNC_IF(mpr_shm_ring_free, link->shm.out);
+        link->shm.out = 0;
+        return;
+    }
+    RETURN_UNLESS(!link->shm.out);
+    get_shm_ring_name(name, link->devs[LINK_LOCAL_DEV], link->devs[LINK_REMOTE_DEV]);
+    link->shm.out = mpr_shm_ring_new(name, MPR_SHM_RING_SIZE,
+                                     mpr_obj_get_id((mpr_obj)link->devs[LINK_LOCAL_DEV]),
+                                     mpr_obj_get_id((mpr_obj)link->devs[LINK_REMOTE_DEV]));
+    link->shm.next_check = 0;
+    if (link->shm.out)
+        trace_dev(link->devs[LINK_LOCAL_DEV], "created shared memory ring %s for device '%s'\n",
+                  name, mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+}
+
+int mpr_link_get_uses_shm(mpr_link link)
+{
+    return link->shm.out && mpr_shm_ring_get_is_attached(link->shm.out);
+}
+
+static int attach_shm(mpr_link link, double now)
+{
+    char name[32];
+    RETURN_ARG_UNLESS(link->shm.same_host && now >= link->shm.next_check, 0);
+    RETURN_ARG_UNLESS(mpr_local_dev_get_use_shm((mpr_local_dev)link->devs[LINK_LOCAL_DEV]), 0);
+    link->shm.next_check = now + SHM_CHECK_INTERVAL;
+    get_shm_ring_name(name, link->devs[LINK_REMOTE_DEV], link->devs[LINK_LOCAL_DEV]);
+    link->shm.in = mpr_shm_ring_open(name, mpr_obj_get_id((mpr_obj)link->devs[LINK_REMOTE_DEV]),
+                                     mpr_obj_get_id((mpr_obj)link->devs[LINK_LOCAL_DEV]));
+    RETURN_ARG_UNLESS(link->shm.in, 0);
+    trace_dev(link->devs[LINK_LOCAL_DEV], "attached to shared memory ring %s from device '%s'\n",
+              name, mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+    return 1;
+}
+
+static void receive_shm_update(mpr_link link, mpr_shm_update u, size_t len)
+{
+    mpr_sig sig;
+    const char *name = (const char*)(u + 1);
+    size_t vsize;
+    RETURN_UNLESS(u->name_len && len >= sizeof(mpr_shm_update_t) + u->name_len);
+    RETURN_UNLESS(!name[u->name_len - 1]);
+    sig = mpr_dev_get_sig_by_name(link->devs[LINK_LOCAL_DEV], name);
+    if (!sig || mpr_sig_get_type(sig) != u->type || mpr_sig_get_len(sig) != u->len) {
+        trace_dev(link->devs[LINK_LOCAL_DEV], "ignoring shared memory update for signal '%s'\n",
+                  name);
+        return;
+    }
+    vsize = u->len * mpr_type_get_size(u->type);
+    RETURN_UNLESS(  len >= sizeof(mpr_shm_update_t) + u->name_len + vsize
+                  + MPR_BITFLAGS_SIZE(u->len));
+    mpr_local_sig_handle_update((mpr_local_sig)sig, u->GID, name + u->name_len,
+                                (mpr_bitflags)(name + u->name_len + vsize), u->time);
+}
+
+/* Rings left behind by a crashed process are never closed, so check occasionally if the writer
+ * still exists. */
+static int get_shm_writer_is_gone(mpr_link link, double now)
+{
+    RETURN_ARG_UNLESS(now >= link->shm.next_check, 0);
+    link->shm.next_check = now + SHM_CHECK_INTERVAL;
+    return mpr_shm_ring_get_is_orphaned(link->shm.in);
+}
 
+int mpr_link_receive_shm(mpr_link link, double now, int will_block)
+{
+    int count = 0;
+    const void *rec;
+    size_t len;
+
+    if (!link->shm.in && !attach_shm(link, now))
+        return 0;
+    do {
+        while ((rec = mpr_shm_ring_peek(link->shm.in, &len))) {
+            if (len >= sizeof(mpr_shm_update_t))
+                receive_shm_update(link, (mpr_shm_update)rec, len);
+            mpr_shm_ring_release(link->shm.in);
+            ++count;
+        }
+        if (   mpr_shm_ring_get_is_closed(link->shm.in) || get_shm_writer_is_gone(link, now)
+            || !mpr_local_dev_get_use_shm((mpr_local_dev)link->devs[LINK_LOCAL_DEV])) {
+            trace_dev(link->devs[LINK_LOCAL_DEV], "detaching from shared memory ring of device "
+                      "'%s'\n", mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+            mpr_shm_ring_free(link->shm.in);
+            link->shm.in = 0;
+            break;
+        }
+        /* the producer will send a datagram to wake us if we block with the ring empty */
+    } while (mpr_shm_ring_set_waiting(link->shm.in, will_block && !count));
+    return count;
+}
+
+static mpr_time get_bundle_time(mpr_link link, mpr_time t, mpr_proto proto)
+{
     /* add offset to timetag */
     /* retrieve clock offset for remote device */
     double offset = mpr_dev_get_offset(link->devs[LINK_REMOTE_DEV]);
@@ -199,33 +380,277 @@ void mpr_link_add_msg(mpr_link link, const char *path, lo_message msg, mpr_time
     /* offset += link->clock.jitter; */
 
     mpr_time_add_dbl(&t, offset);
+    return t;
+}
+
+static mpr_local_msg add_local_msg(mpr_link link, mpr_sig dst, mpr_time t, mpr_proto proto)
+{
+    mpr_local_msg m;
+    mpr_local_bundle lb = &link->bundles[link->bundle_idx].local[MPR_PROTO_UDP == proto ? 0 : 1];
+    if (!lb->num)
+        lb->time = get_bundle_time(link, t, proto);
+    if (lb->num >= lb->size) {
+        lb->size = lb->size ? lb->size * 2 : 8;
+        lb->msgs = realloc(lb->msgs, lb->size * sizeof(mpr_local_msg_t));
+    }
+    m = &lb->msgs[lb->num++];
+    m->dst = dst;
+    m->msg = 0;
+    m->slot = 0;
+    return m;
+}
+
+/* note on memory handling of mpr_link_add_msg(): messages are owned by slot */
+void mpr_link_add_msg(mpr_link link, mpr_sig dst, const char *path, lo_message msg, mpr_time t,
+                      mpr_proto proto)
+{
+    lo_bundle *b;
+    RETURN_UNLESS(msg);
+
+    if (link->is_local_only) {
+        RETURN_UNLESS(dst);
+        add_local_msg(link, dst, t, proto)->msg = msg;
+        lo_message_incref(msg);
+        return;
+    }
 
     /* add message to existing bundles */
-    b = (proto == MPR_PROTO_UDP) ? &link->bundles[bundle_idx].udp : &link->bundles[bundle_idx].tcp;
+    b = (proto == MPR_PROTO_UDP) ? &link->bundles[link->bundle_idx].udp
+                                 : &link->bundles[link->bundle_idx].tcp;
     if (!(*b))
-        *b = lo_bundle_new(t);
+        *b = lo_bundle_new(get_bundle_time(link, t, proto));
     lo_bundle_add_message(*b, path, msg);
 }
 
+void mpr_link_add_slot_updates(mpr_link link, mpr_local_slot slot, mpr_time t, mpr_proto proto)
+{
+    add_local_msg(link, mpr_slot_get_sig((mpr_slot)slot), t, proto)->slot = slot;
+}
+
+void mpr_link_forget_sig(mpr_link link, mpr_sig sig)
+{
+    int i, j, k;
+    for (i = 0; i < NUM_BUNDLES; i++) {
+        for (j = 0; j < 2; j++) {
+            mpr_local_bundle lb = &link->bundles[i].local[j];
+            for (k = 0; k < lb->num; k++) {
+                if (lb->msgs[k].dst == sig)
+                    lb->msgs[k].dst = 0;
+            }
+        }
+    }
+}
+
+void mpr_link_forget_slot(mpr_link link, mpr_local_slot slot)
+{
+    int i, j, k;
+    for (i = 0; i < NUM_BUNDLES; i++) {
+        for (j = 0; j < 2; j++) {
+            mpr_local_bundle lb = &link->bundles[i].local[j];
+            for (k = 0; k < lb->num; k++) {
+                mpr_local_msg m = &lb->msgs[k];
+                if (m->slot != slot)
+                    continue;
+                m->slot = 0;
+                if (m->dst && !(m->msg = mpr_local_slot_get_updates_msg(slot, 0)))
+                    m->dst = 0;
+            }
+        }
+    }
+}
+
+int mpr_link_get_is_local_only(mpr_link link)
+{
+    return link->is_local_only;
+}
+
+/* Write the updates held by a slot to the link's shared memory ring. Updates that do not fit, or
+ * that were queued before the remote device detached from the ring, are encoded as an OSC message
+ * instead. Updates sent over UDP are encoded directly by the given encoder if possible, otherwise
+ * the message is added to the network bundle. Returns the number of records written. */
+static int write_slot_updates(mpr_link link, mpr_local_slot slot, mpr_time t, lo_bundle *b,
+                              mpr_proto proto, mpr_osc_encoder enc)
+{
+    mpr_sig sig = mpr_slot_get_sig((mpr_slot)slot);
+    const char *name = mpr_sig_get_name(sig);
+    mpr_type type = mpr_sig_get_type(sig);
+    int i = 0, len = mpr_sig_get_len(sig), num = mpr_local_slot_get_num_updates(slot);
+    size_t name_len = (strlen(name) + 8) & ~(size_t)7;
+    size_t esize = len * mpr_type_get_size(type) + MPR_BITFLAGS_SIZE(len);
+
+    if (mpr_link_get_uses_shm(link)) {
+        for (; i < num; i++) {
+            mpr_id GID;
+            const char *data = mpr_local_slot_get_update(slot, i, &GID);
+            mpr_shm_update u = mpr_shm_ring_reserve(link->shm.out, sizeof(mpr_shm_update_t)
+                                                    + name_len + esize);
+            if (!u)
+                break;
+            u->time = t;
+            u->GID = GID;
+            u->name_len = name_len;
+            u->len = len;
+            u->type = type;
+            strncpy((char*)(u + 1), name, name_len);
+            memcpy((char*)(u + 1) + name_len, data, esize);
+        }
+    }
+    if (i < num) {
+        lo_message msg;
+        if (   MPR_PROTO_UDP == proto && enc
+            && !mpr_local_slot_encode_updates(slot, enc, i, t))
+            return i;
+        msg = mpr_local_slot_get_updates_msg(slot, i);
+        if (!msg)
+            return i;
+        if (!(*b))
+            *b = lo_bundle_new(t);
+        lo_bundle_add_message(*b, mpr_sig_get_path(sig), msg);
+    }
+    return i;
+}
+
+/* Send a bundle over UDP. If batched I/O is enabled the bundle is queued with those for other
+ * links and sent when the network batch is flushed. */
+static void send_udp(mpr_link link, mpr_net net, lo_server server, lo_bundle b)
+{
+    mpr_udp_batch batch = mpr_net_get_udp_batch(net);
+    if (!batch || mpr_udp_batch_add(batch, server, link->addr.dest, b))
+        lo_send_bundle_from(link->addr.udp, server, b);
+}
+
+/* Send the bundle built by the link's encoder over UDP. */
+static int send_encoded(mpr_link link, mpr_net net, lo_server server)
+{
+    mpr_udp_batch batch = mpr_net_get_udp_batch(net);
+    int count = mpr_osc_encoder_get_num_msgs(link->encoder);
+    size_t len;
+    const void *data = mpr_osc_encoder_get_data(link->encoder, &len);
+    if (!batch || mpr_udp_batch_add_data(batch, server, link->addr.dest, data, len))
+        mpr_udp_send(server, link->addr.dest, data, len);
+    mpr_osc_encoder_reset(link->encoder);
+    return count;
+}
+
+/* Decide whether the slot updates queued in a bundle should be sent now or held back to be
+ * coalesced with later updates, according to the send policy of the local device. Returns the
+ * time at which held updates will be due, or zero if they should be sent now. */
+static double get_hold_deadline(mpr_link link, mpr_bundle mb, mpr_time t)
+{
+    mpr_send_policy p = mpr_local_dev_get_send_policy((mpr_local_dev)link->devs[LINK_LOCAL_DEV]);
+    int i, j, fill = 0, was_held = link->send.held_since != 0;
+    double now, due = 0;
+
+    if (!p || !(mb->local[0].num + mb->local[1].num)) {
+        link->send.held_since = 0;
+        return 0;
+    }
+    now = mpr_get_current_time();
+    if (!was_held)
+        link->send.held_since = now;
+    if (p->max_rate > 0)
+        due = link->send.last + 1.0 / p->max_rate;
+    if (due <= now && p->max_latency > 0) {
+        for (i = 0; i < 2; i++) {
+            for (j = 0; j < mb->local[i].num; j++) {
+                mpr_local_msg m = &mb->local[i].msgs[j];
+                fill += m->slot ? mpr_local_slot_get_num_updates(m->slot) : 1;
+            }
+        }
+        if (fill < p->min_fill)
+            due = link->send.held_since + p->max_latency;
+    }
+    if (due > now)
+        return due;
+
+    if (was_held) {
+        /* the bundles carry the latest values, so use the current timetag */
+        mb->local[0].time = get_bundle_time(link, t, MPR_PROTO_UDP);
+        mb->local[1].time = get_bundle_time(link, t, MPR_PROTO_TCP);
+    }
+    link->send.held_since = 0;
+    link->send.last = now;
+    return 0;
+}
+
+int mpr_link_get_is_holding(mpr_link link)
+{
+    return link->send.held_since != 0;
+}
+
 /* TODO: interrupt driven signal updates may not be followed by mpr_dev_process_outputs(); in the
  * case where the interrupt has interrupted mpr_dev_poll() these messages will not be dispatched. */
 int mpr_link_process_bundles(mpr_link link, mpr_time t)
 {
-    int num_msg = 0;
+    int num_msg = 0, num_bundles = 0, coalesced = 0;
     mpr_net net = mpr_graph_get_net(link->obj.graph);
+    mpr_local_dev ldev = (mpr_local_dev)link->devs[LINK_LOCAL_DEV];
     uint8_t idx = link->bundle_idx;
     mpr_bundle mb = &link->bundles[idx];
     lo_bundle lb;
 
-    /* increment index for circular buffer of lo_bundles */
-    link->bundle_idx = (link->bundle_idx + 1) % NUM_BUNDLES;
-
     if (!link->is_local_only) {
-        mpr_local_dev ldev = (mpr_local_dev)link->devs[LINK_LOCAL_DEV];
+        int i, j, written = 0;
+        lo_server server = mpr_net_get_dev_server(net, ldev, SERVER_UDP);
+        /* the device's servers are removed before its remaining updates are sent */
+        mpr_osc_encoder enc = server ? link->encoder : 0;
+        double due = get_hold_deadline(link, mb, t);
+        if (due) {
+            /* keep the slot updates in the current bundle; messages built by slots are only valid
+             * until the maps are updated again so they are still sent below */
+            mpr_net_schedule_send(net, due);
+        }
+        else {
+            /* increment index for circular buffer of lo_bundles */
+            link->bundle_idx = (link->bundle_idx + 1) % NUM_BUNDLES;
+            for (i = 0; i < 2; i++) {
+                mpr_local_bundle lmb = &mb->local[i];
+                lo_bundle *b = i ? &mb->tcp : &mb->udp;
+                for (j = 0; j < lmb->num; j++) {
+                    mpr_local_msg m = &lmb->msgs[j];
+                    if (m->msg) {
+                        /* updates left behind by a freed slot */
+                        if (m->dst) {
+                            if (!(*b))
+                                *b = lo_bundle_new(lmb->time);
+                            lo_bundle_add_message(*b, mpr_sig_get_path(m->dst), m->msg);
+                        }
+                        else
+                            lo_message_free(m->msg);
+                        continue;
+                    }
+                    if (!m->slot)
+                        continue;
+                    if (m->dst)
+                        written += write_slot_updates(link, m->slot, lmb->time, b,
+                                                      i ? MPR_PROTO_TCP : MPR_PROTO_UDP, enc);
+                    coalesced += mpr_local_slot_get_num_coalesced(m->slot);
+                    mpr_local_slot_clear_updates(m->slot);
+                }
+                lmb->num = 0;
+            }
+        }
+        if (enc && mpr_osc_encoder_get_num_msgs(enc)) {
+            num_msg += send_encoded(link, net, server);
+            ++num_bundles;
+        }
+        if (written) {
+            num_msg += written;
+            ++num_bundles;
+            if (mpr_shm_ring_commit(link->shm.out)) {
+                /* the remote device is blocked in poll(), an empty bundle will wake it */
+                lb = lo_bundle_new(LO_TT_IMMEDIATE);
+                send_udp(link, net, server, lb);
+                lo_bundle_free(lb);
+            }
+        }
         if ((lb = mb->udp)) {
             mb->udp = 0;
-            if ((num_msg = lo_bundle_count(lb))) {
-                lo_send_bundle_from(link->addr.udp, mpr_net_get_dev_server(net, ldev, SERVER_UDP), lb);
+            int count;
+            if ((count = lo_bundle_count(lb))) {
+                num_msg += count;
+                ++num_bundles;
+                send_udp(link, net, server, lb);
             }
             lo_bundle_free_recursive(lb);
         }
@@ -234,39 +659,45 @@ int mpr_link_process_bundles(mpr_link link, mpr_time t)
             int count;
             if ((count = lo_bundle_count(lb))) {
                 num_msg += count;
+                ++num_bundles;
                 lo_send_bundle_from(link->addr.tcp, mpr_net_get_dev_server(net, ldev, SERVER_TCP), lb);
             }
             lo_bundle_free_recursive(lb);
         }
     }
     else {
-        mpr_net net = mpr_graph_get_net(link->obj.graph);
-        lo_bundle *lbs = (lo_bundle*)mb;
-        int i;
+        int i, j;
+        /* increment index for circular buffer of lo_bundles */
+        link->bundle_idx = (link->bundle_idx + 1) % NUM_BUNDLES;
         for (i = 0; i < 2; i++) {
-            if ((lb = lbs[i])) {
-                const char *path;
-                int j = 0, count;
-
-                lbs[i] = 0;
-                /* set out-of-band timestamp */
-                mpr_net_set_bundle_time(net, lo_bundle_get_timestamp(lb));
-                /* call handler directly instead of sending over the network */
-                count = lo_bundle_count(lb);
-                while (j < count) {
-                    /* Find the local signal matching the message path in the destination device. */
-                    lo_message m = lo_bundle_get_message(lb, j, &path);
-                    mpr_sig dst = mpr_dev_get_sig_by_name(link->devs[i], path + 1);
-                    if (dst)
-                        mpr_sig_osc_handler(NULL, lo_message_get_types(m), lo_message_get_argv(m),
-                                            lo_message_get_argc(m), m, dst);
-                    ++j;
+            mpr_local_bundle lb = &mb->local[i];
+            if (!lb->num)
+                continue;
+            /* set out-of-band timestamp */
+            mpr_net_set_bundle_time(net, lb->time);
+            /* call handlers directly instead of sending over the network */
+            for (j = 0; j < lb->num; j++) {
+                mpr_local_msg m = &lb->msgs[j];
+                if (m->msg) {
+                    if (m->dst)
+                        mpr_sig_osc_handler(NULL, lo_message_get_types(m->msg),
+                                            lo_message_get_argv(m->msg),
+                                            lo_message_get_argc(m->msg), m->msg, m->dst);
+                    lo_message_free(m->msg);
+                }
+                else if (m->slot) {
+                    if (m->dst)
+                        mpr_local_slot_deliver_updates(m->slot, lb->time);
+                    mpr_local_slot_clear_updates(m->slot);
                 }
-                lo_bundle_free_recursive(lb);
-                num_msg += count;
             }
+            num_msg += lb->num;
+            ++num_bundles;
+            lb->num = 0;
         }
     }
+    if (num_bundles)
+        mpr_local_dev_add_send_stats(ldev, num_bundles, num_msg, coalesced);
     return num_msg;
 }
 
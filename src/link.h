@@ -3,6 +3,7 @@
 #define __MPR_LINK_H__
 
 typedef struct _mpr_link *mpr_link;
+struct _mpr_local_slot;
 
 #include "device.h"
 #include "graph.h"
@@ -40,7 +41,69 @@ void mpr_link_free(mpr_link link);
 
 int mpr_link_process_bundles(mpr_link link, mpr_time t);
 
-void mpr_link_add_msg(mpr_link link, const char *path, lo_message msg, mpr_time t, mpr_proto proto);
+/*! Check whether a link is holding slot updates back according to the send policy of its local
+ *  device, in which case it has scheduled the network to poll again when they are due.
+ *  \param link         The link to check.
+ *  \return             Non-zero if the link is holding updates. */
+int mpr_link_get_is_holding(mpr_link link);
+
+/*! Add a message to the link's current bundle.
+ *  \param link         The link to use.
+ *  \param dst          The destination signal. Local-only links deliver the message to this signal
+ *                      directly and require it to be set; other links ignore it.
+ *  \param path         The OSC path for the message.
+ *  \param msg          The message to add.
+ *  \param t            The timetag for the bundle.
+ *  \param proto        The protocol to use. */
+void mpr_link_add_msg(mpr_link link, mpr_sig dst, const char *path, lo_message msg, mpr_time t,
+                      mpr_proto proto);
+
+/*! Queue the unencoded updates held by a slot for delivery over a local-only link, or through the
+ *  shared memory ring of a link to a device on the same host. The slot must not be cleared until
+ *  the link's bundles have been processed.
+ *  \param link         The link to use.
+ *  \param slot         The destination slot holding the updates.
+ *  \param t            The timetag for the updates.
+ *  \param proto        The protocol selecting which device of the link receives the updates. */
+void mpr_link_add_slot_updates(mpr_link link, struct _mpr_local_slot *slot, mpr_time t,
+                                mpr_proto proto);
+
+/*! Discard pending messages for a signal, e.g. if the signal is being removed.
+ *  \param link         The link to clear.
+ *  \param sig          The signal to forget. */
+void mpr_link_forget_sig(mpr_link link, mpr_sig sig);
+
+/*! Stop referring to a slot that is being freed. Updates held by the slot that have not been
+ *  sent yet are encoded as an OSC message and sent with the next bundle.
+ *  \param link         The link to clear.
+ *  \param slot         The slot to forget. */
+void mpr_link_forget_slot(mpr_link link, struct _mpr_local_slot *slot);
+
+/*! Check whether both devices of a link belong to this process.
+ *  \param link         The link to check.
+ *  \return             Non-zero if the link is local-only. */
+int mpr_link_get_is_local_only(mpr_link link);
+
+/*! Enable or disable the shared memory ring used to send slot updates to a remote device running
+ *  on the same host. Links to devices on other hosts are not affected.
+ *  \param link         The link to modify.
+ *  \param use          Non-zero to create the ring, zero to remove it. */
+void mpr_link_set_use_shm(mpr_link link, int use);
+
+/*! Check whether slot updates are currently passed through shared memory instead of the network.
+ *  \param link         The link to check.
+ *  \return             Non-zero if the remote device is reading the link's ring. */
+int mpr_link_get_uses_shm(mpr_link link);
+
+/*! Receive updates written to shared memory by a remote device running on the same host,
+ *  attaching to its ring if necessary.
+ *  \param link         The link to check.
+ *  \param now          The current time, used to limit attempts to attach.
+ *  \param will_block   Non-zero if the caller will block waiting for network messages when no
+ *                      updates are available; the remote device will then send a datagram when
+ *                      new updates are written.
+ *  \return             The number of updates received. */
+int mpr_link_receive_shm(mpr_link link, double now, int will_block);
 
 int mpr_link_get_is_ready(mpr_link link);
 
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stddef.h>
 
+#include "arena.h"
 #include "object.h"
 #include "path.h"
 #include "property.h"
@@ -71,7 +72,7 @@ typedef struct _query_info {
 
 /*! Reserve memory for a list item.  Reserves an extra pointer at the
  *  beginning of the structure to allow for a list pointer. */
-static mpr_list_header_t* mpr_list_new_item(size_t size)
+static mpr_list_header_t* mpr_list_new_item(size_t size, mpr_arena arena)
 {
     mpr_list_header_t *lh=0;
 
@@ -82,7 +83,7 @@ static mpr_list_header_t* mpr_list_new_item(size_t size)
                "unexpected offset for data in mpr_list_header_t");
 
     size += LIST_HEADER_SIZE;
-    lh = calloc(1, size);
+    lh = mpr_arena_alloc(arena, size);
     RETURN_ARG_UNLESS(lh, 0);
     lh->self = &lh->data;
     lh->start = &lh->self;
@@ -150,9 +151,10 @@ static void *mpr_list_append_item(void **list, void *item)
     return item;
 }
 
-void *mpr_list_add_item(void **list, size_t size, int prepend)
+void *mpr_list_add_item(void **list, size_t size, int prepend, mpr_arena arena)
 {
-    mpr_list_header_t* lh = mpr_list_new_item(size);
+    mpr_list_header_t* lh = mpr_list_new_item(size, arena);
+    RETURN_ARG_UNLESS(lh, 0);
     if (prepend)
         mpr_list_prepend_item(list, lh);
     else
@@ -178,10 +180,10 @@ void mpr_list_remove_item(void **head, void *item)
 }
 
 /*! Free the memory used by a list item */
-void mpr_list_free_item(void *item)
+void mpr_list_free_item(void *item, size_t size, mpr_arena arena)
 {
     if (item)
-        free(mpr_list_header_by_data(item));
+        mpr_arena_release(arena, mpr_list_header_by_data(item), size + LIST_HEADER_SIZE);
 }
 
 /** Structures and functions for performing dynamic queries **/
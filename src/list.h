@@ -5,15 +5,16 @@
 
 typedef struct _mpr_obj **mpr_list;
 
+#include "arena.h"
 #include "mpr_type.h"
 
 void *mpr_list_from_data(const void *data);
 
-void *mpr_list_add_item(void **list, size_t size, int prepend);
+void *mpr_list_add_item(void **list, size_t size, int prepend, mpr_arena arena);
 
 void mpr_list_remove_item(void **list, void *item);
 
-void mpr_list_free_item(void *item);
+void mpr_list_free_item(void *item, size_t size, mpr_arena arena);
 
 mpr_list mpr_list_new_query(const void **list, const void *func,
                             const mpr_type *types, ...);
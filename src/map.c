@@ -66,7 +66,9 @@ typedef struct _mpr_local_map {
     mpr_id_map_t id_map;            /*!< Associated mpr_id_map. */
 
     mpr_expr expr;                  /*!< The mapping expression. */
+    mpr_expr_eval_buffer eval_buff; /*!< Evaluation buffer for the mapping expression. */
     mpr_bitflags updated_inst;      /*!< Bitflags to indicate updated instances. */
+    uint8_t *inst_status;           /*!< Evaluation status per instance from batched evaluation. */
     mpr_value *vars;                /*!< User variables values. */
     const char **var_names;         /*!< User variables names. */
     const char **old_var_names;     /*!< User variables names. */
@@ -77,6 +79,8 @@ typedef struct _mpr_local_map {
     uint8_t locality;               /* requires 3 bits -----XXX */
     uint8_t one_src;                /* requires 1 bit */
     uint8_t updated;                /* requires 1 bit */
+    uint8_t evaluated;              /* requires 1 bit */
+    uint8_t queued;                 /* requires 2 bits ------XX (MPR_DIR_IN | MPR_DIR_OUT) */
 } mpr_local_map_t;
 
 size_t mpr_map_get_struct_size(int is_local)
@@ -225,8 +229,8 @@ void mpr_map_init(mpr_map m, int num_src, mpr_sig *src, mpr_sig dst, int is_loca
 {
     int i;
     mpr_graph g = m->obj.graph;
-    m->obj.props.synced = mpr_tbl_new();
-    m->obj.props.staged = mpr_tbl_new();
+    m->obj.props.synced = mpr_tbl_new(mpr_graph_get_arena(g), mpr_graph_get_strtab(g));
+    m->obj.props.staged = mpr_tbl_new(mpr_graph_get_arena(g), mpr_graph_get_strtab(g));
 
     m->num_src = num_src;
     m->src = (mpr_slot*)malloc(sizeof(mpr_slot) * num_src);
@@ -443,8 +447,11 @@ void mpr_map_process_before_free(mpr_map map)
                 mpr_time_add_dbl(&time, mpr_dev_get_offset(mpr_sig_get_dev(sig)));
                 mpr_net_set_bundle_time(mpr_graph_get_net(lmap->obj.graph), time);
                 lo_message msg = mpr_slot_get_msg(lmap->dst);
-                mpr_sig_osc_handler(NULL, lo_message_get_types(msg), lo_message_get_argv(msg),
-                                    lo_message_get_argc(msg), msg, (void*)sig);
+                if (msg)
+                    mpr_sig_osc_handler(NULL, lo_message_get_types(msg), lo_message_get_argv(msg),
+                                        lo_message_get_argc(msg), msg, (void*)sig);
+                else
+                    mpr_local_slot_deliver_updates(lmap->dst, time);
             }
             else {
                 mpr_local_dev dev = (mpr_local_dev)mpr_sig_get_dev(mpr_slot_get_sig(map->src[0]));
@@ -532,7 +539,20 @@ void mpr_map_free(mpr_map map)
         }
         FUNC_IF(free, lmap->old_var_names);
         mpr_bitflags_free(lmap->updated_inst);
+        FUNC_IF(free, lmap->inst_status);
         FUNC_IF(mpr_expr_free, lmap->expr);
+        FUNC_IF(mpr_expr_free_eval_buffer, lmap->eval_buff);
+
+        if (lmap->queued) {
+            /* remove map from device processing queues */
+            mpr_list devs = mpr_graph_get_list(map->obj.graph, MPR_DEV);
+            while (devs) {
+                mpr_dev dev = (mpr_dev)*devs;
+                if (mpr_obj_get_is_local((mpr_obj)dev))
+                    mpr_local_dev_remove_queued_map((mpr_local_dev)dev, lmap);
+                devs = mpr_list_get_next(devs);
+            }
+        }
     }
 
     /* remove map from parent link */
@@ -785,9 +805,47 @@ static int update_scope(mpr_map m, mpr_msg_atom a)
  */
 
 /* only called for outgoing, source-processed maps */
-void mpr_map_send(mpr_local_map m, mpr_time time)
+int mpr_map_eval_send(mpr_local_map m, mpr_time time)
 {
     int i, status;
+    mpr_value src_vals[MAX_NUM_MAP_SRC], dst_val;
+
+    RETURN_ARG_UNLESS(   MPR_LOC_DST != m->process_loc && m->updated && m->expr && !m->muted
+                      && MPR_DIR_OUT == mpr_slot_get_dir((mpr_slot)m->src[0]), 0);
+    RETURN_ARG_UNLESS(!m->evaluated, 1);
+
+    for (i = 0; i < m->num_src; i++)
+        src_vals[i] = mpr_slot_get_value(m->src[i]);
+    dst_val = mpr_slot_get_value(m->dst);
+
+    /* TODO: once releases are added to bitflags, find an instance with a value first to check
+     * whether EXPR_EVAL_DONE flag is added. If not, go back and handle releases for previous
+     * instances */
+
+    /* try evaluating all updated instances together before falling back to one at a time */
+    if (!mpr_expr_eval_batch(m->expr, m->eval_buff, src_vals, m->vars, dst_val, &time,
+                             m->updated_inst, m->num_inst, m->inst_status)) {
+        /* If instances share destination storage each one must be evaluated just before its
+         * message is built, which is left to mpr_map_send(). */
+        RETURN_ARG_UNLESS(mpr_value_get_num_inst(dst_val) >= m->num_inst, 1);
+        /* Visit only the instances that have been updated */
+        for (i = mpr_bitflags_get_next(m->updated_inst, 0); i >= 0 && i < m->num_inst;
+             i = mpr_bitflags_get_next(m->updated_inst, i + 1)) {
+            /* TODO: Check if this instance has enough history to process the expression */
+            status = mpr_expr_eval(m->expr, m->eval_buff, src_vals, m->vars, dst_val, &time, i);
+            m->inst_status[i] = status;
+            if (status & EXPR_EVAL_DONE)
+                break;
+        }
+    }
+    m->evaluated = 1;
+    return 1;
+}
+
+/* only called for outgoing, source-processed maps */
+void mpr_map_send(mpr_local_map m, mpr_time time)
+{
+    int i, status, evaluated;
     mpr_sig_group group;
     mpr_type manage_inst = 0;
     mpr_local_dev dev;
@@ -804,14 +862,22 @@ void mpr_map_send(mpr_local_map m, mpr_time time)
         for (i = 0; i < m->num_src; i++) {
             /* We need to send message prepared by source slot through destination link */
             lo_message msg;
-            if ((msg = mpr_slot_get_msg(m->src[i])))
+            mpr_local_sig sig;
+            if (   MPR_PROTO_UDP == m->protocol && mpr_local_slot_get_multicast(m->src[i], 0)
+                && (sig = mpr_slot_get_sig_if_local((mpr_slot)m->src[i]))) {
+                /* updates are sent once to every destination in the signal's multicast group */
+                mpr_local_sig_send_multicast(sig, time);
+            }
+            else if ((msg = mpr_slot_get_msg(m->src[i])))
                 mpr_local_slot_send_msg(m->dst, msg, time, m->protocol);
         }
         return;
     }
 
-    RETURN_UNLESS(   m->updated && m->expr && !m->muted
-                  && MPR_DIR_OUT == mpr_slot_get_dir((mpr_slot)m->src[0]));
+    /* evaluate the expression unless this has already been done by a map worker thread */
+    RETURN_UNLESS(mpr_map_eval_send(m, time));
+    evaluated = m->evaluated;
+    m->evaluated = 0;
 
     /* temporary solution: use most multitudinous source signal for id_map
      * permanent solution: move id_maps to map? */
@@ -841,17 +907,13 @@ void mpr_map_send(mpr_local_map m, mpr_time time)
         }
     }
 
-    /* TODO: once releases are added to bitflags, find an instance with a value first to check
-     * whether EXPR_EVAL_DONE flag is added. If not, go back and handle releases for previous
-     * instances */
-
-    for (i = 0; i < m->num_inst; i++) {
-        /* Check if this instance has been updated */
-        if (!mpr_bitflags_get(m->updated_inst, i))
-            continue;
-        /* TODO: Check if this instance has enough history to process the expression */
-        status = mpr_expr_eval(m->expr, mpr_graph_get_expr_eval_buffer(m->obj.graph),
-                               src_vals, m->vars, dst_val, &time, i);
+    /* Visit only the instances that have been updated */
+    for (i = mpr_bitflags_get_next(m->updated_inst, 0); i >= 0 && i < m->num_inst;
+         i = mpr_bitflags_get_next(m->updated_inst, i + 1)) {
+        if (evaluated)
+            status = m->inst_status[i];
+        else
+            status = mpr_expr_eval(m->expr, m->eval_buff, src_vals, m->vars, dst_val, &time, i);
         if (!m->use_inst) {
             /* remove EXPR_RELEASE* event flags */
             status &= (EXPR_UPDATE | EXPR_EVAL_DONE);
@@ -947,7 +1009,7 @@ void mpr_map_clear_slot_msgs(mpr_local_map m)
 /* TODO: merge with mpr_map_send()? */
 void mpr_map_receive(mpr_local_map m, mpr_time time)
 {
-    int i, status, map_manages_inst = 0;
+    int i, status, batched, map_manages_inst = 0;
     mpr_local_slot src_slot;
     mpr_sig src_sig;
     mpr_local_sig dst_sig;
@@ -979,12 +1041,17 @@ void mpr_map_receive(mpr_local_map m, mpr_time time)
         map_manages_inst = 1;
     }
 
-    for (i = 0; i < m->num_inst; i++) {
+    /* try evaluating all updated instances together before falling back to one at a time */
+    batched = mpr_expr_eval_batch(m->expr, m->eval_buff, src_vals, m->vars, dst_val, &time,
+                                  m->updated_inst, m->num_inst, m->inst_status);
+
+    for (i = mpr_bitflags_get_next(m->updated_inst, 0); i >= 0 && i < m->num_inst;
+         i = mpr_bitflags_get_next(m->updated_inst, i + 1)) {
         void *value;
-        if (!mpr_bitflags_get(m->updated_inst, i))
-            continue;
-        status = mpr_expr_eval(m->expr, mpr_graph_get_expr_eval_buffer(m->obj.graph),
-                               src_vals, m->vars, dst_val, &time, i);
+        if (batched)
+            status = m->inst_status[i];
+        else
+            status = mpr_expr_eval(m->expr, m->eval_buff, src_vals, m->vars, dst_val, &time, i);
         if (!m->use_inst)
             status &= (EXPR_UPDATE | EXPR_EVAL_DONE);
 
@@ -1110,7 +1177,10 @@ void mpr_map_alloc_values(mpr_local_map m, int quiet)
         m->updated_inst = mpr_bitflags_realloc(m->updated_inst, num_inst);
     else
         m->updated_inst = mpr_bitflags_new(num_inst);
+    if (num_inst > m->num_inst || !m->inst_status)
+        m->inst_status = realloc(m->inst_status, num_inst * sizeof(uint8_t));
     m->num_inst = num_inst;
+    mpr_expr_realloc_eval_buffer(e, m->eval_buff, num_inst);
 
     if (!quiet) {
         /* Inform remote peers of the change */
@@ -1155,9 +1225,6 @@ static int replace_expr_str(mpr_local_map m, const char *expr_str)
                                  1, dst_types, dst_lens);
     RETURN_ARG_UNLESS(expr, 1);
 
-    /* reallocate the central evaluation buffer if necessary */
-    mpr_expr_realloc_eval_buffer(expr, mpr_graph_get_expr_eval_buffer(m->obj.graph));
-
     /* expression update may force processing location to change
      * e.g. if expression combines signals from different devices
      * e.g. if expression refers to current/past value of destination */
@@ -1175,6 +1242,11 @@ static int replace_expr_str(mpr_local_map m, const char *expr_str)
     FUNC_IF(mpr_expr_free, m->expr);
     m->expr = expr;
 
+    /* size the evaluation buffer for the new expression */
+    if (!m->eval_buff)
+        m->eval_buff = mpr_expr_new_eval_buffer(NULL);
+    mpr_expr_realloc_eval_buffer(expr, m->eval_buff, m->num_inst);
+
     if (m->expr_str == expr_str)
         return 0;
     mpr_tbl_add_record(m->obj.props.synced, MPR_PROP_EXPR, NULL, 1, MPR_STR, expr_str, MOD_REMOTE);
@@ -1523,8 +1595,7 @@ static int set_expr(mpr_local_map m, const char *expr_str)
         /* evaluate expression to initialise literals */
         mpr_time_set(&now, MPR_NOW);
         for (i = 0; i < m->num_inst; i++)
-            mpr_expr_eval(m->expr, mpr_graph_get_expr_eval_buffer(m->obj.graph), 0,
-                          m->vars, mpr_slot_get_value(m->dst), &now, i);
+            mpr_expr_eval(m->expr, m->eval_buff, 0, m->vars, mpr_slot_get_value(m->dst), &now, i);
 
         /* reset map id_map */
         m->id_map.LID = m->id_map.GID = 0;
@@ -1668,6 +1739,14 @@ int mpr_local_map_set_from_msg(mpr_local_map m, mpr_msg msg)
     return updated;
 }
 
+int mpr_local_map_set_multicast_from_msg(mpr_local_map m, mpr_msg msg)
+{
+    int i, updated = 0;
+    for (i = 0; i < m->num_src; i++)
+        updated += mpr_local_slot_set_multicast_from_msg(m->src[i], msg);
+    return updated;
+}
+
 /* TODO: consider renaming mpr_N_set_from_msg() to mpr_N_update() since this func also updates status */
 int mpr_map_set_from_msg(mpr_map m, mpr_msg msg)
 {
@@ -2315,13 +2394,28 @@ mpr_slot mpr_map_get_src_slot_by_id(mpr_map map, int id)
     return 0;
 }
 
-void mpr_local_map_set_updated(mpr_local_map map, int inst_idx)
+void mpr_local_map_set_updated(mpr_local_map map, int inst_idx, mpr_local_dev dev)
 {
     if (inst_idx < 0)
         mpr_bitflags_set_all(map->updated_inst);
     else
         mpr_bitflags_set(map->updated_inst, inst_idx);
     map->updated = 1;
+    /* maps with remote sources are processed by mpr_map_receive(), others by mpr_map_send() */
+    mpr_local_map_queue(map, dev, (MPR_DIR_IN == mpr_slot_get_dir((mpr_slot)map->src[0])
+                                   ? MPR_DIR_IN : MPR_DIR_OUT));
+}
+
+void mpr_local_map_queue(mpr_local_map map, mpr_local_dev dev, mpr_dir dir)
+{
+    RETURN_UNLESS(!(map->queued & dir));
+    map->queued |= dir;
+    mpr_local_dev_queue_map(dev, map, dir);
+}
+
+void mpr_local_map_dequeue(mpr_local_map map, mpr_dir dir)
+{
+    map->queued &= ~dir;
 }
 
 int mpr_map_get_use_inst(mpr_map map)
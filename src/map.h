@@ -29,6 +29,16 @@ void mpr_map_alloc_values(mpr_local_map map, int quiet);
  *  \param time         Timestamp for this update. */
 void mpr_map_send(mpr_local_map map, mpr_time time);
 
+/*! Evaluate the expression of an updated outgoing map without building or sending any messages.
+ *  This only touches state owned by the map, so different maps may be evaluated concurrently.
+ *  A subsequent call to `mpr_map_send()` will reuse the results instead of evaluating again,
+ *  unless the map's instances share destination storage and must be evaluated one at a time
+ *  while building messages.
+ *  \param map          The mapping process to perform.
+ *  \param time         Timestamp for this update.
+ *  \return             Non-zero if the map has been evaluated and has output to send. */
+int mpr_map_eval_send(mpr_local_map map, mpr_time time);
+
 void mpr_map_receive(mpr_local_map map, mpr_time time);
 
 void mpr_map_clear_slot_msgs(mpr_local_map map);
@@ -36,6 +46,9 @@ void mpr_map_clear_slot_msgs(mpr_local_map map);
 /*! Set a mapping's properties based on message parameters. */
 int mpr_map_set_from_msg(mpr_map map, mpr_msg msg);
 
+/*! Update the multicast groups used for the updates of source signals from a map message. */
+int mpr_local_map_set_multicast_from_msg(mpr_local_map map, mpr_msg msg);
+
 int mpr_local_map_update_status(mpr_local_map map);
 
 int mpr_map_send_state(mpr_map map, int slot, net_msg_t cmd, int version);
@@ -88,7 +101,21 @@ mpr_slot mpr_map_get_src_slot(mpr_map map, int idx);
 
 mpr_slot mpr_map_get_src_slot_by_id(mpr_map map, int id);
 
-void mpr_local_map_set_updated(mpr_local_map map, int inst_idx);
+/*! Mark a map instance as updated and queue the map for processing.
+ *  \param map          The map to update.
+ *  \param inst_idx     Index of the updated instance, or -1 for all instances.
+ *  \param dev          The local device that should process the map. */
+void mpr_local_map_set_updated(mpr_local_map map, int inst_idx, mpr_local_dev dev);
+
+/*! Queue a map for processing by a local device unless it is already queued in this direction.
+ *  Maps with pending slot messages must also be queued so the messages will be sent and cleared.
+ *  \param map          The map to queue.
+ *  \param dev          The local device that should process the map.
+ *  \param dir          `MPR_DIR_OUT` for outgoing processing or `MPR_DIR_IN` for incoming. */
+void mpr_local_map_queue(mpr_local_map map, mpr_local_dev dev, mpr_dir dir);
+
+/*! Called by the device once a queued map has been processed. */
+void mpr_local_map_dequeue(mpr_local_map map, mpr_dir dir);
 
 void mpr_map_status_decr(mpr_map map);
 
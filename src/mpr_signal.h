@@ -22,6 +22,58 @@ size_t mpr_sig_get_struct_size(int is_local);
 int mpr_sig_osc_handler(const char *path, const char *types, lo_arg **argv, int argc,
                         lo_message msg, void *data);
 
+/*! Apply an update from a map between local devices without encoding it as an OSC message. This
+ *  is equivalent to calling `mpr_sig_osc_handler()` with a message containing the same values.
+ *  \param sig          The local signal to update.
+ *  \param GID          The global instance id, or zero if the update is not instanced.
+ *  \param value        A vector of the signal's length and type.
+ *  \param known        Bitflags indicating which elements of `value` are present. An update with
+ *                      no elements present releases the instance.
+ *  \param time         The timetag associated with the update. */
+void mpr_local_sig_handle_update(mpr_local_sig sig, mpr_id GID, const void *value,
+                                 mpr_bitflags known, mpr_time time);
+
+/*! Apply the updates in an OSC message read directly from a datagram, if the message has the
+ *  layout used for signal updates without slot ids. The arguments are decoded in place instead of
+ *  by liblo, with the same result as calling `mpr_sig_osc_handler()`.
+ *  \param sig          The local signal to update.
+ *  \param types        The typetags of the message, not including the leading comma.
+ *  \param args         The arguments of the message in network byte order.
+ *  \param end          The end of the message.
+ *  \param time         The timetag associated with the updates.
+ *  \return             Zero if the message was handled, non-zero if it should be passed to
+ *                      `mpr_sig_osc_handler()` instead. */
+int mpr_local_sig_handle_osc_msg(mpr_local_sig sig, const char *types, const char *args,
+                                 const char *end, mpr_time time);
+
+/*! Apply updates of a remote source signal received through a multicast group to a local map.
+ *  \param slot         The source slot of the map receiving the updates.
+ *  \param types        The typetags of the updates.
+ *  \param argv         The arguments of the updates, not including the list of map ids.
+ *  \param argc         The number of arguments.
+ *  \param time         The timetag associated with the updates. */
+void mpr_local_sig_handle_group_msg(mpr_local_slot slot, const char *types, lo_arg **argv,
+                                    int argc, mpr_time time);
+
+/*! Record the version of the local device at which the metadata of a signal last changed, so
+ *  that subscribers who have already seen that version of the device can be brought up to date
+ *  with only the signals changed since. */
+void mpr_local_sig_set_meta_version(mpr_local_sig sig, int version);
+
+/*! Retrieve the version of the local device at which the metadata of a signal last changed. */
+int mpr_local_sig_get_meta_version(mpr_local_sig sig);
+
+/*! Retrieve the multicast group to which a local signal sends updates.
+ *  \param sig          The local signal to query.
+ *  \param port         Location for the port of the multicast group, or zero.
+ *  \return             The multicast group address, or zero if none has been set. */
+const char *mpr_local_sig_get_multicast(mpr_local_sig sig, int *port);
+
+/*! Send the updates queued for a local signal's multicast group.
+ *  \param sig          The local signal.
+ *  \param time         The timetag for the updates. */
+void mpr_local_sig_send_multicast(mpr_local_sig sig, mpr_time time);
+
 /*! Initialize an already-allocated mpr_sig structure. */
 void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const char *name, int len,
                   mpr_type type, const char *unit, const void *min, const void *max, int *num_inst);
@@ -37,7 +89,11 @@ int mpr_sig_set_from_msg(mpr_sig sig, mpr_msg msg);
  *  \param sig      The signal to free. */
 void mpr_sig_free_internal(mpr_sig sig);
 
-void mpr_sig_send_state(mpr_sig sig, net_msg_t cmd);
+/*! Queue a message describing a signal.
+ *  \param sig          The signal to describe.
+ *  \param cmd          The message to send.
+ *  \return             The length of the queued message in bytes. */
+int mpr_sig_send_state(mpr_sig sig, net_msg_t cmd);
 
 void mpr_local_sig_set_dev_id(mpr_local_sig sig, mpr_id id);
 
@@ -12,6 +12,14 @@
  #include <net/if.h>
 #endif
 
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_EVENTFD_H)
+ #include <sys/epoll.h>
+ #include <sys/eventfd.h>
+ #include <errno.h>
+ #include <unistd.h>
+ #define USE_EPOLL
+#endif
+
 #ifdef HAVE_ARPA_INET_H
  #include <arpa/inet.h>
 #else
@@ -30,10 +38,12 @@
 #include "mpr_signal.h"
 #include "network.h"
 #include "object.h"
+#include "osc_decoder.h"
 #include "path.h"
 #include "property.h"
 #include "slot.h"
 #include "thread_data.h"
+#include "timer_wheel.h"
 #include "util/mpr_debug.h"
 
 #include <mapper/mapper.h>
@@ -53,6 +63,20 @@ extern const char* prop_msg_strings[MPR_PROP_EXTRA+1];
 #define SERVER_MESH     1   /* Mesh comms. */
 
 #define MAX_BUNDLE_LEN 8192
+
+#define EVENT_TIMER_RESOLUTION      0.01    /* Seconds per tick of the housekeeping timers. */
+#define EVENT_REGISTRATION_INTERVAL 0.1     /* Seconds between checks while devices register. */
+#define EVENT_GRAPH_INTERVAL        1.0     /* Seconds between graph housekeeping runs. */
+#define EVENT_ADMIN_DELAY           0.1     /* Delay of graph housekeeping after admin traffic. */
+#define EVENT_TCP_INTERVAL          0.1     /* Maximum sleep while TCP connections may be open. */
+#define EVENT_THREAD_BLOCK_MS       1000
+#define EVENT_MAX_DRAIN             64      /* Maximum receive passes per round of processing. */
+#define EVENT_MAX_EVENTS            32
+#define EVENT_WAKE                  UINT32_MAX
+
+#define PENDING_SEND                0x01
+#define PENDING_HOUSEKEEPING        0x02
+
 #define FIND 0
 #define UPDATE 1
 #define ADD 2
@@ -65,6 +89,17 @@ typedef enum {
 } bundle_dst;
 
 /*! A structure that keeps information about network communications. */
+/* A multicast group through which remote devices send the updates of source signals to every
+ * destination at once, and the local map slots that receive them. */
+typedef struct _mpr_data_group {
+    mpr_net net;
+    lo_server server;
+    char *group;
+    int port;
+    mpr_local_slot *slots;
+    int num_slots;
+} mpr_data_group_t, *mpr_data_group;
+
 typedef struct _mpr_net {
     mpr_graph graph;
 
@@ -87,6 +122,7 @@ typedef struct _mpr_net {
     } iface;
 
     struct _mpr_local_dev **devs;   /*!< Local devices managed by this network structure. */
+    mpr_udp_batch udp_batch;        /*!< Batch for device server I/O, or zero if not in use. */
     lo_bundle bundle;               /*!< Bundle pointer for sending messages on the multicast bus. */
     mpr_time bundle_time;
 
@@ -95,12 +131,39 @@ typedef struct _mpr_net {
         int port;
     } multicast;
 
+    /* Multicast groups joined to receive signal updates. Groups are joined and left while handling
+     * messages, so their servers are added to or removed from `servers` before the next receive. */
+    struct {
+        struct _mpr_data_group **list;
+        int num;
+        uint8_t dirty;              /*!< Non-zero if `servers` needs to be updated. */
+    } data_groups;
+
     int random_id;                  /*!< Random id for allocation speedup. */
     int msg_type;
     int num_devs;
     int num_servers;
     uint32_t next_bus_ping;
     uint32_t next_sub_ping;
+    double send_deadline;           /*!< Time at which held updates are due, or zero. */
+
+    /* Event-driven polling: sockets are watched using epoll and housekeeping is scheduled on a
+     * timing wheel so that polling sleeps until a message arrives or a deadline passes. */
+    struct {
+        mpr_timer_wheel timers;     /*!< Housekeeping timers, or zero if not event-driven. */
+        mpr_timer_t registration;
+        mpr_timer_t ping;
+        mpr_timer_t graph;
+        int fd;                     /*!< The epoll instance. */
+        int wake_fd;                /*!< Written to interrupt polling from another thread. */
+        volatile int sleeping;
+        volatile int pending;       /*!< Work requested by other threads (PENDING_*). */
+        uint8_t dirty;              /*!< Non-zero if the servers have changed since the epoll set
+                                     *   was built. */
+        uint8_t backlog;            /*!< Non-zero if sockets were not fully drained. */
+        uint8_t tcp_active;         /*!< Non-zero if TCP connections may be open. */
+    } events;
+
     uint8_t generic_dev_methods_added;
     uint8_t registered;
     uint8_t polling;
@@ -446,8 +509,10 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
             int num_servers = net->num_devs * 2 + 2;
             net->servers = realloc(net->servers, num_servers * sizeof(lo_server));
             net->server_status = realloc(net->server_status, num_servers * sizeof(int));
-            net->num_servers = num_servers;
         }
+        /* the servers of multicast data groups will be added after those of the devices */
+        net->num_servers = net->num_devs * 2 + 2;
+        net->data_groups.dirty = 1;
         net->servers[net->num_devs * 2] = net->servers[net->num_devs * 2 + 1] = 0;
     }
 
@@ -521,6 +586,13 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
 
     /* Probe potential name. */
     mpr_local_dev_probe_name(dev, dev_idx + 1, net);
+
+    if (net->events.timers) {
+        /* watch the new servers and check the device's registration status */
+        net->events.dirty = 1;
+        mpr_timer_schedule(net->events.timers, &net->events.registration,
+                           mpr_get_current_time());
+    }
 }
 
 void mpr_net_remove_dev(mpr_net net, mpr_local_dev dev)
@@ -537,7 +609,10 @@ void mpr_net_remove_dev(mpr_net net, mpr_local_dev dev)
         return;
     }
     --net->num_devs;
-    net->num_servers -= 2;
+    /* the servers of multicast data groups will be added after those of the devices */
+    net->num_servers = net->num_devs * 2 + 2;
+    net->data_groups.dirty = 1;
+    net->events.dirty = 1;
 
     /* free device servers */
     lo_server_free(net->servers[i * 2 + 2]); /* UDP server */
@@ -549,7 +624,7 @@ void mpr_net_remove_dev(mpr_net net, mpr_local_dev dev)
         net->servers[i * 2 + 3] = net->servers[i * 2 + 5];
     }
     net->devs = realloc(net->devs, net->num_devs * sizeof(mpr_local_dev));
-    net->servers = realloc(net->servers, net->num_servers * sizeof(mpr_local_dev));
+    net->servers = realloc(net->servers, net->num_servers * sizeof(lo_server));
     net->server_status = realloc(net->server_status, net->num_servers * sizeof(int));
 
     for (i = 0; i < NUM_DEV_HANDLERS_SPECIFIC; i++) {
@@ -598,6 +673,127 @@ void mpr_net_remove_dev_server_method(mpr_net net, mpr_local_dev dev, const char
     }
 }
 
+/* Updates sent to a multicast data group are addressed to the source signal and end with the
+ * label "@mp" followed by the ids of the maps they are intended for. */
+static int handler_data_group(const char *path, const char *types, lo_arg **argv, int argc,
+                              lo_message msg, void *user_data)
+{
+    mpr_data_group grp = (mpr_data_group)user_data;
+    mpr_time time = mpr_net_get_bundle_time(grp->net);
+    int i, j, num_args = argc;
+
+    while (num_args > 0 && MPR_INT64 == types[num_args - 1])
+        --num_args;
+    RETURN_ARG_UNLESS(num_args > 0 && MPR_STR == types[--num_args], 0);
+    RETURN_ARG_UNLESS(!strcmp(&argv[num_args]->s, "@mp"), 0);
+
+    for (i = 0; i < grp->num_slots; i++) {
+        mpr_local_slot slot = grp->slots[i];
+        mpr_id id;
+        if (mpr_slot_match_full_name((mpr_slot)slot, path))
+            continue;
+        id = mpr_obj_get_id((mpr_obj)mpr_slot_get_map((mpr_slot)slot));
+        for (j = num_args + 1; j < argc; j++) {
+            if (argv[j]->i64 == id) {
+                mpr_local_sig_handle_group_msg(slot, types, argv, num_args, time);
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+int mpr_net_join_data_group(mpr_net net, const char *group, int port, mpr_local_slot slot)
+{
+    mpr_data_group grp = 0;
+    int i;
+
+    for (i = 0; i < net->data_groups.num; i++) {
+        grp = net->data_groups.list[i];
+        if (grp->port == port && !strcmp(grp->group, group))
+            break;
+    }
+    if (i == net->data_groups.num) {
+        char port_str[10];
+        lo_server server;
+        snprintf(port_str, 10, "%d", port);
+        server = lo_server_new_multicast_iface(group, port_str, net->iface.name, 0, handler_error);
+        TRACE_RETURN_UNLESS(server, 1, "error joining multicast group %s:%d\n", group, port);
+        trace("joined multicast group %s:%d\n", group, port);
+
+        grp = (mpr_data_group)calloc(1, sizeof(mpr_data_group_t));
+        grp->net = net;
+        grp->server = server;
+        grp->group = strdup(group);
+        grp->port = port;
+
+        /* Disable liblo message queueing and add handlers. */
+        lo_server_enable_queue(server, 0, 1);
+        lo_server_add_bundle_handlers(server, mpr_net_bundle_start, NULL, (void*)net);
+        lo_server_add_method(server, NULL, NULL, handler_data_group, grp);
+
+        ++net->data_groups.num;
+        net->data_groups.list = realloc(net->data_groups.list,
+                                        net->data_groups.num * sizeof(mpr_data_group));
+        net->data_groups.list[i] = grp;
+        net->data_groups.dirty = 1;
+    }
+    grp->slots = realloc(grp->slots, (grp->num_slots + 1) * sizeof(mpr_local_slot));
+    grp->slots[grp->num_slots++] = slot;
+    return 0;
+}
+
+void mpr_net_leave_data_group(mpr_net net, mpr_local_slot slot)
+{
+    int i, j;
+    for (i = 0; i < net->data_groups.num; i++) {
+        mpr_data_group grp = net->data_groups.list[i];
+        for (j = 0; j < grp->num_slots; j++) {
+            if (grp->slots[j] != slot)
+                continue;
+            for (++j; j < grp->num_slots; j++)
+                grp->slots[j - 1] = grp->slots[j];
+            /* groups without slots are left before the next receive */
+            if (!--grp->num_slots)
+                net->data_groups.dirty = 1;
+            return;
+        }
+    }
+}
+
+static void free_data_group(mpr_data_group grp)
+{
+    trace("leaving multicast group %s:%d\n", grp->group, grp->port);
+    lo_server_free(grp->server);
+    free(grp->group);
+    FUNC_IF(free, grp->slots);
+    free(grp);
+}
+
+/* Leave unused multicast data groups and place the servers of the others after those of the
+ * devices, outside of message handling. */
+static void update_data_groups(mpr_net net)
+{
+    int i, num = 0, num_servers;
+    RETURN_UNLESS(net->data_groups.dirty);
+    for (i = 0; i < net->data_groups.num; i++) {
+        mpr_data_group grp = net->data_groups.list[i];
+        if (grp->num_slots)
+            net->data_groups.list[num++] = grp;
+        else
+            free_data_group(grp);
+    }
+    net->data_groups.num = num;
+    num_servers = net->num_devs * 2 + 2 + num;
+    net->servers = realloc(net->servers, num_servers * sizeof(lo_server));
+    net->server_status = realloc(net->server_status, num_servers * sizeof(int));
+    for (i = 0; i < num; i++)
+        net->servers[net->num_devs * 2 + 2 + i] = net->data_groups.list[i]->server;
+    net->num_servers = num_servers;
+    net->data_groups.dirty = 0;
+    net->events.dirty = 1;
+}
+
 static void mpr_net_add_graph_methods(mpr_net net, lo_server server)
 {
     /* add graph methods */
@@ -613,6 +809,7 @@ mpr_net mpr_net_new(mpr_graph g)
 {
     mpr_net net = (mpr_net) calloc(1, sizeof(mpr_net_t));
     net->graph = g;
+    net->events.fd = net->events.wake_fd = -1;
     mpr_net_init(net, 0, 0, 0);
     return net;
 }
@@ -713,6 +910,7 @@ int mpr_net_init(mpr_net net, const char *iface, const char *group, int port)
     temp_server2 = net->servers[SERVER_MESH];
     net->servers[SERVER_MESH] = temp_server1;
     FUNC_IF(lo_server_free, temp_server2);
+    net->events.dirty = 1;
 
     for (i = 0; i < net->num_devs; i++) {
         mpr_net_add_dev(net, net->devs[i]);
@@ -733,6 +931,41 @@ const char *mpr_net_get_address(mpr_net net)
     return net->addr.url;
 }
 
+int mpr_net_get_is_local_host(mpr_net net, const char *host)
+{
+    unsigned long addr;
+    RETURN_ARG_UNLESS(host && INADDR_NONE != (addr = inet_addr(host)), 0);
+    /* peers on this host use either the interface or a loopback address */
+    return addr == net->iface.addr.s_addr || 127 == (ntohl(addr) >> 24);
+}
+
+int mpr_net_set_use_batch_io(mpr_net net, int use)
+{
+    /* the batch may be in use by the poll loop */
+    RETURN_ARG_UNLESS(!net->polling, -1);
+    if (!use) {
+        mpr_net_flush_udp_batch(net);
+        FUNC_IF(mpr_udp_batch_free, net->udp_batch);
+        net->udp_batch = 0;
+        return 0;
+    }
+    RETURN_ARG_UNLESS(mpr_udp_batch_get_is_supported(), -1);
+    if (!net->udp_batch)
+        net->udp_batch = mpr_udp_batch_new();
+    return 0;
+}
+
+mpr_udp_batch mpr_net_get_udp_batch(mpr_net net)
+{
+    return net->udp_batch;
+}
+
+void mpr_net_flush_udp_batch(mpr_net net)
+{
+    if (net->udp_batch)
+        mpr_udp_batch_flush(net->udp_batch);
+}
+
 const char *mpr_get_version(void)
 {
     return PACKAGE_VERSION;
@@ -776,6 +1009,7 @@ void mpr_net_send(mpr_net net)
 static int init_bundle(mpr_net net, mpr_time *time)
 {
     mpr_net_send(net);
+    mpr_net_wake(net, 0);
     if (time)
         net->bundle = lo_bundle_new(*time);
     else {
@@ -827,12 +1061,13 @@ void mpr_net_use_subscribers(mpr_net net, mpr_local_dev dev, int type)
         init_bundle(net, NULL);
 }
 
-void mpr_net_add_msg(mpr_net net, const char *s, net_msg_t c, lo_message m)
+int mpr_net_add_msg(mpr_net net, const char *s, net_msg_t c, lo_message m)
 {
-    int len = lo_bundle_length(net->bundle);
+    int len = lo_bundle_length(net->bundle), msg_len;
     if (!s)
         s = net_msg_strings[c];
-    if (len && len + lo_message_length(m, s) >= MAX_BUNDLE_LEN) {
+    msg_len = lo_message_length(m, s);
+    if (len && len + msg_len >= MAX_BUNDLE_LEN) {
         if (net->bundle) {
             lo_timetag t = lo_bundle_get_timestamp(net->bundle);
             mpr_net_send(net);
@@ -840,6 +1075,7 @@ void mpr_net_add_msg(mpr_net net, const char *s, net_msg_t c, lo_message m)
         }
     }
     lo_bundle_add_message(net->bundle, s, m);
+    return msg_len;
 }
 
 void mpr_net_free_msgs(mpr_net net)
@@ -859,10 +1095,16 @@ void mpr_net_free(mpr_net net)
     FUNC_IF(free, net->iface.name);
     FUNC_IF(free, net->multicast.group);
 
-    for (i = 0; i < net->num_servers; i++)
+    /* the servers of multicast data groups are freed with the groups */
+    for (i = 0; i < net->num_servers && i < net->num_devs * 2 + 2; i++)
         FUNC_IF(lo_server_free, net->servers[i]);
     free(net->servers);
+    for (i = 0; i < net->data_groups.num; i++)
+        free_data_group(net->data_groups.list[i]);
+    FUNC_IF(free, net->data_groups.list);
     free(net->server_status);
+    FUNC_IF(mpr_udp_batch_free, net->udp_batch);
+    mpr_net_set_use_epoll(net, 0);
 
     FUNC_IF(lo_address_free, net->addr.bus);
 #ifndef WIN32
@@ -908,6 +1150,8 @@ static void mpr_net_maybe_send_ping(mpr_net net, int force)
         RETURN_UNLESS(net->num_devs);
         for (i = 0; i < net->num_devs; i++) {
             mpr_local_dev dev = net->devs[i];
+            /* housekeeping #2: remove subscriptions whose leases have expired */
+            mpr_local_dev_remove_expired_subscribers(dev);
             if (mpr_local_dev_has_subscribers(dev)) {
                 mpr_net_use_subscribers(net, dev, MPR_DEV);
                 send_device_sync(net, dev);
@@ -925,7 +1169,7 @@ static void mpr_net_maybe_send_ping(mpr_net net, int force)
             send_device_sync(net, net->devs[i]);
     }
 
-    /* housekeeping #2: periodically check if our links are still active */
+    /* housekeeping #3: periodically check if our links are still active */
     list = mpr_graph_get_list(gph, MPR_LINK);
     while (list) {
         mpr_link link = (mpr_link)*list;
@@ -937,36 +1181,389 @@ static void mpr_net_maybe_send_ping(mpr_net net, int force)
     }
 }
 
+/* Update the count of registered devices. Returns 1 if the count has changed. */
+static int update_registered(mpr_net net)
+{
+    int i, registered = 0;
+    RETURN_ARG_UNLESS(net->registered < net->num_devs, 0);
+    for (i = 0; i < net->num_devs; i++)
+        registered += mpr_dev_get_is_registered((mpr_dev)net->devs[i]);
+    RETURN_ARG_UNLESS(registered != net->registered, 0);
+    net->registered = registered;
+    return 1;
+}
+
 /*! This is the main function to be called once in a while from a program so
  *  that the libmapper bus can be automatically managed. */
 static void mpr_net_housekeeping(mpr_net net, int force_ping)
 {
-    int i, num_devs = net->num_devs, registered = 0;
-
     /* send out any cached messages */
     mpr_net_send(net);
 
-    if (num_devs) {
-        if (net->registered < num_devs) {
-            for (i = 0; i < net->num_devs; i++)
-                registered += mpr_dev_get_is_registered((mpr_dev)net->devs[i]);
-            if (registered != net->registered) {
-                net->registered = registered;
-                force_ping = 1;
+    if (update_registered(net))
+        force_ping = 1;
+
+    if (!net->num_devs || net->registered) {
+        /* Send out clock sync messages occasionally */
+        mpr_net_maybe_send_ping(net, force_ping);
+    }
+
+    mpr_graph_housekeeping(net->graph);
+    return;
+}
+
+/* Handle a message from a bundle received by a device if it is a signal update with the expected
+ * layout. Returns non-zero if the message should be dispatched by liblo instead. */
+static int handle_dev_msg(mpr_local_dev dev, const char *msg, size_t len, mpr_time time)
+{
+    const char *types, *args;
+    mpr_sig sig;
+    RETURN_ARG_UNLESS(!mpr_osc_parse_msg(msg, len, &types, &args), 1);
+    RETURN_ARG_UNLESS((sig = mpr_dev_get_sig_by_name((mpr_dev)dev, msg)), 1);
+    return mpr_local_sig_handle_osc_msg((mpr_local_sig)sig, types, args, msg + len, time);
+}
+
+/* Dispatch a datagram received by batched I/O on a device's UDP server. Signal updates are decoded
+ * in place, while anything else is passed to liblo. */
+static void dispatch_dev_data(lo_server server, char *data, size_t len, void *user_data)
+{
+    mpr_local_dev dev = (mpr_local_dev)user_data;
+    mpr_net net = mpr_graph_get_net(mpr_obj_get_graph((mpr_obj)dev));
+    size_t offset = 0, elem_len;
+    mpr_time time;
+    char *elem;
+
+    if (!mpr_osc_get_bundle_time(data, len, &time)) {
+        lo_server_dispatch_data(server, data, len);
+        return;
+    }
+    mpr_net_bundle_start(time, net);
+    while ((elem = mpr_osc_get_bundle_elem(data, len, &offset, &elem_len))) {
+        if (!handle_dev_msg(dev, elem, elem_len, time))
+            continue;
+        lo_server_dispatch_data(server, elem, elem_len);
+        /* restore the timetag in case the element was a nested bundle */
+        mpr_net_bundle_start(time, net);
+    }
+}
+
+/* Receive updates written to shared memory rings by devices in other processes on this host. */
+static int receive_shm(mpr_net net, int will_block)
+{
+    int i, count = 0;
+    double now = mpr_get_current_time();
+    mpr_list links = mpr_graph_get_list(net->graph, MPR_LINK);
+    while (links) {
+        mpr_link link = (mpr_link)*links;
+        if (!mpr_obj_get_is_local((mpr_obj)link)) {
+            /* local links are always located at the start of the list */
+            break;
+        }
+        count += mpr_link_receive_shm(link, now, will_block);
+        links = mpr_list_get_next(links);
+    }
+    if (count) {
+        for (i = 0; i < net->num_devs; i++)
+            mpr_dev_process_incoming_maps(net->devs[i]);
+    }
+    return count;
+}
+
+/* Process the maps updated by messages received through multicast data groups. */
+static int process_data_groups(mpr_net net)
+{
+    int i, count = 0;
+    for (i = net->num_devs * 2 + 2; i < net->num_servers; i++)
+        count += net->server_status[i] > 0;
+    if (count) {
+        for (i = 0; i < net->num_devs; i++)
+            mpr_dev_process_incoming_maps(net->devs[i]);
+    }
+    return count;
+}
+
+void mpr_net_wake(mpr_net net, int housekeeping)
+{
+#ifdef USE_EPOLL
+    uint64_t val = 1;
+    RETURN_UNLESS(net->events.timers);
+    __sync_fetch_and_or(&net->events.pending, housekeeping ? PENDING_HOUSEKEEPING : PENDING_SEND);
+    if (net->events.sleeping && write(net->events.wake_fd, &val, sizeof(val)) < 0)
+        trace("error waking network polling.\n");
+#endif
+}
+
+void mpr_net_schedule_send(mpr_net net, double when)
+{
+    RETURN_UNLESS(!net->send_deadline || when < net->send_deadline);
+    net->send_deadline = when;
+#ifdef USE_EPOLL
+    /* updates may be processed from outside a polling thread */
+    if (net->events.timers && net->events.sleeping)
+        mpr_net_wake(net, 0);
+#endif
+}
+
+/* Forget requests to poll for held updates before updating the maps of all local devices, which
+ * will renew the requests that are still needed. */
+static void update_maps(mpr_net net)
+{
+    int i;
+    net->send_deadline = 0;
+    for (i = 0; i < net->num_devs; i++)
+        mpr_dev_update_maps((mpr_dev)net->devs[i]);
+}
+
+#ifdef USE_EPOLL
+/* Schedule the ping timer for the next time that a ping or subscriber sync is due. */
+static void schedule_ping(mpr_net net, double now)
+{
+    mpr_time t;
+    uint32_t due = net->next_sub_ping + 1;
+    if (net->num_devs && net->registered && net->next_bus_ping < due)
+        due = net->next_bus_ping;
+    mpr_time_set(&t, MPR_NOW);
+    mpr_timer_schedule(net->events.timers, &net->events.ping, now + due - mpr_time_as_dbl(t));
+}
+
+static void on_ping_timer(void *data, double now)
+{
+    mpr_net net = (mpr_net)data;
+    /* while devices are registering the ping is rescheduled by the registration timer */
+    RETURN_UNLESS(!net->num_devs || net->registered);
+    mpr_net_maybe_send_ping(net, 0);
+    mpr_net_send(net);
+    schedule_ping(net, now);
+}
+
+static void on_registration_timer(void *data, double now)
+{
+    mpr_net net = (mpr_net)data;
+    if (update_registered(net) && net->registered) {
+        /* announce newly registered devices immediately */
+        mpr_net_maybe_send_ping(net, 1);
+        schedule_ping(net, now);
+    }
+    mpr_net_send(net);
+    if (net->registered < net->num_devs)
+        mpr_timer_schedule(net->events.timers, &net->events.registration,
+                           now + EVENT_REGISTRATION_INTERVAL);
+}
+
+static void on_graph_timer(void *data, double now)
+{
+    mpr_net net = (mpr_net)data;
+    mpr_graph_housekeeping(net->graph);
+    mpr_net_send(net);
+    mpr_timer_schedule(net->events.timers, &net->events.graph, now + EVENT_GRAPH_INTERVAL);
+}
+
+/* Move a timer's deadline earlier if it is not already due by the given time. */
+static void expedite_timer(mpr_net net, mpr_timer timer, double when)
+{
+    if (   !mpr_timer_get_is_scheduled(timer)
+        || mpr_timer_get_deadline(net->events.timers, timer) > when)
+        mpr_timer_schedule(net->events.timers, timer, when);
+}
+
+/* Add any new servers to the epoll set. Closed sockets are removed automatically. */
+static void update_event_set(mpr_net net)
+{
+    struct epoll_event evt;
+    int i, fd;
+    for (i = 0; i < net->num_servers; i++) {
+        if (!net->servers[i] || (fd = lo_server_get_socket_fd(net->servers[i])) < 0)
+            continue;
+        /* sockets are always drained after waking so edge-triggered notification suffices */
+        evt.events = EPOLLIN | EPOLLET;
+        evt.data.u32 = i;
+        if (   epoll_ctl(net->events.fd, EPOLL_CTL_ADD, fd, &evt)
+            && epoll_ctl(net->events.fd, EPOLL_CTL_MOD, fd, &evt))
+            trace("error adding server socket to epoll set.\n");
+    }
+    net->events.dirty = 0;
+}
+
+/* Receive and handle everything that is ready without blocking, then run any housekeeping that
+ * is due. */
+static int process_events(mpr_net net)
+{
+    int i, j, count = 0, admin = 0, passes = 0;
+    int pending = __sync_fetch_and_and(&net->events.pending, 0);
+    double now;
+
+    mpr_net_send(net);
+
+    /* send updates queued since the last poll before any map changes are received */
+    update_maps(net);
+
+    /* Handle updates from shared memory before admin messages that may have been sent after them.
+     * This also stops shared memory writers from sending wakeup datagrams. */
+    count += receive_shm(net, 0);
+
+    update_data_groups(net);
+
+    /* edge-triggered notifications are only repeated once a socket has been drained */
+    while (lo_servers_recv_noblock(net->servers, net->server_status, net->num_servers, 0)) {
+        admin |= (net->server_status[SERVER_BUS] > 0) || (net->server_status[SERVER_MESH] > 0);
+        count += (net->server_status[SERVER_BUS] > 0) + (net->server_status[SERVER_MESH] > 0);
+        for (i = 0, j = 2; i < net->num_devs; i++, j += 2) {
+            int dev_count = (net->server_status[j] > 0) || (net->server_status[j+1] > 0);
+            if (net->udp_batch && net->server_status[j] > 0) {
+                /* drain any further datagrams queued on the device's UDP server */
+                dev_count += mpr_udp_batch_recv(net->udp_batch, net->servers[j],
+                                                 dispatch_dev_data, net->devs[i]);
+            }
+            if (net->server_status[j+1] > 0)
+                net->events.tcp_active = 1;
+            if (dev_count) {
+                mpr_dev_process_incoming_maps(net->devs[i]);
+                count += dev_count;
             }
         }
+        count += process_data_groups(net);
+        update_maps(net);
+        if (++passes >= EVENT_MAX_DRAIN) {
+            /* let housekeeping run and continue draining without sleeping */
+            net->events.backlog = 1;
+            break;
+        }
+    }
 
-        if (net->registered) {
-            /* Send out clock sync messages occasionally */
-            mpr_net_maybe_send_ping(net, force_ping);
+    now = mpr_get_current_time();
+    if (pending & PENDING_HOUSEKEEPING)
+        expedite_timer(net, &net->events.graph, now);
+    else if (admin)
+        expedite_timer(net, &net->events.graph, now + EVENT_ADMIN_DELAY);
+    mpr_timer_wheel_advance(net->events.timers, now);
+
+    /* housekeeping may read the device clocks so mark them stale afterwards */
+    update_maps(net);
+    for (i = 0; i < net->num_devs; i++)
+        mpr_dev_update_subscribers(net->devs[i]);
+    mpr_net_send(net);
+    return count;
+}
+
+/* Find the time at which events should next be processed, no later than the given time. */
+static double get_deadline(mpr_net net, double now, double end)
+{
+    double next = mpr_timer_wheel_get_next_deadline(net->events.timers);
+    if (next >= 0 && next < end)
+        end = next;
+    /* liblo does not expose the sockets of accepted TCP connections */
+    if (net->events.tcp_active && end > now + EVENT_TCP_INTERVAL)
+        end = now + EVENT_TCP_INTERVAL;
+    if (net->send_deadline && net->send_deadline < end)
+        end = net->send_deadline;
+    return end;
+}
+
+static void drain_wake_fd(mpr_net net)
+{
+    uint64_t val;
+    if (read(net->events.wake_fd, &val, sizeof(val)) < 0 && EAGAIN != errno)
+        trace("error reading network wakeup event.\n");
+}
+
+/* Sleep until a socket is readable, another thread wakes us, or the next timer or the given
+ * time is due. */
+static int wait_events(mpr_net net, double end)
+{
+    struct epoll_event evts[EVENT_MAX_EVENTS];
+    double now = mpr_get_current_time();
+    int i, num, count, timeout = 0;
+
+    update_data_groups(net);
+    if (net->events.dirty)
+        update_event_set(net);
+
+    end = get_deadline(net, now, end);
+    if (net->events.backlog)
+        net->events.backlog = 0;
+    else if (end > now)
+        timeout = ceil((end - now) * 1000);
+
+    net->events.sleeping = 1;
+    __sync_synchronize();
+    /* ask shared memory writers to wake us, and don't sleep if work is already pending */
+    if ((count = receive_shm(net, timeout > 0)) || net->events.pending)
+        timeout = 0;
+    num = epoll_wait(net->events.fd, evts, EVENT_MAX_EVENTS, timeout);
+    net->events.sleeping = 0;
+
+    for (i = 0; i < num; i++) {
+        if (EVENT_WAKE == evts[i].data.u32)
+            drain_wake_fd(net);
+        else if (   evts[i].data.u32 > SERVER_MESH && (evts[i].data.u32 & 1)
+                 && evts[i].data.u32 < net->num_devs * 2 + 2) {
+            /* a device's TCP server is accepting a connection */
+            net->events.tcp_active = 1;
         }
     }
-    else {
-        mpr_net_maybe_send_ping(net, 0);
+    return count;
+}
+
+static int poll_events(mpr_net net, int block_ms)
+{
+    double end = mpr_get_current_time() + block_ms * 0.001;
+    int count = process_events(net);
+    while (block_ms > 0 && (!net->thread_data || net->thread_data->is_active)) {
+        if (mpr_get_current_time() >= end)
+            break;
+        count += wait_events(net, end);
+        count += process_events(net);
     }
+    return count;
+}
+#endif /* USE_EPOLL */
 
-    mpr_graph_housekeeping(net->graph);
-    return;
+int mpr_net_set_use_epoll(mpr_net net, int use)
+{
+#ifdef USE_EPOLL
+    struct epoll_event evt;
+    double now;
+    /* the engine may be in use by the poll loop */
+    RETURN_ARG_UNLESS(!net->polling && !net->thread_data, -1);
+    if (!use) {
+        RETURN_ARG_UNLESS(net->events.timers, 0);
+        mpr_timer_wheel_free(net->events.timers);
+        net->events.timers = 0;
+        close(net->events.fd);
+        close(net->events.wake_fd);
+        net->events.fd = net->events.wake_fd = -1;
+        return 0;
+    }
+    RETURN_ARG_UNLESS(!net->events.timers, 0);
+    RETURN_ARG_UNLESS((net->events.fd = epoll_create1(EPOLL_CLOEXEC)) >= 0, -1);
+    net->events.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    evt.events = EPOLLIN;
+    evt.data.u32 = EVENT_WAKE;
+    if (   net->events.wake_fd < 0
+        || epoll_ctl(net->events.fd, EPOLL_CTL_ADD, net->events.wake_fd, &evt)) {
+        if (net->events.wake_fd >= 0)
+            close(net->events.wake_fd);
+        close(net->events.fd);
+        net->events.fd = net->events.wake_fd = -1;
+        return -1;
+    }
+
+    now = mpr_get_current_time();
+    net->events.timers = mpr_timer_wheel_new(EVENT_TIMER_RESOLUTION, now);
+    mpr_timer_init(&net->events.registration, on_registration_timer, net);
+    mpr_timer_init(&net->events.ping, on_ping_timer, net);
+    mpr_timer_init(&net->events.graph, on_graph_timer, net);
+    mpr_timer_schedule(net->events.timers, &net->events.registration, now);
+    mpr_timer_schedule(net->events.timers, &net->events.ping, now);
+    mpr_timer_schedule(net->events.timers, &net->events.graph, now);
+    net->events.pending = 0;
+    net->events.dirty = 1;
+    net->events.backlog = 0;
+    net->events.tcp_active = 0;
+    return 0;
+#else
+    return use ? -1 : 0;
+#endif
 }
 
 int mpr_net_poll_internal(mpr_net net, int block_ms)
@@ -979,13 +1576,19 @@ int mpr_net_poll_internal(mpr_net net, int block_ms)
         return 0;
     }
 
+#ifdef USE_EPOLL
+    if (net->events.timers) {
+        count = poll_events(net, block_ms);
+        net->polling = 0;
+        return count;
+    }
+#endif
+
     then = mpr_get_current_time();
 
     mpr_net_housekeeping(net, 0);
 
-    for (i = 0; i < net->num_devs; i++) {
-        mpr_dev_update_maps((mpr_dev)net->devs[i]);
-    }
+    update_maps(net);
 
     /* Desired behavour here:
      * If block_ms == 0, check for incoming messages once and continue
@@ -995,25 +1598,44 @@ int mpr_net_poll_internal(mpr_net net, int block_ms)
 
     left_ms = block_ms >= 0 ? block_ms : 0;
     do {
-        register int recvd = 0;
+        register int recvd = 0, shm_count;
         /* set timeout to a maximum of 100ms */
         if (left_ms > 100)
             left_ms = 100;
+        /* wake in time to send updates held by links */
+        if (net->send_deadline && left_ms > 0) {
+            int send_ms = ceil((net->send_deadline - mpr_get_current_time()) * 1000);
+            if (send_ms < left_ms)
+                left_ms = send_ms > 0 ? send_ms : 0;
+        }
+
+        /* don't block on the network if updates were received through shared memory */
+        if ((shm_count = receive_shm(net, left_ms > 0)))
+            left_ms = 0;
 
+        update_data_groups(net);
         if (lo_servers_recv_noblock(net->servers, net->server_status, net->num_servers, left_ms)) {
             count = (net->server_status[0] > 0) + (net->server_status[1] > 0);
-            for (i = 0, j = 2; j < net->num_servers; i++, j += 2) {
+            for (i = 0, j = 2; i < net->num_devs; i++, j += 2) {
                 int dev_count = (net->server_status[j] > 0) || (net->server_status[j+1] > 0);
+                if (net->udp_batch && net->server_status[j] > 0) {
+                    /* drain any further datagrams queued on the device's UDP server */
+                    dev_count += mpr_udp_batch_recv(net->udp_batch, net->servers[j],
+                                                     dispatch_dev_data, net->devs[i]);
+                }
                 if (dev_count) {
                     mpr_dev_process_incoming_maps(net->devs[i]);
                     count += dev_count;
                 }
             }
+            count += process_data_groups(net);
             recvd = 1;
         }
-        for (i = 0; i < net->num_devs; i++) {
-            mpr_dev_update_maps((mpr_dev)net->devs[i]);
+        if (shm_count) {
+            count += shm_count;
+            recvd = 1;
         }
+        update_maps(net);
 
         /* Only run mpr_net_housekeeping() again if more than 100ms have elapsed. */
         elapsed_ms = (mpr_get_current_time() - then) * 1000;
@@ -1029,6 +1651,9 @@ int mpr_net_poll_internal(mpr_net net, int block_ms)
             break;
     } while (block_ms < 0 || left_ms > 0);
 
+    /* stop asking shared memory writers for wakeup datagrams */
+    count += receive_shm(net, 0);
+
     for (i = 0; i < net->num_devs; i++) {
         mpr_dev_update_subscribers(net->devs[i]);
     }
@@ -1037,6 +1662,77 @@ int mpr_net_poll_internal(mpr_net net, int block_ms)
     return count;
 }
 
+int mpr_net_get_fds(mpr_net net, int *fds, int size)
+{
+    int i, fd, count = 0;
+    update_data_groups(net);
+    for (i = 0; i < net->num_servers; i++) {
+        if (!net->servers[i] || (fd = lo_server_get_socket_fd(net->servers[i])) < 0)
+            continue;
+        if (count < size)
+            fds[count] = fd;
+        ++count;
+    }
+#ifdef USE_EPOLL
+    if (net->events.wake_fd >= 0) {
+        if (count < size)
+            fds[count] = net->events.wake_fd;
+        ++count;
+    }
+#endif
+    return count;
+}
+
+int mpr_net_get_timeout(mpr_net net)
+{
+#ifdef USE_EPOLL
+    if (net->events.timers) {
+        double now = mpr_get_current_time(), end;
+        RETURN_ARG_UNLESS(!net->events.backlog && !net->events.pending, 0);
+        end = get_deadline(net, now, HUGE_VAL);
+        RETURN_ARG_UNLESS(end < HUGE_VAL, -1);
+        return end > now ? ceil((end - now) * 1000) : 0;
+    }
+#endif
+    /* the default engine runs housekeeping every 100ms */
+    if (net->send_deadline) {
+        double now = mpr_get_current_time();
+        if (net->send_deadline < now + 0.1)
+            return net->send_deadline > now ? ceil((net->send_deadline - now) * 1000) : 0;
+    }
+    return 100;
+}
+
+int mpr_net_process_fds(mpr_net net)
+{
+    if (net->thread_data || net->polling) {
+        trace("Network polling already in process.\n");
+        return 0;
+    }
+#ifdef USE_EPOLL
+    if (net->events.timers) {
+        int count, shm_count;
+        ++net->polling;
+        net->events.sleeping = 0;
+        net->events.backlog = 0;
+        drain_wake_fd(net);
+        count = process_events(net);
+
+        /* the caller's event loop is about to wait on our descriptors, so ask other threads and
+         * shared memory writers to wake it */
+        net->events.sleeping = 1;
+        __sync_synchronize();
+        if ((shm_count = receive_shm(net, 1))) {
+            net->events.backlog = 1;
+            count += shm_count;
+        }
+        net->polling = 0;
+        return count;
+    }
+#endif
+    return mpr_net_poll_internal(net, -1);
+}
+
 int mpr_net_poll(mpr_net net, int block_ms)
 {
     if (net->thread_data || net->polling) {
@@ -1050,8 +1746,10 @@ int mpr_net_poll(mpr_net net, int block_ms)
 static void *net_thread_func(void *data)
 {
     mpr_thread_data td = (mpr_thread_data)data;
+    mpr_net net = (mpr_net)td->object;
     while (td->is_active) {
-        mpr_net_poll_internal((mpr_net)td->object, td->block_ms);
+        /* event-driven polling is woken as soon as there is work to do */
+        mpr_net_poll_internal(net, net->events.timers ? EVENT_THREAD_BLOCK_MS : td->block_ms);
     }
     td->is_done = 1;
     pthread_exit(NULL);
@@ -1063,8 +1761,10 @@ static void *net_thread_func(void *data)
 static unsigned __stdcall net_thread_func(void *data)
 {
     mpr_thread_data td = (mpr_thread_data)data;
+    mpr_net net = (mpr_net)td->object;
     while (td->is_active) {
-        mpr_net_poll_internal((mpr_net)td->object, td->block_ms);
+        /* event-driven polling is woken as soon as there is work to do */
+        mpr_net_poll_internal(net, net->events.timers ? EVENT_THREAD_BLOCK_MS : td->block_ms);
     }
     td->is_done = 1;
     _endthread();
@@ -1116,6 +1816,7 @@ int mpr_net_stop_polling(mpr_net net)
     if (!td || !td->is_active)
         return 0;
     td->is_active = 0;
+    mpr_net_wake(net, 0);
 
     trace("stopping polling thread.\n");
 
@@ -1348,7 +2049,7 @@ static int handler_subscribe(const char *path, const char *types, lo_arg **av,
                              int ac, lo_message msg, void *user)
 {
     mpr_local_dev dev = (mpr_local_dev)user;
-    int i, version = -1, flags = 0, timeout_seconds = -1;
+    int i, since = -1, flags = 0, timeout_seconds = -1;
 
 #ifdef DEBUG
     trace_net(mpr_graph_get_net(mpr_obj_get_graph((mpr_obj)dev)));
@@ -1378,10 +2079,15 @@ static int handler_subscribe(const char *path, const char *types, lo_arg **av,
         else if (0 == strcmp(&av[i]->s, "maps_out"))
             flags |= MPR_MAP_OUT;
         else if (0 == strcmp(&av[i]->s, "@version")) {
-            /* next argument is last device version recorded by subscriber */
+            /* next argument is last device version recorded by subscriber; older graphs send it
+             * with every subscription so it does not limit the signals sent */
+            ++i;
+        }
+        else if (0 == strcmp(&av[i]->s, "@since")) {
+            /* next argument is the device version since which only changed signals are needed */
             ++i;
             if (i < ac && MPR_INT32 == types[i])
-                version = av[i]->i;
+                since = av[i]->i;
         }
         else if (0 == strcmp(&av[i]->s, "@lease")) {
             /* next argument is lease timeout in seconds */
@@ -1399,7 +2105,7 @@ static int handler_subscribe(const char *path, const char *types, lo_arg **av,
     }
 
     /* add or renew subscription */
-    mpr_dev_manage_subscriber(dev, addr, flags, timeout_seconds, version);
+    mpr_dev_manage_subscriber(dev, addr, flags, timeout_seconds, since);
     return 0;
 }
 
@@ -1964,6 +2670,10 @@ static int handler_mapped(const char *path, const char *types, lo_arg **av,
         /* TODO: refactor for clarity */
         mpr_map_set_from_msg(map, 0);
     }
+    if (props && mpr_obj_get_is_local((mpr_obj)map)) {
+        /* multicast groups are chosen by the source device wherever the map is processed */
+        mpr_local_map_set_multicast_from_msg((mpr_local_map)map, props);
+    }
     mpr_msg_free(props);
 
     if (mpr_obj_get_is_local((mpr_obj)map)) {
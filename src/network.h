@@ -3,12 +3,14 @@
 #define __MPR_NETWORK_H__
 
 typedef struct _mpr_net *mpr_net;
+struct _mpr_local_slot;
 
 #include <lo/lo.h>
 
 #include "device.h"
 #include "graph.h"
 #include "mpr_time.h"
+#include "udp_batch.h"
 #include "util/mpr_inline.h"
 
 typedef enum {
@@ -41,12 +43,45 @@ void mpr_net_add_dev_server_method(mpr_net net, mpr_local_dev dev, const char *p
 
 void mpr_net_remove_dev_server_method(mpr_net net, mpr_local_dev dev, const char *path);
 
+/*! Receive the updates that a remote device sends to a multicast group for a local map slot.
+ *  Groups are joined once and shared by every slot that uses them.
+ *  \param net         The network structure to use.
+ *  \param group       The multicast group address.
+ *  \param port        The port of the multicast group.
+ *  \param slot        The source slot of a local map with a remote source signal.
+ *  \return            Zero if successful, non-zero if the group could not be joined. */
+int mpr_net_join_data_group(mpr_net net, const char *group, int port,
+                            struct _mpr_local_slot *slot);
+
+/*! Stop receiving updates from a multicast group for a map slot, leaving the group if no other
+ *  slots use it.
+ *  \param net         The network structure to use.
+ *  \param slot        The slot passed to `mpr_net_join_data_group()`. */
+void mpr_net_leave_data_group(mpr_net net, struct _mpr_local_slot *slot);
+
 int mpr_net_poll(mpr_net n, int block_ms);
 
 int mpr_net_start_polling(mpr_net net, int block_ms);
 
 int mpr_net_stop_polling(mpr_net net);
 
+/*! Retrieve the file descriptors to watch when the network is driven by an external event loop.
+ *  \param net         The network structure to query.
+ *  \param fds         An array to fill with file descriptors.
+ *  \param size        The number of elements in the array.
+ *  \return            The number of file descriptors, which may be larger than `size`. */
+int mpr_net_get_fds(mpr_net net, int *fds, int size);
+
+/*! Retrieve the time until `mpr_net_process_fds()` should next be called.
+ *  \param net         The network structure to query.
+ *  \return            The timeout in milliseconds, or -1 if there is no deadline. */
+int mpr_net_get_timeout(mpr_net net);
+
+/*! Handle everything waiting on the network's file descriptors without blocking.
+ *  \param net         The network structure to use.
+ *  \return            The number of handled messages. */
+int mpr_net_process_fds(mpr_net net);
+
 int mpr_net_init(mpr_net n, const char *iface, const char *group, int port);
 
 void mpr_net_use_local(mpr_net n);
@@ -57,7 +92,9 @@ void mpr_net_use_mesh(mpr_net n, lo_address addr, mpr_time *time);
 
 void mpr_net_use_subscribers(mpr_net net, mpr_local_dev dev, int type);
 
-void mpr_net_add_msg(mpr_net n, const char *str, net_msg_t cmd, lo_message msg);
+/*! Add a message to the bundle being prepared, sending the bundle first if it would become too
+ *  large. Returns the length of the message in bytes. */
+int mpr_net_add_msg(mpr_net n, const char *str, net_msg_t cmd, lo_message msg);
 
 void mpr_net_send(mpr_net n);
 
@@ -73,6 +110,48 @@ const char *mpr_net_get_interface(mpr_net net);
 
 const char *mpr_net_get_address(mpr_net net);
 
+/*! Check whether a host address belongs to this computer.
+ *  \param net         The network structure to use.
+ *  \param host        The numeric address of the host.
+ *  \return            Non-zero if the address is a loopback address or that of the interface. */
+int mpr_net_get_is_local_host(mpr_net net, const char *host);
+
+/*! Enable or disable batched sending and receiving of signal updates.
+ *  \param net         The network structure to use.
+ *  \param use         Non-zero to use batched I/O.
+ *  \return            Zero if successful, less than zero if batched I/O is not supported. */
+int mpr_net_set_use_batch_io(mpr_net net, int use);
+
+/*! Retrieve the batch used for sending signal updates.
+ *  \param net         The network structure to query.
+ *  \return            The batch, or zero if batched I/O is disabled. */
+mpr_udp_batch mpr_net_get_udp_batch(mpr_net net);
+
+/*! Send any signal updates queued in the network's batch.
+ *  \param net         The network structure to use. */
+void mpr_net_flush_udp_batch(mpr_net net);
+
+/*! Enable or disable event-driven polling, in which sockets are watched using epoll and
+ *  housekeeping is scheduled on timers so that polling only wakes when there is work to do.
+ *  \param net         The network structure to use.
+ *  \param use         Non-zero to use event-driven polling.
+ *  \return            Zero if successful, less than zero if event-driven polling is not
+ *                     supported or the network is being polled. */
+int mpr_net_set_use_epoll(mpr_net net, int use);
+
+/*! Interrupt event-driven polling that is sleeping in another thread, e.g. because updates or
+ *  messages have been queued.
+ *  \param net         The network structure to use.
+ *  \param housekeeping Non-zero if graph housekeeping should also be run promptly. */
+void mpr_net_wake(mpr_net net, int housekeeping);
+
+/*! Ask for the network to be polled again no later than the given time, e.g. because a link is
+ *  holding updates that will be due then. Requests are forgotten once polling has processed
+ *  the local devices.
+ *  \param net         The network structure to use.
+ *  \param when        The time at which polling should resume, see mpr_get_current_time(). */
+void mpr_net_schedule_send(mpr_net net, double when);
+
 #define NEW_LO_MSG(VARNAME, FAIL)           \
 lo_message VARNAME = lo_message_new();      \
 if (!VARNAME) {                             \
@@ -42,7 +42,8 @@ void mpr_obj_incr_version(mpr_obj o)
         ++o->version;
         mpr_tbl_set_is_dirty(o->props.synced, 1);
         if (o->type == MPR_SIG)
-            ((mpr_obj)mpr_sig_get_dev((mpr_sig)o))->status |= MPR_DEV_SIG_CHANGED;
+            mpr_local_dev_set_sig_changed((mpr_local_dev)mpr_sig_get_dev((mpr_sig)o),
+                                          (mpr_local_sig)o);
     }
     else if (o->props.staged)
         mpr_tbl_set_is_dirty(o->props.staged, 1);
@@ -0,0 +1,49 @@
+#include <string.h>
+
+#include "osc_decoder.h"
+#include "util/mpr_debug.h"
+
+#define BUNDLE_HEADER_LEN   16      /* "#bundle" and the timetag */
+
+int mpr_osc_get_bundle_time(const char *data, size_t len, mpr_time *time)
+{
+    RETURN_ARG_UNLESS(len >= BUNDLE_HEADER_LEN && !memcmp(data, "#bundle", 8), 0);
+    time->sec = mpr_osc_read_be32(data + 8);
+    time->frac = mpr_osc_read_be32(data + 12);
+    return 1;
+}
+
+char *mpr_osc_get_bundle_elem(char *data, size_t len, size_t *offset, size_t *elem_len)
+{
+    size_t size;
+    if (*offset < BUNDLE_HEADER_LEN)
+        *offset = BUNDLE_HEADER_LEN;
+    RETURN_ARG_UNLESS(*offset + 4 <= len, 0);
+    size = mpr_osc_read_be32(data + *offset);
+    RETURN_ARG_UNLESS(size && !(size & 3) && size <= len - *offset - 4, 0);
+    data += *offset + 4;
+    *offset += size + 4;
+    *elem_len = size;
+    return data;
+}
+
+/* Return the padded length of the string at the start of a buffer, or zero if it is not
+ * terminated within the buffer. */
+static size_t get_padded_len(const char *str, size_t len)
+{
+    const char *end = memchr(str, 0, len);
+    RETURN_ARG_UNLESS(end, 0);
+    return ((end - str) + 4) & ~(size_t)3;
+}
+
+int mpr_osc_parse_msg(const char *msg, size_t len, const char **types, const char **args)
+{
+    size_t path_len, types_len;
+    RETURN_ARG_UNLESS(len && '/' == msg[0] && (path_len = get_padded_len(msg, len)), 1);
+    RETURN_ARG_UNLESS(path_len < len && ',' == msg[path_len], 1);
+    RETURN_ARG_UNLESS((types_len = get_padded_len(msg + path_len, len - path_len)), 1);
+    RETURN_ARG_UNLESS(path_len + types_len <= len, 1);
+    *types = msg + path_len + 1;
+    *args = msg + path_len + types_len;
+    return 0;
+}
@@ -0,0 +1,50 @@
+
+#ifndef __MPR_OSC_DECODER_H__
+#define __MPR_OSC_DECODER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mapper/mapper_types.h>
+
+#include "util/mpr_inline.h"
+
+/*! Helpers for reading OSC datagrams in place, used to handle signal updates without having liblo
+ *  build intermediate messages and argument arrays. */
+
+/*! Check whether a datagram is an OSC bundle and retrieve its timetag.
+ *  \param data         The datagram.
+ *  \param len          The length of the datagram in bytes.
+ *  \param time         Location for the timetag of the bundle.
+ *  \return             Non-zero if the datagram is a bundle. */
+int mpr_osc_get_bundle_time(const char *data, size_t len, mpr_time *time);
+
+/*! Retrieve the next element of an OSC bundle.
+ *  \param data         The bundle.
+ *  \param len          The length of the bundle in bytes.
+ *  \param offset       Offset of the next element, which should be initialized to zero and is
+ *                      advanced past the element.
+ *  \param elem_len     Location for the length of the element in bytes.
+ *  \return             The element, or zero if there are no more elements or the bundle is
+ *                      malformed. */
+char *mpr_osc_get_bundle_elem(char *data, size_t len, size_t *offset, size_t *elem_len);
+
+/*! Locate the path, typetags and arguments of an OSC message.
+ *  \param msg          The message.
+ *  \param len          The length of the message in bytes.
+ *  \param types        Location for the typetags, not including the leading comma.
+ *  \param args         Location for the arguments.
+ *  \return             Zero if the message is well-formed, non-zero otherwise. */
+int mpr_osc_parse_msg(const char *msg, size_t len, const char **types, const char **args);
+
+MPR_INLINE static uint32_t mpr_osc_read_be32(const char *p)
+{
+    const unsigned char *u = (const unsigned char*)p;
+    return ((uint32_t)u[0] << 24) | ((uint32_t)u[1] << 16) | ((uint32_t)u[2] << 8) | u[3];
+}
+
+MPR_INLINE static uint64_t mpr_osc_read_be64(const char *p)
+{
+    return ((uint64_t)mpr_osc_read_be32(p) << 32) | mpr_osc_read_be32(p + 4);
+}
+
+#endif /* __MPR_OSC_DECODER_H__ */
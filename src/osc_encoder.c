@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "bitflags.h"
+#include "mpr_type.h"
+#include "osc_encoder.h"
+#include "util/mpr_debug.h"
+
+#include <mapper/mapper.h>
+
+#define INITIAL_SIZE        1024
+#define MAX_DATAGRAM_LEN    65507   /* largest UDP payload over IPv4 */
+#define BUNDLE_HEADER_LEN   16      /* "#bundle" and the timetag */
+#define INSTANCE_ARGS_LEN   12      /* the string "@in" and an int64 instance id */
+
+#define PAD4(LEN) (((LEN) + 3) & ~(size_t)3)
+
+typedef struct _mpr_osc_template {
+    char *path;                     /*!< Path padded with zeros to a multiple of four bytes. */
+    char *types;                    /*!< Typetags of a value vector with all elements known. */
+    size_t path_len;
+    int len;
+    mpr_type type;
+    uint8_t size;                   /*!< Size of an encoded element in bytes. */
+} mpr_osc_template_t;
+
+typedef struct _mpr_osc_encoder {
+    char *buf;
+    size_t size;
+    size_t used;
+    int num_msgs;
+} mpr_osc_encoder_t;
+
+mpr_osc_template mpr_osc_template_new(const char *path, mpr_type type, int len)
+{
+    mpr_osc_template tmpl;
+    RETURN_ARG_UNLESS(path && len > 0, 0);
+    RETURN_ARG_UNLESS(MPR_INT32 == type || MPR_FLT == type || MPR_DBL == type, 0);
+    tmpl = (mpr_osc_template)calloc(1, sizeof(mpr_osc_template_t));
+    tmpl->path_len = PAD4(strlen(path) + 1);
+    tmpl->path = (char*)calloc(1, tmpl->path_len);
+    strcpy(tmpl->path, path);
+    tmpl->types = (char*)malloc(len);
+    memset(tmpl->types, type, len);
+    tmpl->len = len;
+    tmpl->type = type;
+    tmpl->size = MPR_DBL == type ? 8 : 4;
+    return tmpl;
+}
+
+void mpr_osc_template_free(mpr_osc_template tmpl)
+{
+    RETURN_UNLESS(tmpl);
+    free(tmpl->path);
+    free(tmpl->types);
+    free(tmpl);
+}
+
+int mpr_osc_template_get_matches(mpr_osc_template tmpl, mpr_type type, int len)
+{
+    return tmpl->type == type && tmpl->len == len;
+}
+
+mpr_osc_encoder mpr_osc_encoder_new(void)
+{
+    mpr_osc_encoder enc = (mpr_osc_encoder)calloc(1, sizeof(mpr_osc_encoder_t));
+    enc->size = INITIAL_SIZE;
+    enc->buf = (char*)malloc(enc->size);
+    return enc;
+}
+
+void mpr_osc_encoder_free(mpr_osc_encoder enc)
+{
+    RETURN_UNLESS(enc);
+    free(enc->buf);
+    free(enc);
+}
+
+MPR_INLINE static char *write_be32(char *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+    return p + 4;
+}
+
+MPR_INLINE static char *write_be64(char *p, uint64_t v)
+{
+    p = write_be32(p, v >> 32);
+    return write_be32(p, (uint32_t)v);
+}
+
+static int reserve(mpr_osc_encoder enc, size_t len)
+{
+    size_t size = enc->size;
+    RETURN_ARG_UNLESS(enc->used + len > size, 0);
+    RETURN_ARG_UNLESS(enc->used + len <= MAX_DATAGRAM_LEN, 1);
+    while (size < enc->used + len)
+        size *= 2;
+    if (size > MAX_DATAGRAM_LEN)
+        size = MAX_DATAGRAM_LEN;
+    enc->buf = (char*)realloc(enc->buf, size);
+    enc->size = size;
+    return 0;
+}
+
+int mpr_osc_encoder_add_updates(mpr_osc_encoder enc, mpr_osc_template tmpl, mpr_time time,
+                                int num, const mpr_id *GIDs, const char *data)
+{
+    int i, j, len = tmpl->len, num_types = 0;
+    size_t vsize = len * mpr_type_get_size(tmpl->type), esize = MPR_UPDATE_SIZE(vsize, len);
+    size_t types_len, max_len = 0;
+    char *start, *types, *args;
+    RETURN_ARG_UNLESS(num > 0, 0);
+
+    /* the typetags only depend on which updates are instanced, so their length is known before
+     * encoding; the arguments are sized assuming all elements are known */
+    for (i = 0; i < num; i++) {
+        num_types += len;
+        max_len += len * tmpl->size;
+        if (GIDs[i]) {
+            num_types += 2;
+            max_len += INSTANCE_ARGS_LEN;
+        }
+    }
+    types_len = PAD4(num_types + 2);
+    max_len += 4 + tmpl->path_len + types_len;
+    RETURN_ARG_UNLESS(!reserve(enc, max_len + (enc->num_msgs ? 0 : BUNDLE_HEADER_LEN)), 1);
+
+    if (!enc->num_msgs) {
+        memcpy(enc->buf, "#bundle", 8);
+        write_be32(write_be32(enc->buf + 8, time.sec), time.frac);
+        enc->used = BUNDLE_HEADER_LEN;
+    }
+
+    /* leave room for the message size, then copy the precomputed path */
+    start = enc->buf + enc->used;
+    types = start + 4;
+    memcpy(types, tmpl->path, tmpl->path_len);
+    types += tmpl->path_len;
+    memset(types, 0, types_len);
+    args = types + types_len;
+    *types++ = ',';
+
+    /* write the typetags and arguments in a single pass */
+    for (i = 0; i < num; i++, data += esize) {
+        mpr_bitflags known = (mpr_bitflags)(data + vsize);
+        if (GIDs[i]) {
+            *types++ = 's';
+            *types++ = 'h';
+            memcpy(args, "@in", 4);
+            args = write_be64(args + 4, GIDs[i]);
+        }
+        memcpy(types, tmpl->types, len);
+        for (j = 0; j < len; j++) {
+            if (!mpr_bitflags_get(known, j)) {
+                types[j] = 'N';
+                continue;
+            }
+            switch (tmpl->type) {
+                case MPR_INT32: {
+                    uint32_t v;
+                    memcpy(&v, (const int*)data + j, 4);
+                    args = write_be32(args, v);
+                    break;
+                }
+                case MPR_FLT: {
+                    uint32_t v;
+                    memcpy(&v, (const float*)data + j, 4);
+                    args = write_be32(args, v);
+                    break;
+                }
+                default: {
+                    uint64_t v;
+                    memcpy(&v, (const double*)data + j, 8);
+                    args = write_be64(args, v);
+                    break;
+                }
+            }
+        }
+        types += len;
+    }
+    write_be32(start, args - start - 4);
+    enc->used = args - enc->buf;
+    ++enc->num_msgs;
+    return 0;
+}
+
+int mpr_osc_encoder_get_num_msgs(mpr_osc_encoder enc)
+{
+    return enc->num_msgs;
+}
+
+const void *mpr_osc_encoder_get_data(mpr_osc_encoder enc, size_t *len)
+{
+    *len = enc->used;
+    return enc->buf;
+}
+
+void mpr_osc_encoder_reset(mpr_osc_encoder enc)
+{
+    enc->used = 0;
+    enc->num_msgs = 0;
+}
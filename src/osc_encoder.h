@@ -0,0 +1,73 @@
+
+#ifndef __MPR_OSC_ENCODER_H__
+#define __MPR_OSC_ENCODER_H__
+
+#include <stddef.h>
+#include <mapper/mapper_types.h>
+#include "bitflags.h"
+
+/*! An encoder that writes signal updates as an OSC bundle directly into a preallocated buffer,
+ *  without building intermediate messages. The buffer only grows when a larger bundle than any
+ *  before it is encoded, so that steady-state sending does not allocate. */
+typedef struct _mpr_osc_encoder *mpr_osc_encoder;
+
+/*! The static parts of the OSC messages carrying updates for a signal: the padded path and the
+ *  typetags of a value vector with all elements known. */
+typedef struct _mpr_osc_template *mpr_osc_template;
+
+/*! The size of an unencoded update as stored by destination slots: the value vector followed by
+ *  the bitflags indicating which elements are known, padded to 8 bytes so that the value vectors
+ *  of consecutive updates stay aligned. */
+#define MPR_UPDATE_SIZE(VSIZE, LEN) (((VSIZE) + MPR_BITFLAGS_SIZE(LEN) + 7) & ~(size_t)7)
+
+/*! Create a new template.
+ *  \param path         The OSC path of the destination signal.
+ *  \param type         The data type of the signal.
+ *  \param len          The vector length of the signal.
+ *  \return             The new template, or zero if the type is not supported. */
+mpr_osc_template mpr_osc_template_new(const char *path, mpr_type type, int len);
+
+/*! Free a template. */
+void mpr_osc_template_free(mpr_osc_template tmpl);
+
+/*! Check whether a template was created for a signal with the given type and vector length.
+ *  \param tmpl         The template to check.
+ *  \param type         The data type of the signal.
+ *  \param len          The vector length of the signal.
+ *  \return             Non-zero if the template matches. */
+int mpr_osc_template_get_matches(mpr_osc_template tmpl, mpr_type type, int len);
+
+/*! Create a new encoder.
+ *  \return             The new encoder. */
+mpr_osc_encoder mpr_osc_encoder_new(void);
+
+/*! Free an encoder. */
+void mpr_osc_encoder_free(mpr_osc_encoder enc);
+
+/*! Encode updates as a single OSC message and add it to the bundle being built. The bundle is
+ *  started with the given timetag if it is empty.
+ *  \param enc          The encoder to use.
+ *  \param tmpl         The template for the destination signal.
+ *  \param time         The timetag for the bundle.
+ *  \param num          The number of updates.
+ *  \param GIDs         Instance id for each update, or zero if not instanced.
+ *  \param data         Each update's value vector followed by bitflags indicating which elements
+ *                      are known, as stored by destination slots.
+ *  \return             Zero if the message was added, non-zero if it would exceed the maximum
+ *                      datagram size. */
+int mpr_osc_encoder_add_updates(mpr_osc_encoder enc, mpr_osc_template tmpl, mpr_time time,
+                                int num, const mpr_id *GIDs, const char *data);
+
+/*! Retrieve the number of messages in the bundle being built. */
+int mpr_osc_encoder_get_num_msgs(mpr_osc_encoder enc);
+
+/*! Retrieve the encoded bundle.
+ *  \param enc          The encoder to query.
+ *  \param len          Location for the length of the bundle in bytes.
+ *  \return             The encoded bundle. */
+const void *mpr_osc_encoder_get_data(mpr_osc_encoder enc, size_t *len);
+
+/*! Discard the bundle being built while keeping the buffer for reuse. */
+void mpr_osc_encoder_reset(mpr_osc_encoder enc);
+
+#endif /* __MPR_OSC_ENCODER_H__ */
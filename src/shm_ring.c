@@ -0,0 +1,251 @@
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_SHM_OPEN) && defined(HAVE_SYS_MMAN_H)
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <fcntl.h>
+ #include <signal.h>
+ #include <errno.h>
+ #include <unistd.h>
+ #define USE_SHM
+#endif
+
+#include "shm_ring.h"
+#include "util/mpr_debug.h"
+
+#define SHM_RING_MAGIC  0x6d707231  /* "mpr1" */
+#define WRAP_MARKER     0xFFFFFFFF
+#define ALIGN8(x)       (((x) + 7) & ~(size_t)7)
+
+/*! Header at the start of the shared memory object. The write and read positions are kept on
+ *  separate cache lines since they are written by different processes. Positions increase
+ *  monotonically and wrap around at 2^32, which is a multiple of the ring size. */
+typedef struct _mpr_shm_hdr {
+    uint32_t magic;
+    uint32_t size;                  /*!< Number of bytes for records, always a power of two. */
+    uint64_t src_id;
+    uint64_t dst_id;
+    int32_t pid;                    /*!< Process id of the producer. */
+    volatile uint32_t attached;     /*!< Set by the consumer while it is reading. */
+    volatile uint32_t closed;       /*!< Set by the producer once it stops writing. */
+    volatile uint32_t waiting;      /*!< Set by the consumer before it blocks. */
+    uint8_t pad1[24];
+    volatile uint32_t head;         /*!< Write position, only modified by the producer. */
+    uint8_t pad2[60];
+    volatile uint32_t tail;         /*!< Read position, only modified by the consumer. */
+    uint8_t pad3[60];
+} mpr_shm_hdr_t, *mpr_shm_hdr;
+
+typedef struct _mpr_shm_ring {
+    mpr_shm_hdr hdr;
+    char *data;
+    char *name;                     /*!< Name of the shared memory object, producer only. */
+    size_t map_size;
+    uint32_t mask;
+    uint32_t pos;                   /*!< Pending write position, or current read position. */
+    uint32_t rec_size;              /*!< Size of the last peeked record. */
+} mpr_shm_ring_t;
+
+int mpr_shm_ring_get_is_supported(void)
+{
+#ifdef USE_SHM
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+#ifdef USE_SHM
+static mpr_shm_ring map_ring(int fd, size_t map_size)
+{
+    mpr_shm_ring ring;
+    void *mem = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    RETURN_ARG_UNLESS(mem != MAP_FAILED, 0);
+    ring = (mpr_shm_ring)calloc(1, sizeof(mpr_shm_ring_t));
+    ring->hdr = (mpr_shm_hdr)mem;
+    ring->data = (char*)mem + sizeof(mpr_shm_hdr_t);
+    ring->map_size = map_size;
+    return ring;
+}
+#endif
+
+mpr_shm_ring mpr_shm_ring_new(const char *name, size_t size, uint64_t src_id, uint64_t dst_id)
+{
+#ifdef USE_SHM
+    mpr_shm_ring ring;
+    size_t ring_size = 64;
+    int fd;
+
+    while (ring_size < size)
+        ring_size <<= 1;
+    RETURN_ARG_UNLESS(ring_size <= 0x40000000, 0);
+
+    /* replace any ring left behind by a process that did not exit cleanly */
+    shm_unlink(name);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    TRACE_RETURN_UNLESS(fd >= 0, 0, "couldn't create shared memory ring '%s'\n", name);
+    if (ftruncate(fd, sizeof(mpr_shm_hdr_t) + ring_size)) {
+        trace("couldn't size shared memory ring '%s'\n", name);
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+    if (!(ring = map_ring(fd, sizeof(mpr_shm_hdr_t) + ring_size))) {
+        shm_unlink(name);
+        return 0;
+    }
+    ring->name = strdup(name);
+    ring->mask = ring_size - 1;
+    ring->hdr->size = ring_size;
+    ring->hdr->src_id = src_id;
+    ring->hdr->dst_id = dst_id;
+    ring->hdr->pid = getpid();
+    __sync_synchronize();
+    ring->hdr->magic = SHM_RING_MAGIC;
+    return ring;
+#else
+    return 0;
+#endif
+}
+
+mpr_shm_ring mpr_shm_ring_open(const char *name, uint64_t src_id, uint64_t dst_id)
+{
+#ifdef USE_SHM
+    mpr_shm_ring ring;
+    mpr_shm_hdr hdr;
+    struct stat st;
+    int fd = shm_open(name, O_RDWR, 0600);
+    RETURN_ARG_UNLESS(fd >= 0, 0);
+    if (fstat(fd, &st) || st.st_size < sizeof(mpr_shm_hdr_t)) {
+        close(fd);
+        return 0;
+    }
+    RETURN_ARG_UNLESS((ring = map_ring(fd, st.st_size)), 0);
+    hdr = ring->hdr;
+    __sync_synchronize();
+    if (   SHM_RING_MAGIC != hdr->magic || hdr->closed || hdr->src_id != src_id
+        || hdr->dst_id != dst_id || !hdr->size || (hdr->size & (hdr->size - 1))
+        || sizeof(mpr_shm_hdr_t) + hdr->size > ring->map_size
+        || mpr_shm_ring_get_is_orphaned(ring)) {
+        munmap(hdr, ring->map_size);
+        free(ring);
+        return 0;
+    }
+    ring->mask = hdr->size - 1;
+
+    /* skip anything written for a previous consumer */
+    ring->pos = hdr->head;
+    hdr->tail = ring->pos;
+    __sync_synchronize();
+    hdr->attached = 1;
+    return ring;
+#else
+    return 0;
+#endif
+}
+
+void mpr_shm_ring_free(mpr_shm_ring ring)
+{
+    RETURN_UNLESS(ring);
+#ifdef USE_SHM
+    if (ring->name) {
+        ring->hdr->closed = 1;
+        shm_unlink(ring->name);
+        free(ring->name);
+    }
+    else
+        ring->hdr->attached = 0;
+    __sync_synchronize();
+    munmap(ring->hdr, ring->map_size);
+#endif
+    free(ring);
+}
+
+int mpr_shm_ring_get_is_attached(mpr_shm_ring ring)
+{
+    return ring->hdr->attached;
+}
+
+int mpr_shm_ring_get_is_closed(mpr_shm_ring ring)
+{
+    return ring->hdr->closed;
+}
+
+int mpr_shm_ring_get_is_orphaned(mpr_shm_ring ring)
+{
+#ifdef USE_SHM
+    return kill(ring->hdr->pid, 0) && ESRCH == errno;
+#else
+    return 0;
+#endif
+}
+
+void *mpr_shm_ring_reserve(mpr_shm_ring ring, size_t len)
+{
+    uint32_t off = ring->pos & ring->mask, size = ring->mask + 1, used, need, skip = 0;
+    size_t rec_size = ALIGN8(len + 8);
+    RETURN_ARG_UNLESS(rec_size <= size / 2, 0);
+    need = rec_size;
+
+    /* records are not split across the end of the ring */
+    if (size - off < need)
+        need += skip = size - off;
+
+    used = ring->pos - ring->hdr->tail;
+    __sync_synchronize();
+    RETURN_ARG_UNLESS(used + need <= size, 0);
+
+    if (skip) {
+        *(uint32_t*)(ring->data + off) = WRAP_MARKER;
+        ring->pos += skip;
+        off = 0;
+    }
+    *(uint32_t*)(ring->data + off) = len;
+    ring->pos += rec_size;
+    return ring->data + off + 8;
+}
+
+int mpr_shm_ring_commit(mpr_shm_ring ring)
+{
+    __sync_synchronize();
+    ring->hdr->head = ring->pos;
+    __sync_synchronize();
+    return ring->hdr->waiting;
+}
+
+const void *mpr_shm_ring_peek(mpr_shm_ring ring, size_t *len)
+{
+    uint32_t head = ring->hdr->head, off, rec_len;
+    __sync_synchronize();
+    while (ring->pos != head) {
+        off = ring->pos & ring->mask;
+        rec_len = *(uint32_t*)(ring->data + off);
+        if (WRAP_MARKER == rec_len) {
+            ring->pos += ring->mask + 1 - off;
+            continue;
+        }
+        ring->rec_size = ALIGN8(rec_len + 8);
+        *len = rec_len;
+        return ring->data + off + 8;
+    }
+    return 0;
+}
+
+void mpr_shm_ring_release(mpr_shm_ring ring)
+{
+    ring->pos += ring->rec_size;
+    ring->rec_size = 0;
+    __sync_synchronize();
+    ring->hdr->tail = ring->pos;
+}
+
+int mpr_shm_ring_set_waiting(mpr_shm_ring ring, int waiting)
+{
+    ring->hdr->waiting = waiting ? 1 : 0;
+    __sync_synchronize();
+    return ring->pos != ring->hdr->head;
+}
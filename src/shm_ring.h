@@ -0,0 +1,80 @@
+
+#ifndef __MPR_SHM_RING_H__
+#define __MPR_SHM_RING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*! A single-producer, single-consumer ring buffer of variable-length records in shared memory,
+ *  used for passing signal updates between processes on the same host. The producer creates the
+ *  ring and the consumer attaches to it by name. Records are passed without locks or system
+ *  calls; the read and write positions are published using memory barriers. */
+typedef struct _mpr_shm_ring *mpr_shm_ring;
+
+/*! Default number of bytes available for records in a ring. */
+#define MPR_SHM_RING_SIZE 262144
+
+/*! Check whether shared memory rings are available on this platform.
+ *  \return             Non-zero if rings can be created. */
+int mpr_shm_ring_get_is_supported(void);
+
+/*! Create a new ring for writing. Any stale ring with the same name is replaced.
+ *  \param name         The name of the shared memory object.
+ *  \param size         Number of bytes available for records, rounded up to a power of two.
+ *  \param src_id       Id of the producer, checked by the consumer when attaching.
+ *  \param dst_id       Id of the consumer, checked by the consumer when attaching.
+ *  \return             The new ring, or zero if it could not be created. */
+mpr_shm_ring mpr_shm_ring_new(const char *name, size_t size, uint64_t src_id, uint64_t dst_id);
+
+/*! Attach to an existing ring for reading.
+ *  \param name         The name of the shared memory object.
+ *  \param src_id       Expected id of the producer.
+ *  \param dst_id       Expected id of the consumer.
+ *  \return             The ring, or zero if it does not exist or does not match. */
+mpr_shm_ring mpr_shm_ring_open(const char *name, uint64_t src_id, uint64_t dst_id);
+
+/*! Release a ring. The producer marks the ring as closed and removes its name, while the consumer
+ *  marks the ring as detached so that the producer stops writing to it. */
+void mpr_shm_ring_free(mpr_shm_ring ring);
+
+/*! Check whether a consumer is attached to a ring. Only valid for the producer. */
+int mpr_shm_ring_get_is_attached(mpr_shm_ring ring);
+
+/*! Check whether the producer has closed a ring. Only valid for the consumer. */
+int mpr_shm_ring_get_is_closed(mpr_shm_ring ring);
+
+/*! Check whether the process that created a ring has exited without closing it, e.g. because it
+ *  crashed. This requires a system call so it should only be called occasionally. */
+int mpr_shm_ring_get_is_orphaned(mpr_shm_ring ring);
+
+/*! Reserve space for writing a record. The record is not visible to the consumer until
+ *  `mpr_shm_ring_commit()` is called, so several records can be written before publishing them.
+ *  \param ring         The ring to write to.
+ *  \param len          Length of the record in bytes.
+ *  \return             Pointer to 8-byte aligned space for the record, or zero if the ring is
+ *                      full. */
+void *mpr_shm_ring_reserve(mpr_shm_ring ring, size_t len);
+
+/*! Publish all records reserved since the last commit.
+ *  \param ring         The ring to write to.
+ *  \return             Non-zero if the consumer is blocked waiting for records and should be
+ *                      woken by some other means. */
+int mpr_shm_ring_commit(mpr_shm_ring ring);
+
+/*! Retrieve the next record without removing it from a ring.
+ *  \param ring         The ring to read from.
+ *  \param len          Location for the length of the record.
+ *  \return             Pointer to the record, or zero if the ring is empty. */
+const void *mpr_shm_ring_peek(mpr_shm_ring ring, size_t *len);
+
+/*! Remove the record returned by the last call to `mpr_shm_ring_peek()`. */
+void mpr_shm_ring_release(mpr_shm_ring ring);
+
+/*! Tell the producer whether the consumer is about to block waiting for records.
+ *  \param ring         The ring to read from.
+ *  \param waiting      Non-zero if the consumer will block.
+ *  \return             Non-zero if records are already available, in which case the consumer
+ *                      should not block. */
+int mpr_shm_ring_set_waiting(mpr_shm_ring ring, int waiting);
+
+#endif /* __MPR_SHM_RING_H__ */
@@ -10,6 +10,7 @@
 #include "graph.h"
 #include "mpr_signal.h"
 #include "object.h"
+#include "osc_decoder.h"
 #include "path.h"
 #include "property.h"
 #include "table.h"
@@ -21,7 +22,6 @@
 #include <malloc.h>
 #endif
 
-#define MAX_INST 128
 #define BUFFSIZE 512
 
 /* Signals and signal instances
@@ -70,9 +70,18 @@ typedef struct _mpr_sig_inst
     mpr_time created;               /*!< The instance's creation timestamp. */
 
     uint16_t status;                /*!< Status of this instance. */
-    uint8_t idx;                    /*!< Index for accessing value history. */
+    unsigned int idx;               /*!< Index for accessing value history. */
+    int id_map_idx;                 /*!< Index of the most recent id map used by this instance.
+                                     *   Must be verified before use since id maps are reused. */
 } mpr_sig_inst_t;
 
+/*! A block of signal instances reserved together. Blocks are only freed along with the signal;
+ *  the records of removed instances are kept on a free list for reuse. */
+typedef struct _mpr_sig_inst_block {
+    struct _mpr_sig_inst_block *next;
+    mpr_sig_inst_t inst[];
+} mpr_sig_inst_block_t, *mpr_sig_inst_block;
+
 /* plan: remove inst, add map/slot resource index (is this the same for all source signals?) */
 typedef struct _mpr_sig_id_map
 {
@@ -90,7 +99,10 @@ typedef struct _mpr_local_sig
     mpr_sig_id_map id_maps;         /*!< ID maps and active instances. */
     mpr_value value;
     unsigned int num_id_maps;
-    mpr_sig_inst *inst;             /*!< Array of pointers to the signal insts. */
+    mpr_sig_inst *inst;             /*!< Array of pointers to the signal insts sorted by id. */
+    mpr_sig_inst *inst_by_idx;      /*!< Array of pointers to the signal insts indexed by idx. */
+    mpr_sig_inst_block inst_blocks; /*!< Storage for the signal insts. */
+    mpr_sig_inst free_inst;         /*!< Removed insts, linked through their data pointer. */
     mpr_bitflags updated_inst;      /*!< Bitflags to indicate updated instances. */
 
     /*! An optional function to be called when the signal value changes or when
@@ -102,7 +114,18 @@ typedef struct _mpr_local_sig
     mpr_local_slot *slots_in;
     mpr_local_slot *slots_out;
 
+    /* Multicast group to which updates are sent once for every remote destination that has
+     * confirmed receiving them there, instead of separately through each link. */
+    struct {
+        lo_address addr;
+        char *group;
+        lo_message msg;             /*!< Updates waiting to be sent to the group. */
+        int port;
+        int num_msg;
+    } multicast;
+
     mpr_sig_group group;            /* TODO: replace with hierarchical instancing */
+    int meta_version;               /*!< Device version when the metadata last changed. */
     uint8_t locked;
     uint8_t updated;                /* TODO: fold into updated_inst bitflags. */
 } mpr_local_sig_t;
@@ -114,7 +137,16 @@ size_t mpr_sig_get_struct_size(int is_local)
 
 static int _compare_inst_ids(const void *l, const void *r)
 {
-    return (*(mpr_sig_inst*)l)->id - (*(mpr_sig_inst*)r)->id;
+    mpr_id l_id = (*(mpr_sig_inst*)l)->id, r_id = (*(mpr_sig_inst*)r)->id;
+    return l_id < r_id ? -1 : l_id > r_id;
+}
+
+/* Orders instances with the same id by their index, which holds the position of the instance in
+ * the arguments while reserving. */
+static int _compare_inst_ids_and_pos(const void *l, const void *r)
+{
+    int cmp = _compare_inst_ids(l, r);
+    return cmp ? cmp : ((*(mpr_sig_inst*)l)->idx < (*(mpr_sig_inst*)r)->idx ? -1 : 1);
 }
 
 static mpr_sig_inst _find_inst_by_id(mpr_local_sig lsig, mpr_id id)
@@ -133,6 +165,13 @@ MPR_INLINE static mpr_sig_inst _get_inst_by_id_map_idx(mpr_local_sig sig, int id
     return sig->id_maps[id_map_idx].inst;
 }
 
+/* Return the index of the id map last used by an instance if it still refers to the instance. */
+MPR_INLINE static int _get_id_map_hint(mpr_local_sig sig, mpr_sig_inst si)
+{
+    int i = si->id_map_idx;
+    return (i >= 0 && i < sig->num_id_maps && sig->id_maps[i].inst == si) ? i : -1;
+}
+
 /*! Helper to check if a type character is valid. */
 MPR_INLINE static int check_sig_length(int length)
 {
@@ -152,12 +191,40 @@ MPR_INLINE static int check_types(const mpr_type *types, int len, mpr_type sig_t
     return vals;
 }
 
+/* Updates of maps processed at their destination are sent to the signal's multicast group if the
+ * destination has confirmed receiving them there, unless the map uses TCP. */
+MPR_INLINE static int get_uses_multicast(mpr_local_map map, mpr_local_slot slot)
+{
+    return (   MPR_PROTO_UDP == mpr_map_get_protocol((mpr_map)map)
+            && mpr_local_slot_get_multicast(slot, 0));
+}
+
+/* Add an update to the message sent to the signal's multicast group. Only one copy is built however
+ * many maps receive it, and destinations discard instance ids and releases for maps that are not
+ * instanced. */
+static void build_multicast_msg(mpr_local_sig sig, int inst_idx, mpr_id_map id_map, int release)
+{
+    int i;
+    lo_message msg = sig->multicast.msg;
+    if (sig->use_inst) {
+        lo_message_add_string(msg, "@in");
+        lo_message_add_int64(msg, id_map->GID);
+    }
+    if (!release)
+        mpr_value_add_to_msg(sig->value, inst_idx, msg);
+    else {
+        for (i = 0; i < sig->len; i++)
+            lo_message_add_nil(msg);
+    }
+    ++sig->multicast.num_msg;
+}
+
 static void process_maps(mpr_local_sig sig, int id_map_idx)
 {
     mpr_id_map id_map = sig->id_maps[id_map_idx].id_map;
     mpr_sig_inst si;
     mpr_local_map map;
-    int i, j, inst_idx;
+    int i, j, inst_idx, multicast = 0;
     uint8_t *locked = &sig->locked;
     mpr_time time;
 
@@ -219,6 +286,7 @@ static void process_maps(mpr_local_sig sig, int id_map_idx)
                 mpr_slot_build_msg(src_slot, 0, 0, id_map);
                 /* TODO: consider calling this later for batch releases */
                 mpr_local_slot_send_msg(src_slot, NULL, time, proto);
+                mpr_local_map_queue(map, sig->dev, MPR_DIR_OUT);
             }
         }
         for (i = 0; i < sig->num_maps_out; i++) {
@@ -246,12 +314,18 @@ static void process_maps(mpr_local_sig sig, int id_map_idx)
                         /* TODO: use updated bitflags (or released before/after if necessary) to mark release,
                          * don't send immediately */
                         mpr_slot_build_msg(dst_slot, 0, 0, id_map);
-                        mpr_local_map_set_updated(map, inst_idx);
+                        mpr_local_map_set_updated(map, inst_idx, sig->dev);
                     }
                 }
+                else if (get_uses_multicast(map, src_slot)) {
+                    if (!multicast++)
+                        build_multicast_msg(sig, inst_idx, id_map, 1);
+                    mpr_local_map_queue(map, sig->dev, MPR_DIR_OUT);
+                }
                 else if (mpr_local_map_get_has_scope(map, id_map->GID)) {
                     /* need to build msg immediately since id_map won't be available later */
                     mpr_slot_build_msg(src_slot, 0, 0, id_map);
+                    mpr_local_map_queue(map, sig->dev, MPR_DIR_OUT);
                 }
             }
         }
@@ -270,6 +344,15 @@ static void process_maps(mpr_local_sig sig, int id_map_idx)
             != MPR_STATUS_ACTIVE)
             continue;
 
+        if (   MPR_LOC_DST == mpr_map_get_process_loc((mpr_map)map)
+            && get_uses_multicast(map, src_slot)) {
+            /* destinations filter updates by instance scope */
+            if (!multicast++)
+                build_multicast_msg(sig, inst_idx, id_map, 0);
+            mpr_local_map_queue(map, sig->dev, MPR_DIR_OUT);
+            continue;
+        }
+
         /* TODO: should we continue for out-of-scope local destination updates? */
         if (mpr_map_get_use_inst((mpr_map)map) && !(mpr_local_map_get_has_scope(map, id_map->GID)))
             continue;
@@ -284,6 +367,7 @@ static void process_maps(mpr_local_sig sig, int id_map_idx)
             mpr_slot_build_msg(src_slot, sig->value, inst_idx,
                                (   mpr_map_get_use_inst((mpr_map)map)
                                 && mpr_sig_get_use_inst((mpr_sig)sig)) ? id_map : 0);
+            mpr_local_map_queue(map, sig->dev, MPR_DIR_OUT);
             continue;
         }
 
@@ -316,7 +400,7 @@ static void process_maps(mpr_local_sig sig, int id_map_idx)
             if (!si && (all || mpr_sig_get_use_inst((mpr_sig)sig)))
                 continue;
             inst_idx = si->idx;
-            mpr_local_map_set_updated(map, inst_idx);
+            mpr_local_map_set_updated(map, inst_idx, sig->dev);
             if (!all)
                 break;
         }
@@ -347,95 +431,20 @@ static void process_maps(mpr_local_sig sig, int id_map_idx)
  * - flexible input (mapping something new to the persistent instances) is handled
  *   by using dynamic proxy id_maps */
 
-int mpr_sig_osc_handler(const char *path, const char *types, lo_arg **argv, int argc,
-                        lo_message msg, void *data)
+/* Apply an update addressed to a local signal, either directly or to a slot of one of its
+ * incoming maps. `vals` is the number of elements provided; if it is zero the update is an instance
+ * release and `value` is ignored. Otherwise `value` holds a full vector of the signal's (or slot's)
+ * type and `known` indicates which elements are present, or is zero if all of them are. Returns
+ * non-zero if any remaining updates in the same message should be discarded. */
+static int handle_update(mpr_local_sig sig, mpr_local_map map, mpr_local_slot slot, mpr_id GID,
+                         int vals, const void *value, mpr_bitflags known, mpr_time time)
 {
-    mpr_local_sig sig = (mpr_local_sig)data;
-    mpr_local_dev dev;
+    mpr_local_dev dev = sig->dev;
     mpr_sig_inst si;
-    mpr_net net = mpr_graph_get_net(sig->obj.graph);
-    int i, offset = 0, val_len = 0, vals;
-    int id_map_idx, inst_idx, slot_id = -1, map_manages_inst = 0;
-    mpr_id GID = 0;
+    mpr_sig slot_sig = slot ? mpr_slot_get_sig((mpr_slot)slot) : 0;
+    int i, id_map_idx, inst_idx;
     mpr_id_map id_map, remote_id_map = 0;
-    mpr_local_map map = 0;
-    mpr_local_slot slot = 0;
-    mpr_sig slot_sig = 0;
-    mpr_time time;
-
-    assert(sig);
-    dev = sig->dev;
-
-#ifdef DEBUG
-    trace("'%s:%s' received update: ", mpr_dev_get_name((mpr_dev)dev), sig->name);
-    lo_message_pp(msg);
-#endif
-
-    TRACE_RETURN_UNLESS(sig->num_inst, 0, "signal '%s' has no instances.\n", sig->name);
-    RETURN_ARG_UNLESS(argc, 0);
-
-    time = mpr_net_get_bundle_time(net);
-
-    /* We need to consider that there may be properties prepended to the msg
-     * check length and find properties if any */
-    if (types[0] == MPR_STR) {
-        if ((strcmp(&argv[0]->s, "@sl") == 0) && argc >= 2) {
-            TRACE_RETURN_UNLESS(types[1] == MPR_INT32, 0,
-                                "error in mpr_sig_osc_handler: bad arguments for 'slot' prop.\n")
-            slot_id = argv[1]->i32;
-            trace("retrieved slot id %d\n", slot_id);
-            offset += 2;
-        }
-    }
-again:
-    if (types[offset] == MPR_STR) {
-        if ((strcmp(&argv[offset]->s, "@in") == 0) && argc >= offset + 2) {
-            TRACE_RETURN_UNLESS(types[offset + 1] == MPR_INT64, 0,
-                                "error in mpr_sig_osc_handler: bad arguments for 'instance' prop.\n")
-            GID = argv[offset + 1]->i64;
-            trace("retrieved GUID %"PR_MPR_ID"\n", GID);
-            offset += 2;
-        }
-        else {
-            trace("error in mpr_sig_osc_handler: unknown property name '%s'.\n", &argv[offset]->s);
-            return 0;
-        }
-    }
-    val_len = offset;
-    while (val_len < argc && types[val_len] != MPR_STR)
-        ++val_len;
-    val_len -= offset;
-
-    if (slot_id >= 0) {
-        mpr_expr expr;
-        /* retrieve mapping associated with this slot */
-        for (i = 0; i < sig->num_maps_in; i++) {
-            map = (mpr_local_map)mpr_slot_get_map((mpr_slot)sig->slots_in[i]);
-            if ((slot = (mpr_local_slot)mpr_map_get_src_slot_by_id((mpr_map)map, slot_id)))
-                break;
-        }
-        TRACE_RETURN_UNLESS(slot, 0, "error in mpr_sig_osc_handler: slot %d not found.\n", slot_id);
-        slot_sig = mpr_slot_get_sig((mpr_slot)slot);
-        TRACE_RETURN_UNLESS(   (mpr_obj_get_status((mpr_obj)map, 0)
-                             & (MPR_STATUS_ACTIVE | MPR_STATUS_REMOVED)) == MPR_STATUS_ACTIVE,
-                            0, "error in mpr_sig_osc_handler: map not yet ready.\n");
-        if ((expr = mpr_local_map_get_expr(map)) && MPR_LOC_BOTH != mpr_map_get_locality((mpr_map)map)) {
-            vals = check_types(types + offset, val_len, slot_sig->type, slot_sig->len);
-            val_len = slot_sig->len;
-            map_manages_inst = mpr_expr_get_manages_inst(expr);
-        }
-        else {
-            /* value has already been processed at source device */
-            map = 0;
-            vals = check_types(types + offset, val_len, sig->type, sig->len);
-            val_len = sig->len;
-        }
-    }
-    else {
-        vals = check_types(types + offset, val_len, sig->type, sig->len);
-        val_len = sig->len;
-    }
-    RETURN_ARG_UNLESS(vals >= 0, 0);
+    size_t size = mpr_type_get_size(sig->type);
 
     /* TODO: optionally discard out-of-order messages
      * requires timebase sync for many-to-one mappings or local updates
@@ -444,12 +453,13 @@ again:
      */
 
     /* TODO: should map_get_use_inst() call be part of map_manages_inst? */
-    if (map_manages_inst && slot_sig->use_inst && mpr_map_get_use_inst((mpr_map)map)) {
+    if (   map && mpr_expr_get_manages_inst(mpr_local_map_get_expr(map))
+        && slot_sig->use_inst && mpr_map_get_use_inst((mpr_map)map)) {
         mpr_id_map id_map = mpr_local_map_get_id_map(map);
         if (!id_map->GID) {
             if (!vals) {
                 trace("no map-managed instances available for GUID %"PR_MPR_ID"\n", GID);
-                goto done;
+                return 0;
             }
             /* id_map is currently empty - claim it now */
             id_map->LID = GID;
@@ -457,7 +467,7 @@ again:
         }
         else if (id_map->LID != GID) {
             trace("no map-managed instances available for GUID %"PR_MPR_ID"\n", GID);
-            goto done;
+            return 0;
         }
         trace("creating new instance GUID remap: %"PR_MPR_ID" -> %"PR_MPR_ID"\n", GID, id_map->GID);
         GID = id_map->GID;
@@ -494,7 +504,7 @@ again:
 
         if (id_map_idx < 0) {
             trace("  no instances available for GUID\n");
-            goto done;
+            return 0;
         }
 
         if (sig->id_maps[id_map_idx].status & RELEASED_LOCALLY) {
@@ -510,11 +520,11 @@ again:
                 sig->id_maps[id_map_idx].id_map = 0;
             }
             trace("  instance already released locally\n");
-            goto done;
+            return 0;
         }
         if (!sig->id_maps[id_map_idx].inst) {
             trace("  error in mpr_sig_osc_handler: missing instance!\n");
-            goto done;
+            return 0;
         }
     }
     else {
@@ -538,8 +548,8 @@ again:
                     if (src_slot != (mpr_slot)slot) {
                         mpr_sig src_sig = mpr_slot_get_sig(src_slot);
                         if (src_sig->use_inst) {
-                            mpr_slot_set_value(slot, 0, argv[offset], time);
-                            goto done;
+                            mpr_slot_set_value(slot, 0, vals ? value : NULL, time);
+                            return 0;
                         }
                     }
                 }
@@ -549,7 +559,7 @@ again:
 
         id_map_idx = mpr_sig_get_id_map_with_LID(sig, sig->inst[i]->id, RELEASED_REMOTELY, time, 1, 1);
         if (id_map_idx < 0)
-            goto done;
+            return 0;
     }
     si = _get_inst_by_id_map_idx(sig, id_map_idx);
     inst_idx = si->idx;
@@ -572,7 +582,7 @@ again:
         /* if user-code has registered callback for release events we will proceed even if the
          * signal is non-ephemeral. Conceptually this matches setting the "released" bitflag. */
         if (map && !mpr_map_get_use_inst((mpr_map)map)) {
-            goto done;
+            return 0;
         }
 
         /* Try to release instance, but do not call process_maps() here, since we don't
@@ -586,10 +596,10 @@ again:
             /* Reset memory for corresponding source slot. */
             mpr_slot_set_value(slot, inst_idx, NULL, time);
         }
-        goto done;
+        return 0;
     }
     else if (sig->dir == MPR_DIR_OUT)
-        goto done;
+        return 0;
 
     if (map) {
         if (vals != slot_sig->len) {
@@ -599,7 +609,7 @@ again:
             trace_dev(dev, "error in mpr_sig_osc_handler: partial vector update "
                       "applied to convergent mapping slot.");
 #endif
-            return 0;
+            return 1;
         }
         /* Setting to local timestamp here */
         time = mpr_dev_get_time((mpr_dev)dev);
@@ -610,12 +620,11 @@ again:
         if ((si = _get_inst_by_id_map_idx(sig, id_map_idx)) && (si->status & MPR_STATUS_ACTIVE)) {
             inst_idx = si->idx;
             /* TODO: jitter mitigation etc. */
-            if (mpr_slot_set_value(slot, inst_idx, argv[offset], time)) {
-                mpr_local_map_set_updated(map, inst_idx);
-                mpr_local_dev_set_receiving(dev);
+            if (mpr_slot_set_value(slot, inst_idx, value, time)) {
+                mpr_local_map_set_updated(map, inst_idx, dev);
             }
         }
-        goto done;
+        return 0;
     }
 
     /* If no instance id was included in the message we will apply this update to all instances */
@@ -637,10 +646,10 @@ again:
                 mpr_value_cpy_next(sig->value, si->idx, time);
             }
             /* we can't use mpr_value_set() here since some vector elements may be missing */
-            for (i = offset; i < offset + sig->len; i++) {
-                if (types[i] == MPR_NULL)
+            for (i = 0; i < sig->len; i++) {
+                if (known && !mpr_bitflags_get(known, i))
                     continue;
-                if (mpr_value_set_element(sig->value, si->idx, i, argv[i]))
+                if (mpr_value_set_element(sig->value, si->idx, i, (char*)value + i * size))
                     status = MPR_STATUS_NEW_VALUE;
             }
             if (mpr_value_get_has_value(sig->value, si->idx)) {
@@ -658,10 +667,236 @@ again:
         if (GID)
             break;
     }
-done:
+    return 0;
+}
+
+/* Apply the updates in the arguments of a message starting at `offset`, each of which may be
+ * preceded by an instance id. If `filter` is set the updates were received through a multicast
+ * group and are filtered for the map as the source device does when sending updates to it
+ * directly. */
+static void handle_updates(mpr_local_sig sig, mpr_local_map map, mpr_local_slot slot,
+                           mpr_sig slot_sig, const char *types, lo_arg **argv, int argc,
+                           int offset, int filter, mpr_time time)
+{
+    int i, val_len, vals;
+    mpr_id GID = 0;
+
+again:
+    if (types[offset] == MPR_STR) {
+        if ((strcmp(&argv[offset]->s, "@in") == 0) && argc >= offset + 2) {
+            if (types[offset + 1] != MPR_INT64) {
+                trace("error in mpr_sig_osc_handler: bad arguments for 'instance' prop.\n");
+                return;
+            }
+            GID = argv[offset + 1]->i64;
+            trace("retrieved GUID %"PR_MPR_ID"\n", GID);
+            offset += 2;
+        }
+        else {
+            trace("error in mpr_sig_osc_handler: unknown property name '%s'.\n", &argv[offset]->s);
+            return;
+        }
+    }
+    val_len = offset;
+    while (val_len < argc && types[val_len] != MPR_STR)
+        ++val_len;
+    val_len -= offset;
+
+    if (slot_sig) {
+        vals = check_types(types + offset, val_len, slot_sig->type, slot_sig->len);
+        val_len = slot_sig->len;
+    }
+    else {
+        vals = check_types(types + offset, val_len, sig->type, sig->len);
+        val_len = sig->len;
+    }
+    RETURN_UNLESS(vals >= 0);
+
+    if (filter) {
+        if (!mpr_map_get_use_inst((mpr_map)map)) {
+            /* instance ids and releases are only sent for instanced maps */
+            GID = 0;
+            if (!vals)
+                goto next;
+        }
+        else if (GID && !mpr_local_map_get_has_scope(map, GID))
+            goto next;
+    }
+
+    if (vals == val_len) {
+        /* complete vector: arguments are stored contiguously in the message */
+        if (handle_update(sig, map, slot, GID, vals, argv[offset], NULL, time))
+            return;
+    }
+    else if (vals) {
+        /* partial vector: gather the elements that are present */
+        double buf[MPR_MAX_VECTOR_LEN];
+        char known[MPR_BITFLAGS_SIZE(MPR_MAX_VECTOR_LEN)];
+        size_t size = mpr_type_get_size(slot_sig ? slot_sig->type : sig->type);
+        mpr_bitflags_init(known, val_len);
+        for (i = 0; i < val_len; i++) {
+            if (types[offset + i] == MPR_NULL)
+                continue;
+            memcpy((char*)buf + i * size, argv[offset + i], size);
+            mpr_bitflags_set(known, i);
+        }
+        if (handle_update(sig, map, slot, GID, vals, buf, known, time))
+            return;
+    }
+    else if (handle_update(sig, map, slot, GID, 0, NULL, NULL, time))
+        return;
+
+next:
     offset += val_len;
     if (offset < argc)
         goto again;
+}
+
+int mpr_sig_osc_handler(const char *path, const char *types, lo_arg **argv, int argc,
+                        lo_message msg, void *data)
+{
+    mpr_local_sig sig = (mpr_local_sig)data;
+    mpr_net net = mpr_graph_get_net(sig->obj.graph);
+    int i, offset = 0, slot_id = -1;
+    mpr_local_map map = 0;
+    mpr_local_slot slot = 0;
+    mpr_sig slot_sig = 0;
+    mpr_time time;
+
+    assert(sig);
+
+#ifdef DEBUG
+    trace("'%s:%s' received update: ", mpr_dev_get_name((mpr_dev)sig->dev), sig->name);
+    lo_message_pp(msg);
+#endif
+
+    TRACE_RETURN_UNLESS(sig->num_inst, 0, "signal '%s' has no instances.\n", sig->name);
+    RETURN_ARG_UNLESS(argc, 0);
+
+    time = mpr_net_get_bundle_time(net);
+
+    /* We need to consider that there may be properties prepended to the msg
+     * check length and find properties if any */
+    if (types[0] == MPR_STR) {
+        if ((strcmp(&argv[0]->s, "@sl") == 0) && argc >= 2) {
+            TRACE_RETURN_UNLESS(types[1] == MPR_INT32, 0,
+                                "error in mpr_sig_osc_handler: bad arguments for 'slot' prop.\n")
+            slot_id = argv[1]->i32;
+            trace("retrieved slot id %d\n", slot_id);
+            offset += 2;
+        }
+    }
+    if (slot_id >= 0) {
+        /* retrieve mapping associated with this slot */
+        for (i = 0; i < sig->num_maps_in; i++) {
+            map = (mpr_local_map)mpr_slot_get_map((mpr_slot)sig->slots_in[i]);
+            if ((slot = (mpr_local_slot)mpr_map_get_src_slot_by_id((mpr_map)map, slot_id)))
+                break;
+        }
+        TRACE_RETURN_UNLESS(slot, 0, "error in mpr_sig_osc_handler: slot %d not found.\n", slot_id);
+        slot_sig = mpr_slot_get_sig((mpr_slot)slot);
+        TRACE_RETURN_UNLESS(   (mpr_obj_get_status((mpr_obj)map, 0)
+                             & (MPR_STATUS_ACTIVE | MPR_STATUS_REMOVED)) == MPR_STATUS_ACTIVE,
+                            0, "error in mpr_sig_osc_handler: map not yet ready.\n");
+        if (!mpr_local_map_get_expr(map) || MPR_LOC_BOTH == mpr_map_get_locality((mpr_map)map)) {
+            /* value has already been processed at source device */
+            map = 0;
+            slot_sig = 0;
+        }
+    }
+    handle_updates(sig, map, slot, slot_sig, types, argv, argc, offset, 0, time);
+    return 0;
+}
+
+void mpr_local_sig_handle_group_msg(mpr_local_slot slot, const char *types, lo_arg **argv,
+                                    int argc, mpr_time time)
+{
+    mpr_local_map map = (mpr_local_map)mpr_slot_get_map((mpr_slot)slot);
+    mpr_local_sig sig = mpr_slot_get_sig_if_local(mpr_map_get_dst_slot((mpr_map)map));
+    RETURN_UNLESS(sig && sig->num_inst && argc);
+    RETURN_UNLESS(   (mpr_obj_get_status((mpr_obj)map, 0)
+                   & (MPR_STATUS_ACTIVE | MPR_STATUS_REMOVED)) == MPR_STATUS_ACTIVE);
+    RETURN_UNLESS(   MPR_LOC_DST == mpr_map_get_process_loc((mpr_map)map)
+                  && mpr_local_map_get_expr(map));
+    handle_updates(sig, map, slot, mpr_slot_get_sig((mpr_slot)slot), types, argv, argc, 0, 1,
+                   time);
+}
+
+void mpr_local_sig_handle_update(mpr_local_sig sig, mpr_id GID, const void *value,
+                                 mpr_bitflags known, mpr_time time)
+{
+    int i, vals = 0;
+    RETURN_UNLESS(sig->num_inst);
+    for (i = 0; i < sig->len; i++) {
+        if (mpr_bitflags_get(known, i))
+            ++vals;
+    }
+    handle_update(sig, 0, 0, GID, vals, value, vals == sig->len ? NULL : known, time);
+}
+
+/* Check that every update in a message has the layout produced for maps by the sender's encoder:
+ * an optional "@in" instance id followed by one argument of the signal's type, or nil, per vector
+ * element. Returns the total size of the arguments, or -1 if the layout does not match. */
+static int get_update_args_size(mpr_local_sig sig, const char *types, const char *args,
+                                const char *end)
+{
+    int i, size = 0, esize = MPR_DBL == sig->type ? 8 : 4;
+    while (*types) {
+        if (MPR_STR == types[0]) {
+            RETURN_ARG_UNLESS(MPR_INT64 == types[1] && args + size + 12 <= end, -1);
+            RETURN_ARG_UNLESS(!memcmp(args + size, "@in", 4), -1);
+            types += 2;
+            size += 12;
+        }
+        for (i = 0; i < sig->len; i++) {
+            if (types[i] == sig->type)
+                size += esize;
+            else if (types[i] != MPR_NULL)
+                return -1;
+        }
+        types += sig->len;
+    }
+    return args + size <= end ? size : -1;
+}
+
+int mpr_local_sig_handle_osc_msg(mpr_local_sig sig, const char *types, const char *args,
+                                 const char *end, mpr_time time)
+{
+    double buf[MPR_MAX_VECTOR_LEN];
+    char known[MPR_BITFLAGS_SIZE(MPR_MAX_VECTOR_LEN)];
+    mpr_id GID = 0;
+    int i;
+    RETURN_ARG_UNLESS(*types && get_update_args_size(sig, types, args, end) >= 0, 1);
+    RETURN_ARG_UNLESS(sig->num_inst, 0);
+
+    /* as in mpr_sig_osc_handler() an instance id applies to the following updates until another
+     * is given */
+    while (*types) {
+        if (MPR_STR == types[0]) {
+            GID = mpr_osc_read_be64(args + 4);
+            types += 2;
+            args += 12;
+        }
+        /* convert elements from network byte order in a single pass */
+        mpr_bitflags_init(known, sig->len);
+        for (i = 0; i < sig->len; i++) {
+            if (MPR_NULL == types[i])
+                continue;
+            mpr_bitflags_set(known, i);
+            if (MPR_DBL == sig->type) {
+                uint64_t v = mpr_osc_read_be64(args);
+                memcpy(buf + i, &v, 8);
+                args += 8;
+            }
+            else {
+                uint32_t v = mpr_osc_read_be32(args);
+                memcpy((char*)buf + i * 4, &v, 4);
+                args += 4;
+            }
+        }
+        types += sig->len;
+        mpr_local_sig_handle_update(sig, GID, buf, known, time);
+    }
     return 0;
 }
 
@@ -706,26 +941,31 @@ void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const cha
                   mpr_type type, const char *unit, const void *min, const void *max, int *num_inst)
 {
     int str_len, mod = is_local ? MOD_ANY : MOD_NONE;
+    mpr_graph g = sig->obj.graph;
+    mpr_strtab strings = mpr_graph_get_strtab(g);
+    char *path;
     mpr_tbl tbl;
     RETURN_UNLESS(name);
 
     sig->dev = dev;
 
+    /* the path, name and unit are interned so they can be shared with other signals */
     name = mpr_path_skip_slash(name);
     str_len = strlen(name)+2;
-    sig->path = malloc(str_len);
-    snprintf(sig->path, str_len, "/%s", name);
+    path = alloca(str_len);
+    snprintf(path, str_len, "/%s", name);
+    sig->path = (char*)mpr_strtab_add(strings, path);
     sig->name = (char*)sig->path+1;
     sig->obj.is_local = is_local;
     sig->len = len;
     sig->type = type;
     sig->dir = dir ? dir : MPR_DIR_OUT;
-    sig->unit = unit ? strdup(unit) : strdup("unknown");
+    sig->unit = (char*)mpr_strtab_add(strings, unit ? unit : "unknown");
     sig->ephemeral = 0;
     sig->steal_mode = MPR_STEAL_NONE;
 
     sig->obj.type = MPR_SIG;
-    sig->obj.props.synced = mpr_tbl_new();
+    sig->obj.props.synced = mpr_tbl_new(mpr_graph_get_arena(g), mpr_graph_get_strtab(g));
 
     tbl = sig->obj.props.synced;
 
@@ -745,7 +985,7 @@ void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const cha
     link(STATUS,       MPR_INT32, &sig->obj.status,   MOD_NONE | LOCAL_ACCESS);
     link(STEAL_MODE,   MPR_INT32, &sig->steal_mode,   MOD_ANY);
     link(TYPE,         MPR_TYPE,  &sig->type,         MOD_NONE);
-    link(UNIT,         MPR_STR,   &sig->unit,         mod | INDIRECT);
+    link(UNIT,         MPR_STR,   &sig->unit,         mod | INDIRECT | INTERNED);
     link(USE_INST,     MPR_BOOL,  &sig->use_inst,     MOD_NONE);
     link(VERSION,      MPR_INT32, &sig->obj.version,  MOD_NONE);
 #undef link
@@ -781,7 +1021,7 @@ void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const cha
     else {
         sig->num_inst = 1;
         sig->use_inst = 0;
-        sig->obj.props.staged = mpr_tbl_new();
+        sig->obj.props.staged = mpr_tbl_new(mpr_graph_get_arena(g), mpr_graph_get_strtab(g));
         sig->obj.status = MPR_STATUS_NEW;
     }
 }
@@ -824,25 +1064,31 @@ void mpr_sig_free(mpr_sig sig)
 
 void mpr_sig_free_internal(mpr_sig sig)
 {
-    int i;
     RETURN_UNLESS(sig);
     if (sig->obj.is_local) {
         mpr_local_sig lsig = (mpr_local_sig)sig;
         free(lsig->id_maps);
-        for (i = 0; i < lsig->num_inst; i++) {
-            free(lsig->inst[i]);
+        while (lsig->inst_blocks) {
+            mpr_sig_inst_block block = lsig->inst_blocks;
+            lsig->inst_blocks = block->next;
+            free(block);
         }
         free(lsig->inst);
+        FUNC_IF(free, lsig->inst_by_idx);
         mpr_bitflags_free(lsig->updated_inst);
         mpr_value_free(lsig->value);
 
         FUNC_IF(free, lsig->slots_in);
         FUNC_IF(free, lsig->slots_out);
+
+        FUNC_IF(lo_address_free, lsig->multicast.addr);
+        FUNC_IF(free, lsig->multicast.group);
+        FUNC_IF(lo_message_free, lsig->multicast.msg);
     }
 
     mpr_obj_free(&sig->obj);
-    FUNC_IF(free, sig->path);
-    FUNC_IF(free, sig->unit);
+    mpr_strtab_remove(mpr_graph_get_strtab(sig->obj.graph), sig->path);
+    mpr_strtab_remove(mpr_graph_get_strtab(sig->obj.graph), sig->unit);
 }
 
 /* TODO: consider using inst status to trigger callbacks here (if registered)
@@ -1118,11 +1364,17 @@ static int mpr_sig_get_id_map_with_LID(mpr_local_sig lsig, mpr_id LID, int flags
                                        uint8_t activate, uint8_t call_handler_on_activate)
 {
     mpr_sig_handler *h;
+    mpr_sig_inst si;
     int i;
 
     if (!lsig->use_inst)
         LID = MPR_DEFAULT_INST_LID;
     h = (mpr_sig_handler*)lsig->handler;
+    if ((si = _find_inst_by_id(lsig, LID)) && (i = _get_id_map_hint(lsig, si)) >= 0) {
+        mpr_sig_id_map sig_id_map = &lsig->id_maps[i];
+        if (sig_id_map->id_map && sig_id_map->id_map->LID == LID)
+            return (sig_id_map->status & ~flags) ? -1 : i;
+    }
     for (i = 0; i < lsig->num_id_maps; i++) {
         mpr_sig_id_map sig_id_map = &lsig->id_maps[i];
         if (sig_id_map->inst && sig_id_map->id_map && sig_id_map->id_map->LID == LID)
@@ -1190,8 +1442,15 @@ static int mpr_sig_get_id_map_with_GID(mpr_local_sig lsig, mpr_id GID, int flags
 {
     mpr_sig_handler *h;
     mpr_sig_inst si;
+    mpr_id_map id_map;
     int i;
     h = (mpr_sig_handler*)lsig->handler;
+    if ((id_map = mpr_dev_get_id_map_by_GID(lsig->dev, lsig->group, GID))
+        && (si = _find_inst_by_id(lsig, id_map->LID)) && (i = _get_id_map_hint(lsig, si)) >= 0) {
+        mpr_sig_id_map sig_id_map = &lsig->id_maps[i];
+        if (sig_id_map->id_map && sig_id_map->id_map->GID == GID)
+            return (sig_id_map->status & ~flags) ? -1 : i;
+    }
     for (i = 0; i < lsig->num_id_maps; i++) {
         mpr_sig_id_map sig_id_map = &lsig->id_maps[i];
         if (sig_id_map->id_map && sig_id_map->id_map->GID == GID)
@@ -1249,11 +1508,12 @@ static int mpr_sig_get_id_map_with_GID(mpr_local_sig lsig, mpr_id GID, int flags
     return i;
 }
 
-/* finding id_maps here will be a bit inefficient for now */
-/* TODO: optimize storage and lookup */
 static int _get_id_map_idx_by_inst_idx(mpr_local_sig sig, unsigned int inst_idx)
 {
     int i;
+    if (inst_idx < sig->num_inst && (i = _get_id_map_hint(sig, sig->inst_by_idx[inst_idx])) >= 0)
+        return i;
+    /* fall back to searching in case the instance is referenced by a stale id map */
     for (i = 0; i < sig->num_id_maps; i++) {
         mpr_sig_id_map sig_id_map = &sig->id_maps[i];
         if (sig_id_map->inst && sig_id_map->inst->idx == inst_idx) {
@@ -1269,50 +1529,89 @@ mpr_id_map mpr_local_sig_get_id_map_by_inst_idx(mpr_local_sig sig, unsigned int
     return (id_map_idx >= 0) ? sig->id_maps[id_map_idx].id_map : 0;
 }
 
-static int _reserve_inst(mpr_local_sig lsig, mpr_id *id, void *data)
-{
-    int i, cont;
-    mpr_sig_inst si;
-    RETURN_ARG_UNLESS(lsig->num_inst < MAX_INST, -1);
-
-    /* check if instance with this id already exists! If so, stop here. */
-    if (id && _find_inst_by_id(lsig, *id))
-        return -1;
-
-    /* reallocate array of instances */
-    lsig->inst = realloc(lsig->inst, sizeof(mpr_sig_inst) * (lsig->num_inst + 1));
-    lsig->inst[lsig->num_inst] = (mpr_sig_inst) calloc(1, sizeof(struct _mpr_sig_inst));
-    si = lsig->inst[lsig->num_inst];
-    si->status = MPR_STATUS_STAGED;
+/* Reserve a number of instances at once. Instance records are allocated in a single block, ids
+ * that are not provided are assigned in one pass over the sorted instances, and the instance
+ * array is sorted once. Provided ids that are already in use are skipped. Returns the number of
+ * instances reserved. */
+static int _reserve_inst(mpr_local_sig lsig, int num, mpr_id *ids, void **data)
+{
+    int i, count = 0, pos = 0;
+    mpr_id next_id = 0;
+    mpr_sig_inst si, *new_inst, *recs;
+    mpr_sig_inst_block block = 0;
+
+    /* take records from removed instances before allocating a new block for the remainder */
+    recs = (mpr_sig_inst*)malloc(sizeof(mpr_sig_inst) * num);
+    for (i = 0; i < num && lsig->free_inst; i++) {
+        recs[i] = lsig->free_inst;
+        lsig->free_inst = (mpr_sig_inst)recs[i]->data;
+        memset(recs[i], 0, sizeof(mpr_sig_inst_t));
+    }
+    if (i < num) {
+        int j;
+        block = (mpr_sig_inst_block)calloc(1, sizeof(mpr_sig_inst_block_t)
+                                              + (num - i) * sizeof(mpr_sig_inst_t));
+        block->next = lsig->inst_blocks;
+        lsig->inst_blocks = block;
+        for (j = 0; i < num; i++, j++)
+            recs[i] = &block->inst[j];
+    }
+    lsig->inst = realloc(lsig->inst, sizeof(mpr_sig_inst) * (lsig->num_inst + num));
+    lsig->inst_by_idx = realloc(lsig->inst_by_idx, sizeof(mpr_sig_inst) * (lsig->num_inst + num));
+
+    if (ids) {
+        /* sort the new instances after the existing ones to find ids that are already in use,
+         * keeping the first of any repeated ids */
+        new_inst = lsig->inst + lsig->num_inst;
+        for (i = 0; i < num; i++) {
+            recs[i]->id = ids[i];
+            recs[i]->idx = i;
+            new_inst[i] = recs[i];
+        }
+        qsort(new_inst, num, sizeof(mpr_sig_inst), _compare_inst_ids_and_pos);
+        for (i = 0; i < num; i++) {
+            si = new_inst[i];
+            if ((!i || si->id != new_inst[i - 1]->id) && !_find_inst_by_id(lsig, si->id))
+                si->status = MPR_STATUS_STAGED;
+        }
+    }
 
-    if (id)
-        si->id = *id;
-    else {
-        /* find lowest unused id */
-        mpr_id lowest_id = 0;
-        cont = 1;
-        while (cont) {
-            cont = 0;
-            for (i = 0; i < lsig->num_inst; i++) {
-                if (lsig->inst[i]->id == lowest_id) {
-                    cont = 1;
-                    break;
-                }
+    for (i = 0; i < num; i++) {
+        si = recs[i];
+        if (ids) {
+            if (!si->status) {
+                /* id already in use; keep the record for later */
+                si->data = lsig->free_inst;
+                lsig->free_inst = si;
+                continue;
+            }
+        }
+        else {
+            /* find lowest unused id */
+            while (pos < lsig->num_inst && lsig->inst[pos]->id <= next_id) {
+                if (lsig->inst[pos]->id == next_id)
+                    ++next_id;
+                ++pos;
             }
-            lowest_id += cont;
+            si->id = next_id++;
+            si->status = MPR_STATUS_STAGED;
         }
-        si->id = lowest_id;
+        si->id_map_idx = -1;
+        si->idx = lsig->num_inst + count;
+        si->data = data ? data[i] : 0;
+        lsig->inst[si->idx] = si;
+        lsig->inst_by_idx[si->idx] = si;
+        ++count;
     }
-    si->idx = lsig->num_inst;
-    si->data = data;
 
-    ++lsig->num_inst;
-    /* TODO: move this qsort out to call with multiple ids */
+    free(recs);
+    RETURN_ARG_UNLESS(count, 0);
+    lsig->num_inst += count;
     qsort(lsig->inst, lsig->num_inst, sizeof(mpr_sig_inst), _compare_inst_ids);
-    return lsig->num_inst - 1;
+    return count;
 }
 
-static void realloc_maps(mpr_local_sig sig, int size)
+static void realloc_maps(mpr_local_sig sig)
 {
     int i;
     for (i = 0; i < sig->num_maps_out; i++) {
@@ -1329,9 +1628,9 @@ static void realloc_maps(mpr_local_sig sig, int size)
 
 int mpr_sig_reserve_inst(mpr_sig sig, int num, mpr_id *ids, void **data)
 {
-    int i = 0, count = 0, highest = -1, result, old_num = sig->num_inst;
+    int i = 0, count = 0, reserved;
     mpr_local_sig lsig = (mpr_local_sig)sig;
-    RETURN_ARG_UNLESS(sig && sig->obj.is_local && num, 0);
+    RETURN_ARG_UNLESS(sig && sig->obj.is_local && num > 0, 0);
 
     if (!sig->use_inst && lsig->num_inst == 1 && !lsig->inst[0]->id && !lsig->inst[0]->data) {
         /* we will overwrite the default instance first */
@@ -1343,23 +1642,17 @@ int mpr_sig_reserve_inst(mpr_sig sig, int num, mpr_id *ids, void **data)
         ++count;
     }
     sig->use_inst = 1;
-    for (; i < num; i++) {
-        result = _reserve_inst(lsig, ids ? &ids[i] : 0, data ? data[i] : 0);
-        if (result == -1)
-            continue;
-        highest = result;
-        ++count;
-    }
-    if (highest != -1)
-        realloc_maps(lsig, highest + 1);
+    reserved = i < num ? _reserve_inst(lsig, num - i, ids ? ids + i : 0, data ? data + i : 0) : 0;
+    count += reserved;
+
+    /* resize the values and map buffers that depend on the number of instances once */
+    if (reserved)
+        realloc_maps(lsig);
 
     mpr_value_realloc(lsig->value, lsig->len, lsig->type, 1, lsig->num_inst, 0);
 
     mpr_obj_incr_version((mpr_obj)lsig);
 
-    if (old_num > 0 && (lsig->num_inst / 8) == (old_num / 8))
-        return count;
-
     /* reallocate instance update bitflags */
     if (!lsig->updated_inst)
         lsig->updated_inst = mpr_bitflags_new(lsig->num_inst);
@@ -1569,15 +1862,27 @@ void mpr_sig_remove_inst(mpr_sig sig, mpr_id id)
 
     remove_idx = lsig->inst[i]->idx;
 
-    /* Free value and timetag memory held by instance */
-    mpr_value_remove_inst(lsig->value, i);
-    free(lsig->inst[i]);
+    /* Free value and timetag memory held by instance; the instance record is part of a block
+     * that is freed along with the signal, so keep it for reuse by later reservations */
+    mpr_value_remove_inst(lsig->value, remove_idx);
+    lsig->inst[i]->data = lsig->free_inst;
+    lsig->free_inst = lsig->inst[i];
 
     for (++i; i < lsig->num_inst; i++)
     lsig->inst[i-1] = lsig->inst[i];
     --lsig->num_inst;
     lsig->inst = realloc(lsig->inst, sizeof(mpr_sig_inst) * lsig->num_inst);
 
+    /* shift the update flags of the following instances down and shrink the bitflags */
+    for (i = remove_idx; i < lsig->num_inst; i++) {
+        if (mpr_bitflags_get(lsig->updated_inst, i + 1))
+            mpr_bitflags_set(lsig->updated_inst, i);
+        else
+            mpr_bitflags_unset(lsig->updated_inst, i);
+    }
+    if (lsig->num_inst)
+        lsig->updated_inst = mpr_bitflags_realloc(lsig->updated_inst, lsig->num_inst);
+
     /* Remove instance memory held by map slots */
     for (i = 0; i < lsig->num_maps_out; i++)
         mpr_slot_remove_inst(lsig->slots_out[i], remove_idx);
@@ -1588,6 +1893,7 @@ void mpr_sig_remove_inst(mpr_sig sig, mpr_id id)
     for (i = 0; i < lsig->num_inst; i++) {
         if (lsig->inst[i]->idx > remove_idx)
             --lsig->inst[i]->idx;
+        lsig->inst_by_idx[lsig->inst[i]->idx] = lsig->inst[i];
     }
     mpr_obj_incr_version((mpr_obj)sig);
 }
@@ -1719,6 +2025,92 @@ void mpr_sig_set_cb(mpr_sig sig, mpr_sig_handler *h, int events)
     lsig->event_flags = events;
 }
 
+int mpr_sig_set_multicast(mpr_sig sig, const char *group, int port)
+{
+    mpr_local_sig lsig = (mpr_local_sig)sig;
+    lo_address addr = 0;
+    int i;
+    RETURN_ARG_UNLESS(sig && sig->obj.is_local && (!group || port > 0), 1);
+
+    if (group) {
+        char port_str[10];
+        snprintf(port_str, 10, "%d", port);
+        RETURN_ARG_UNLESS((addr = lo_address_new(group, port_str)), 1);
+        /* restrict updates to the local subnet as for the bus */
+        lo_address_set_ttl(addr, 1);
+        lo_address_set_iface(addr, mpr_net_get_interface(mpr_graph_get_net(sig->obj.graph)), 0);
+        if (!lsig->multicast.msg) {
+            lsig->multicast.msg = lo_message_new();
+            /* increment refcount to prevent freeing by lo_bundle_free_recursive() */
+            lo_message_incref(lsig->multicast.msg);
+        }
+    }
+
+    /* destinations need to confirm a new group, so updates are sent through each link until they
+     * have done so */
+    for (i = 0; i < lsig->num_maps_out; i++)
+        mpr_local_slot_set_multicast(lsig->slots_out[i], NULL, 0);
+
+    FUNC_IF(lo_address_free, lsig->multicast.addr);
+    FUNC_IF(free, lsig->multicast.group);
+    lsig->multicast.addr = addr;
+    lsig->multicast.group = group ? strdup(group) : 0;
+    lsig->multicast.port = group ? port : 0;
+    if (lsig->multicast.msg)
+        lo_message_clear(lsig->multicast.msg);
+    lsig->multicast.num_msg = 0;
+    return 0;
+}
+
+void mpr_local_sig_set_meta_version(mpr_local_sig sig, int version)
+{
+    sig->meta_version = version;
+}
+
+int mpr_local_sig_get_meta_version(mpr_local_sig sig)
+{
+    return sig->meta_version;
+}
+
+const char *mpr_local_sig_get_multicast(mpr_local_sig sig, int *port)
+{
+    if (port)
+        *port = sig->multicast.port;
+    return sig->multicast.group;
+}
+
+void mpr_local_sig_send_multicast(mpr_local_sig sig, mpr_time time)
+{
+    lo_message msg = sig->multicast.msg;
+    lo_server server;
+    lo_bundle bundle;
+    char path[BUFFSIZE];
+    int i;
+    RETURN_UNLESS(sig->multicast.num_msg > 0);
+
+    /* list the maps that should be updated so that destinations ignore updates meant for maps
+     * that have not yet confirmed the group */
+    lo_message_add_string(msg, "@mp");
+    for (i = 0; i < sig->num_maps_out; i++) {
+        mpr_local_slot slot = sig->slots_out[i];
+        mpr_local_map map = (mpr_local_map)mpr_slot_get_map((mpr_slot)slot);
+        if (   MPR_LOC_DST == mpr_map_get_process_loc((mpr_map)map)
+            && get_uses_multicast(map, slot))
+            lo_message_add_int64(msg, mpr_obj_get_id((mpr_obj)map));
+    }
+
+    server = mpr_net_get_dev_server(mpr_graph_get_net(sig->obj.graph), sig->dev, SERVER_UDP);
+    path[0] = '/';
+    if (   server && mpr_sig_full_name((mpr_sig)sig, path + 1, BUFFSIZE - 1)
+        && (bundle = lo_bundle_new(time))) {
+        lo_bundle_add_message(bundle, path, msg);
+        lo_send_bundle_from(sig->multicast.addr, server, bundle);
+        lo_bundle_free_recursive(bundle);
+    }
+    lo_message_clear(msg);
+    sig->multicast.num_msg = 0;
+}
+
 /**** Signal Properties ****/
 
 static int mpr_sig_full_name(mpr_sig sig, char *name, int len)
@@ -1772,12 +2164,6 @@ static int _init_and_add_id_map(mpr_local_sig lsig, mpr_sig_inst si,
     }
     if (i == lsig->num_id_maps) {
         /* need more memory */
-        if (lsig->num_id_maps >= MAX_INST) {
-            /* Arbitrary limit to number of tracked id_maps */
-            /* TODO: add checks for this return value */
-            trace("warning: reached maximum number of instances for signal %s.\n", lsig->name);
-            return -1;
-        }
         lsig->num_id_maps = lsig->num_id_maps ? lsig->num_id_maps * 2 : 1;
         lsig->id_maps = realloc(lsig->id_maps, (lsig->num_id_maps * sizeof(struct _mpr_sig_id_map)));
         memset(lsig->id_maps + i, 0, ((lsig->num_id_maps - i) * sizeof(struct _mpr_sig_id_map)));
@@ -1785,23 +2171,27 @@ static int _init_and_add_id_map(mpr_local_sig lsig, mpr_sig_inst si,
     lsig->id_maps[i].id_map = id_map;
     lsig->id_maps[i].inst = si;
     lsig->id_maps[i].status = 0;
+    si->id_map_idx = i;
 
-    si->id = id_map->LID;
-    /* same comment wrt qsort here */
-    qsort(lsig->inst, lsig->num_inst, sizeof(mpr_sig_inst), _compare_inst_ids);
+    if (si->id != id_map->LID) {
+        si->id = id_map->LID;
+        /* same comment wrt qsort here */
+        qsort(lsig->inst, lsig->num_inst, sizeof(mpr_sig_inst), _compare_inst_ids);
+    }
 
     /* return id_map index */
     return i;
 }
 
-void mpr_sig_send_state(mpr_sig sig, net_msg_t cmd)
+int mpr_sig_send_state(mpr_sig sig, net_msg_t cmd)
 {
     char str[BUFFSIZE];
     lo_message msg;
     mpr_net net;
-    RETURN_UNLESS(sig);
+    int len;
+    RETURN_ARG_UNLESS(sig, 0);
     msg = lo_message_new();
-    RETURN_UNLESS(msg);
+    RETURN_ARG_UNLESS(msg, 0);
     net = mpr_graph_get_net(sig->obj.graph);
 
     if (cmd == MSG_SIG_MOD) {
@@ -1812,12 +2202,15 @@ void mpr_sig_send_state(mpr_sig sig, net_msg_t cmd)
         mpr_obj_add_props_to_msg((mpr_obj)sig, msg);
 
         snprintf(str, BUFFSIZE, "/%s/signal/modify", mpr_dev_get_name(sig->dev));
-        mpr_net_add_msg(net, str, 0, msg);
+        len = mpr_net_add_msg(net, str, 0, msg);
         /* send immediately since path string is not cached */
         mpr_net_send(net);
     }
     else {
-        RETURN_UNLESS(mpr_sig_full_name(sig, str, BUFFSIZE));
+        if (!mpr_sig_full_name(sig, str, BUFFSIZE)) {
+            lo_message_free(msg);
+            return 0;
+        }
         lo_message_add_string(msg, str);
 
         /* properties */
@@ -1835,8 +2228,9 @@ void mpr_sig_send_state(mpr_sig sig, net_msg_t cmd)
             lo_message_add_string(msg, buf);
             lo_message_add_float(msg, jitter);
         }
-        mpr_net_add_msg(net, 0, cmd, msg);
+        len = mpr_net_add_msg(net, 0, cmd, msg);
     }
+    return len;
 }
 
 /*! Update information about a signal record based on message properties. */
@@ -1952,8 +2346,10 @@ int mpr_sig_get_use_inst(mpr_sig sig)
 
 int mpr_sig_compare_names(mpr_sig l, mpr_sig r)
 {
-    int res = strcmp(mpr_dev_get_name(l->dev), mpr_dev_get_name(r->dev));
-    if (0 == res)
+    /* names interned in the same graph can be matched by pointer */
+    const char *l_dev = mpr_dev_get_name(l->dev), *r_dev = mpr_dev_get_name(r->dev);
+    int res = l_dev == r_dev ? 0 : strcmp(l_dev, r_dev);
+    if (0 == res && l->name != r->name)
         res = strcmp(l->name, r->name);
     return res;
 }
@@ -2014,7 +2410,8 @@ void mpr_local_sig_set_inst_value(mpr_local_sig sig, const void *value, int inst
                 /* instance was released in previous handler call */
                 assert(map_manages_inst);
                 /* try to re-activate with a new GID */
-                id_map->GID = mpr_dev_generate_unique_id((mpr_dev)sig->dev);
+                mpr_dev_set_id_map_GID(sig->dev, sig->group, id_map,
+                                       mpr_dev_generate_unique_id((mpr_dev)sig->dev));
                 id_map_idx = mpr_sig_get_id_map_with_GID(sig, id_map->GID, RELEASED_LOCALLY, time, 1);
                 if (id_map_idx < 0) {
                     trace("error: couldn't find id_map for signal instance idx %d\n", id_map_idx);
@@ -7,10 +7,12 @@
 
 #include "device.h"
 #include "expression.h"
+#include "graph.h"
 #include "link.h"
 #include "message.h"
 #include "mpr_type.h"
 #include "object.h"
+#include "osc_encoder.h"
 #include "property.h"
 #include "slot.h"
 #include "table.h"
@@ -22,7 +24,7 @@
 #define MPR_SLOT_STRUCT_ITEMS                                                   \
     mpr_sig sig;                    /*!< Pointer to parent signal */            \
     int id;                                                                     \
-    uint8_t num_inst;                                                           \
+    unsigned int num_inst;                                                      \
     char dir;                       /*!< `DI_INCOMING` or `DI_OUTGOING` */      \
     char causes_update;             /*!< 1 if causes update, 0 otherwise. */    \
     char is_local;
@@ -42,6 +44,29 @@ typedef struct _mpr_local_slot {
     lo_message msg;
     uint16_t num_msg;
     uint16_t sending;
+
+    /* Updates held by a destination slot instead of being encoded in `msg`. They are passed to the
+     * destination signal as they are on local-only links, written to shared memory, or encoded
+     * directly into the link's OSC bundle. Each entry of `data` holds the value vector followed by
+     * bitflags indicating which elements are known; releases have no known elements. Once queued
+     * on a link the updates are kept until the link clears them, which may be after several
+     * updates of the map if the link is holding them back. */
+    struct {
+        mpr_id *GIDs;               /*!< Instance id for each update, or zero if not instanced. */
+        char *data;
+        mpr_osc_template tmpl;      /*!< Static parts of the OSC message carrying the updates. */
+        int coalesced;              /*!< Number of updates replaced by a newer value. */
+        uint16_t num;
+        uint16_t size;
+        uint16_t sending;
+    } updates;
+
+    /* For a remote source signal, the multicast group joined to receive its updates. For a local
+     * source signal, the group that the destination has confirmed receiving updates from. */
+    struct {
+        char *group;
+        int port;
+    } multicast;
 } mpr_local_slot_t;
 
 mpr_slot mpr_slot_new(mpr_map map, mpr_sig sig, mpr_dir dir,
@@ -50,7 +75,9 @@ mpr_slot mpr_slot_new(mpr_map map, mpr_sig sig, mpr_dir dir,
     size_t size = is_local ? sizeof(struct _mpr_local_slot) : sizeof(struct _mpr_slot);
     int sig_is_local = mpr_obj_get_is_local((mpr_obj)sig);
     int num_inst = mpr_sig_get_num_inst_internal(sig);
-    mpr_slot slot = (mpr_slot)calloc(1, size);
+    mpr_graph g = mpr_obj_get_graph((mpr_obj)map);
+    mpr_slot slot = (mpr_slot)mpr_arena_alloc(mpr_graph_get_arena(g), size);
+    RETURN_ARG_UNLESS(slot, 0);
     slot->map = map;
     slot->sig = sig;
     slot->is_local = is_local ? 1 : 0;
@@ -89,6 +116,7 @@ void mpr_slot_set_map_ptr(mpr_slot slot, mpr_map map)
 
 void mpr_slot_free(mpr_slot slot)
 {
+    mpr_arena arena = mpr_graph_get_arena(mpr_obj_get_graph((mpr_obj)slot->map));
     if (slot->is_local) {
         mpr_local_slot lslot = (mpr_local_slot)slot;
         FUNC_IF(mpr_value_free, lslot->val);
@@ -101,8 +129,16 @@ void mpr_slot_free(mpr_slot slot)
         else {
             lo_message_free(lslot->msg);
         }
+        if (lslot->updates.sending)
+            mpr_link_forget_slot(lslot->link, lslot);
+        FUNC_IF(free, lslot->updates.GIDs);
+        FUNC_IF(free, lslot->updates.data);
+        FUNC_IF(mpr_osc_template_free, lslot->updates.tmpl);
+        mpr_local_slot_set_multicast(lslot, NULL, 0);
+        mpr_arena_release(arena, slot, sizeof(struct _mpr_local_slot));
     }
-    free(slot);
+    else
+        mpr_arena_release(arena, slot, sizeof(struct _mpr_slot));
 }
 
 MPR_INLINE static int slot_mask(mpr_slot slot)
@@ -110,6 +146,58 @@ MPR_INLINE static int slot_mask(mpr_slot slot)
     return slot == mpr_map_get_dst_slot(slot->map) ? DST_SLOT_PROP : SRC_SLOT_PROP(slot->id);
 }
 
+int mpr_local_slot_set_multicast(mpr_local_slot slot, const char *group, int port)
+{
+    mpr_net net = mpr_graph_get_net(mpr_obj_get_graph((mpr_obj)slot->map));
+    int is_remote = !mpr_obj_get_is_local((mpr_obj)slot->sig);
+    if (slot->multicast.group) {
+        if (group && port == slot->multicast.port && !strcmp(group, slot->multicast.group))
+            return 0;
+        if (is_remote)
+            mpr_net_leave_data_group(net, slot);
+        free(slot->multicast.group);
+        slot->multicast.group = 0;
+    }
+    else if (!group)
+        return 0;
+    if (group && (!is_remote || !mpr_net_join_data_group(net, group, port, slot))) {
+        slot->multicast.group = strdup(group);
+        slot->multicast.port = port;
+    }
+    return 1;
+}
+
+const char *mpr_local_slot_get_multicast(mpr_local_slot slot, int *port)
+{
+    if (port)
+        *port = slot->multicast.port;
+    return slot->multicast.group;
+}
+
+/* A local source signal may send its updates to a multicast group, which is advertised to the
+ * destination along with the other slot properties. The destination joins the group and replies
+ * with the same properties to confirm that updates for the map can be sent there. */
+int mpr_local_slot_set_multicast_from_msg(mpr_local_slot lslot, mpr_msg msg)
+{
+    mpr_slot slot = (mpr_slot)lslot;
+    int mask = slot_mask(slot);
+    const char *group = mpr_msg_get_prop_as_str(msg, MPR_PROP_HOST | mask);
+    int port = mpr_msg_get_prop_as_int32(msg, MPR_PROP_PORT | mask);
+    RETURN_ARG_UNLESS(group && port, 0);
+    if (mpr_obj_get_is_local((mpr_obj)slot->sig)) {
+        /* the destination confirmed the group, which may since have been changed */
+        int sig_port;
+        const char *sig_group = mpr_local_sig_get_multicast((mpr_local_sig)slot->sig, &sig_port);
+        if (!sig_group || sig_port != port || strcmp(sig_group, group))
+            group = 0;
+        mpr_local_slot_set_multicast(lslot, group, port);
+        return 0;
+    }
+    /* only the destination device receives updates */
+    RETURN_ARG_UNLESS(mpr_slot_get_sig_if_local(mpr_map_get_dst_slot(slot->map)), 0);
+    return mpr_local_slot_set_multicast(lslot, group, port);
+}
+
 int mpr_slot_set_from_msg(mpr_slot slot, mpr_msg msg)
 {
     int updated = 0, mask;
@@ -160,8 +248,9 @@ int mpr_slot_set_from_msg(mpr_slot slot, mpr_msg msg)
 
 void mpr_slot_add_props_to_msg(lo_message msg, mpr_slot slot, int is_dst)
 {
-    int len;
+    int len, port = 0;
     char temp[32];
+    const char *group = 0;
     if (is_dst)
         snprintf(temp, 32, "@dst");
     else if (0 == (int)slot->id)
@@ -190,6 +279,22 @@ void mpr_slot_add_props_to_msg(lo_message msg, mpr_slot slot, int is_dst)
         snprintf(temp+len, 32-len, "%s", mpr_prop_as_str(MPR_PROP_NUM_INST, 0));
         lo_message_add_string(msg, temp);
         lo_message_add_int32(msg, slot->num_inst);
+
+        /* include multicast group used for sending updates */
+        if (!is_dst)
+            group = mpr_local_sig_get_multicast((mpr_local_sig)slot->sig, &port);
+    }
+    else if (!is_dst && slot->is_local) {
+        /* confirm multicast group joined for receiving updates */
+        group = mpr_local_slot_get_multicast((mpr_local_slot)slot, &port);
+    }
+    if (group) {
+        snprintf(temp+len, 32-len, "%s", mpr_prop_as_str(MPR_PROP_HOST, 0));
+        lo_message_add_string(msg, temp);
+        lo_message_add_string(msg, group);
+        snprintf(temp+len, 32-len, "%s", mpr_prop_as_str(MPR_PROP_PORT, 0));
+        lo_message_add_string(msg, temp);
+        lo_message_add_int32(msg, port);
     }
 }
 
@@ -294,9 +399,23 @@ mpr_link mpr_slot_get_link(mpr_slot slot)
     return slot->is_local ? ((mpr_local_slot)slot)->link : NULL;
 }
 
+static mpr_osc_template get_osc_template(mpr_local_slot slot)
+{
+    mpr_type type = mpr_sig_get_type(slot->sig);
+    int len = mpr_sig_get_len(slot->sig);
+    if (!slot->updates.tmpl || !mpr_osc_template_get_matches(slot->updates.tmpl, type, len)) {
+        FUNC_IF(mpr_osc_template_free, slot->updates.tmpl);
+        slot->updates.tmpl = mpr_osc_template_new(mpr_sig_get_path(slot->sig), type, len);
+    }
+    return slot->updates.tmpl;
+}
+
 void mpr_local_slot_set_link(mpr_local_slot slot, mpr_link link)
 {
     slot->link = link;
+    /* prepare the static parts of update messages for remote destination signals */
+    if (link && slot->id < 0 && !mpr_obj_get_is_local((mpr_obj)slot->sig))
+        get_osc_template(slot);
 }
 
 mpr_map mpr_slot_get_map(mpr_slot slot)
@@ -383,6 +502,10 @@ void mpr_local_slot_send_msg(mpr_local_slot slot, lo_message msg, mpr_time time,
 {
     if (slot->link) {
         if (!msg) {
+            if (slot->updates.num && !slot->updates.sending) {
+                mpr_link_add_slot_updates(slot->link, slot, time, proto);
+                slot->updates.sending = 1;
+            }
             if (slot->num_msg > 0 && !slot->sending) {
                 msg = slot->msg;
                 slot->sending = 1;
@@ -390,10 +513,99 @@ void mpr_local_slot_send_msg(mpr_local_slot slot, lo_message msg, mpr_time time,
             else
                 return;
         }
-        mpr_link_add_msg(slot->link, mpr_sig_get_path((mpr_sig)slot->sig), msg, time, proto);
+        mpr_link_add_msg(slot->link, slot->sig, mpr_sig_get_path(slot->sig), msg, time, proto);
+    }
+}
+
+void mpr_local_slot_deliver_updates(mpr_local_slot slot, mpr_time time)
+{
+    /* updates added during delivery will be discarded when the slot is cleared */
+    int i, num = slot->updates.num, len = mpr_sig_get_len(slot->sig);
+    size_t vsize = len * mpr_type_get_size(mpr_sig_get_type(slot->sig));
+    size_t esize = MPR_UPDATE_SIZE(vsize, len);
+    for (i = 0; i < num; i++) {
+        char *data = slot->updates.data + i * esize;
+        mpr_local_sig_handle_update((mpr_local_sig)slot->sig, slot->updates.GIDs[i], data,
+                                    data + vsize, time);
     }
 }
 
+int mpr_local_slot_get_num_updates(mpr_local_slot slot)
+{
+    return slot->updates.num;
+}
+
+int mpr_local_slot_get_num_coalesced(mpr_local_slot slot)
+{
+    return slot->updates.coalesced;
+}
+
+void mpr_local_slot_clear_updates(mpr_local_slot slot)
+{
+    slot->updates.num = slot->updates.sending = 0;
+    slot->updates.coalesced = 0;
+}
+
+const char *mpr_local_slot_get_update(mpr_local_slot slot, int idx, mpr_id *GID)
+{
+    int len = mpr_sig_get_len(slot->sig);
+    size_t esize = MPR_UPDATE_SIZE(len * mpr_type_get_size(mpr_sig_get_type(slot->sig)), len);
+    *GID = slot->updates.GIDs[idx];
+    return slot->updates.data + idx * esize;
+}
+
+lo_message mpr_local_slot_get_updates_msg(mpr_local_slot slot, int start)
+{
+    int i, j, len = mpr_sig_get_len(slot->sig);
+    mpr_type type = mpr_sig_get_type(slot->sig);
+    size_t vsize = len * mpr_type_get_size(type);
+    lo_message msg;
+    RETURN_ARG_UNLESS(start < slot->updates.num && (msg = lo_message_new()), 0);
+
+    for (i = start; i < slot->updates.num; i++) {
+        mpr_id GID;
+        const char *data = mpr_local_slot_get_update(slot, i, &GID);
+        mpr_bitflags known = (mpr_bitflags)(data + vsize);
+        if (GID) {
+            lo_message_add_string(msg, "@in");
+            lo_message_add_int64(msg, GID);
+        }
+        for (j = 0; j < len; j++) {
+            if (!mpr_bitflags_get(known, j))
+                lo_message_add_nil(msg);
+            else if (MPR_INT32 == type) {
+                int v;
+                memcpy(&v, data + j * sizeof(int), sizeof(int));
+                lo_message_add_int32(msg, v);
+            }
+            else if (MPR_FLT == type) {
+                float v;
+                memcpy(&v, data + j * sizeof(float), sizeof(float));
+                lo_message_add_float(msg, v);
+            }
+            else {
+                double v;
+                memcpy(&v, data + j * sizeof(double), sizeof(double));
+                lo_message_add_double(msg, v);
+            }
+        }
+    }
+    return msg;
+}
+
+int mpr_local_slot_encode_updates(mpr_local_slot slot, mpr_osc_encoder enc, int start,
+                                  mpr_time time)
+{
+    int len = mpr_sig_get_len(slot->sig);
+    size_t esize = MPR_UPDATE_SIZE(len * mpr_type_get_size(mpr_sig_get_type(slot->sig)), len);
+    mpr_osc_template tmpl;
+    RETURN_ARG_UNLESS(start < slot->updates.num, 0);
+    RETURN_ARG_UNLESS((tmpl = get_osc_template(slot)), 1);
+    return mpr_osc_encoder_add_updates(enc, tmpl, time, slot->updates.num - start,
+                                       slot->updates.GIDs + start,
+                                       slot->updates.data + start * esize);
+}
+
 int mpr_slot_compare_names(mpr_slot l, mpr_slot r)
 {
     mpr_sig lsig = l->sig;
@@ -415,6 +627,10 @@ lo_address mpr_slot_get_addr(mpr_slot slot)
 
 void mpr_slot_clear_msg(mpr_local_slot slot)
 {
+    /* updates queued on a link are cleared by the link once they have been sent */
+    if (!slot->updates.sending)
+        slot->updates.num = 0;
+
     /* run if slot has msg or is uninitialized (num_msg == -1) */
     RETURN_UNLESS(slot->num_msg);
 
@@ -428,11 +644,94 @@ void mpr_slot_clear_msg(mpr_local_slot slot)
     slot->num_msg = slot->sending = 0;
 }
 
+/* Destination slots store updates instead of building OSC messages, unless the destination signal
+ * is local and the link is not local-only. */
+MPR_INLINE static int use_direct_updates(mpr_local_slot slot)
+{
+    RETURN_ARG_UNLESS(slot->id < 0 && slot->link, 0);
+    if (mpr_obj_get_is_local((mpr_obj)slot->sig))
+        return mpr_link_get_is_local_only(slot->link);
+    return 1;
+}
+
+/* Replace the value of a queued update with a newer one, keeping any elements that are not known
+ * in the newer value. Returns non-zero if there was a queued value for the same instance. */
+static int coalesce_update(mpr_local_slot slot, mpr_id GID, const char *value,
+                           mpr_bitflags known)
+{
+    int i, len = mpr_sig_get_len(slot->sig);
+    size_t size = mpr_type_get_size(mpr_sig_get_type(slot->sig)), vsize = len * size;
+    size_t fsize = MPR_BITFLAGS_SIZE(len);
+    char *data;
+
+    for (i = slot->updates.num - 1; i >= 0; i--) {
+        if (slot->updates.GIDs[i] == GID)
+            break;
+    }
+    RETURN_ARG_UNLESS(i >= 0, 0);
+    data = slot->updates.data + i * MPR_UPDATE_SIZE(vsize, len);
+
+    /* an instance release must be followed by the new value rather than replaced */
+    for (i = MPR_BITFLAGS_HEADER_SIZE; i < fsize; i++) {
+        if (data[vsize + i])
+            break;
+    }
+    RETURN_ARG_UNLESS(i < fsize, 0);
+
+    for (i = 0; i < len; i++) {
+        if (mpr_bitflags_get(known, i))
+            memcpy(data + i * size, value + i * size, size);
+    }
+    mpr_bitflags_or(data + vsize, known);
+    ++slot->updates.coalesced;
+    return 1;
+}
+
+static void add_update(mpr_local_slot slot, mpr_value val, unsigned int idx, mpr_id_map id_map)
+{
+    int len = mpr_sig_get_len(slot->sig);
+    size_t vsize = len * mpr_type_get_size(mpr_sig_get_type(slot->sig));
+    size_t fsize = MPR_BITFLAGS_SIZE(len);
+    char *data;
+    void *value = 0;
+
+    if (val) {
+        value = mpr_value_get_value(val, idx, 0);
+        RETURN_UNLESS(value);
+        /* updates already queued on a link are being held back, so a newer value for the same
+         * instance replaces the queued one */
+        if (   slot->updates.sending && mpr_link_get_is_holding(slot->link)
+            && coalesce_update(slot, id_map ? id_map->GID : 0, value,
+                               mpr_value_get_elements_known(val, idx)))
+            return;
+    }
+    if (slot->updates.num >= slot->updates.size) {
+        slot->updates.size = slot->updates.size ? slot->updates.size * 2 : 4;
+        slot->updates.GIDs = realloc(slot->updates.GIDs, slot->updates.size * sizeof(mpr_id));
+        slot->updates.data = realloc(slot->updates.data,
+                                     slot->updates.size * MPR_UPDATE_SIZE(vsize, len));
+    }
+    slot->updates.GIDs[slot->updates.num] = id_map ? id_map->GID : 0;
+    data = slot->updates.data + slot->updates.num * MPR_UPDATE_SIZE(vsize, len);
+    if (value) {
+        memcpy(data, value, vsize);
+        memcpy(data + vsize, mpr_value_get_elements_known(val, idx), fsize);
+    }
+    else
+        memset(data + vsize, 0, fsize);
+    ++slot->updates.num;
+}
+
 void mpr_slot_build_msg(mpr_local_slot slot, mpr_value val, unsigned int idx, mpr_id_map id_map)
 {
     int i;
     lo_message msg = slot->msg;
 
+    if (use_direct_updates(slot)) {
+        add_update(slot, val, idx, id_map);
+        return;
+    }
+
     if (id_map) {
         /* add instance GID */
         lo_message_add_string(msg, "@in");
@@ -8,6 +8,7 @@ typedef struct _mpr_local_slot *mpr_local_slot;
 #include "link.h"
 #include "map.h"
 #include "mpr_signal.h"
+#include "osc_encoder.h"
 #include "value.h"
 
 #define MPR_SLOT_DEV_KNOWN  0x1 /* bitflag 0001 */
@@ -23,6 +24,27 @@ void mpr_slot_free(mpr_slot slot);
 
 int mpr_slot_set_from_msg(mpr_slot slot, mpr_msg msg);
 
+/*! Set the multicast group used for the updates of a source slot. For a remote source signal the
+ *  group is joined to receive its updates; for a local source signal this records that the
+ *  destination has confirmed receiving updates from the group.
+ *  \param slot         The source slot of a local map.
+ *  \param group        The multicast group address, or zero to stop using multicast.
+ *  \param port         The port of the multicast group.
+ *  \return             Non-zero if the group of the slot was changed. */
+int mpr_local_slot_set_multicast(mpr_local_slot slot, const char *group, int port);
+
+/*! Set the multicast group of a source slot from the properties of a map message, if present.
+ *  \param slot         The source slot of a local map.
+ *  \param msg          The parsed map message.
+ *  \return             Non-zero if a multicast group was joined or left. */
+int mpr_local_slot_set_multicast_from_msg(mpr_local_slot slot, mpr_msg msg);
+
+/*! Retrieve the multicast group used for the updates of a source slot.
+ *  \param slot         The source slot of a local map.
+ *  \param port         Location for the port of the multicast group, or zero.
+ *  \return             The multicast group address, or zero if multicast is not used. */
+const char *mpr_local_slot_get_multicast(mpr_local_slot slot, int *port);
+
 void mpr_slot_add_props_to_msg(lo_message msg, mpr_slot slot, int is_dest);
 
 void mpr_slot_print(mpr_slot slot, int is_dest);
@@ -67,6 +89,43 @@ int mpr_slot_set_value(mpr_local_slot slot, unsigned int inst_idx, const void *v
 
 void mpr_local_slot_send_msg(mpr_local_slot slot, lo_message msg, mpr_time time, mpr_proto proto);
 
+/*! Apply the unencoded updates held by a destination slot on a local-only link to its signal.
+ *  \param slot         The slot holding the updates.
+ *  \param time         The timetag for the updates. */
+void mpr_local_slot_deliver_updates(mpr_local_slot slot, mpr_time time);
+
+int mpr_local_slot_get_num_updates(mpr_local_slot slot);
+
+/*! Retrieve the number of updates held by a destination slot that were replaced by a newer value
+ *  for the same instance before being sent. */
+int mpr_local_slot_get_num_coalesced(mpr_local_slot slot);
+
+/*! Discard the updates held by a destination slot once its link has sent them. */
+void mpr_local_slot_clear_updates(mpr_local_slot slot);
+
+/*! Retrieve an unencoded update held by a destination slot.
+ *  \param slot         The slot holding the updates.
+ *  \param idx          Index of the update.
+ *  \param GID          Location for the instance id, or zero if not instanced.
+ *  \return             The value vector, followed by bitflags indicating which elements are known. */
+const char *mpr_local_slot_get_update(mpr_local_slot slot, int idx, mpr_id *GID);
+
+/*! Encode the unencoded updates held by a destination slot as an OSC message.
+ *  \param slot         The slot holding the updates.
+ *  \param start        Index of the first update to encode.
+ *  \return             A new OSC message, or zero if there are no updates to encode. */
+lo_message mpr_local_slot_get_updates_msg(mpr_local_slot slot, int start);
+
+/*! Encode the unencoded updates held by a destination slot directly into an OSC bundle.
+ *  \param slot         The slot holding the updates.
+ *  \param enc          The encoder building the bundle.
+ *  \param start        Index of the first update to encode.
+ *  \param time         The timetag for the bundle if it is empty.
+ *  \return             Zero if the updates were encoded, non-zero if they should be sent using
+ *                      `mpr_local_slot_get_updates_msg()` instead. */
+int mpr_local_slot_encode_updates(mpr_local_slot slot, mpr_osc_encoder enc, int start,
+                                  mpr_time time);
+
 int mpr_slot_compare_names(mpr_slot l, mpr_slot r);
 
 void mpr_slot_set_map_ptr(mpr_slot slot, mpr_map map);
@@ -0,0 +1,154 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strtab.h"
+#include "util/mpr_debug.h"
+
+#define MIN_BUCKETS 64              /* must be a power of two */
+
+typedef struct _mpr_strtab_entry {
+    struct _mpr_strtab_entry *next;
+    uint32_t hash;
+    uint32_t refs;
+    char str[1];
+} mpr_strtab_entry_t, *mpr_strtab_entry;
+
+/* Entries are allocated with room for the string and its terminator. */
+#define ENTRY_SIZE(LEN) (offsetof(mpr_strtab_entry_t, str) + (LEN) + 1)
+#define ENTRY_FROM_STR(S) ((mpr_strtab_entry)((char*)(S) - offsetof(mpr_strtab_entry_t, str)))
+
+typedef struct _mpr_strtab {
+    mpr_arena arena;
+    mpr_strtab_entry *buckets;
+    unsigned int num_buckets;
+    unsigned int count;
+} mpr_strtab_t;
+
+/* FNV-1a hash, also returning the length of the string. */
+static uint32_t hash_str(const char *str, size_t *len)
+{
+    const unsigned char *c = (const unsigned char*)str;
+    uint32_t hash = 2166136261u;
+    while (*c) {
+        hash ^= *c++;
+        hash *= 16777619u;
+    }
+    *len = c - (const unsigned char*)str;
+    return hash;
+}
+
+static mpr_strtab_entry find_entry(mpr_strtab tab, const char *str, uint32_t hash)
+{
+    mpr_strtab_entry e = tab->buckets[hash & (tab->num_buckets - 1)];
+    while (e && (e->hash != hash || strcmp(e->str, str)))
+        e = e->next;
+    return e;
+}
+
+static void grow(mpr_strtab tab)
+{
+    unsigned int i, num_buckets = tab->num_buckets * 2;
+    mpr_strtab_entry *buckets = (mpr_strtab_entry*)calloc(num_buckets, sizeof(mpr_strtab_entry));
+    RETURN_UNLESS(buckets);
+    for (i = 0; i < tab->num_buckets; i++) {
+        while (tab->buckets[i]) {
+            mpr_strtab_entry e = tab->buckets[i];
+            tab->buckets[i] = e->next;
+            e->next = buckets[e->hash & (num_buckets - 1)];
+            buckets[e->hash & (num_buckets - 1)] = e;
+        }
+    }
+    free(tab->buckets);
+    tab->buckets = buckets;
+    tab->num_buckets = num_buckets;
+}
+
+mpr_strtab mpr_strtab_new(mpr_arena arena)
+{
+    mpr_strtab tab = (mpr_strtab)calloc(1, sizeof(mpr_strtab_t));
+    RETURN_ARG_UNLESS(tab, 0);
+    tab->buckets = (mpr_strtab_entry*)calloc(MIN_BUCKETS, sizeof(mpr_strtab_entry));
+    if (!tab->buckets) {
+        free(tab);
+        return 0;
+    }
+    tab->arena = arena;
+    tab->num_buckets = MIN_BUCKETS;
+    return tab;
+}
+
+void mpr_strtab_free(mpr_strtab tab)
+{
+    unsigned int i;
+    RETURN_UNLESS(tab);
+    if (!tab->arena) {
+        /* entries are not reclaimed along with an arena */
+        for (i = 0; i < tab->num_buckets; i++) {
+            while (tab->buckets[i]) {
+                mpr_strtab_entry e = tab->buckets[i];
+                tab->buckets[i] = e->next;
+                free(e);
+            }
+        }
+    }
+    free(tab->buckets);
+    free(tab);
+}
+
+const char *mpr_strtab_add(mpr_strtab tab, const char *str)
+{
+    mpr_strtab_entry e;
+    uint32_t hash;
+    size_t len;
+    RETURN_ARG_UNLESS(str, 0);
+    if (!tab)
+        return strdup(str);
+
+    hash = hash_str(str, &len);
+    if ((e = find_entry(tab, str, hash))) {
+        ++e->refs;
+        return e->str;
+    }
+    if (tab->count >= tab->num_buckets)
+        grow(tab);
+    e = (mpr_strtab_entry)mpr_arena_alloc(tab->arena, ENTRY_SIZE(len));
+    RETURN_ARG_UNLESS(e, 0);
+    memcpy(e->str, str, len + 1);
+    e->hash = hash;
+    e->refs = 1;
+    e->next = tab->buckets[hash & (tab->num_buckets - 1)];
+    tab->buckets[hash & (tab->num_buckets - 1)] = e;
+    ++tab->count;
+    return e->str;
+}
+
+void mpr_strtab_remove(mpr_strtab tab, const char *str)
+{
+    mpr_strtab_entry e, *prev;
+    RETURN_UNLESS(str);
+    if (!tab) {
+        free((char*)str);
+        return;
+    }
+    e = ENTRY_FROM_STR(str);
+    RETURN_UNLESS(--e->refs == 0);
+
+    prev = &tab->buckets[e->hash & (tab->num_buckets - 1)];
+    while (*prev && *prev != e)
+        prev = &(*prev)->next;
+    if (*prev)
+        *prev = e->next;
+    --tab->count;
+    mpr_arena_release(tab->arena, e, ENTRY_SIZE(strlen(e->str)));
+}
+
+const char *mpr_strtab_find(mpr_strtab tab, const char *str)
+{
+    mpr_strtab_entry e;
+    size_t len;
+    RETURN_ARG_UNLESS(tab && str, 0);
+    e = find_entry(tab, str, hash_str(str, &len));
+    return e ? e->str : 0;
+}
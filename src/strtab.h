@@ -0,0 +1,38 @@
+
+#ifndef __MPR_STRTAB_H__
+#define __MPR_STRTAB_H__
+
+#include "arena.h"
+
+/*! A graph-wide table of interned strings. Each distinct string is stored once and reference
+ *  counted, so strings from the same table can be compared by pointer. Strings are allocated from
+ *  the arena of the table. All functions also accept a null table, in which case strings are
+ *  copied with the system allocator and are never shared. */
+typedef struct _mpr_strtab *mpr_strtab;
+
+/*! Create a new string table.
+ *  \param arena        The arena to allocate strings from, or zero.
+ *  \return             The new string table. */
+mpr_strtab mpr_strtab_new(mpr_arena arena);
+
+/*! Free a string table. Strings that are still referenced remain allocated in the arena. */
+void mpr_strtab_free(mpr_strtab tab);
+
+/*! Add a reference to a string, interning it if it is not already stored.
+ *  \param tab          The string table to use, or zero.
+ *  \param str          The string to intern.
+ *  \return             The interned copy of the string. */
+const char *mpr_strtab_add(mpr_strtab tab, const char *str);
+
+/*! Release a reference to an interned string, freeing it once it is no longer used.
+ *  \param tab          The string table that the string was interned in, or zero.
+ *  \param str          A string returned by mpr_strtab_add(). */
+void mpr_strtab_remove(mpr_strtab tab, const char *str);
+
+/*! Find the interned copy of a string without adding a reference.
+ *  \param tab          The string table to search.
+ *  \param str          The string to find.
+ *  \return             The interned copy of the string, or zero if it is not stored. */
+const char *mpr_strtab_find(mpr_strtab tab, const char *str);
+
+#endif /* __MPR_STRTAB_H__ */
@@ -3,16 +3,22 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "arena.h"
 #include "list.h"
 #include "mpr_type.h"
 #include "path.h"
 #include "property.h"
 #include "object.h"
+#include "strtab.h"
 #include "util/mpr_debug.h"
 #include "util/mpr_set_coerced.h"
 #include "table.h"
 #include <mapper/mapper.h>
 
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
 #define MPR_TBL_MAX_RECORDS 128
 
 /*! Used to hold look-up table records. */
@@ -22,12 +28,14 @@ typedef struct _mpr_tbl_record {
     int len;
     mpr_prop prop;
     mpr_type type;
-    char flags;
+    short flags;
 } mpr_tbl_record_t;
 
 /*! Used to hold look-up tables. */
 typedef struct _mpr_tbl {
     mpr_tbl_record rec;
+    mpr_arena arena;                /*!< Memory for the table and its records, may be zero. */
+    mpr_strtab strings;             /*!< Interned keys and string values, may be zero. */
     int count;
     int alloced;
     char dirty;
@@ -42,6 +50,8 @@ static int compare_rec(const void *l, const void *r)
     int idx_r = MASK_PROP_BITFLAGS(rec_r->prop);
     if ((idx_l == MPR_PROP_EXTRA) && (idx_r == MPR_PROP_EXTRA)) {
         const char *str_l = rec_l->key, *str_r = rec_r->key;
+        if (str_l == str_r)
+            return 0;
         if (str_l[0] == '@')
             ++str_l;
         if (str_r[0] == '@')
@@ -55,13 +65,39 @@ static int compare_rec(const void *l, const void *r)
     return idx_l - idx_r;
 }
 
-mpr_tbl mpr_tbl_new(void)
+/* Values that are owned by a table and stored directly in its records are allocated from the
+ * table's arena. Indirect values belong to the parent object and use the system allocator. */
+#define VAL_ARENA(T, R) (((R)->flags & (PROP_OWNED | INDIRECT)) == PROP_OWNED ? (T)->arena : 0)
+
+/* Strings owned by a table are interned, as are indirect strings that the parent object has
+ * marked as INTERNED. Other indirect strings are copied with the system allocator. */
+#define VAL_STRTAB(T, R) \
+    (((R)->flags & (PROP_OWNED | INDIRECT)) == PROP_OWNED || (R)->flags & INTERNED ? (T)->strings : 0)
+
+/* Release a value allocated for a record. The record type and length must describe the value. */
+static void free_val(mpr_tbl t, mpr_tbl_record rec, void *val)
+{
+    int i;
+    if (MPR_STR == rec->type) {
+        if (1 == rec->len) {
+            mpr_strtab_remove(VAL_STRTAB(t, rec), (char*)val);
+            return;
+        }
+        for (i = 0; i < rec->len; i++)
+            mpr_strtab_remove(VAL_STRTAB(t, rec), ((char**)val)[i]);
+    }
+    mpr_arena_release(VAL_ARENA(t, rec), val, mpr_type_get_size(rec->type) * rec->len);
+}
+
+mpr_tbl mpr_tbl_new(mpr_arena arena, mpr_strtab strings)
 {
-    mpr_tbl t = (mpr_tbl)calloc(1, sizeof(mpr_tbl_t));
+    mpr_tbl t = (mpr_tbl)mpr_arena_alloc(arena, sizeof(mpr_tbl_t));
     RETURN_ARG_UNLESS(t, 0);
+    t->arena = arena;
+    t->strings = strings;
     t->count = 0;
     t->alloced = 1;
-    t->rec = (mpr_tbl_record)calloc(1, sizeof(mpr_tbl_record_t));
+    t->rec = (mpr_tbl_record)mpr_arena_alloc(arena, sizeof(mpr_tbl_record_t));
     return t;
 }
 
@@ -72,41 +108,35 @@ void mpr_tbl_sort(mpr_tbl t)
 
 void mpr_tbl_clear(mpr_tbl t)
 {
-    int i, j, free_vals = 1;
+    int i, free_vals = 1;
     for (i = 0; i < t->count; i++) {
         mpr_tbl_record rec = &t->rec[i];
         if (!(rec->flags & PROP_OWNED))
             continue;
-        if (rec->key)
-            free((char*)rec->key);
+        mpr_strtab_remove(t->strings, rec->key);
         if (free_vals && rec->val) {
             void *val = (rec->flags & INDIRECT) ? *rec->val : rec->val;
             if (val) {
                 if (MPR_LIST == rec->type)
                     mpr_list_free(val);
-                else if (MPR_OBJ != rec->type && MPR_PTR != rec->type) {
-                    if ((MPR_STR == rec->type) && rec->len > 1) {
-                        char **vals = (char**)val;
-                        for (j = 0; j < rec->len; j++)
-                            FUNC_IF(free, vals[j]);
-                    }
-                    free(val);
-                }
+                else if (MPR_OBJ != rec->type && MPR_PTR != rec->type)
+                    free_val(t, rec, val);
             }
             if (rec->flags & INDIRECT)
                 *rec->val = 0;
         }
     }
     t->count = 0;
-    t->rec = realloc(t->rec, sizeof(mpr_tbl_record_t));
+    t->rec = mpr_arena_realloc(t->arena, t->rec, t->alloced * sizeof(mpr_tbl_record_t),
+                               sizeof(mpr_tbl_record_t));
     t->alloced = 1;
 }
 
 void mpr_tbl_free(mpr_tbl t)
 {
     mpr_tbl_clear(t);
-    free(t->rec);
-    free(t);
+    mpr_arena_release(t->arena, t->rec, sizeof(mpr_tbl_record_t));
+    mpr_arena_release(t->arena, t, sizeof(mpr_tbl_t));
 }
 
 static mpr_tbl_record add_record_internal(mpr_tbl t, mpr_prop prop, const char *key,
@@ -116,14 +146,16 @@ static mpr_tbl_record add_record_internal(mpr_tbl t, mpr_prop prop, const char *
     RETURN_ARG_UNLESS(t->count < MPR_TBL_MAX_RECORDS, NULL);
     t->count += 1;
     if (t->count > t->alloced) {
+        int alloced = t->alloced;
         while (t->count > t->alloced)
             t->alloced *= 2;
-        t->rec = realloc(t->rec, t->alloced * sizeof(mpr_tbl_record_t));
+        t->rec = mpr_arena_realloc(t->arena, t->rec, alloced * sizeof(mpr_tbl_record_t),
+                                   t->alloced * sizeof(mpr_tbl_record_t));
     }
     rec = &t->rec[t->count-1];
     if (MPR_PROP_EXTRA == prop)
         flags |= MOD_ANY;
-    rec->key = key ? strdup(key) : 0;
+    rec->key = key ? mpr_strtab_add(t->strings, key) : 0;
     rec->prop = prop;
     rec->len = len;
     rec->type = type;
@@ -152,6 +184,28 @@ mpr_tbl_record mpr_tbl_get_record(mpr_tbl t, mpr_prop prop, const char *key)
     mpr_tbl_record_t tmp;
     mpr_tbl_record rec = 0;
     RETURN_ARG_UNLESS(key || (MPR_PROP_EXTRA != prop), 0);
+    if (MPR_PROP_EXTRA == MASK_PROP_BITFLAGS(prop) && t->strings && !strchr(key, '*')) {
+        /* keys are interned so an exact match can be found by comparing pointers; keys are stored
+         * as given, so look for both the plain and the '@'-prefixed form */
+        const char *plain, *prefixed;
+        char *at_key;
+        int i;
+        if ('@' == key[0])
+            ++key;
+        at_key = alloca(strlen(key) + 2);
+        at_key[0] = '@';
+        strcpy(at_key + 1, key);
+        plain = mpr_strtab_find(t->strings, key);
+        prefixed = mpr_strtab_find(t->strings, at_key);
+        RETURN_ARG_UNLESS(plain || prefixed, 0);
+        for (i = 0; i < t->count; i++) {
+            mpr_tbl_record r = &t->rec[i];
+            if (MPR_PROP_EXTRA == MASK_PROP_BITFLAGS(r->prop)
+                && ((plain && r->key == plain) || (prefixed && r->key == prefixed)))
+                return r;
+        }
+        return 0;
+    }
     tmp.prop = prop;
     tmp.key = key;
     rec = bsearch(&tmp, t->rec, t->count, sizeof(mpr_tbl_record_t), compare_rec);
@@ -238,7 +292,7 @@ int mpr_tbl_get_record_is_writable(mpr_tbl t, mpr_prop prop)
 
 int mpr_tbl_remove_record(mpr_tbl t, mpr_prop prop, const char *key, int flags)
 {
-    int i, ret = 0;
+    int ret = 0;
 
     do {
         mpr_tbl_record rec = mpr_tbl_get_record(t, prop, key);
@@ -249,7 +303,7 @@ int mpr_tbl_remove_record(mpr_tbl t, mpr_prop prop, const char *key, int flags)
             if (rec->flags & INDIRECT) {
                 /* set value to null rather than removing */
                 if (rec->val && *rec->val && rec->type != MPR_PTR) {
-                    free(*rec->val);
+                    free_val(t, rec, *rec->val);
                     *rec->val = 0;
                 }
                 rec->prop |= PROP_REMOVE;
@@ -264,12 +318,7 @@ int mpr_tbl_remove_record(mpr_tbl t, mpr_prop prop, const char *key, int flags)
 
         /* Calculate its key in the records. */
         if (rec->val && rec->type != MPR_PTR) {
-            if ((rec->type == MPR_STR) && rec->len > 1) {
-                char **vals = (char**)rec->val;
-                for (i = 0; i < rec->len; i++)
-                    FUNC_IF(free, vals[i]);
-            }
-            free(rec->val);
+            free_val(t, rec, rec->val);
             rec->val = 0;
         }
         rec->prop |= PROP_REMOVE;
@@ -289,7 +338,7 @@ void mpr_tbl_clear_empty_records(mpr_tbl t)
         rec->prop &= ~PROP_REMOVE;
         if (MASK_PROP_BITFLAGS(rec->prop) != MPR_PROP_EXTRA)
             continue;
-        free((char*)rec->key);
+        mpr_strtab_remove(t->strings, rec->key);
         for (j = rec - t->rec + 1; j < t->count; j++)
             t->rec[j-1] = t->rec[j];
         --t->count;
@@ -298,10 +347,13 @@ void mpr_tbl_clear_empty_records(mpr_tbl t)
 
 /* For unknown reasons, strcpy crashes here with -O2, so we'll use memcpy
  * instead, which does not crash. */
-static int update_elements(mpr_tbl_record rec, unsigned int len, mpr_type type, const void *val)
+static int update_elements(mpr_tbl t, mpr_tbl_record rec, unsigned int len, mpr_type type,
+                           const void *val)
 {
     int i, updated = 0;
     void *old_val, *new_val, *coerced = 0;
+    mpr_arena arena = VAL_ARENA(t, rec);
+    mpr_strtab strings = VAL_STRTAB(t, rec);
     RETURN_ARG_UNLESS(len && (rec->val || !(rec->flags & INDIRECT)), 0);
     old_val = (rec->flags & INDIRECT) ? *rec->val : rec->val;
     new_val = old_val;
@@ -320,12 +372,8 @@ static int update_elements(mpr_tbl_record rec, unsigned int len, mpr_type type,
         }
         else {
             /* free old values */
-            if (MPR_STR == rec->type && rec->len > 1) {
-                for (i = 0; i < rec->len; i++)
-                    free(((char**)old_val)[i]);
-            }
             if (rec->len > 1 || (MPR_PTR != rec->type && MPR_GRAPH < rec->type))
-                free(old_val);
+                free_val(t, rec, old_val);
             old_val = 0;
             updated = 1;
         }
@@ -335,26 +383,25 @@ static int update_elements(mpr_tbl_record rec, unsigned int len, mpr_type type,
             if (1 == len) {
                 if (old_val) {
                     if (strcmp((char*)old_val, (char*)val)) {
-                        free((char*)old_val);
+                        mpr_strtab_remove(strings, (char*)old_val);
                         old_val = 0;
                         updated = 1;
                     }
                     else
                         goto done;
                 }
-                new_val = val ? (void*)strdup((char*)val) : 0;
+                new_val = val ? (void*)mpr_strtab_add(strings, (char*)val) : 0;
             }
             else {
                 const char **from = (const char**)val;
                 char **to;
                 if (!old_val)
-                    new_val = calloc(1, sizeof(char*) * len);
+                    new_val = mpr_arena_alloc(arena, sizeof(char*) * len);
                 to = (char**)new_val;
                 for (i = 0; i < len; i++) {
                     if (!to[i] || strcmp(from[i], to[i])) {
-                        int n = strlen(from[i]);
-                        to[i] = realloc(to[i], n+1);
-                        memcpy(to[i], from[i], n+1);
+                        mpr_strtab_remove(strings, to[i]);
+                        to[i] = (char*)mpr_strtab_add(strings, from[i]);
                         updated = 1;
                     }
                 }
@@ -370,7 +417,7 @@ static int update_elements(mpr_tbl_record rec, unsigned int len, mpr_type type,
             }
         default: {
             if (!old_val) {
-                new_val = malloc(mpr_type_get_size(type) * len);
+                new_val = mpr_arena_alloc(arena, mpr_type_get_size(type) * len);
                 memcpy(new_val, val, mpr_type_get_size(type) * len);
                 updated = 1;
             }
@@ -409,14 +456,14 @@ static int set_internal(mpr_tbl t, mpr_prop prop, const char *key, int len,
         }
         else
             rec->prop &= ~PROP_REMOVE;
-        updated = t->dirty = update_elements(rec, len, type, val);
+        updated = t->dirty = update_elements(t, rec, len, type, val);
     }
     else {
         /* Need to add a new entry. */
         if (!(rec = add_record_internal(t, prop, key, 0, type, 0, flags | PROP_OWNED)))
             return 0;
         if (val)
-            update_elements(rec, len, type, val);
+            update_elements(t, rec, len, type, val);
         else
             rec->prop |= PROP_REMOVE;
         mpr_tbl_sort(t);
@@ -444,7 +491,7 @@ void mpr_tbl_link_value(mpr_tbl t, mpr_prop prop, int len, mpr_type type, void *
             if (MPR_LIST == rec->type)
                 mpr_list_free(val);
             else
-                free(val);
+                free_val(t, rec, val);
         }
         /* update value */
         rec->val = val;
@@ -454,7 +501,7 @@ void mpr_tbl_link_value(mpr_tbl t, mpr_prop prop, int len, mpr_type type, void *
     }
 }
 
-static int update_elements_osc(mpr_tbl_record rec, unsigned int len,
+static int update_elements_osc(mpr_tbl t, mpr_tbl_record rec, unsigned int len,
                                const mpr_type *types, lo_arg **args)
 {
     int i, size, updated;
@@ -462,7 +509,7 @@ static int update_elements_osc(mpr_tbl_record rec, unsigned int len,
     void *val;
     RETURN_ARG_UNLESS(len, 0);
     if (MPR_STR == types[0] && 1 == len)
-        return update_elements(rec, 1, MPR_STR, &args[0]->s);
+        return update_elements(t, rec, 1, MPR_STR, &args[0]->s);
 
     type = types[0];
     size = mpr_type_get_size(types[0]) * len;
@@ -509,7 +556,7 @@ static int update_elements_osc(mpr_tbl_record rec, unsigned int len,
             break;
     }
 
-    updated = update_elements(rec, len, type, val);
+    updated = update_elements(t, rec, len, type, val);
     free(val);
     return updated;
 }
@@ -527,7 +574,7 @@ int mpr_tbl_add_record_from_msg_atom(mpr_tbl t, mpr_msg_atom atom, int flags)
 
     rec = mpr_tbl_get_record(t, prop, key);
     if (rec)
-        updated = t->dirty = update_elements_osc(rec, len, mpr_msg_atom_get_types(atom),
+        updated = t->dirty = update_elements_osc(t, rec, len, mpr_msg_atom_get_types(atom),
                                                  mpr_msg_atom_get_values(atom));
     else {
         /* Need to add a new entry. */
@@ -535,7 +582,7 @@ int mpr_tbl_add_record_from_msg_atom(mpr_tbl t, mpr_msg_atom atom, int flags)
         if (!(rec = add_record_internal(t, prop, key, 0, types[0], 0, flags | PROP_OWNED)))
             return 0;
         rec->val = 0;
-        update_elements_osc(rec, len, types, mpr_msg_atom_get_values(atom));
+        update_elements_osc(t, rec, len, types, mpr_msg_atom_get_values(atom));
         mpr_tbl_sort(t);
         updated = t->dirty = 1;
     }
@@ -5,7 +5,9 @@
 typedef struct _mpr_tbl *mpr_tbl;
 typedef struct _mpr_tbl_record *mpr_tbl_record;
 
+#include "arena.h"
 #include "message.h"
+#include "strtab.h"
 
 /* bit flags for tracking permissions for modifying properties */
 #define MOD_NONE        0x00    /* 00000000 */
@@ -18,9 +20,12 @@ typedef struct _mpr_tbl_record *mpr_tbl_record;
 #define INDIRECT        0x20    /* 00100000 */
 #define PROP_OWNED      0x40    /* 01000000 */
 #define PROP_SET        0x80    /* 10000000 */
+#define INTERNED        0x100   /* 100000000 string values are interned */
 
-/*! Create a new string table. */
-mpr_tbl mpr_tbl_new(void);
+/*! Create a new string table.
+ * \param arena     Arena to allocate the table and its records from, or zero.
+ * \param strings   Table for interning keys and string values, or zero. */
+mpr_tbl mpr_tbl_new(mpr_arena arena, mpr_strtab strings);
 
 /*! Sort a string table. */
 void mpr_tbl_sort(mpr_tbl t);
@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "timer_wheel.h"
+#include "util/mpr_debug.h"
+
+#define NUM_SLOTS 64                /* must be a power of two */
+
+typedef struct _mpr_timer_wheel {
+    mpr_timer slots[NUM_SLOTS];
+    double start;                   /*!< The time of tick zero. */
+    double resolution;
+    uint64_t tick;                  /*!< The next tick to be processed. */
+} mpr_timer_wheel_t;
+
+mpr_timer_wheel mpr_timer_wheel_new(double resolution, double now)
+{
+    mpr_timer_wheel wheel = (mpr_timer_wheel)calloc(1, sizeof(mpr_timer_wheel_t));
+    wheel->start = now;
+    wheel->resolution = resolution;
+    return wheel;
+}
+
+void mpr_timer_wheel_free(mpr_timer_wheel wheel)
+{
+    int i;
+    RETURN_UNLESS(wheel);
+    for (i = 0; i < NUM_SLOTS; i++) {
+        while (wheel->slots[i])
+            mpr_timer_cancel(wheel->slots[i]);
+    }
+    free(wheel);
+}
+
+void mpr_timer_init(mpr_timer timer, mpr_timer_handler *handler, void *data)
+{
+    timer->next = 0;
+    timer->prev = 0;
+    timer->tick = 0;
+    timer->handler = handler;
+    timer->data = data;
+}
+
+static void link_timer(mpr_timer timer, mpr_timer *head)
+{
+    timer->next = *head;
+    if (timer->next)
+        timer->next->prev = &timer->next;
+    timer->prev = head;
+    *head = timer;
+}
+
+void mpr_timer_schedule(mpr_timer_wheel wheel, mpr_timer timer, double when)
+{
+    double ticks = ceil((when - wheel->start) / wheel->resolution);
+    mpr_timer_cancel(timer);
+    timer->tick = ticks > 0 ? (uint64_t)ticks : 0;
+    /* deadlines that have already passed are handled on the next advance */
+    if (timer->tick < wheel->tick)
+        timer->tick = wheel->tick;
+    link_timer(timer, &wheel->slots[timer->tick & (NUM_SLOTS - 1)]);
+}
+
+void mpr_timer_cancel(mpr_timer timer)
+{
+    RETURN_UNLESS(timer->prev);
+    *timer->prev = timer->next;
+    if (timer->next)
+        timer->next->prev = timer->prev;
+    timer->next = 0;
+    timer->prev = 0;
+}
+
+int mpr_timer_get_is_scheduled(mpr_timer timer)
+{
+    return timer->prev != 0;
+}
+
+double mpr_timer_get_deadline(mpr_timer_wheel wheel, mpr_timer timer)
+{
+    return wheel->start + timer->tick * wheel->resolution;
+}
+
+double mpr_timer_wheel_get_next_deadline(mpr_timer_wheel wheel)
+{
+    uint64_t i, min_tick = 0;
+    mpr_timer timer;
+    int found = 0;
+
+    /* check one revolution of the wheel in order for a timer due on the matching tick */
+    for (i = wheel->tick; i < wheel->tick + NUM_SLOTS; i++) {
+        for (timer = wheel->slots[i & (NUM_SLOTS - 1)]; timer; timer = timer->next) {
+            if (timer->tick == i)
+                return wheel->start + i * wheel->resolution;
+            if (!found || timer->tick < min_tick) {
+                min_tick = timer->tick;
+                found = 1;
+            }
+        }
+    }
+    /* all timers are due after more than one revolution */
+    return found ? wheel->start + min_tick * wheel->resolution : -1;
+}
+
+int mpr_timer_wheel_advance(mpr_timer_wheel wheel, double now)
+{
+    uint64_t i, end, current;
+    mpr_timer timer, next, expired = 0;
+    int count = 0;
+    RETURN_ARG_UNLESS(now >= wheel->start, 0);
+    current = (uint64_t)floor((now - wheel->start) / wheel->resolution);
+    RETURN_ARG_UNLESS(current >= wheel->tick, 0);
+
+    /* move expired timers to a separate list, visiting each slot at most once */
+    end = current - wheel->tick < NUM_SLOTS ? current : wheel->tick + NUM_SLOTS - 1;
+    for (i = wheel->tick; i <= end; i++) {
+        for (timer = wheel->slots[i & (NUM_SLOTS - 1)]; timer; timer = next) {
+            next = timer->next;
+            if (timer->tick <= current) {
+                mpr_timer_cancel(timer);
+                link_timer(timer, &expired);
+            }
+        }
+    }
+    wheel->tick = current + 1;
+
+    /* handlers may cancel or reschedule any timer, including those still in the expired list */
+    while ((timer = expired)) {
+        mpr_timer_cancel(timer);
+        timer->handler(timer->data, now);
+        ++count;
+    }
+    return count;
+}
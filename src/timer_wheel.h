@@ -0,0 +1,72 @@
+
+#ifndef __MPR_TIMER_WHEEL_H__
+#define __MPR_TIMER_WHEEL_H__
+
+#include <stdint.h>
+
+/*! A hashed timing wheel. Timers are stored in slots indexed by their deadline tick so that
+ *  scheduling and cancelling take constant time, and advancing the wheel only visits the slots
+ *  whose ticks have passed. Timers are owned by the caller and may be embedded in other
+ *  structures. */
+typedef struct _mpr_timer_wheel *mpr_timer_wheel;
+
+/*! A function called when a timer expires. The timer may be rescheduled from within the handler.
+ *  \param data         The user data passed to `mpr_timer_init()`.
+ *  \param now          The time at which the wheel was advanced. */
+typedef void mpr_timer_handler(void *data, double now);
+
+typedef struct _mpr_timer {
+    struct _mpr_timer *next;
+    struct _mpr_timer **prev;       /*!< The link pointing to this timer, or zero if idle. */
+    uint64_t tick;
+    mpr_timer_handler *handler;
+    void *data;
+} mpr_timer_t, *mpr_timer;
+
+/*! Create a new timing wheel.
+ *  \param resolution   The duration of one tick in seconds.
+ *  \param now          The current time in seconds.
+ *  \return             The new timing wheel. */
+mpr_timer_wheel mpr_timer_wheel_new(double resolution, double now);
+
+/*! Free a timing wheel. Any scheduled timers are cancelled. */
+void mpr_timer_wheel_free(mpr_timer_wheel wheel);
+
+/*! Initialize a timer.
+ *  \param timer        The timer to initialize.
+ *  \param handler      The function to call when the timer expires.
+ *  \param data         User data to pass to the handler. */
+void mpr_timer_init(mpr_timer timer, mpr_timer_handler *handler, void *data);
+
+/*! Schedule a timer, replacing any deadline it already has. Deadlines are rounded up to the next
+ *  tick and deadlines in the past expire on the next call to `mpr_timer_wheel_advance()`.
+ *  \param wheel        The timing wheel to use.
+ *  \param timer        The timer to schedule.
+ *  \param when         The time at which the timer should expire, in seconds. */
+void mpr_timer_schedule(mpr_timer_wheel wheel, mpr_timer timer, double when);
+
+/*! Cancel a timer if it is scheduled. */
+void mpr_timer_cancel(mpr_timer timer);
+
+/*! Check whether a timer is scheduled. */
+int mpr_timer_get_is_scheduled(mpr_timer timer);
+
+/*! Retrieve the deadline of a scheduled timer.
+ *  \param wheel        The timing wheel the timer is scheduled on.
+ *  \param timer        The timer to query.
+ *  \return             The deadline in seconds, rounded up to the wheel's resolution. */
+double mpr_timer_get_deadline(mpr_timer_wheel wheel, mpr_timer timer);
+
+/*! Find the earliest deadline of all scheduled timers.
+ *  \param wheel        The timing wheel to query.
+ *  \return             The earliest deadline in seconds, or a negative value if no timers are
+ *                      scheduled. */
+double mpr_timer_wheel_get_next_deadline(mpr_timer_wheel wheel);
+
+/*! Call the handlers of all timers whose deadlines have passed.
+ *  \param wheel        The timing wheel to advance.
+ *  \param now          The current time in seconds.
+ *  \return             The number of timers that expired. */
+int mpr_timer_wheel_advance(mpr_timer_wheel wheel, double now);
+
+#endif /* __MPR_TIMER_WHEEL_H__ */
@@ -0,0 +1,294 @@
+#define _GNU_SOURCE
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifndef WIN32
+ #include <sys/types.h>
+ #include <sys/socket.h>
+ #include <netdb.h>
+ #include <errno.h>
+ #define USE_DEST
+ #if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+  #define USE_BATCH
+ #endif
+#endif
+
+#include "udp_batch.h"
+#include "util/mpr_debug.h"
+
+#define RECV_BATCH_SIZE     16
+#define SEND_BATCH_SIZE     64
+#define MAX_DATAGRAM_LEN    65536
+#define SEND_BUFFER_LEN     (MAX_DATAGRAM_LEN * 2)
+
+#ifdef USE_DEST
+typedef struct _mpr_udp_dest {
+    struct sockaddr_storage addr;
+    socklen_t len;
+} mpr_udp_dest_t;
+#endif
+
+#ifdef USE_BATCH
+typedef struct _mpr_udp_batch {
+    struct {
+        struct mmsghdr hdrs[RECV_BATCH_SIZE];
+        struct iovec iovs[RECV_BATCH_SIZE];
+        char *buf;                  /*!< One maximum-sized datagram per slot. */
+    } in;
+    struct {
+        struct mmsghdr hdrs[SEND_BATCH_SIZE];
+        struct iovec iovs[SEND_BATCH_SIZE];
+        struct sockaddr_storage addrs[SEND_BATCH_SIZE];
+        char *buf;                  /*!< Serialised bundles, packed end to end. */
+        size_t used;
+        int num;
+        int fd;                     /*!< Socket of the server that queued bundles are sent from. */
+    } out;
+} mpr_udp_batch_t;
+#endif
+
+int mpr_udp_batch_get_is_supported(void)
+{
+#ifdef USE_BATCH
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+mpr_udp_batch mpr_udp_batch_new(void)
+{
+#ifdef USE_BATCH
+    int i;
+    mpr_udp_batch batch = (mpr_udp_batch)calloc(1, sizeof(mpr_udp_batch_t));
+    batch->in.buf = (char*)malloc(RECV_BATCH_SIZE * MAX_DATAGRAM_LEN);
+    batch->out.buf = (char*)malloc(SEND_BUFFER_LEN);
+    for (i = 0; i < RECV_BATCH_SIZE; i++) {
+        batch->in.iovs[i].iov_base = batch->in.buf + i * MAX_DATAGRAM_LEN;
+        batch->in.iovs[i].iov_len = MAX_DATAGRAM_LEN;
+        batch->in.hdrs[i].msg_hdr.msg_iov = &batch->in.iovs[i];
+        batch->in.hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (i = 0; i < SEND_BATCH_SIZE; i++) {
+        batch->out.hdrs[i].msg_hdr.msg_name = &batch->out.addrs[i];
+        batch->out.hdrs[i].msg_hdr.msg_iov = &batch->out.iovs[i];
+        batch->out.hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+    batch->out.fd = -1;
+    return batch;
+#else
+    return 0;
+#endif
+}
+
+void mpr_udp_batch_free(mpr_udp_batch batch)
+{
+    RETURN_UNLESS(batch);
+#ifdef USE_BATCH
+    free(batch->in.buf);
+    free(batch->out.buf);
+#endif
+    free(batch);
+}
+
+int mpr_udp_batch_recv(mpr_udp_batch batch, lo_server server, mpr_udp_dispatch_handler *h,
+                       void *user_data)
+{
+#ifdef USE_BATCH
+    int i, num, fd = lo_server_get_socket_fd(server);
+    RETURN_ARG_UNLESS(fd >= 0, 0);
+    do {
+        num = recvmmsg(fd, batch->in.hdrs, RECV_BATCH_SIZE, MSG_DONTWAIT, NULL);
+    } while (num < 0 && EINTR == errno);
+    RETURN_ARG_UNLESS(num > 0, 0);
+    for (i = 0; i < num; i++) {
+        struct mmsghdr *hdr = &batch->in.hdrs[i];
+        if (hdr->msg_hdr.msg_flags & MSG_TRUNC) {
+            trace("dropping truncated datagram of length %u\n", hdr->msg_len);
+            continue;
+        }
+        if (h)
+            h(server, batch->in.iovs[i].iov_base, hdr->msg_len, user_data);
+        else
+            lo_server_dispatch_data(server, batch->in.iovs[i].iov_base, hdr->msg_len);
+    }
+    return num;
+#else
+    return 0;
+#endif
+}
+
+#ifdef USE_BATCH
+/* Reserve the next datagram of a batch, flushing it first if necessary. */
+static struct iovec *reserve(mpr_udp_batch batch, lo_server server, mpr_udp_dest dest, size_t len)
+{
+    int fd = server ? lo_server_get_socket_fd(server) : -1;
+    struct iovec *iov;
+    RETURN_ARG_UNLESS(dest && fd >= 0 && len <= MAX_DATAGRAM_LEN, 0);
+
+    if (batch->out.num && (   fd != batch->out.fd || batch->out.num >= SEND_BATCH_SIZE
+                           || batch->out.used + len > SEND_BUFFER_LEN))
+        mpr_udp_batch_flush(batch);
+
+    iov = &batch->out.iovs[batch->out.num];
+    iov->iov_base = batch->out.buf + batch->out.used;
+    iov->iov_len = len;
+    return iov;
+}
+
+/* Set the destination of the next datagram of a batch. */
+static void set_dest(mpr_udp_batch batch, mpr_udp_dest dest)
+{
+    memcpy(&batch->out.addrs[batch->out.num], &dest->addr, dest->len);
+    batch->out.hdrs[batch->out.num].msg_hdr.msg_namelen = dest->len;
+}
+
+/* Add the datagram reserved by reserve() to a batch. */
+static void commit(mpr_udp_batch batch, lo_server server, mpr_udp_dest dest, size_t len)
+{
+    batch->out.iovs[batch->out.num].iov_len = len;
+    set_dest(batch, dest);
+    batch->out.used += len;
+    batch->out.fd = lo_server_get_socket_fd(server);
+    ++batch->out.num;
+}
+#endif
+
+int mpr_udp_batch_add(mpr_udp_batch batch, lo_server server, mpr_udp_dest dest, lo_bundle bundle)
+{
+#ifdef USE_BATCH
+    size_t len = lo_bundle_length(bundle);
+    struct iovec *iov = reserve(batch, server, dest, len);
+    RETURN_ARG_UNLESS(iov && lo_bundle_serialise(bundle, iov->iov_base, &len), 1);
+    commit(batch, server, dest, len);
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+int mpr_udp_batch_add_data(mpr_udp_batch batch, lo_server server, mpr_udp_dest dest,
+                           const void *data, size_t len)
+{
+#ifdef USE_BATCH
+    struct iovec *iov = reserve(batch, server, dest, len);
+    RETURN_ARG_UNLESS(iov, 1);
+    memcpy(iov->iov_base, data, len);
+    commit(batch, server, dest, len);
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+int mpr_udp_batch_add_fanout(mpr_udp_batch batch, lo_server server, mpr_udp_dest *dests,
+                             int num_dests, const void *data, size_t len)
+{
+#ifdef USE_BATCH
+    int i, fd = server ? lo_server_get_socket_fd(server) : -1;
+    char *copy = 0;
+    RETURN_ARG_UNLESS(fd >= 0 && len <= MAX_DATAGRAM_LEN, 1);
+    for (i = 0; i < num_dests; i++) {
+        struct iovec *iov;
+        if (!dests[i])
+            continue;
+        if (batch->out.num && (   fd != batch->out.fd || batch->out.num >= SEND_BATCH_SIZE
+                               || (!copy && batch->out.used + len > SEND_BUFFER_LEN))) {
+            mpr_udp_batch_flush(batch);
+            copy = 0;
+        }
+        if (!copy) {
+            copy = batch->out.buf + batch->out.used;
+            memcpy(copy, data, len);
+            batch->out.used += len;
+        }
+        /* the datagrams for each destination share the same copy of the data */
+        iov = &batch->out.iovs[batch->out.num];
+        iov->iov_base = copy;
+        iov->iov_len = len;
+        set_dest(batch, dests[i]);
+        batch->out.fd = fd;
+        ++batch->out.num;
+    }
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+int mpr_udp_batch_flush(mpr_udp_batch batch)
+{
+#ifdef USE_BATCH
+    int idx = 0, sent = 0, ret;
+    while (idx < batch->out.num) {
+        ret = sendmmsg(batch->out.fd, batch->out.hdrs + idx, batch->out.num - idx, 0);
+        if (ret > 0) {
+            idx += ret;
+            sent += ret;
+        }
+        else if (ret < 0 && EINTR == errno)
+            continue;
+        else {
+            /* skip the datagram that failed and continue with the rest of the batch */
+            trace("error sending datagram: %s\n", strerror(errno));
+            ++idx;
+        }
+    }
+    batch->out.num = 0;
+    batch->out.used = 0;
+    return sent;
+#else
+    return 0;
+#endif
+}
+
+int mpr_udp_send(lo_server server, mpr_udp_dest dest, const void *data, size_t len)
+{
+#ifdef USE_DEST
+    int fd = server ? lo_server_get_socket_fd(server) : -1;
+    ssize_t ret;
+    RETURN_ARG_UNLESS(dest && fd >= 0, 1);
+    do {
+        ret = sendto(fd, data, len, 0, (struct sockaddr*)&dest->addr, dest->len);
+    } while (ret < 0 && EINTR == errno);
+    if (ret < 0)
+        trace("error sending datagram: %s\n", strerror(errno));
+    return ret < 0;
+#else
+    return 1;
+#endif
+}
+
+mpr_udp_dest mpr_udp_dest_new(const char *host, int port)
+{
+#ifdef USE_DEST
+    mpr_udp_dest dest;
+    struct addrinfo hints, *info;
+    char port_str[16];
+    RETURN_ARG_UNLESS(host, 0);
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    snprintf(port_str, 16, "%d", port);
+    RETURN_ARG_UNLESS(!getaddrinfo(host, port_str, &hints, &info), 0);
+    if (info->ai_addrlen > sizeof(struct sockaddr_storage)) {
+        freeaddrinfo(info);
+        return 0;
+    }
+    dest = (mpr_udp_dest)calloc(1, sizeof(mpr_udp_dest_t));
+    memcpy(&dest->addr, info->ai_addr, info->ai_addrlen);
+    dest->len = info->ai_addrlen;
+    freeaddrinfo(info);
+    return dest;
+#else
+    return 0;
+#endif
+}
+
+void mpr_udp_dest_free(mpr_udp_dest dest)
+{
+    FUNC_IF(free, dest);
+}
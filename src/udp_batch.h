@@ -0,0 +1,99 @@
+
+#ifndef __MPR_UDP_BATCH_H__
+#define __MPR_UDP_BATCH_H__
+
+#include <lo/lo.h>
+
+/*! Batched datagram I/O for device servers. Incoming datagrams are drained from a server socket
+ *  several at a time and passed to liblo for dispatch, and outgoing bundles are serialised and
+ *  queued so that the bundles for all links can be sent with a single system call. */
+typedef struct _mpr_udp_batch *mpr_udp_batch;
+
+/*! The resolved address of a remote UDP server. */
+typedef struct _mpr_udp_dest *mpr_udp_dest;
+
+/*! Check whether batched I/O is available on this platform.
+ *  \return             Non-zero if batches can be created. */
+int mpr_udp_batch_get_is_supported(void);
+
+/*! Create a new batch.
+ *  \return             The new batch, or zero if batched I/O is not supported. */
+mpr_udp_batch mpr_udp_batch_new(void);
+
+/*! Free a batch. Any queued bundles are discarded. */
+void mpr_udp_batch_free(mpr_udp_batch batch);
+
+/*! A function called to dispatch each datagram received by a batch.
+ *  \param server       The server that received the datagram.
+ *  \param data         The datagram, which may be modified by the handler.
+ *  \param len          The length of the datagram in bytes.
+ *  \param user_data    The data passed to `mpr_udp_batch_recv()`. */
+typedef void mpr_udp_dispatch_handler(lo_server server, char *data, size_t len, void *user_data);
+
+/*! Receive all waiting datagrams from a server, up to the size of a batch, and dispatch them.
+ *  Since the sender of each datagram is not passed to liblo this should only be used for servers
+ *  whose handlers do not call `lo_message_get_source()`.
+ *  \param batch        The batch to use for receiving.
+ *  \param server       The UDP server to read from.
+ *  \param h            A function for dispatching each datagram, or zero to pass them to liblo.
+ *  \param user_data    Data passed to the dispatch function.
+ *  \return             The number of datagrams dispatched. */
+int mpr_udp_batch_recv(mpr_udp_batch batch, lo_server server, mpr_udp_dispatch_handler *h,
+                       void *user_data);
+
+/*! Queue a bundle to be sent from a server. The bundle is serialised immediately and may be
+ *  freed after this call. Queued bundles are sent by `mpr_udp_batch_flush()`, or when the batch
+ *  is full or a bundle is queued for a different server.
+ *  \param batch        The batch to add to.
+ *  \param server       The UDP server to send from.
+ *  \param dest         The destination address.
+ *  \param bundle       The bundle to send.
+ *  \return             Zero if the bundle was queued, non-zero if it should be sent directly. */
+int mpr_udp_batch_add(mpr_udp_batch batch, lo_server server, mpr_udp_dest dest, lo_bundle bundle);
+
+/*! Queue an encoded datagram to be sent from a server. The data is copied immediately.
+ *  \param batch        The batch to add to.
+ *  \param server       The UDP server to send from.
+ *  \param dest         The destination address.
+ *  \param data         The datagram to send.
+ *  \param len          The length of the datagram in bytes.
+ *  \return             Zero if the datagram was queued, non-zero if it should be sent directly. */
+int mpr_udp_batch_add_data(mpr_udp_batch batch, lo_server server, mpr_udp_dest dest,
+                           const void *data, size_t len);
+
+/*! Queue an encoded datagram to be sent from a server to several destinations. The data is
+ *  copied once and shared by the datagrams for each destination.
+ *  \param batch        The batch to add to.
+ *  \param server       The UDP server to send from.
+ *  \param dests        The destination addresses.
+ *  \param num_dests    The number of destination addresses.
+ *  \param data         The datagram to send.
+ *  \param len          The length of the datagram in bytes.
+ *  \return             Zero if the datagrams were queued, non-zero if they should be sent
+ *                      directly. */
+int mpr_udp_batch_add_fanout(mpr_udp_batch batch, lo_server server, mpr_udp_dest *dests,
+                             int num_dests, const void *data, size_t len);
+
+/*! Send all queued bundles.
+ *  \param batch        The batch to flush.
+ *  \return             The number of datagrams sent. */
+int mpr_udp_batch_flush(mpr_udp_batch batch);
+
+/*! Send an encoded datagram from a server immediately.
+ *  \param server       The UDP server to send from.
+ *  \param dest         The destination address.
+ *  \param data         The datagram to send.
+ *  \param len          The length of the datagram in bytes.
+ *  \return             Zero if the datagram was sent, non-zero otherwise. */
+int mpr_udp_send(lo_server server, mpr_udp_dest dest, const void *data, size_t len);
+
+/*! Resolve the address of a remote UDP server.
+ *  \param host         The host name or address.
+ *  \param port         The port number.
+ *  \return             The resolved address, or zero if it could not be resolved. */
+mpr_udp_dest mpr_udp_dest_new(const char *host, int port);
+
+/*! Free a resolved address. */
+void mpr_udp_dest_free(mpr_udp_dest dest);
+
+#endif /* __MPR_UDP_BATCH_H__ */
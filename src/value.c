@@ -12,32 +12,46 @@
 
 #define GET_BUFFER() &v->inst[inst_idx % v->num_inst]
 
+/* The history of every instance is stored in a single block with separate planes for samples,
+ * times, known-element flags and the state of each circular buffer. Samples are laid out as
+ * [inst][hist][vlen] and times as [inst][hist]. Each plane starts on a cache line boundary so
+ * that it is suitably aligned for vector instructions. */
+#define PLANE_ALIGN 64
+#define PLANE_SIZE(S) (((S) + PLANE_ALIGN - 1) & ~(size_t)(PLANE_ALIGN - 1))
+
+#define HIST_SIZE(V) ((size_t)(V)->mlen * (V)->vlen * mpr_type_get_size((V)->type))
+#define BUFFER_IDX(V, B) ((size_t)((B) - (V)->inst))
+#define GET_SAMPS(V, B) ((V)->samps + BUFFER_IDX(V, B) * HIST_SIZE(V))
+#define GET_TIMES(V, B) ((V)->times + BUFFER_IDX(V, B) * (V)->mlen)
+#define KNOWN_SIZE(V) MPR_BITFLAGS_SIZE((V)->vlen)
+#define GET_KNOWN(V, B) ((mpr_bitflags)((V)->known + BUFFER_IDX(V, B) * KNOWN_SIZE(V)))
+
 typedef struct _mpr_value_buffer
 {
     mpr_time start;             /*!< Time at which this instance was activated. */
-    void *samps;                /*!< Value for each sample of stored history. */
-    mpr_time *times;            /*!< Time for each sample of stored history. */
-    mpr_bitflags known;         /*!< Bitflags indicating which value elements are known. */
     int16_t pos;                /*!< Current position in the circular buffer. */
     uint8_t full;               /*!< Indicates whether complete buffer contains valid data. */
 } mpr_value_buffer_t, *mpr_value_buffer;
 
 typedef struct _mpr_value
 {
-    mpr_value_buffer inst;      /*!< Array of value histories for each signal instance. */
-    uint8_t vlen;               /*!< Vector length. */
-    uint8_t num_inst;           /*!< Number of instances. */
-    uint8_t num_active_inst;    /*!< Number of active instances. */
-    mpr_type type;              /*!< The type of this signal. */
+    void *mem;                  /*!< Block holding the planes below. */
+    char *samps;                /*!< Samples of every instance. */
+    mpr_time *times;            /*!< Time of each sample of every instance. */
+    char *known;                /*!< Bitflags indicating which value elements are known. */
+    mpr_value_buffer inst;      /*!< Circular buffer state for each signal instance. */
+    unsigned int size;          /*!< Number of instances the block has room for. */
+    uint16_t vlen;              /*!< Vector length. */
     uint16_t mlen;              /*!< History size of the buffer. */
+    unsigned int num_inst;      /*!< Number of instances. */
+    unsigned int num_active_inst;   /*!< Number of active instances. */
+    mpr_type type;              /*!< The type of this signal. */
 
     float period;               /*!< Estimate of the update rate of this value. */
     float jitter;               /*!< Estimate of the timing jitter of this value. */
     mpr_time t_last;
 } mpr_value_t;
 
-MPR_INLINE static int _min(int a, int b) { return a < b ? a : b; }
-
 mpr_value mpr_value_new(unsigned int vlen, mpr_type type, unsigned int mlen, unsigned int num_inst)
 {
     mpr_value v = (mpr_value) calloc(1, sizeof(mpr_value_t));
@@ -51,151 +65,142 @@ mpr_value mpr_value_new(unsigned int vlen, mpr_type type, unsigned int mlen, uns
 }
 
 void mpr_value_free(mpr_value v) {
-    int i;
-    RETURN_UNLESS(v && v->inst);
-    for (i = 0; i < v->num_inst; i++) {
-        mpr_value_buffer b = &v->inst[i];
-        FUNC_IF(free, b->samps);
-        FUNC_IF(free, b->times);
-        FUNC_IF(mpr_bitflags_free, b->known);
-    }
-    free(v->inst);
+    RETURN_UNLESS(v);
+    FUNC_IF(free, v->mem);
     free(v);
 }
 
+/* Allocate zeroed planes with room for v->size instances. */
+static void _alloc_planes(mpr_value v)
+{
+    size_t samps_size = PLANE_SIZE(v->size * HIST_SIZE(v));
+    size_t times_size = PLANE_SIZE(v->size * v->mlen * sizeof(mpr_time));
+    size_t known_size = PLANE_SIZE(v->size * KNOWN_SIZE(v));
+    size_t inst_size = v->size * sizeof(mpr_value_buffer_t);
+    char *mem;
+
+    v->mem = calloc(1, samps_size + times_size + known_size + inst_size + PLANE_ALIGN);
+    mem = (char*)(((uintptr_t)v->mem + PLANE_ALIGN - 1) & ~(uintptr_t)(PLANE_ALIGN - 1));
+    v->samps = mem;
+    v->times = (mpr_time*)(mem + samps_size);
+    v->known = mem + samps_size + times_size;
+    v->inst = (mpr_value_buffer)(v->known + known_size);
+}
+
+static void _init_inst(mpr_value v, unsigned int idx)
+{
+    mpr_value_buffer b = &v->inst[idx];
+    memset(GET_SAMPS(v, b), 0, HIST_SIZE(v));
+    memset(GET_TIMES(v, b), 0, v->mlen * sizeof(mpr_time));
+    mpr_bitflags_init(GET_KNOWN(v, b), v->vlen);
+    memset(b, 0, sizeof(mpr_value_buffer_t));
+    b->pos = -1;
+}
+
+/* Copy the most recent samples of an instance into a history of a different size, oldest first. */
+static void _copy_hist(mpr_value dst, mpr_value src, unsigned int idx)
+{
+    mpr_value_buffer sb = &src->inst[idx], db = &dst->inst[idx];
+    size_t samp_size = src->vlen * mpr_type_get_size(src->type);
+    int i, j, num = sb->full ? src->mlen : sb->pos + 1;
+
+    db->start = sb->start;
+    if (sb->pos < 0) {
+        /* no value to copy; keep the reset timestamp at idx 0 */
+        GET_TIMES(dst, db)[0] = GET_TIMES(src, sb)[0];
+        return;
+    }
+    if (num > dst->mlen)
+        num = dst->mlen;
+    for (i = 0; i < num; i++) {
+        j = (sb->pos - (num - 1 - i) + src->mlen) % src->mlen;
+        memcpy(GET_SAMPS(dst, db) + i * samp_size, GET_SAMPS(src, sb) + j * samp_size, samp_size);
+        GET_TIMES(dst, db)[i] = GET_TIMES(src, sb)[j];
+    }
+    mpr_bitflags_cpy(GET_KNOWN(dst, db), GET_KNOWN(src, sb));
+    db->pos = num - 1;
+    db->full = (num == dst->mlen);
+}
+
 void mpr_value_realloc(mpr_value v, unsigned int vlen, mpr_type type, unsigned int mlen,
                        unsigned int num_inst, int reset)
 {
-    int i, samp_size;
-    mpr_value_buffer_t *b, tmp;
+    unsigned int i, num_cpy;
+    mpr_value_t n;
     RETURN_UNLESS(v);
     if (vlen <= 0)
         vlen = v->vlen;
     if (mlen <= 0)
         mlen = v->mlen;
-    samp_size = vlen * mpr_type_get_size(type);
-
-    if (!v->inst || num_inst > v->num_inst) {
-        if (v->inst)
-            v->inst = realloc(v->inst, sizeof(mpr_value_buffer_t) * num_inst);
-        else {
-            v->inst = malloc(sizeof(mpr_value_buffer_t) * num_inst);
-            v->num_inst = 0;
-        }
-        /* initialize new instances */
-        for (i = v->num_inst; i < num_inst; i++) {
-            b = &v->inst[i];
-            b->samps = calloc(1, mlen * samp_size);
-            b->times = calloc(1, mlen * sizeof(mpr_time));
-            b->known = mpr_bitflags_new(vlen);
-            b->pos = -1;
-            b->full = 0;
-        }
-    }
+    if (vlen != v->vlen || type != v->type)
+        reset = 1;
 
-    if (reset || vlen != v->vlen || type != v->type) {
-        /* reallocate old instances (v->num_inst has not yet been updated) */
-        for (i = 0; i < v->num_inst; i++) {
-            b = &v->inst[i];
-            b->samps = realloc(b->samps, mlen * samp_size);
-            b->times = realloc(b->times, mlen * sizeof(mpr_time));
-            b->known = b->known ? mpr_bitflags_realloc(b->known, vlen) : mpr_bitflags_new(vlen);
-            /* Initialize entire value to 0 */
-            memset(b->samps, 0, mlen * samp_size);
-            memset(b->times, 0, mlen * sizeof(mpr_time));
-            mpr_bitflags_clear(b->known);
-            if (b->pos >= 0)
-                --v->num_active_inst;
-            b->pos = -1;
-            b->full = 0;
-        }
-        goto done;
+    /* values of instances that are dropped are no longer active */
+    for (i = num_inst; i < v->num_inst; i++) {
+        if (v->inst[i].pos >= 0)
+            --v->num_active_inst;
     }
 
-    if (!v->mlen || mlen == v->mlen)
-        goto done;
-
-    /* only the memory size is different */
+    if (v->mem && !reset && mlen == v->mlen && num_inst <= v->size) {
+        /* the existing block has room for all the instances */
+        for (i = v->num_inst; i < num_inst; i++)
+            _init_inst(v, i);
+        v->num_inst = num_inst;
+        return;
+    }
 
-    for (i = 0; i < v->num_inst; i++) {
-        b = &v->inst[i];
-        tmp.samps = malloc(samp_size * mlen);
-        tmp.times = malloc(sizeof(mpr_time) * mlen);
-
-        if (b->pos < 0) {
-            /* no value to copy */
-            if (b->times) {
-                /* copy reset timestamp from/to idx 0 */
-                memcpy(tmp.times, &b->times[0], sizeof(mpr_time));
-            }
-        }
-        else if (mlen > v->mlen) {
-            int offset = 0, len;
-            if (b->full) {
-                /* copy from [b->pos : v->mlen] to [0 : v->mlen - v->pos] */
-                int len = v->mlen - b->pos;
-                memcpy(tmp.samps, (char*)b->samps + b->pos * samp_size, len * samp_size);
-                memcpy(tmp.times, &b->times[b->pos], len * sizeof(mpr_time));
-                offset = len;
-            }
-
-            /* copy from [0 : v->pos] to [v->mlen - v->pos : v->mlen] */
-            memcpy((char*)tmp.samps + offset * samp_size, b->samps, (b->pos + 1) * samp_size);
-            memcpy(&tmp.times[offset], b->times, (b->pos + 1) * sizeof(mpr_time));
-
-            /* set position to end of copied memory */
-            b->pos += offset;
-
-            /* zero remainder */
-            len = mlen - b->pos - 1;
-            memset((char*)tmp.samps + (b->pos + 1) * samp_size, 0, len * samp_size);
-            memset(&tmp.times[b->pos + 1], 0, len * sizeof(mpr_time));
-            b->full = 0;
+    /* move the instances to a new block with a single allocation */
+    n = *v;
+    n.vlen = vlen;
+    n.type = type;
+    n.mlen = mlen;
+    n.size = num_inst;
+    _alloc_planes(&n);
+    for (i = 0; i < num_inst; i++)
+        _init_inst(&n, i);
+
+    num_cpy = !v->mem ? 0 : (v->num_inst < num_inst ? v->num_inst : num_inst);
+    if (reset) {
+        /* leave the values of existing instances zeroed */
+        for (i = 0; i < num_cpy; i++) {
+            if (v->inst[i].pos >= 0)
+                --n.num_active_inst;
+            n.inst[i].start = v->inst[i].start;
         }
-        else {
-            int opos = b->pos;
-            int len = _min(v->mlen - opos, mlen);
-            memcpy(tmp.samps, (char*)b->samps + opos * samp_size, len * samp_size);
-            memcpy(tmp.times, &b->times[opos], len * sizeof(mpr_time));
-            if (mlen > len) {
-                memcpy((char*)tmp.samps + len * samp_size, b->samps, (mlen - len) * samp_size);
-                memcpy(&tmp.times[len], b->times, (mlen - len) * sizeof(mpr_time));
-            }
-            b->full |= (b->pos >= mlen);
-            b->pos = len - 1;
-        }
-
-        free(b->samps);
-        free(b->times);
-        b->samps = tmp.samps;
-        b->times = tmp.times;
+    }
+    else if (mlen == v->mlen) {
+        /* only the number of instances is different */
+        memcpy(n.samps, v->samps, num_cpy * HIST_SIZE(v));
+        memcpy(n.times, v->times, num_cpy * mlen * sizeof(mpr_time));
+        memcpy(n.known, v->known, num_cpy * KNOWN_SIZE(v));
+        memcpy(n.inst, v->inst, num_cpy * sizeof(mpr_value_buffer_t));
+    }
+    else {
+        for (i = 0; i < num_cpy; i++)
+            _copy_hist(&n, v, i);
     }
 
-done:
-    v->vlen = vlen;
-    v->type = type;
-    v->mlen = mlen;
+    FUNC_IF(free, v->mem);
+    *v = n;
     v->num_inst = num_inst;
 }
 
 int mpr_value_remove_inst(mpr_value v, unsigned int idx)
 {
-    int i;
-    mpr_value_buffer_t *b;
-    RETURN_ARG_UNLESS(idx >= 0 && idx < v->num_inst, v->num_inst);
-    b = &v->inst[idx];
-    free(b->samps);
-    free(b->times);
-    FUNC_IF(mpr_bitflags_free, b->known);
-    if (b->pos >= 0)
+    size_t num;
+    RETURN_ARG_UNLESS(idx < v->num_inst, v->num_inst);
+    if (v->inst[idx].pos >= 0)
         --v->num_active_inst;
-    for (i = idx + 1; i < v->num_inst; i++) {
-        /* shift values down */
-        memcpy(&(v->inst[i-1]), &(v->inst[i]), sizeof(mpr_value_buffer_t));
-    }
+
+    /* shift values down within each plane */
+    num = v->num_inst - idx - 1;
+    memmove(GET_SAMPS(v, &v->inst[idx]), GET_SAMPS(v, &v->inst[idx + 1]), num * HIST_SIZE(v));
+    memmove(GET_TIMES(v, &v->inst[idx]), GET_TIMES(v, &v->inst[idx + 1]),
+            num * v->mlen * sizeof(mpr_time));
+    memmove(GET_KNOWN(v, &v->inst[idx]), GET_KNOWN(v, &v->inst[idx + 1]),
+            num * KNOWN_SIZE(v));
+    memmove(&v->inst[idx], &v->inst[idx + 1], num * sizeof(mpr_value_buffer_t));
     --v->num_inst;
-    assert(v->num_inst >= 0);
-    v->inst = realloc(v->inst, sizeof(mpr_value_buffer_t) * v->num_inst);
     return v->num_inst;
 }
 
@@ -204,11 +209,11 @@ void mpr_value_reset_inst(mpr_value v, unsigned int idx, mpr_time t)
     mpr_value_buffer b;
     RETURN_UNLESS(v->inst && idx < v->num_inst);
     b = &v->inst[idx];
-    memset(b->samps, 0, v->mlen * v->vlen * mpr_type_get_size(v->type));
+    memset(GET_SAMPS(v, b), 0, HIST_SIZE(v));
     /* store the reset time at idx 0 */
-    memset(b->times, 0, v->mlen * sizeof(mpr_time));
-    memcpy(b->times, &t, sizeof(mpr_time));
-    mpr_bitflags_clear(b->known);
+    memset(GET_TIMES(v, b), 0, v->mlen * sizeof(mpr_time));
+    memcpy(GET_TIMES(v, b), &t, sizeof(mpr_time));
+    mpr_bitflags_clear(GET_KNOWN(v, b));
 
     if (b->pos >= 0)
         --v->num_active_inst;
@@ -252,7 +257,7 @@ void* mpr_value_get_value(mpr_value v, unsigned int inst_idx, int hist_idx)
     RETURN_ARG_UNLESS(b->pos >= 0, NULL);
     if (idx < 0)
         idx += v->mlen;
-    return (char*)b->samps + idx * v->vlen * mpr_type_get_size(v->type);
+    return GET_SAMPS(v, b) + idx * v->vlen * mpr_type_get_size(v->type);
 }
 
 static mpr_time* mpr_value_get_time_internal(mpr_value v, unsigned int inst_idx, int hist_idx)
@@ -264,7 +269,7 @@ static mpr_time* mpr_value_get_time_internal(mpr_value v, unsigned int inst_idx,
         if (idx < 0)
             idx += v->mlen;
     }
-    return &b->times[idx];
+    return &GET_TIMES(v, b)[idx];
 }
 
 /* here we return the time at idx 0 even if the value has been reset */
@@ -287,12 +292,12 @@ int mpr_value_set_next(mpr_value v, unsigned int inst_idx, const void *s, mpr_ti
     void *mem;
     RETURN_ARG_UNLESS(s, 0);
 
-    if (mpr_bitflags_get_all(b->known)) {
+    if (mpr_bitflags_get_all(GET_KNOWN(v, b))) {
         /* we can compare to last value */
         cmp = memcmp(mpr_value_get_value(v, inst_idx, 0), s, v->vlen * mpr_type_get_size(v->type));
     }
     else {
-        mpr_bitflags_set_all(b->known);
+        mpr_bitflags_set_all(GET_KNOWN(v, b));
     }
 
     mpr_value_incr_idx(v, inst_idx, t);
@@ -313,8 +318,8 @@ void mpr_value_cpy_next(mpr_value v, unsigned int inst_idx, mpr_time t)
     if (b->pos < 0) {
         mpr_value_incr_idx(v, inst_idx, t);
     }
-    else if (mpr_bitflags_get_all(b->known)) {
-        s = (char*)b->samps + b->pos * v->vlen * mpr_type_get_size(v->type);
+    else if (mpr_bitflags_get_all(GET_KNOWN(v, b))) {
+        s = GET_SAMPS(v, b) + b->pos * v->vlen * mpr_type_get_size(v->type);
         mpr_value_set_next(v, inst_idx, s, t);
     }
 }
@@ -334,9 +339,9 @@ int mpr_value_set_element(mpr_value v, unsigned int inst_idx, int el_idx, void *
         el_idx += v->vlen;
 
     /* set bitflag indicating this element has a value */
-    mpr_bitflags_set(b->known, el_idx);
+    mpr_bitflags_set(GET_KNOWN(v, b), el_idx);
 
-    old = (char*)b->samps + b->pos * v->vlen * size;
+    old = GET_SAMPS(v, b) + b->pos * v->vlen * size;
     RETURN_ARG_UNLESS(old, 0);
 
     if (memcmp(old + el_idx * size, new, size)) {
@@ -356,21 +361,21 @@ void mpr_value_set_elements_known(mpr_value v, unsigned int inst_idx, int start,
     for (i = start; num > 0; i++, num--) {
         if (i >= vlen)
             i = 0;
-        mpr_bitflags_set(b->known, i);
+        mpr_bitflags_set(GET_KNOWN(v, b), i);
     }
 }
 
 mpr_bitflags mpr_value_get_elements_known(mpr_value v, unsigned int inst_idx)
 {
     mpr_value_buffer b = GET_BUFFER();
-    return b->known;
+    return GET_KNOWN(v, b);
 }
 
 /* TODO: use an extra 'value known' bitflag for faster comparison? */
 int mpr_value_get_has_value(mpr_value v, unsigned int inst_idx)
 {
     mpr_value_buffer b = GET_BUFFER();
-    return b->pos >= 0 && mpr_bitflags_get_all(b->known);
+    return b->pos >= 0 && mpr_bitflags_get_all(GET_KNOWN(v, b));
 }
 
 int mpr_value_set_next_coerced(mpr_value v, unsigned int inst_idx, unsigned int len,
@@ -381,7 +386,7 @@ int mpr_value_set_next_coerced(mpr_value v, unsigned int inst_idx, unsigned int
     status = mpr_set_coerced(len, type, s, v->vlen, v->type, mpr_value_get_value(v, inst_idx, 0));
     if (status >= 0) {
         mpr_value_buffer b = GET_BUFFER();
-        mpr_bitflags_set_all(b->known);
+        mpr_bitflags_set_all(GET_KNOWN(v, b));
         memcpy(mpr_value_get_time_internal(v, inst_idx, 0), &t, sizeof(mpr_time));
     }
     return status;
@@ -393,7 +398,7 @@ void mpr_value_set_time(mpr_value v, mpr_time t, unsigned int inst_idx, int hist
     int idx = (b->pos + v->mlen + hist_idx) % v->mlen;
     if (idx < 0)
         idx += v->mlen;
-    memcpy(&b->times[idx], &t, sizeof(mpr_time));
+    memcpy(&GET_TIMES(v, b)[idx], &t, sizeof(mpr_time));
     if (0 == hist_idx)
         update_timing_stats(v, t);
 }
@@ -409,9 +414,9 @@ void mpr_value_incr_idx(mpr_value v, unsigned int inst_idx, mpr_time t)
     mpr_value_buffer b = GET_BUFFER();
     if (b->pos < 0) {
         ++v->num_active_inst;
-        b->start = b->times[0] = t;
+        b->start = GET_TIMES(v, b)[0] = t;
     }
-    else if (!mpr_bitflags_get_all(b->known)) {
+    else if (!mpr_bitflags_get_all(GET_KNOWN(v, b))) {
         /* don't advance position until all vector elements are known */
         return;
     }
@@ -464,16 +469,18 @@ void mpr_value_add_to_msg(mpr_value v, unsigned int inst_idx, lo_message msg)
 {
     /* value of vector elements can be <type> or NULL */
     mpr_value_buffer b = GET_BUFFER();
+    mpr_bitflags known;
     void *val;
     RETURN_UNLESS(b->pos >= 0);
-    val = (char*)b->samps + b->pos * v->vlen * mpr_type_get_size(v->type);
+    val = GET_SAMPS(v, b) + b->pos * v->vlen * mpr_type_get_size(v->type);
+    known = GET_KNOWN(v, b);
 
     switch (v->type) {
 #define TYPED_CASE(MTYPE, TYPE, CAST)                               \
         case MTYPE: {                                               \
             int i;                                                  \
             for (i = 0; i < v->vlen; i++) {                         \
-                if (mpr_bitflags_get(b->known, i))                  \
+                if (mpr_bitflags_get(known, i))                     \
                     lo_message_add_##TYPE(msg, ((CAST*)val)[i]);    \
                 else                                                \
                     lo_message_add_nil(msg);                        \
@@ -524,9 +531,9 @@ static void _value_print(mpr_value v, unsigned int inst_idx, int hist_idx) {
     }
 
     if (v->vlen > 1)
-        printf("\b\b] @%p -> %p\n", v->inst[inst_idx].samps, s);
+        printf("\b\b] @%p -> %p\n", GET_SAMPS(v, &v->inst[inst_idx]), s);
     else
-        printf("\b\b @%p -> %p\n", v->inst[inst_idx].samps, s);
+        printf("\b\b @%p -> %p\n", GET_SAMPS(v, &v->inst[inst_idx]), s);
 }
 
 int mpr_value_print_inst(mpr_value v, unsigned int inst_idx) {
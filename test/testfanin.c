@@ -0,0 +1,293 @@
+#include <mapper/mapper.h>
+#include "../src/mpr_time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include <lo/lo.h>
+#ifdef WIN32
+#include <io.h>
+#else
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+#include <signal.h>
+
+/* Benchmark for receiving updates from many remote devices. A number of source devices are each
+ * mapped to a different input signal of a single aggregating destination device, every source is
+ * updated on each round, and the rate at which the destination receives updates is reported with
+ * batched network I/O disabled and enabled. Shared memory is disabled so that all updates are
+ * sent over the network. Each source uses its own graph, as if it were running in a separate
+ * process. */
+
+#define MAX_SRCS 128
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+
+int num_srcs = 40;
+int iterations = 500;
+int use_epoll = 0;
+
+mpr_dev srcs[MAX_SRCS];
+mpr_dev dst = 0;
+mpr_sig sendsigs[MAX_SRCS];
+mpr_sig recvsigs[MAX_SRCS];
+
+int expected = 0;
+int received = 0;
+int mismatched = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (!value)
+        return;
+    ++received;
+    if (*(const int*)value != expected)
+        ++mismatched;
+}
+
+int setup_devs(const char *iface)
+{
+    char name[32];
+    int i;
+
+    dst = mpr_dev_new("testfanin-recv", 0);
+    if (!dst)
+        return 1;
+    if (iface)
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    mpr_dev_set_use_shm(dst, 0);
+    if (use_epoll && mpr_graph_set_use_epoll(mpr_obj_get_graph((mpr_obj)dst), 1))
+        return 1;
+
+    for (i = 0; i < num_srcs; i++) {
+        if (!(srcs[i] = mpr_dev_new("testfanin-send", 0)))
+            return 1;
+        if (iface)
+            mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)srcs[i]), iface);
+        mpr_dev_set_use_shm(srcs[i], 0);
+        if (use_epoll && mpr_graph_set_use_epoll(mpr_obj_get_graph((mpr_obj)srcs[i]), 1))
+            return 1;
+        sendsigs[i] = mpr_sig_new(srcs[i], MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL,
+                                  NULL, NULL, NULL, NULL, 0);
+        snprintf(name, 32, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_INT32, NULL,
+                                  NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+        if (!sendsigs[i] || !recvsigs[i])
+            return 1;
+    }
+    eprintf("Created %d source devices.\n", num_srcs);
+    return 0;
+}
+
+void cleanup_devs(void)
+{
+    int i;
+    eprintf("Freeing devices... ");
+    fflush(stdout);
+    for (i = 0; i < num_srcs; i++) {
+        if (srcs[i])
+            mpr_dev_free(srcs[i]);
+    }
+    if (dst)
+        mpr_dev_free(dst);
+    eprintf("ok\n");
+}
+
+void poll_all(int block_ms)
+{
+    int i;
+    /* drain the sources' sockets since every graph receives all of the bus traffic */
+    for (i = 0; i < num_srcs; i++)
+        mpr_dev_poll(srcs[i], -1);
+    mpr_dev_poll(dst, block_ms);
+}
+
+/* Enable or disable batched I/O for the graphs of all devices. */
+int set_use_batch_io(int use)
+{
+    int i, result = mpr_graph_set_use_batch_io(mpr_obj_get_graph((mpr_obj)dst), use);
+    for (i = 0; i < num_srcs && !result; i++)
+        result = mpr_graph_set_use_batch_io(mpr_obj_get_graph((mpr_obj)srcs[i]), use);
+    return result;
+}
+
+int wait_ready(void)
+{
+    int i, ready = 0;
+    while (!done && !ready) {
+        poll_all(25);
+        ready = mpr_dev_get_is_ready(dst);
+        for (i = 0; i < num_srcs && ready; i++)
+            ready = mpr_dev_get_is_ready(srcs[i]);
+    }
+    return done;
+}
+
+int map_sigs(void)
+{
+    int i, ready = 0;
+    mpr_map maps[MAX_SRCS];
+
+    eprintf("Creating %d maps... ", num_srcs);
+    fflush(stdout);
+    for (i = 0; i < num_srcs; i++) {
+        maps[i] = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+        mpr_obj_push((mpr_obj)maps[i]);
+    }
+
+    /* wait until all maps have been established */
+    while (!done && !ready) {
+        poll_all(10);
+        ready = 1;
+        for (i = 0; i < num_srcs && ready; i++)
+            ready = mpr_map_get_is_ready(maps[i]);
+    }
+    eprintf("ok\n");
+    return done;
+}
+
+/* Update every source once per round and wait for the destination to receive the updates.
+ * Returns the elapsed time, or a negative value if updates went missing. */
+double run_trial(void)
+{
+    int i, j;
+    double then, timeout;
+
+    received = 0;
+    then = mpr_get_current_time();
+    for (i = 0; i < iterations && !done; i++) {
+        expected = i;
+        for (j = 0; j < num_srcs; j++) {
+            mpr_sig_set_value(sendsigs[j], 0, 1, MPR_INT32, &i);
+            mpr_dev_update_maps(srcs[j]);
+        }
+        timeout = mpr_get_current_time() + 1.0;
+        while (received < (i + 1) * num_srcs && mpr_get_current_time() < timeout)
+            mpr_dev_poll(dst, -1);
+        if (received < (i + 1) * num_srcs) {
+            eprintf("  timed out waiting for round %d\n", i);
+            return -1;
+        }
+    }
+    return mpr_get_current_time() - then;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testfanin.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--sources <int> (default %d), "
+                               "--iterations <int> (default %d), "
+                               "--epoll use event-driven polling, "
+                               "--iface network interface\n",
+                               num_srcs, iterations);
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--sources") == 0 && argc > i + 1) {
+                            ++i;
+                            num_srcs = atoi(argv[i]);
+                            if (num_srcs < 1)
+                                num_srcs = 1;
+                            else if (num_srcs > MAX_SRCS)
+                                num_srcs = MAX_SRCS;
+                        }
+                        else if (strcmp(argv[i], "--iterations") == 0 && argc > i + 1) {
+                            ++i;
+                            iterations = atoi(argv[i]);
+                        }
+                        else if (strcmp(argv[i], "--epoll") == 0)
+                            use_epoll = 1;
+                        else if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            ++i;
+                            iface = argv[i];
+                        }
+                        j = len;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (wait_ready() || map_sigs()) {
+        eprintf("Device or map setup aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    eprintf("Sending %d rounds of updates from %d sources\n", iterations, num_srcs);
+    eprintf("  batched    seconds    updates/s\n");
+    for (i = 0; i < 2 && !done; i++) {
+        double elapsed;
+        if (set_use_batch_io(i)) {
+            eprintf("  batched I/O is not supported on this platform\n");
+            break;
+        }
+        if ((elapsed = run_trial()) < 0) {
+            result = 1;
+            break;
+        }
+        eprintf("  %7s  %9.3f  %11.0f\n", i ? "yes" : "no", elapsed, received / elapsed);
+    }
+    if (mismatched) {
+        eprintf("%d updates did not match the expected value.\n", mismatched);
+        result = 1;
+    }
+
+    while (!terminate && !done)
+        poll_all(100);
+
+  done:
+    cleanup_devs();
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -329,7 +329,8 @@ void handler(mpr_sig sig, mpr_sig_evt e, mpr_id inst, int len, mpr_type type,
 int setup_dst(mpr_graph g, const char *iface)
 {
     float mn=0;
-    int i, num_inst;
+    int num_inst;
+    mpr_id ids[4] = {2, 4, 6, 8};
 
     dst = mpr_dev_new("testinstance-recv", g);
     if (!dst)
@@ -349,9 +350,7 @@ int setup_dst(mpr_graph g, const char *iface)
     if (!multirecv || !monorecv)
         goto error;
 
-    for (i = 2; i < 10; i += 2) {
-        mpr_sig_reserve_inst(multirecv, 1, (mpr_id*)&i, 0);
-    }
+    mpr_sig_reserve_inst(multirecv, 4, ids, 0);
 
     eprintf("Input signal added with %i instances.\n",
             mpr_sig_get_num_inst(multirecv, MPR_STATUS_ANY));
@@ -618,6 +617,37 @@ void ctrlc(int sig)
     done = 1;
 }
 
+/* Reserving instances with repeated ids should keep the first of each, including when the
+ * records of removed instances are reused. */
+int test_reserve_repeated_ids(void)
+{
+    int i, num_inst = 0, data[3], result = 0;
+    mpr_id ids[4] = {10, 11, 12, 13}, repeated[3] = {20, 20, 21};
+    void *data_ptrs[3] = {&data[0], &data[1], &data[2]};
+    mpr_sig sig = mpr_sig_new(dst, MPR_DIR_IN, "reserve", 1, MPR_FLT, NULL,
+                              NULL, NULL, &num_inst, NULL, 0);
+    if (!sig)
+        return 1;
+
+    mpr_sig_reserve_inst(sig, 4, ids, 0);
+    for (i = 1; i < 3; i++)
+        mpr_sig_remove_inst(sig, ids[i]);
+
+    i = mpr_sig_reserve_inst(sig, 3, repeated, data_ptrs);
+    eprintf("Reserved %d instances with repeated ids, expected 2.\n", i);
+    if (i != 2 || mpr_sig_get_num_inst(sig, MPR_STATUS_ANY) != 4) {
+        eprintf("Error: unexpected number of instances after reserving repeated ids.\n");
+        result = 1;
+    }
+    else if (mpr_sig_get_inst_data(sig, 20) != &data[0]
+             || mpr_sig_get_inst_data(sig, 21) != &data[2]) {
+        eprintf("Error: reserving repeated ids did not keep the first of each.\n");
+        result = 1;
+    }
+    mpr_sig_free(sig);
+    return result;
+}
+
 int run_test(test_config *config)
 {
     mpr_sig srcs[2], *dst_ptr;
@@ -926,6 +956,11 @@ int main(int argc, char **argv)
         goto done;
     }
 
+    if (test_reserve_repeated_ids()) {
+        result = 1;
+        goto done;
+    }
+
     eprintf("Key:\n");
     eprintf("  *\t denotes processing location\n");
     eprintf("  ––>\t singleton (non-instanced) map\n");
@@ -305,7 +305,8 @@ void cleanup_src(void)
 int setup_dst(mpr_graph g, const char *iface)
 {
     float mn=0;
-    int i, num_inst;
+    int num_inst;
+    mpr_id ids[4] = {2, 4, 6, 8};
 
     dst = mpr_dev_new("testinstance_no_cb-recv", g);
     if (!dst)
@@ -326,9 +327,7 @@ int setup_dst(mpr_graph g, const char *iface)
     if (!multirecv || !monorecv)
         goto error;
 
-    for (i = 2; i < 10; i += 2) {
-        mpr_sig_reserve_inst(multirecv, 1, (mpr_id*)&i, 0);
-    }
+    mpr_sig_reserve_inst(multirecv, 4, ids, 0);
 
     eprintf("Input signal added with %i instances.\n",
             mpr_sig_get_num_inst(multirecv, MPR_STATUS_ANY));
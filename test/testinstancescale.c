@@ -0,0 +1,266 @@
+#include <mapper/mapper.h>
+#include "../src/mpr_time.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+
+/* Test updating signals with many instances. Instanced signals of increasing size are mapped
+ * together and every instance is activated before timing updates of randomly chosen instances.
+ * The cost of an update should not grow with the number of instances, but since timings depend on
+ * the machine the ratio is only checked when benchmarking with the -b flag. */
+
+#define NUM_SIZES 3
+#define BATCH_SIZE 16
+#define MAX_SLOWDOWN 8
+
+int verbose = 1;
+int terminate = 0;
+int benchmark = 0;
+int done = 0;
+char *iface = 0;
+
+int sizes[NUM_SIZES] = {16, 256, 16384};
+int num_batches = 200;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+
+int *expected = 0;
+int num_inst = 0;
+int received = 0;
+int matched = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length, mpr_type type,
+             const void *value, mpr_time t)
+{
+    if (!value)
+        return;
+    ++received;
+    if (inst >= 0 && inst < num_inst && *(int*)value == expected[inst])
+        ++matched;
+    else
+        eprintf("error: unexpected value for instance %d\n", (int)inst);
+}
+
+int setup_devs(void)
+{
+    src = mpr_dev_new("testinstancescale-send", 0);
+    dst = mpr_dev_new("testinstancescale-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
+
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    return done;
+}
+
+void cleanup_devs(void)
+{
+    if (!src && !dst)
+        return;
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+    src = dst = 0;
+    eprintf("ok\n");
+}
+
+int setup_sigs(int size)
+{
+    mpr_map map;
+    char name[32];
+    double elapsed = mpr_get_current_time();
+
+    snprintf(name, 32, "outsig%d", size);
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, name, 1, MPR_INT32, NULL, NULL, NULL, &size, NULL, 0);
+    snprintf(name, 32, "insig%d", size);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_INT32, NULL, NULL, NULL, &size,
+                          handler, MPR_SIG_UPDATE);
+    if (!sendsig || !recvsig)
+        return 1;
+    eprintf("  reserved instances in %g seconds.\n", mpr_get_current_time() - elapsed);
+
+    map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map)) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+    return done;
+}
+
+/* Send the current expected value of some instances and wait until they have all arrived. */
+int send_and_wait(int *ids, int num)
+{
+    int i, target = received + num;
+    double timeout = mpr_get_current_time() + 2;
+    for (i = 0; i < num; i++)
+        mpr_sig_set_value(sendsig, ids[i], 1, MPR_INT32, &expected[ids[i]]);
+    mpr_dev_update_maps(src);
+    while (!done && received < target) {
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 1);
+        if (mpr_get_current_time() > timeout) {
+            eprintf("Timed out waiting for updates: received %d of %d.\n",
+                    num - (target - received), num);
+            return 1;
+        }
+    }
+    return done;
+}
+
+/* Returns the average time taken per update in seconds, or a negative value on error. Each size
+ * uses new devices so that earlier instances do not affect the result. */
+double run_size(int size)
+{
+    int i, j, ids[BATCH_SIZE];
+    double elapsed;
+
+    eprintf("Testing signals with %d instances.\n", size);
+    num_inst = size;
+    expected = realloc(expected, sizeof(int) * size);
+    received = matched = 0;
+    if (setup_devs() || setup_sigs(size))
+        return -1;
+
+    /* activate every instance so that updates are made in a fully populated store */
+    for (i = 0; i < size; i += BATCH_SIZE) {
+        for (j = 0; j < BATCH_SIZE && i + j < size; j++) {
+            ids[j] = i + j;
+            expected[i + j] = rand();
+        }
+        if (send_and_wait(ids, j))
+            return -1;
+    }
+    eprintf("  activated %d instances at destination.\n",
+            mpr_sig_get_num_inst(recvsig, MPR_STATUS_ACTIVE));
+
+    /* update runs of instances starting at random positions so that the ids in a batch differ */
+    elapsed = mpr_get_current_time();
+    for (i = 0; i < num_batches; i++) {
+        int start = rand();
+        for (j = 0; j < BATCH_SIZE; j++) {
+            ids[j] = (start + j) % size;
+            expected[ids[j]] = rand();
+        }
+        if (send_and_wait(ids, BATCH_SIZE))
+            return -1;
+    }
+    elapsed = (mpr_get_current_time() - elapsed) / (num_batches * BATCH_SIZE);
+    eprintf("  %d updates averaged %g microseconds each.\n",
+            num_batches * BATCH_SIZE, elapsed * 1000000);
+    if (matched != received) {
+        eprintf("  matched only %d of %d received values.\n", matched, received);
+        return -1;
+    }
+    cleanup_devs();
+    return elapsed;
+}
+
+int loop(void)
+{
+    int i;
+    double times[NUM_SIZES];
+    for (i = 0; i < NUM_SIZES; i++) {
+        if ((times[i] = run_size(sizes[i])) < 0)
+            return 1;
+    }
+    eprintf("Update cost with %d instances is %g times that with %d instances.\n",
+            sizes[NUM_SIZES - 1], times[NUM_SIZES - 1] / times[0], sizes[0]);
+    return benchmark && times[NUM_SIZES - 1] > times[0] * MAX_SLOWDOWN;
+}
+
+void segv(int sig)
+{
+    printf("\x1B[31m(SEGV)\n\x1B[0m");
+    exit(1);
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testinstancescale.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-f fast (execute quickly), "
+                               "-b benchmark (fail if updates slow down with more instances), "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case 'f':
+                        num_batches = 50;
+                        break;
+                    case 'b':
+                        benchmark = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            i++;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGSEGV, segv);
+    signal(SIGINT, ctrlc);
+
+    result = loop();
+
+    cleanup_devs();
+    if (expected)
+        free(expected);
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,320 @@
+#include <mapper/mapper.h>
+#include "../src/mpr_time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+
+#include <lo/lo.h>
+#ifdef WIN32
+#include <io.h>
+#else
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+#include <signal.h>
+
+/* Benchmark for parallel evaluation of outgoing maps. A source device with many output signals
+ * is mapped one-to-one to a destination device using a moderately expensive vector expression,
+ * and the time taken to process all updated maps is reported for a range of worker pool sizes.
+ * The values received by the destination are checked against a reference computed in C. */
+
+#define MAX_SIGS 1024
+#define VEC_LEN 32
+#define MAX_STAGED_MAPS 32
+
+int verbose = 1;
+int terminate = 0;
+int shared_graph = 0;
+int done = 0;
+
+int num_sigs = 256;
+int iterations = 200;
+int max_workers = 4;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsigs[MAX_SIGS];
+mpr_sig recvsigs[MAX_SIGS];
+
+const char *expr = "y=sin(x)*cos(x*0.5)+sqrt(x+1)*exp(-x*x*0.01);";
+
+float values[VEC_LEN];
+int received = 0;
+int mismatched = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static float reference(float x)
+{
+    return sinf(x) * cosf(x * 0.5f) + sqrtf(x + 1) * expf(-x * x * 0.01f);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    int i;
+    const float *fvalue = (const float*)value;
+    if (!value || length != VEC_LEN)
+        return;
+    ++received;
+    for (i = 0; i < VEC_LEN; i++) {
+        if (fabsf(fvalue[i] - reference(values[i])) > 1e-4f * (1 + fabsf(fvalue[i]))) {
+            ++mismatched;
+            eprintf("  mismatch at element %d: got %g, expected %g\n", i, fvalue[i],
+                    reference(values[i]));
+            break;
+        }
+    }
+}
+
+int setup_devs(const char *iface)
+{
+    char name[32];
+    int i;
+    mpr_graph g = shared_graph ? mpr_graph_new(0) : 0;
+    if (g && iface)
+        mpr_graph_set_interface(g, iface);
+
+    src = mpr_dev_new("testmapworkers-send", g);
+    dst = mpr_dev_new("testmapworkers-recv", g);
+    if (!src || !dst)
+        return 1;
+    if (!g && iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+
+    for (i = 0; i < num_sigs; i++) {
+        snprintf(name, 32, "outsig%d", i);
+        sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, VEC_LEN, MPR_FLT, NULL,
+                                  NULL, NULL, NULL, NULL, 0);
+        snprintf(name, 32, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, VEC_LEN, MPR_FLT, NULL,
+                                  NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+        if (!sendsigs[i] || !recvsigs[i])
+            return 1;
+    }
+    eprintf("Created %d output and input signals.\n", num_sigs);
+    return 0;
+}
+
+void cleanup_devs(void)
+{
+    mpr_graph g = src && shared_graph ? mpr_obj_get_graph((mpr_obj)src) : 0;
+    if (src) {
+        eprintf("Freeing source... ");
+        fflush(stdout);
+        mpr_dev_free(src);
+        eprintf("ok\n");
+    }
+    if (dst) {
+        eprintf("Freeing destination... ");
+        fflush(stdout);
+        mpr_dev_free(dst);
+        eprintf("ok\n");
+    }
+    if (g)
+        mpr_graph_free(g);
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    return done;
+}
+
+/* Create maps for output signals that are not mapped yet. Only a limited number of maps are
+ * staged at once to avoid overflowing the bundles used to push them. Returns the number of maps
+ * that are ready. */
+int push_maps(void)
+{
+    int i, ready = 0, staged = 0;
+    for (i = 0; i < num_sigs; i++) {
+        mpr_list l = mpr_sig_get_maps(sendsigs[i], MPR_DIR_OUT);
+        if (l) {
+            if (mpr_map_get_is_ready((mpr_map)*l))
+                ++ready;
+            else
+                ++staged;
+            mpr_list_free(l);
+        }
+        else if (staged < MAX_STAGED_MAPS) {
+            mpr_map map = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+            mpr_obj_set_prop((mpr_obj)map, MPR_PROP_EXPR, NULL, 1, MPR_STR, expr, 1);
+            mpr_obj_push((mpr_obj)map);
+            ++staged;
+        }
+    }
+    return ready;
+}
+
+int map_sigs(void)
+{
+    eprintf("Creating %d maps... ", num_sigs);
+    fflush(stdout);
+
+    /* wait until all maps have been established */
+    while (!done && push_maps() < num_sigs) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+    eprintf("ok\n");
+    return done;
+}
+
+/* Update every output signal and time how long the source device takes to process its maps. */
+double run_trial(int num_workers)
+{
+    int i, j;
+    double then, elapsed = 0;
+
+    if (mpr_dev_set_num_map_workers(src, num_workers)) {
+        eprintf("failed to start %d map workers\n", num_workers);
+        return -1;
+    }
+    received = 0;
+    for (i = 0; i < iterations && !done; i++) {
+        for (j = 0; j < VEC_LEN; j++)
+            values[j] = (float)((i + j) % 23) * 0.25f;
+        for (j = 0; j < num_sigs; j++)
+            mpr_sig_set_value(sendsigs[j], 0, VEC_LEN, MPR_FLT, values);
+
+        then = mpr_get_current_time();
+        mpr_dev_update_maps(src);
+        elapsed += mpr_get_current_time() - then;
+
+        /* drain the destination so that the handler can check values for this iteration */
+        while (mpr_dev_poll(dst, 0)) {}
+    }
+    return elapsed;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+    double base_time = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testmapworkers.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-s shared (use one mpr_graph only), "
+                               "-h help, "
+                               "--signals <int> (default %d), "
+                               "--workers <int> maximum number of workers (default %d), "
+                               "--iterations <int> (default %d), "
+                               "--iface network interface\n",
+                               num_sigs, max_workers, iterations);
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case 's':
+                        shared_graph = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--signals") == 0 && argc > i + 1) {
+                            ++i;
+                            num_sigs = atoi(argv[i]);
+                            if (num_sigs < 1)
+                                num_sigs = 1;
+                            else if (num_sigs > MAX_SIGS)
+                                num_sigs = MAX_SIGS;
+                        }
+                        else if (strcmp(argv[i], "--workers") == 0 && argc > i + 1) {
+                            ++i;
+                            max_workers = atoi(argv[i]);
+                        }
+                        else if (strcmp(argv[i], "--iterations") == 0 && argc > i + 1) {
+                            ++i;
+                            iterations = atoi(argv[i]);
+                        }
+                        else if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            ++i;
+                            iface = argv[i];
+                        }
+                        j = len;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (wait_ready() || map_sigs()) {
+        eprintf("Device or map setup aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    eprintf("Evaluating '%s' on %d maps of length %d (%d iterations)\n", expr, num_sigs, VEC_LEN,
+            iterations);
+    eprintf("  workers    us/update    speedup\n");
+    for (i = 0; i <= max_workers && !done; i++) {
+        double elapsed = run_trial(i);
+        if (elapsed < 0) {
+            result = 1;
+            break;
+        }
+        if (!i)
+            base_time = elapsed;
+        eprintf("  %7d  %11.1f  %9.2f\n", i, elapsed / iterations * 1e6, base_time / elapsed);
+        if (received < num_sigs) {
+            eprintf("  only received %d of %d updates\n", received, num_sigs * iterations);
+            result = 1;
+        }
+    }
+    if (mismatched) {
+        eprintf("%d updates did not match the reference.\n", mismatched);
+        result = 1;
+    }
+
+    while (!terminate && !done) {
+        mpr_dev_poll(src, 100);
+        mpr_dev_poll(dst, 100);
+    }
+
+  done:
+    cleanup_devs();
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
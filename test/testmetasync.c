@@ -0,0 +1,269 @@
+#include <mapper/mapper.h>
+#include "../src/mpr_time.h"
+#include <lo/lo.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+
+/* Test bringing subscribers up to date with signal metadata. A subscriber that only reports a
+ * version of the device with "@version", as older graphs do, should receive every signal. A
+ * subscriber that asks for the changes since a version with "@since" should only receive the
+ * signals that have changed since, and a budget for metadata should spread the signals sent to a
+ * new subscriber over time. */
+
+#define NUM_SIGS 64
+#define NUM_CHANGED 5
+#define BUDGET 8000
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+
+mpr_dev dev = 0;
+mpr_sig sigs[NUM_SIGS];
+lo_server server = 0;
+lo_address bus_addr = 0;
+
+int received = 0;
+int seen[NUM_SIGS];
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static int handler(const char *path, const char *types, lo_arg **av, int ac, lo_message msg,
+                   void *user)
+{
+    /* count each signal once since changed signals are also sent to every subscriber */
+    const char *name;
+    int idx;
+    if (strcmp(path, "/signal") || !ac || 's' != types[0] || !(name = strstr(&av[0]->s, "/sig")))
+        return 0;
+    idx = atoi(name + 4);
+    if (idx >= 0 && idx < NUM_SIGS && !seen[idx]) {
+        seen[idx] = 1;
+        ++received;
+    }
+    return 0;
+}
+
+int setup_dev(const char *iface)
+{
+    int i, mn = 0, mx = 1;
+    char name[32];
+    lo_server_config config = {sizeof(lo_server_config), NULL, NULL, NULL, NULL, LO_UDP};
+
+    dev = mpr_dev_new("testmetasync", 0);
+    if (!dev)
+        return 1;
+    if (iface)
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dev), iface);
+    eprintf("device created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)dev)));
+
+    for (i = 0; i < NUM_SIGS; i++) {
+        snprintf(name, 32, "sig%d", i);
+        if (!(sigs[i] = mpr_sig_new(dev, MPR_DIR_OUT, name, 1, MPR_INT32, NULL,
+                                    &mn, &mx, NULL, NULL, 0)))
+            return 1;
+    }
+
+    while (!done && !mpr_dev_get_is_ready(dev))
+        mpr_dev_poll(dev, 25);
+    if (done)
+        return 1;
+
+    /* subscribe from a plain OSC server so that the signal messages can be counted */
+    if (!(server = lo_server_new_from_config(&config)))
+        return 1;
+    lo_server_add_method(server, NULL, NULL, handler, 0);
+    /* administrative messages are sent to devices over the multicast bus */
+    if (!(bus_addr = lo_address_new("224.0.1.3", "7570")))
+        return 1;
+    lo_address_set_ttl(bus_addr, 1);
+    return 0;
+}
+
+void cleanup_dev(void)
+{
+    eprintf("Freeing device.. ");
+    fflush(stdout);
+    if (bus_addr)
+        lo_address_free(bus_addr);
+    if (server)
+        lo_server_free(server);
+    if (dev)
+        mpr_dev_free(dev);
+    eprintf("ok\n");
+}
+
+/* Subscribe to the device's signals, adding a version argument if key is not null. */
+void subscribe(int lease, const char *key, int version)
+{
+    char path[256];
+    const char *name = mpr_obj_get_prop_as_str((mpr_obj)dev, MPR_PROP_NAME, NULL);
+    lo_message msg = lo_message_new();
+    snprintf(path, 256, "/%s/subscribe", name);
+    lo_message_add_string(msg, "signals");
+    lo_message_add_string(msg, "@lease");
+    lo_message_add_int32(msg, lease);
+    if (key) {
+        lo_message_add_string(msg, key);
+        lo_message_add_int32(msg, version);
+    }
+    lo_send_message_from(bus_addr, server, path, msg);
+    lo_message_free(msg);
+}
+
+void poll_for(double sec)
+{
+    int recvd;
+    double end = mpr_get_current_time() + sec;
+    while (!done && mpr_get_current_time() < end) {
+        mpr_dev_poll(dev, 10);
+        lo_servers_recv_noblock(&server, &recvd, 1, 0);
+    }
+}
+
+int sync_and_count(const char *key, int version, double sec, int expected)
+{
+    received = 0;
+    memset(seen, 0, sizeof(seen));
+    subscribe(60, key, version);
+    poll_for(sec);
+    eprintf("Subscribing with %s %d: received %d signals, expected %d.\n",
+            key ? key : "no version", version, received, expected);
+
+    /* end the subscription so that the next one starts afresh */
+    subscribe(0, NULL, 0);
+    poll_for(0.1);
+    return received != expected;
+}
+
+int loop(void)
+{
+    int i, value, version;
+    double start;
+
+    /* a subscriber that has not seen the device should receive every signal */
+    if (sync_and_count(NULL, 0, 0.5, NUM_SIGS))
+        return 1;
+
+    /* change the device so that the signals created earlier belong to an older version */
+    value = 1;
+    mpr_obj_set_prop((mpr_obj)dev, MPR_PROP_EXTRA, "foo", 1, MPR_INT32, &value, 1);
+    mpr_obj_push((mpr_obj)dev);
+    poll_for(0.1);
+    version = mpr_obj_get_prop_as_int32((mpr_obj)dev, MPR_PROP_VERSION, NULL);
+
+    for (i = 0; i < NUM_CHANGED; i++) {
+        mpr_obj_set_prop((mpr_obj)sigs[i * 7], MPR_PROP_EXTRA, "foo", 1, MPR_INT32, &i, 1);
+        mpr_obj_push((mpr_obj)sigs[i * 7]);
+    }
+    poll_for(0.1);
+
+    /* reporting the current version with "@version" alone should still bring a full sync */
+    if (sync_and_count("@version",
+                       mpr_obj_get_prop_as_int32((mpr_obj)dev, MPR_PROP_VERSION, NULL),
+                       0.5, NUM_SIGS))
+        return 1;
+
+    /* a subscriber that has seen this version should only receive the changed signals */
+    if (sync_and_count("@since", version, 0.5, NUM_CHANGED))
+        return 1;
+
+    /* with a budget the signals should arrive over time */
+    mpr_dev_set_meta_budget(dev, BUDGET);
+    received = 0;
+    memset(seen, 0, sizeof(seen));
+    start = mpr_get_current_time();
+    subscribe(60, NULL, 0);
+    poll_for(0.1);
+    eprintf("Received %d signals within 0.1 seconds using a budget of %d bytes/sec.\n",
+            received, BUDGET);
+    if (received >= NUM_SIGS) {
+        eprintf("Error: the budget did not limit sending.\n");
+        return 1;
+    }
+    while (!done && received < NUM_SIGS && mpr_get_current_time() - start < 10)
+        poll_for(0.1);
+    eprintf("Received %d signals in %g seconds.\n", received, mpr_get_current_time() - start);
+    subscribe(0, NULL, 0);
+    return received != NUM_SIGS;
+}
+
+void segv(int sig)
+{
+    printf("\x1B[31m(SEGV)\n\x1B[0m");
+    exit(1);
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testmetasync.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            i++;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGSEGV, segv);
+    signal(SIGINT, ctrlc);
+
+    if (setup_dev(iface)) {
+        eprintf("Error initializing device.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = loop();
+
+  done:
+    cleanup_dev();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
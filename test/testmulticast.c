@@ -0,0 +1,266 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+
+/* Test sending the updates of a source signal mapped to several remote destinations through a
+ * multicast group. Every destination should receive each update once, while the source device
+ * should not send a separate copy through each of its links. */
+
+#define NUM_DSTS 3
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 200;
+const char *group = "224.0.1.4";
+int port = 7571;
+
+mpr_dev src = 0;
+mpr_dev dsts[NUM_DSTS];
+mpr_sig sendsig = 0;
+mpr_sig recvsigs[NUM_DSTS];
+
+int sent = 0;
+int received[NUM_DSTS];
+int last_value[NUM_DSTS];
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    int i;
+    if (!value)
+        return;
+    for (i = 0; i < NUM_DSTS; i++) {
+        if (sig == recvsigs[i])
+            break;
+    }
+    if (i == NUM_DSTS)
+        return;
+    eprintf("handler %d: Got %d\n", i, *(int*)value);
+    last_value[i] = *(int*)value;
+    ++received[i];
+}
+
+int setup_devs(const char *iface)
+{
+    int i, mn = 0, mx = 1000;
+
+    src = mpr_dev_new("testmulticast-send", 0);
+    if (!src)
+        return 1;
+    if (iface)
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL,
+                          &mn, &mx, NULL, NULL, 0);
+    if (!sendsig || mpr_sig_set_multicast(sendsig, group, port))
+        return 1;
+
+    for (i = 0; i < NUM_DSTS; i++) {
+        dsts[i] = mpr_dev_new("testmulticast-recv", 0);
+        if (!dsts[i])
+            return 1;
+        if (iface)
+            mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dsts[i]), iface);
+        recvsigs[i] = mpr_sig_new(dsts[i], MPR_DIR_IN, "insig", 1, MPR_INT32, NULL,
+                                  &mn, &mx, NULL, handler, MPR_SIG_UPDATE);
+        if (!recvsigs[i])
+            return 1;
+        last_value[i] = -1;
+    }
+    return 0;
+}
+
+void cleanup_devs(void)
+{
+    int i;
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    if (src)
+        mpr_dev_free(src);
+    for (i = 0; i < NUM_DSTS; i++) {
+        if (dsts[i])
+            mpr_dev_free(dsts[i]);
+    }
+    eprintf("ok\n");
+}
+
+void poll_devs(int block_ms)
+{
+    int i;
+    mpr_dev_poll(src, block_ms);
+    for (i = 0; i < NUM_DSTS; i++)
+        mpr_dev_poll(dsts[i], 0);
+}
+
+int wait_ready(void)
+{
+    int i, ready = 0;
+    while (!done && !ready) {
+        poll_devs(25);
+        ready = mpr_dev_get_is_ready(src);
+        for (i = 0; i < NUM_DSTS; i++)
+            ready = ready && mpr_dev_get_is_ready(dsts[i]);
+    }
+    return done;
+}
+
+int setup_maps(void)
+{
+    int i, ready = 0, loc = MPR_LOC_DST;
+    mpr_map maps[NUM_DSTS];
+
+    for (i = 0; i < NUM_DSTS; i++) {
+        maps[i] = mpr_map_new(1, &sendsig, 1, &recvsigs[i]);
+        /* only maps processed at the destination can share updates */
+        mpr_obj_set_prop(maps[i], MPR_PROP_PROCESS_LOC, NULL, 1, MPR_INT32, &loc, 1);
+        mpr_obj_push(maps[i]);
+    }
+
+    /* wait until maps are established */
+    while (!done && !ready) {
+        poll_devs(10);
+        ready = 1;
+        for (i = 0; i < NUM_DSTS; i++)
+            ready = ready && mpr_map_get_is_ready(maps[i]);
+    }
+
+    /* allow time for the destinations to confirm the multicast group */
+    for (i = 0; i < 50 && !done; i++)
+        poll_devs(10);
+    return done;
+}
+
+int loop(void)
+{
+    int i, result = 0;
+    uint64_t bundles, msgs, msgs_before, coalesced;
+
+    mpr_dev_get_send_stats(src, &bundles, &msgs_before, &coalesced);
+
+    for (i = 0; i < iterations && !done; i++) {
+        mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &i);
+        ++sent;
+        poll_devs(10);
+    }
+    for (i = 0; i < 10; i++)
+        poll_devs(10);
+
+    mpr_dev_get_send_stats(src, &bundles, &msgs, &coalesced);
+    msgs -= msgs_before;
+    eprintf("Sent %d updates to %d destinations, %d messages were sent through links.\n",
+            sent, NUM_DSTS, (int)msgs);
+
+    for (i = 0; i < NUM_DSTS; i++) {
+        eprintf("Destination %d received %d updates, the last with value %d.\n", i,
+                received[i], last_value[i]);
+        if (received[i] != sent || last_value[i] != sent - 1) {
+            eprintf("Error: destination %d did not receive every update once.\n", i);
+            result = 1;
+        }
+    }
+    if (msgs) {
+        eprintf("Error: updates were sent through links instead of the multicast group.\n");
+        result = 1;
+    }
+    return result;
+}
+
+void segv(int sig)
+{
+    printf("\x1B[31m(SEGV)\n\x1B[0m");
+    exit(1);
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testmulticast.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        iterations = 50;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            i++;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGSEGV, segv);
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (wait_ready()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (setup_maps()) {
+        eprintf("Error initializing maps.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = loop();
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -340,7 +340,7 @@ int parse_and_eval(int expectation, int max_tok, int check, int exp_updates)
         result = 1;
         goto free;
     }
-    mpr_expr_realloc_eval_buffer(e, eval_buff);
+    mpr_expr_realloc_eval_buffer(e, eval_buff, 1);
     mpr_time_set(&time_in, MPR_NOW);
     for (i = 0; i < n_sources; i++) {
         mlen = mpr_expr_get_src_mlen(e, i);
@@ -0,0 +1,252 @@
+#include <mapper/mapper.h>
+#include "../src/mpr_time.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <poll.h>
+#include <signal.h>
+
+/* Test driving devices from an external event loop. Instead of calling mpr_dev_poll(), the file
+ * descriptors of both graphs are watched using poll() and mpr_graph_process_fds() is called when
+ * any of them is readable or the earliest timeout has elapsed. */
+
+#define MAX_FDS 32
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int period = 100;
+int use_epoll = 1;
+
+mpr_graph graphs[2] = {0, 0};
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+
+int sent = 0;
+int received = 0;
+int expected = -1;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value) {
+        eprintf("handler: Got %d\n", *(int*)value);
+        if (*(int*)value == expected)
+            received++;
+        else
+            eprintf(" expected %d\n", expected);
+    }
+}
+
+int setup_devs(const char *iface)
+{
+    int i, mn = 0, mx = 1;
+
+    src = mpr_dev_new("testreactor-send", 0);
+    dst = mpr_dev_new("testreactor-recv", 0);
+    if (!src || !dst)
+        return 1;
+    graphs[0] = mpr_obj_get_graph((mpr_obj)src);
+    graphs[1] = mpr_obj_get_graph((mpr_obj)dst);
+
+    for (i = 0; i < 2; i++) {
+        if (iface)
+            mpr_graph_set_interface(graphs[i], iface);
+        if (use_epoll && mpr_graph_set_use_epoll(graphs[i], 1)) {
+            eprintf("event-driven polling is not supported, using default engine.\n");
+            use_epoll = 0;
+        }
+    }
+    eprintf("devices created using interface %s.\n", mpr_graph_get_interface(graphs[0]));
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL,
+                          &mn, &mx, NULL, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_INT32, NULL,
+                          &mn, &mx, NULL, handler, MPR_SIG_UPDATE);
+    return !sendsig || !recvsig;
+}
+
+void cleanup_devs(void)
+{
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+    eprintf("ok\n");
+}
+
+/* Run the event loop for the given number of milliseconds. */
+void run_loop(int block_ms)
+{
+    struct pollfd pfds[MAX_FDS];
+    int i, num_fds, timeout, fds[MAX_FDS];
+    double end = mpr_get_current_time() + block_ms * 0.001, now;
+
+    do {
+        /* the set of descriptors may have changed during processing */
+        num_fds = 0;
+        timeout = block_ms;
+        for (i = 0; i < 2; i++) {
+            int j, num = mpr_graph_get_fds(graphs[i], fds, MAX_FDS - num_fds);
+            int graph_timeout = mpr_graph_get_timeout(graphs[i]);
+            for (j = 0; j < num && num_fds < MAX_FDS; j++) {
+                pfds[num_fds].fd = fds[j];
+                pfds[num_fds].events = POLLIN;
+                ++num_fds;
+            }
+            if (graph_timeout >= 0 && graph_timeout < timeout)
+                timeout = graph_timeout;
+        }
+        now = mpr_get_current_time();
+        if (now + timeout * 0.001 > end)
+            timeout = now < end ? (end - now) * 1000 : 0;
+
+        poll(pfds, num_fds, timeout);
+        for (i = 0; i < 2; i++)
+            mpr_graph_process_fds(graphs[i]);
+    } while (!done && mpr_get_current_time() < end);
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst)))
+        run_loop(25);
+    return done;
+}
+
+int setup_map(void)
+{
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_push(map);
+
+    /* wait until map is established */
+    while (!done && !mpr_map_get_is_ready(map))
+        run_loop(10);
+    return done;
+}
+
+void loop(void)
+{
+    const char *name = mpr_obj_get_prop_as_str((mpr_obj)sendsig, MPR_PROP_NAME, NULL);
+    while ((!terminate || sent < 50) && !done) {
+        eprintf("Updating signal %s to %d\n", name, sent);
+        expected = sent;
+        mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &sent);
+        sent++;
+        run_loop(period);
+
+        if (!verbose) {
+            printf("\r  Sent: %4i, Received: %4i   ", sent, received);
+            fflush(stdout);
+        }
+    }
+}
+
+void segv(int sig)
+{
+    printf("\x1B[31m(SEGV)\n\x1B[0m");
+    exit(1);
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testreactor.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--no-epoll use the default poll engine, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        period = 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--no-epoll") == 0)
+                            use_epoll = 0;
+                        else if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            i++;
+                            iface = argv[i];
+                        }
+                        j = len;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGSEGV, segv);
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (wait_ready()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (setup_map()) {
+        eprintf("Error initializing map.\n");
+        result = 1;
+        goto done;
+    }
+
+    loop();
+
+    if (sent != received) {
+        eprintf("Not all sent messages were received.\n");
+        eprintf("Updated value %d time%s and received %d of them.\n",
+                sent, sent == 1 ? "" : "s", received);
+        result = 1;
+    }
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,230 @@
+#include <mapper/mapper.h>
+#include "../src/mpr_time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+
+/* Test limiting the rate at which a device sends updates to a remote device. The source signal is
+ * updated much faster than the send policy allows, so most updates should be replaced by newer
+ * values while they are held, and the destination should still end up with the latest value. */
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 400;
+float max_rate = 20;
+float max_latency = 0.05;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+
+int sent = 0;
+int received = 0;
+int last_value = -1;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (!value)
+        return;
+    eprintf("handler: Got %d\n", *(int*)value);
+    if (*(int*)value <= last_value)
+        eprintf("  error: values received out of order\n");
+    last_value = *(int*)value;
+    ++received;
+}
+
+int setup_devs(const char *iface)
+{
+    int mn = 0, mx = 1000;
+
+    src = mpr_dev_new("testsendpolicy-send", 0);
+    dst = mpr_dev_new("testsendpolicy-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL,
+                          &mn, &mx, NULL, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_INT32, NULL,
+                          &mn, &mx, NULL, handler, MPR_SIG_UPDATE);
+    return !sendsig || !recvsig;
+}
+
+void cleanup_devs(void)
+{
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+    eprintf("ok\n");
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    return done;
+}
+
+int setup_map(void)
+{
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_push(map);
+
+    /* wait until map is established */
+    while (!done && !mpr_map_get_is_ready(map)) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+    return done;
+}
+
+int loop(void)
+{
+    int i;
+    uint64_t bundles, msgs, coalesced;
+    double elapsed, start = mpr_get_current_time();
+
+    mpr_dev_set_send_policy(src, max_rate, max_latency, 0);
+
+    for (i = 0; i < iterations && !done; i++) {
+        mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &i);
+        ++sent;
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 1);
+    }
+    elapsed = mpr_get_current_time() - start;
+
+    /* held updates should be sent within the maximum latency */
+    for (i = 0; i < 10; i++) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+
+    mpr_dev_get_send_stats(src, &bundles, &msgs, &coalesced);
+    eprintf("Sent %d updates in %g seconds as %d bundles, %d updates were coalesced.\n",
+            sent, elapsed, (int)bundles, (int)coalesced);
+    eprintf("Received %d updates, the last with value %d.\n", received, last_value);
+
+    if (last_value != sent - 1) {
+        eprintf("Error: the latest value was not received.\n");
+        return 1;
+    }
+    if (bundles > elapsed * max_rate + 2) {
+        eprintf("Error: bundles were sent faster than the maximum rate.\n");
+        return 1;
+    }
+    if (!coalesced || received + coalesced != sent) {
+        eprintf("Error: updates were not coalesced.\n");
+        return 1;
+    }
+    return 0;
+}
+
+void segv(int sig)
+{
+    printf("\x1B[31m(SEGV)\n\x1B[0m");
+    exit(1);
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testsendpolicy.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        iterations = 100;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            i++;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGSEGV, segv);
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (wait_ready()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (setup_map()) {
+        eprintf("Error initializing map.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = loop();
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -42,6 +42,27 @@ int done = 0;
 double times[100];
 float expected[NUM_INST];
 
+/* Modes using shared memory are skipped if it is not supported. Instanced modes are run first since
+ * switching to non-instanced updates releases the other instances. */
+typedef struct {
+    const char *name;
+    int use_inst;
+    int use_shm;
+} test_mode;
+
+test_mode modes[] = {
+    { "instanced, network",             1, 0 },
+    { "instanced, shared memory",       1, 1 },
+    { "non-instanced, network",         0, 0 },
+    { "non-instanced, shared memory",   0, 1 }
+};
+int shm_supported = 0;
+
+test_mode *get_mode(int idx)
+{
+    return &modes[shm_supported ? idx : idx * 2];
+}
+
 void switch_modes(void);
 void print_results(void);
 
@@ -229,17 +250,15 @@ void switch_modes(void)
         return;
     }
 
-    switch (mode)
-    {
-        case 0:
-            use_inst = 1;
-            break;
-        case 1:
-            use_inst = 0;
-            for (i = 1; i < 10; i++) {
-                mpr_sig_release_inst(sendsig, i);
-            }
-            break;
+    if (use_inst && !get_mode(mode)->use_inst) {
+        for (i = 1; i < 10; i++) {
+            mpr_sig_release_inst(sendsig, i);
+        }
+    }
+    use_inst = get_mode(mode)->use_inst;
+    if (shm_supported) {
+        mpr_dev_set_use_shm(dst, get_mode(mode)->use_shm);
+        mpr_dev_set_use_shm(src, get_mode(mode)->use_shm);
     }
 
     times[mode * numTrials + trial] = mpr_get_current_time();
@@ -268,7 +287,7 @@ void print_results(void)
     eprintf("\nRESULTS OF SPEED TEST:\n");
     for (i = 0; i < numModes; i++) {
         float bestTime = times[i * numTrials];
-        eprintf("MODE %i\n", i);
+        eprintf("MODE %i (%s)\n", i, get_mode(i)->name);
         for (j = 0; j < numTrials; j++) {
             eprintf("trial %i: %i messages processed in %f seconds\n", j,
                     iterations, times[i * numTrials + j]);
@@ -337,6 +356,14 @@ int main(int argc, char **argv)
         goto done;
     }
 
+    /* start with shared memory disabled so that the network path is measured first */
+    if (!mpr_dev_set_use_shm(src, 1)) {
+        shm_supported = 1;
+        numModes = 4;
+    }
+    mpr_dev_set_use_shm(src, 0);
+    mpr_dev_set_use_shm(dst, 0);
+
     if (wait_ready()) {
         eprintf("Device registration aborted.\n");
         result = 1;
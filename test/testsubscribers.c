@@ -0,0 +1,215 @@
+#include <mapper/mapper.h>
+#include "../src/mpr_time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+
+/* Test sending device metadata to many subscribers. Half of the subscribing graphs renew their
+ * subscriptions automatically and the others hold a short lease, so after the lease has expired
+ * only the renewing graphs should receive updated properties. */
+
+#define NUM_GRAPHS 8
+#define LEASE_SEC 2
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+
+mpr_dev dev = 0;
+mpr_graph graphs[NUM_GRAPHS];
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+int setup_graphs(const char *iface)
+{
+    int i;
+
+    dev = mpr_dev_new("testsubscribers", 0);
+    if (!dev)
+        return 1;
+    if (iface)
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dev), iface);
+    eprintf("device created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)dev)));
+
+    for (i = 0; i < NUM_GRAPHS; i++) {
+        if (!(graphs[i] = mpr_graph_new(MPR_DEV)))
+            return 1;
+        if (iface)
+            mpr_graph_set_interface(graphs[i], iface);
+    }
+    return 0;
+}
+
+void cleanup_graphs(void)
+{
+    int i;
+    eprintf("Freeing graphs.. ");
+    fflush(stdout);
+    for (i = 0; i < NUM_GRAPHS; i++) {
+        if (graphs[i])
+            mpr_graph_free(graphs[i]);
+    }
+    if (dev)
+        mpr_dev_free(dev);
+    eprintf("ok\n");
+}
+
+void poll_all(int block_ms)
+{
+    int i;
+    mpr_dev_poll(dev, block_ms);
+    for (i = 0; i < NUM_GRAPHS; i++)
+        mpr_graph_poll(graphs[i], 0);
+}
+
+mpr_dev get_remote_dev(mpr_graph graph)
+{
+    mpr_id id = mpr_obj_get_prop_as_int64((mpr_obj)dev, MPR_PROP_ID, NULL);
+    return (mpr_dev)mpr_graph_get_obj(graph, id, MPR_DEV);
+}
+
+/* Return the number of graphs that have recorded the latest value of the device property. */
+int count_updated(int value)
+{
+    int i, count = 0;
+    for (i = 0; i < NUM_GRAPHS; i++) {
+        mpr_dev remote = get_remote_dev(graphs[i]);
+        if (remote && mpr_obj_get_prop_as_int32((mpr_obj)remote, MPR_PROP_EXTRA, "foo") == value)
+            ++count;
+    }
+    return count;
+}
+
+int set_prop_and_wait(int value, int expected)
+{
+    int i, count = 0;
+    mpr_obj_set_prop((mpr_obj)dev, MPR_PROP_EXTRA, "foo", 1, MPR_INT32, &value, 1);
+    mpr_obj_push((mpr_obj)dev);
+    for (i = 0; i < 100 && !done; i++) {
+        poll_all(10);
+        if ((count = count_updated(value)) >= expected)
+            break;
+    }
+    /* keep polling in case any unexpected updates arrive */
+    for (i = 0; i < 20 && !done; i++)
+        poll_all(10);
+    count = count_updated(value);
+    eprintf("%d graphs received property value %d, expected %d.\n", count, value, expected);
+    return count != expected;
+}
+
+int loop(void)
+{
+    int i, ready = 0;
+    double end;
+
+    while (!done && !ready) {
+        poll_all(25);
+        ready = mpr_dev_get_is_ready(dev);
+        for (i = 0; i < NUM_GRAPHS && ready; i++)
+            ready = get_remote_dev(graphs[i]) != 0;
+    }
+    if (done)
+        return 1;
+
+    /* every graph should receive updates while subscribed */
+    if (set_prop_and_wait(1, NUM_GRAPHS))
+        return 1;
+
+    /* send the remaining updates with batched I/O where it is supported */
+    if (mpr_graph_set_use_batch_io(mpr_obj_get_graph((mpr_obj)dev), 1))
+        eprintf("Batched I/O is not supported, sending to each subscriber in turn.\n");
+
+    /* replace the leases of half of the subscriptions with short ones */
+    for (i = 0; i < NUM_GRAPHS; i += 2)
+        mpr_graph_subscribe(graphs[i], get_remote_dev(graphs[i]), MPR_DEV, LEASE_SEC);
+    if (set_prop_and_wait(2, NUM_GRAPHS))
+        return 1;
+
+    /* expired subscriptions are removed during device housekeeping */
+    eprintf("Waiting for leases to expire...\n");
+    end = mpr_get_current_time() + LEASE_SEC + 4;
+    while (!done && mpr_get_current_time() < end)
+        poll_all(50);
+
+    return set_prop_and_wait(3, NUM_GRAPHS / 2);
+}
+
+void segv(int sig)
+{
+    printf("\x1B[31m(SEGV)\n\x1B[0m");
+    exit(1);
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testsubscribers.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            i++;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGSEGV, segv);
+    signal(SIGINT, ctrlc);
+
+    if (setup_graphs(iface)) {
+        eprintf("Error initializing device and graphs.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = loop();
+
+  done:
+    cleanup_graphs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
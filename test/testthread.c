@@ -174,8 +174,9 @@ void *update_thread(void *context)
     mpr_dev dev2 = mpr_dev_new("foo", gf);
     while ((!terminate || sent < 50) && !done) {
         eprintf("Updating signal %s to %d\n", name, sent);
-        mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &sent);
+        /* the polling thread may handle the update as soon as it is set */
         expected = sent;
+        mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &sent);
         sent++;
         mpr_dev_update_maps(src);
         mpr_dev_poll(src, period);
@@ -242,8 +243,9 @@ void loop2(void)
 
     while ((!terminate || sent < 100) && !done) {
         eprintf("Updating signal %s to %d\n", name, sent);
-        mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &sent);
+        /* the polling thread may handle the update as soon as it is set */
         expected = sent;
+        mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &sent);
         sent++;
         if (shared_graph) {
             /* sleep here instead of calling poll on shared graph */
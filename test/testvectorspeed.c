@@ -0,0 +1,219 @@
+#include "../src/expression.h"
+#include "../src/mpr_time.h"
+#include "../src/value.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <mapper/mapper.h>
+
+/* Benchmark for expression evaluation on vector signals. Each expression is evaluated for a range
+ * of vector lengths and the mean evaluation time is reported per evaluation and per element. The
+ * final output is also checked against a reference computed in C. */
+
+#define MAX_VEC_LEN 48
+
+int verbose = 1;
+int iterations = 20000;
+
+typedef enum {
+    REF_SCALE,
+    REF_SQUARE,
+    REF_RATIO,
+    REF_SUM,
+    REF_DOT,
+    REF_NORM,
+    REF_SIN
+} ref_type;
+
+static struct {
+    const char *str;
+    ref_type ref;
+    int reduces;
+} exprs[] = {
+    { "y=x*0.5+1;",     REF_SCALE,  0 },
+    { "y=x*x-x;",       REF_SQUARE, 0 },
+    { "y=x/(x+1);",     REF_RATIO,  0 },
+    { "y=sum(x);",      REF_SUM,    1 },
+    { "y=dot(x,x);",    REF_DOT,    1 },
+    { "y=norm(x);",     REF_NORM,   1 },
+    { "y=sin(x);",      REF_SIN,    0 },
+};
+#define NUM_EXPRS (sizeof(exprs) / sizeof(exprs[0]))
+
+static int vec_lens[] = { 1, 2, 4, 8, 16, 32, 48 };
+#define NUM_VEC_LENS (sizeof(vec_lens) / sizeof(vec_lens[0]))
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static void reference(ref_type ref, const double *in, double *out, int len)
+{
+    int i;
+    double acc = 0;
+    switch (ref) {
+        case REF_SCALE:
+            for (i = 0; i < len; i++)
+                out[i] = in[i] * 0.5 + 1;
+            break;
+        case REF_SQUARE:
+            for (i = 0; i < len; i++)
+                out[i] = in[i] * in[i] - in[i];
+            break;
+        case REF_RATIO:
+            for (i = 0; i < len; i++)
+                out[i] = in[i] / (in[i] + 1);
+            break;
+        case REF_SUM:
+            for (i = 0; i < len; i++)
+                acc += in[i];
+            out[0] = acc;
+            break;
+        case REF_DOT:
+            for (i = 0; i < len; i++)
+                acc += in[i] * in[i];
+            out[0] = acc;
+            break;
+        case REF_NORM:
+            for (i = 0; i < len; i++)
+                acc += in[i] * in[i];
+            out[0] = sqrt(acc);
+            break;
+        case REF_SIN:
+            for (i = 0; i < len; i++)
+                out[i] = sin(in[i]);
+            break;
+    }
+}
+
+static int check(mpr_type type, void *result, const double *expected, int len)
+{
+    int i;
+    double tol = MPR_FLT == type ? 1e-4 : 1e-10;
+    for (i = 0; i < len; i++) {
+        double got = MPR_FLT == type ? ((float*)result)[i] : ((double*)result)[i];
+        if (fabs(got - expected[i]) > tol * (1 + fabs(expected[i]))) {
+            eprintf("\n  mismatch at element %d: got %g, expected %g\n", i, got, expected[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int run_test(const char *str, ref_type ref, int reduces, mpr_type type, unsigned int len)
+{
+    mpr_expr e;
+    mpr_expr_eval_buffer buff;
+    mpr_value src, dst;
+    mpr_time t;
+    unsigned int dst_len = reduces ? 1 : len;
+    float src_flt[MAX_VEC_LEN];
+    double src_dbl[MAX_VEC_LEN], expected[MAX_VEC_LEN], then, elapsed;
+    int i, result = 0;
+
+    for (i = 0; i < len; i++) {
+        src_dbl[i] = (i % 17) * 0.125 + 0.5;
+        src_flt[i] = (float)src_dbl[i];
+    }
+
+    e = mpr_expr_new_from_str(str, 1, &type, &len, 1, &type, &dst_len);
+    if (!e) {
+        eprintf("failed to parse expression '%s'\n", str);
+        return 1;
+    }
+    buff = mpr_expr_new_eval_buffer(e);
+    src = mpr_value_new(len, type, mpr_expr_get_src_mlen(e, 0), 1);
+    dst = mpr_value_new(dst_len, type, mpr_expr_get_dst_mlen(e, 0), 1);
+
+    mpr_time_set(&t, MPR_NOW);
+    then = mpr_get_current_time();
+    for (i = 0; i < iterations; i++) {
+        mpr_value_set_next(src, 0, MPR_FLT == type ? (void*)src_flt : (void*)src_dbl, t);
+        if (!(mpr_expr_eval(e, buff, &src, NULL, dst, &t, 0) & EXPR_UPDATE)) {
+            eprintf("evaluation failed for expression '%s'\n", str);
+            result = 1;
+            break;
+        }
+    }
+    elapsed = mpr_get_current_time() - then;
+
+    if (!result) {
+        if (MPR_FLT == type) {
+            /* compute the reference from the rounded inputs */
+            for (i = 0; i < len; i++)
+                src_dbl[i] = src_flt[i];
+        }
+        reference(ref, src_dbl, expected, len);
+        result = check(type, mpr_value_get_value(dst, 0, 0), expected, dst_len);
+        eprintf("  %3d  %10.1f  %10.2f\n", len, elapsed / iterations * 1e9,
+                elapsed / iterations / len * 1e9);
+    }
+
+    mpr_value_free(src);
+    mpr_value_free(dst);
+    mpr_expr_free_eval_buffer(buff);
+    mpr_expr_free(e);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, k, result = 0;
+    mpr_type types[] = { MPR_FLT, MPR_DBL };
+
+    /* process flags for -v verbose, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testvectorspeed.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--iterations <int> (default %d)\n",
+                               iterations);
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iterations")==0 && argc>i+1) {
+                            ++i;
+                            iterations = atoi(argv[i]);
+                        }
+                        j = len;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < NUM_EXPRS; i++) {
+        for (j = 0; j < 2; j++) {
+            eprintf("Expression '%s' (type '%c', %d iterations)\n", exprs[i].str, types[j],
+                    iterations);
+            eprintf("  len     ns/eval   ns/element\n");
+            for (k = 0; k < NUM_VEC_LENS; k++) {
+                if (run_test(exprs[i].str, exprs[i].ref, exprs[i].reduces, types[j], vec_lens[k]))
+                    result = 1;
+            }
+        }
+    }
+
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}